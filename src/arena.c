@@ -0,0 +1,297 @@
+/**
+ * @file      arena.c
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     Implementation of arena (slab) allocator module. It includes
+ *              1. creating an arena and releasing all its memory at once
+ *              2. allocating a block of memory from the arena
+ *              3. returning a block to the arena so it can be reused
+ *              4. reporting the allocation statistics
+ *            Block sizes are rounded up to 16 bytes. Blocks up to 1 KiB are
+ *            in a size class, a freed block goes to the free list of its
+ *            class and is reused first. Otherwise, blocks are carved from
+ *            the current chunk, and a new chunk is allocated once it is full.
+ *            Larger blocks get a chunk of their own, which is only released
+ *            with the arena.
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#include "arena.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <assert.h>
+
+
+// ============================================================================
+// == | Constant Definitions
+// ============================================================================
+#define ARENA_ALIGN           16
+#define NUM_SIZE_CLASSES      64
+#define MAX_CLASS_SIZE        (ARENA_ALIGN * NUM_SIZE_CLASSES)
+#define ROUND_UP_ALIGN(size)  (((size) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+#define BYTES_PER_KIB         1024
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+typedef struct arena_chunk ArenaChunk;
+/**
+ * @brief  A chunk of memory the blocks are carved from, the chunks of an
+ *         arena are linked. The blocks start after the chunk header
+ */
+struct arena_chunk {
+    ArenaChunk *next;
+};
+
+
+typedef struct free_block FreeBlock;
+/**
+ * @brief  A freed block, linked in the free list of its size class
+ */
+struct free_block {
+    FreeBlock *next;
+};
+
+
+/**
+ * @brief  An arena include its chunks, the free space left in the current
+ *         chunk, the size of a chunk, the free list of each size class, and
+ *         the allocation statistics
+ */
+struct arena {
+    ArenaChunk *chunks;
+    char *pos;
+    char *end;
+    int chunk_size;
+    FreeBlock *free_lists[NUM_SIZE_CLASSES];
+    int num_chunks;
+    long chunk_bytes;
+    long allocs;
+    long reused;
+    long frees;
+    long live_bytes;
+    long peak_live_bytes;
+};
+
+
+// ============================================================================
+// == | Function Prototypes
+// ============================================================================
+// Allocate a new chunk with at least the given free space
+char *arena_new_chunk(Arena *arena, int size);
+
+
+// ============================================================================
+// == | Module Functions
+// ============================================================================
+/**
+ * @brief  Create a new empty arena
+ *
+ * @param  chunk_size   the size of each chunk the blocks are carved from
+ * @return              the pointer of new arena
+ */
+Arena *new_Arena(int chunk_size) {
+
+    assert(chunk_size > MAX_CLASS_SIZE);
+
+    Arena *arena = (Arena *)malloc(sizeof *arena);
+    if (arena == NULL) {
+        fprintf(stderr, "Error: new_Arena() malloc returned NULL\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Initalise value of the arena
+    arena->chunks     = NULL;
+    arena->pos        = NULL;
+    arena->end        = NULL;
+    arena->chunk_size = chunk_size;
+    for (int i = 0; i < NUM_SIZE_CLASSES; i++) {
+        arena->free_lists[i] = NULL;
+    }
+    arena->num_chunks      = 0;
+    arena->chunk_bytes     = 0;
+    arena->allocs          = 0;
+    arena->reused          = 0;
+    arena->frees           = 0;
+    arena->live_bytes      = 0;
+    arena->peak_live_bytes = 0;
+
+    return arena;
+}
+
+
+/**
+ * @brief  Release all memory of an arena, every block allocated from it
+ *         is no longer valid
+ *
+ * @param  arena  an arena
+ */
+void free_Arena(Arena *arena) {
+
+    // Error if the arena does not initalise
+    assert(arena != NULL);
+
+    ArenaChunk *chunk = arena->chunks;
+    while (chunk != NULL) {
+        ArenaChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    arena->chunks = NULL;
+
+    free(arena);
+    arena = NULL;
+}
+
+
+/**
+ * @brief  Allocate a block of memory from an arena. A freed block of the
+ *         same size class is reused first
+ *
+ * @param  arena  an arena
+ * @param  size   the size of the block
+ * @return        the block (aligned to 16 bytes)
+ */
+void *arena_alloc(Arena *arena, int size) {
+
+    assert(arena != NULL);
+    assert(size > 0);
+
+    int block_size = ROUND_UP_ALIGN(size);
+    char *block;
+
+    arena->allocs++;
+    arena->live_bytes += block_size;
+    if (arena->live_bytes > arena->peak_live_bytes) {
+        arena->peak_live_bytes = arena->live_bytes;
+    }
+
+    if (block_size > MAX_CLASS_SIZE) {
+        // A large block gets a chunk of its own
+        return arena_new_chunk(arena, block_size);
+    }
+
+    // Reuse a freed block of the same size class
+    int size_class = block_size / ARENA_ALIGN - 1;
+    if (arena->free_lists[size_class] != NULL) {
+        FreeBlock *free_block = arena->free_lists[size_class];
+        arena->free_lists[size_class] = free_block->next;
+        arena->reused++;
+        return free_block;
+    }
+
+    // Otherwise, carve it from the current chunk
+    if (arena->end - arena->pos < block_size) {
+        arena->pos = arena_new_chunk(arena, arena->chunk_size);
+        arena->end = arena->pos + arena->chunk_size;
+    }
+    block = arena->pos;
+    arena->pos += block_size;
+
+    return block;
+}
+
+
+/**
+ * @brief  Return a block of memory to an arena so it can be reused
+ *
+ * @param  arena  an arena
+ * @param  block  a block allocated from the arena
+ * @param  size   the size the block was allocated with
+ */
+void arena_free(Arena *arena, void *block, int size) {
+
+    assert(arena != NULL);
+
+    if (block == NULL) {
+        return;
+    }
+
+    int block_size = ROUND_UP_ALIGN(size);
+
+    arena->frees++;
+    arena->live_bytes -= block_size;
+
+    // A large block stays in its chunk until the arena is released
+    if (block_size > MAX_CLASS_SIZE) {
+        return;
+    }
+
+    int size_class = block_size / ARENA_ALIGN - 1;
+    FreeBlock *free_block = (FreeBlock *)block;
+    free_block->next = arena->free_lists[size_class];
+    arena->free_lists[size_class] = free_block;
+}
+
+
+/**
+ * @brief  Add the allocation statistics of an arena to the total
+ *         (e.g. of the arenas of all threads)
+ *
+ * @param  arena  an arena
+ * @param  total  the statistics added to
+ */
+void add_arena_stats(Arena *arena, ArenaStats *total) {
+
+    assert(arena != NULL);
+    assert(total != NULL);
+
+    total->num_chunks      += arena->num_chunks;
+    total->chunk_bytes     += arena->chunk_bytes;
+    total->allocs          += arena->allocs;
+    total->reused          += arena->reused;
+    total->frees           += arena->frees;
+    total->peak_live_bytes += arena->peak_live_bytes;
+}
+
+
+/**
+ * @brief  Print out the allocation statistics of arenas
+ *
+ * @param  stats  the statistics of the arenas
+ * @param  name   the name of the arenas
+ * @param  fp     the file to print into
+ */
+void print_arena_stats(ArenaStats *stats, char *name, FILE *fp) {
+
+    assert(stats != NULL);
+
+    fprintf(fp, "%s arena: %ld allocs (%ld reused), %ld frees, "
+                "%ld KiB in %d chunks, peak %ld KiB live\n",
+            name, stats->allocs, stats->reused, stats->frees,
+            stats->chunk_bytes / BYTES_PER_KIB, stats->num_chunks,
+            stats->peak_live_bytes / BYTES_PER_KIB);
+}
+
+
+// ============================================================================
+// == | Auxillary Functions
+// ============================================================================
+/**
+ * @brief  Allocate a new chunk with at least the given free space,
+ *         and link it into the chunks of the arena
+ *
+ * @param  arena  an arena
+ * @param  size   the free space needed
+ * @return        the start of the free space in the new chunk
+ */
+char *arena_new_chunk(Arena *arena, int size) {
+
+    // The chunk header takes one aligned unit, so the blocks are aligned
+    ArenaChunk *chunk = (ArenaChunk *)malloc(ARENA_ALIGN + size);
+    if (chunk == NULL) {
+        fprintf(stderr, "Error: arena_new_chunk() malloc returned NULL\n");
+        exit(EXIT_FAILURE);
+    }
+
+    chunk->next   = arena->chunks;
+    arena->chunks = chunk;
+    arena->num_chunks++;
+    arena->chunk_bytes += ARENA_ALIGN + size;
+
+    return (char *)chunk + ARENA_ALIGN;
+}
@@ -0,0 +1,64 @@
+/**
+ * @file      arena.h
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     Arena (slab) allocator module. It includes
+ *              1. creating an arena and releasing all its memory at once
+ *              2. allocating a block of memory from the arena
+ *              3. returning a block to the arena so it can be reused
+ *              4. reporting the allocation statistics
+ *            The blocks are carved from large chunks, and freed blocks are
+ *            kept in a free list for their size class, so small records
+ *            with the same lifetime do not each need a malloc and free.
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdio.h>
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+typedef struct arena Arena;
+
+typedef struct arena_stats ArenaStats;
+/**
+ * @brief  The allocation statistics of one or more arenas
+ */
+struct arena_stats {
+    int num_chunks;
+    long chunk_bytes;
+    long allocs;
+    long reused;
+    long frees;
+    long peak_live_bytes;
+};
+
+
+// ============================================================================
+// == | Module Functions
+// ============================================================================
+// Create a new empty arena
+Arena *new_Arena(int chunk_size);
+
+// Release all memory of an arena (every block allocated from it)
+void free_Arena(Arena *arena);
+
+// Allocate a block of memory from an arena
+void *arena_alloc(Arena *arena, int size);
+
+// Return a block of memory to an arena so it can be reused
+void arena_free(Arena *arena, void *block, int size);
+
+// Add the allocation statistics of an arena to the total
+void add_arena_stats(Arena *arena, ArenaStats *total);
+
+// Print out the allocation statistics of arenas
+void print_arena_stats(ArenaStats *stats, char *name, FILE *fp);
+
+
+#endif
@@ -0,0 +1,429 @@
+/**
+ * @file      bloomFilter.c
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     Implementation of blocked Bloom filter module. It includes
+ *              1. creating a filter sized for a number of keys and a target
+ *                 false positive rate, and destroying it
+ *              2. adding a key (a 64-bit hash value), and checking if a key
+ *                 may be added before
+ *              3. saving the filter into a file, and loading it back
+ *              4. reporting the filter statistics
+ *            The filter is an array of blocks of one cache line (512 bits).
+ *            The key is mixed once more, the high bits choose the block and
+ *            the low bits give the bits set in the block by double hashing.
+ *            The bits are set with atomic or, so adding a key and checking
+ *            it again needs no lock (two threads adding the same key at once
+ *            may both find it new, the caller keeps them apart if it
+ *            matters). The blocks are mapped anonymously, so the pages of a
+ *            large filter are only zeroed once they are used
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#include "bloomFilter.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <assert.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+
+
+// ============================================================================
+// == | Constant Definitions
+// ============================================================================
+#define BLOCK_BITS              512
+#define BLOCK_WORDS             (BLOCK_BITS / 64)
+#define MIN_HASHES              1
+#define MAX_HASHES              16
+#define BLOOM_FILE_MAGIC        "CRWLBLM1"
+#define BLOOM_MAGIC_LEN         8
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+/**
+ * @brief  A Bloom filter include its blocks (and the bytes mapped for them),
+ *         the number of blocks, the number of bits set for each key, the
+ *         number of keys added, and the number of keys it reported as added
+ *         before but were not (once the caller finds out)
+ */
+struct bloom_filter {
+    uint64_t *blocks;
+    size_t bytes;
+    uint64_t num_blocks;
+    int num_hashes;
+    long count;
+    long false_positives;
+};
+
+
+typedef struct bloom_file_header BloomFileHeader;
+/**
+ * @brief  The header of a saved filter, it is followed by the blocks
+ */
+struct bloom_file_header {
+    char magic[BLOOM_MAGIC_LEN];
+    uint64_t num_blocks;
+    uint32_t num_hashes;
+    uint32_t reserved;
+    uint64_t count;
+};
+
+
+// ============================================================================
+// == | Function Prototypes
+// ============================================================================
+// Create a new empty filter with the given number of blocks and hashes
+BloomFilter *alloc_BloomFilter(uint64_t num_blocks, int num_hashes);
+
+// Mix the bits of a key, so every bit depends on every bit of the key
+uint64_t mix_bloom_key(uint64_t key);
+
+// Get the first word of the block of a mixed key
+uint64_t *get_bloom_block(BloomFilter *filter, uint64_t mixed);
+
+// Estimate the false positive rate from the bits set
+double estimate_false_positive_rate(BloomFilter *filter);
+
+
+// ============================================================================
+// == | Module Functions
+// ============================================================================
+/**
+ * @brief  Create a new empty filter sized for a number of keys, so the
+ *         false positive rate stays around the target once they are added
+ *
+ * @param  num_keys   the number of keys expected
+ * @param  fp_rate    the target false positive rate (between 0 and 1)
+ * @return            the pointer of new filter
+ */
+BloomFilter *new_BloomFilter(long num_keys, double fp_rate) {
+
+    assert(num_keys > 0);
+    assert(fp_rate > 0 && fp_rate < 1);
+
+    // The optimal bits per key, and the bits set for each key
+    double bits_per_key = -log(fp_rate) / (M_LN2 * M_LN2);
+    int num_hashes = (int)lround(bits_per_key * M_LN2);
+    if (num_hashes < MIN_HASHES) {
+        num_hashes = MIN_HASHES;
+    }
+    if (num_hashes > MAX_HASHES) {
+        num_hashes = MAX_HASHES;
+    }
+
+    double num_bits = ceil(bits_per_key * num_keys);
+    uint64_t num_blocks = (uint64_t)ceil(num_bits / BLOCK_BITS);
+
+    return alloc_BloomFilter(num_blocks, num_hashes);
+}
+
+
+/**
+ * @brief  Destroy and free the memory associated with a filter
+ *
+ * @param  filter   a filter
+ */
+void free_BloomFilter(BloomFilter *filter) {
+
+    assert(filter != NULL);
+
+    munmap(filter->blocks, filter->bytes);
+    filter->blocks = NULL;
+
+    free(filter);
+    filter = NULL;
+}
+
+
+/**
+ * @brief  Add a key to the filter by setting its bits
+ *
+ * @param  filter   a filter
+ * @param  key      the key (a well spread hash value)
+ * @return true     If the key is new (one of its bits was not set)
+ * @return false    If the key may be added before (all its bits were set)
+ */
+bool bloom_filter_add(BloomFilter *filter, uint64_t key) {
+
+    uint64_t mixed  = mix_bloom_key(key);
+    uint64_t *block = get_bloom_block(filter, mixed);
+    uint32_t bit    = (uint32_t)mixed;
+    uint32_t step   = (uint32_t)(mixed >> 16) | 1;
+    bool isNew      = false;
+
+    for (int i = 0; i < filter->num_hashes; i++) {
+        uint32_t pos  = bit % BLOCK_BITS;
+        uint64_t mask = 1ULL << (pos % 64);
+
+        if ((__atomic_load_n(&block[pos / 64], __ATOMIC_RELAXED) & mask) == 0) {
+            __atomic_fetch_or(&block[pos / 64], mask, __ATOMIC_RELAXED);
+            isNew = true;
+        }
+        bit += step;
+    }
+
+    if (isNew) {
+        __atomic_add_fetch(&filter->count, 1, __ATOMIC_RELAXED);
+    }
+
+    return isNew;
+}
+
+
+/**
+ * @brief  Check if a key may be added to the filter before
+ *
+ * @param  filter   a filter
+ * @param  key      the key (a well spread hash value)
+ * @return true     If the key may be added before (all its bits are set)
+ * @return false    If the key is not added before
+ */
+bool bloom_filter_contains(BloomFilter *filter, uint64_t key) {
+
+    uint64_t mixed  = mix_bloom_key(key);
+    uint64_t *block = get_bloom_block(filter, mixed);
+    uint32_t bit    = (uint32_t)mixed;
+    uint32_t step   = (uint32_t)(mixed >> 16) | 1;
+
+    for (int i = 0; i < filter->num_hashes; i++) {
+        uint32_t pos  = bit % BLOCK_BITS;
+        uint64_t mask = 1ULL << (pos % 64);
+
+        if ((__atomic_load_n(&block[pos / 64], __ATOMIC_RELAXED) & mask) == 0) {
+            return false;
+        }
+        bit += step;
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief  Count a key the filter reported as added before, but the caller
+ *         found it was not (e.g. checking an exact store). It is counted as
+ *         a key added as well
+ *
+ * @param  filter   a filter
+ */
+void bloom_filter_add_false_positive(BloomFilter *filter) {
+
+    __atomic_add_fetch(&filter->false_positives, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&filter->count, 1, __ATOMIC_RELAXED);
+}
+
+
+/**
+ * @brief  Save the filter into a file: a header and the blocks
+ *
+ * @param  filter   a filter
+ * @param  path     the path of the file
+ * @return true     If the filter is saved
+ * @return false    If the file cannot be written
+ */
+bool save_BloomFilter(BloomFilter *filter, char *path) {
+
+    assert(filter != NULL);
+    assert(path != NULL);
+
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        return false;
+    }
+
+    BloomFileHeader header;
+    memset(&header, 0, sizeof header);
+    memcpy(header.magic, BLOOM_FILE_MAGIC, BLOOM_MAGIC_LEN);
+    header.num_blocks = filter->num_blocks;
+    header.num_hashes = (uint32_t)filter->num_hashes;
+    header.count      = (uint64_t)filter->count;
+
+    size_t size = filter->num_blocks * BLOCK_WORDS;
+    bool isSaved = fwrite(&header, sizeof header, 1, file) == 1
+                   && fwrite(filter->blocks, sizeof(uint64_t), size, file)
+                      == size;
+
+    if (fclose(file) != 0) {
+        isSaved = false;
+    }
+
+    return isSaved;
+}
+
+
+/**
+ * @brief  Load a filter saved into a file
+ *
+ * @param  path     the path of the file
+ * @return          the pointer of the filter loaded, or NULL if the file
+ *                  cannot be read or is not a saved filter
+ */
+BloomFilter *load_BloomFilter(char *path) {
+
+    BloomFileHeader header;
+
+    assert(path != NULL);
+
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+
+    if (fread(&header, sizeof header, 1, file) != 1
+        || memcmp(header.magic, BLOOM_FILE_MAGIC, BLOOM_MAGIC_LEN) != 0
+        || header.num_blocks == 0 || header.num_hashes < MIN_HASHES
+        || header.num_hashes > MAX_HASHES) {
+        fclose(file);
+        return NULL;
+    }
+
+    BloomFilter *filter = alloc_BloomFilter(header.num_blocks,
+                                            (int)header.num_hashes);
+    filter->count = (long)header.count;
+
+    size_t size = filter->num_blocks * BLOCK_WORDS;
+    if (fread(filter->blocks, sizeof(uint64_t), size, file) != size) {
+        free_BloomFilter(filter);
+        filter = NULL;
+    }
+
+    fclose(file);
+
+    return filter;
+}
+
+
+/**
+ * @brief  Print out the size of the filter (and the memory per key), the
+ *         number of keys added, the false positive rate estimated from the
+ *         bits set, and the false positives found
+ *
+ * @param  filter   a filter
+ * @param  fp       the file to print into
+ */
+void print_bloom_filter_stats(BloomFilter *filter, FILE *fp) {
+
+    assert(filter != NULL);
+
+    long count = __atomic_load_n(&filter->count, __ATOMIC_RELAXED);
+    long false_positives = __atomic_load_n(&filter->false_positives,
+                                           __ATOMIC_RELAXED);
+    size_t bytes = filter->num_blocks * BLOCK_WORDS * sizeof(uint64_t);
+
+    fprintf(fp, "filter: %ld urls, %zu bytes (%.1f bits per url), "
+                "%d hashes, estimated fp rate %.6f, %ld false positives\n",
+            count, bytes, count > 0 ? (double)bytes * 8 / count : 0.0,
+            filter->num_hashes, estimate_false_positive_rate(filter),
+            false_positives);
+}
+
+
+// ============================================================================
+// == | Auxillary Functions
+// ============================================================================
+/**
+ * @brief  Create a new empty filter with the given number of blocks and
+ *         bits set for each key. The blocks are mapped anonymously (zeroed
+ *         once they are used)
+ *
+ * @param  num_blocks   the number of blocks
+ * @param  num_hashes   the number of bits set for each key
+ * @return              the pointer of new filter
+ */
+BloomFilter *alloc_BloomFilter(uint64_t num_blocks, int num_hashes) {
+
+    BloomFilter *filter = (BloomFilter *)malloc(sizeof *filter);
+    if (filter == NULL) {
+        fprintf(stderr, "Error: alloc_BloomFilter() malloc returned NULL\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (num_blocks == 0) {
+        num_blocks = 1;
+    }
+    size_t bytes = num_blocks * BLOCK_WORDS * sizeof(uint64_t);
+
+    void *blocks = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (blocks == MAP_FAILED) {
+        fprintf(stderr, "Error: alloc_BloomFilter() mmap failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Initalise value of the filter
+    filter->blocks          = (uint64_t *)blocks;
+    filter->bytes           = bytes;
+    filter->num_blocks      = num_blocks;
+    filter->num_hashes      = num_hashes;
+    filter->count           = 0;
+    filter->false_positives = 0;
+
+    return filter;
+}
+
+
+/**
+ * @brief  Mix the bits of a key (the finaliser of SplitMix64), so the block
+ *         and the bits of similar keys are not related
+ *
+ * @param  key    the key
+ * @return        the mixed key
+ */
+uint64_t mix_bloom_key(uint64_t key) {
+
+    key ^= key >> 30;
+    key *= 0xbf58476d1ce4e5b9ULL;
+    key ^= key >> 27;
+    key *= 0x94d049bb133111ebULL;
+    key ^= key >> 31;
+
+    return key;
+}
+
+
+/**
+ * @brief  Get the first word of the block of a mixed key, chosen by its
+ *         high 32 bits scaled to the number of blocks
+ *
+ * @param  filter   a filter
+ * @param  mixed    the mixed key
+ * @return          the first word of the block
+ */
+uint64_t *get_bloom_block(BloomFilter *filter, uint64_t mixed) {
+
+    uint64_t index = (uint64_t)(((unsigned __int128)(mixed >> 32)
+                                 * filter->num_blocks) >> 32);
+
+    return &filter->blocks[index * BLOCK_WORDS];
+}
+
+
+/**
+ * @brief  Estimate the false positive rate from the fraction of the bits
+ *         set: the chance that all bits of a new key are set
+ *
+ * @param  filter   a filter
+ * @return          the estimated false positive rate
+ */
+double estimate_false_positive_rate(BloomFilter *filter) {
+
+    uint64_t num_words = filter->num_blocks * BLOCK_WORDS;
+    uint64_t bits_set  = 0;
+
+    for (uint64_t i = 0; i < num_words; i++) {
+        bits_set += __builtin_popcountll(
+            __atomic_load_n(&filter->blocks[i], __ATOMIC_RELAXED));
+    }
+
+    double fill = (double)bits_set / ((double)num_words * 64);
+
+    return pow(fill, filter->num_hashes);
+}
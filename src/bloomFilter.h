@@ -0,0 +1,61 @@
+/**
+ * @file      bloomFilter.h
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     Blocked Bloom filter module. It includes
+ *              1. creating a filter sized for a number of keys and a target
+ *                 false positive rate, and destroying it
+ *              2. adding a key (a 64-bit hash value), and checking if a key
+ *                 may be added before
+ *              3. saving the filter into a file, and loading it back
+ *              4. reporting the filter statistics
+ *            All the bits of a key are in one block of a cache line, so a
+ *            key is added or checked with one cache miss. Keys may be added
+ *            and checked by many threads at once
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#ifndef BLOOMFILTER_H
+#define BLOOMFILTER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+typedef struct bloom_filter BloomFilter;
+
+
+// ============================================================================
+// == | Module Functions
+// ============================================================================
+// Create a new empty filter for a number of keys and false positive rate
+BloomFilter *new_BloomFilter(long num_keys, double fp_rate);
+
+// Destroy a filter and free its memory
+void free_BloomFilter(BloomFilter *filter);
+
+// Add a key to the filter, return false if it may be added before
+bool bloom_filter_add(BloomFilter *filter, uint64_t key);
+
+// Check if a key may be added to the filter before
+bool bloom_filter_contains(BloomFilter *filter, uint64_t key);
+
+// Count a key the filter reported as added before, but was not
+void bloom_filter_add_false_positive(BloomFilter *filter);
+
+// Save the filter into a file, return false if it cannot be written
+bool save_BloomFilter(BloomFilter *filter, char *path);
+
+// Load a filter saved into a file, or NULL if it cannot be read
+BloomFilter *load_BloomFilter(char *path);
+
+// Print out the filter statistics
+void print_bloom_filter_stats(BloomFilter *filter, FILE *fp);
+
+
+#endif
@@ -0,0 +1,335 @@
+/**
+ * @file      byteScan.c
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     Implementation of vectorised byte scanning module. It includes
+ *              1. choosing the scanning method supported by the CPU
+ *                 (AVX2, SSE2, or scalar) when it is first used
+ *              2. finding the next given byte in a block of memory
+ *              3. finding the next end of tag or quotation mark
+ *            Each SIMD method compares a block of 16 (SSE2) or 32 (AVX2)
+ *            bytes at once, turns the matches into a bit mask, and the
+ *            lowest bit set is the first match. The bytes left over at the
+ *            end are scanned one by one. SSE2 is always available on x86-64,
+ *            AVX2 is detected at run time. Other CPUs use the scalar method.
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#include "byteScan.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <assert.h>
+#include <stdbool.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define HAVE_X86_SIMD
+#include <immintrin.h>
+#endif
+
+
+// ============================================================================
+// == | Constant Definitions
+// ============================================================================
+#define TAG_END               '>'
+#define DOUBLE_QUOTE          '"'
+#define SINGLE_QUOTE          '\''
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+typedef char *(*FindByteFunc)(char *pos, char *end, char byte);
+typedef char *(*FindTagEndFunc)(char *pos, char *end);
+
+
+// ============================================================================
+// == | Function Prototypes
+// ============================================================================
+// Find the next given byte, one byte at a time
+char *find_byte_scalar(char *pos, char *end, char byte);
+
+// Find the next end of tag or quotation mark, one byte at a time
+char *find_tag_end_scalar(char *pos, char *end);
+
+#ifdef HAVE_X86_SIMD
+// Find the next given byte, 16 bytes at a time
+char *find_byte_sse2(char *pos, char *end, char byte);
+
+// Find the next end of tag or quotation mark, 16 bytes at a time
+char *find_tag_end_sse2(char *pos, char *end);
+
+// Find the next given byte, 32 bytes at a time
+char *find_byte_avx2(char *pos, char *end, char byte);
+
+// Find the next end of tag or quotation mark, 32 bytes at a time
+char *find_tag_end_avx2(char *pos, char *end);
+#endif
+
+
+// ============================================================================
+// == | Global Variables
+// ============================================================================
+// The scanning method used, chosen when it is first used
+static FindByteFunc   find_byte    = NULL;
+static FindTagEndFunc find_tag_end = NULL;
+
+
+// ============================================================================
+// == | Module Functions
+// ============================================================================
+/**
+ * @brief  Choose the fastest scanning method supported by the CPU
+ *
+ * @return    the scanning method chosen
+ */
+ByteScanMode init_byte_scan() {
+
+    if (set_byte_scan_mode(BYTE_SCAN_AVX2)) {
+        return BYTE_SCAN_AVX2;
+    }
+    if (set_byte_scan_mode(BYTE_SCAN_SSE2)) {
+        return BYTE_SCAN_SSE2;
+    }
+
+    set_byte_scan_mode(BYTE_SCAN_SCALAR);
+    return BYTE_SCAN_SCALAR;
+}
+
+
+/**
+ * @brief  Use the given scanning method, if it is supported by the CPU
+ *
+ * @param  mode     the scanning method
+ * @return true     If the method is supported and will be used
+ * @return false    If the method is not supported
+ */
+bool set_byte_scan_mode(ByteScanMode mode) {
+
+    switch (mode) {
+        case BYTE_SCAN_SCALAR:
+            find_byte    = find_byte_scalar;
+            find_tag_end = find_tag_end_scalar;
+            return true;
+#ifdef HAVE_X86_SIMD
+        case BYTE_SCAN_SSE2:
+            find_byte    = find_byte_sse2;
+            find_tag_end = find_tag_end_sse2;
+            return true;
+        case BYTE_SCAN_AVX2:
+            if (!__builtin_cpu_supports("avx2")) {
+                return false;
+            }
+            find_byte    = find_byte_avx2;
+            find_tag_end = find_tag_end_avx2;
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+
+/**
+ * @brief  Return the name of a scanning method
+ *
+ * @param  mode   the scanning method
+ * @return        the name of the method
+ */
+char *get_byte_scan_name(ByteScanMode mode) {
+
+    switch (mode) {
+        case BYTE_SCAN_SSE2:
+            return "sse2";
+        case BYTE_SCAN_AVX2:
+            return "avx2";
+        default:
+            return "scalar";
+    }
+}
+
+
+/**
+ * @brief  Find the next given byte
+ *
+ * @param  pos    the position to start from
+ * @param  end    the end of the memory to scan
+ * @param  byte   the byte to find
+ * @return        the position of the byte, or the end if it is not found
+ */
+char *scan_find_byte(char *pos, char *end, char byte) {
+
+    if (find_byte == NULL) {
+        init_byte_scan();
+    }
+    return find_byte(pos, end, byte);
+}
+
+
+/**
+ * @brief  Find the next end of tag ('>') or quotation mark ('"' or '\'')
+ *
+ * @param  pos    the position to start from
+ * @param  end    the end of the memory to scan
+ * @return        the position of the byte, or the end if it is not found
+ */
+char *scan_find_tag_end(char *pos, char *end) {
+
+    if (find_tag_end == NULL) {
+        init_byte_scan();
+    }
+    return find_tag_end(pos, end);
+}
+
+
+// ============================================================================
+// == | Auxillary Functions
+// ============================================================================
+/**
+ * @brief  Find the next given byte, one byte at a time
+ *
+ * @param  pos    the position to start from
+ * @param  end    the end of the memory to scan
+ * @param  byte   the byte to find
+ * @return        the position of the byte, or the end if it is not found
+ */
+char *find_byte_scalar(char *pos, char *end, char byte) {
+
+    while (pos < end && *pos != byte) {
+        pos++;
+    }
+    return pos;
+}
+
+
+/**
+ * @brief  Find the next end of tag or quotation mark, one byte at a time
+ *
+ * @param  pos    the position to start from
+ * @param  end    the end of the memory to scan
+ * @return        the position of the byte, or the end if it is not found
+ */
+char *find_tag_end_scalar(char *pos, char *end) {
+
+    while (pos < end && *pos != TAG_END
+           && *pos != DOUBLE_QUOTE && *pos != SINGLE_QUOTE) {
+        pos++;
+    }
+    return pos;
+}
+
+
+#ifdef HAVE_X86_SIMD
+/**
+ * @brief  Find the next given byte, 16 bytes at a time
+ *
+ * @param  pos    the position to start from
+ * @param  end    the end of the memory to scan
+ * @param  byte   the byte to find
+ * @return        the position of the byte, or the end if it is not found
+ */
+char *find_byte_sse2(char *pos, char *end, char byte) {
+
+    __m128i needle = _mm_set1_epi8(byte);
+
+    while (end - pos >= 16) {
+        __m128i block = _mm_loadu_si128((__m128i *)pos);
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, needle));
+        if (mask != 0) {
+            return pos + __builtin_ctz(mask);
+        }
+        pos += 16;
+    }
+
+    return find_byte_scalar(pos, end, byte);
+}
+
+
+/**
+ * @brief  Find the next end of tag or quotation mark, 16 bytes at a time
+ *
+ * @param  pos    the position to start from
+ * @param  end    the end of the memory to scan
+ * @return        the position of the byte, or the end if it is not found
+ */
+char *find_tag_end_sse2(char *pos, char *end) {
+
+    __m128i tag_end      = _mm_set1_epi8(TAG_END);
+    __m128i double_quote = _mm_set1_epi8(DOUBLE_QUOTE);
+    __m128i single_quote = _mm_set1_epi8(SINGLE_QUOTE);
+
+    while (end - pos >= 16) {
+        __m128i block = _mm_loadu_si128((__m128i *)pos);
+        __m128i match = _mm_or_si128(
+            _mm_cmpeq_epi8(block, tag_end),
+            _mm_or_si128(_mm_cmpeq_epi8(block, double_quote),
+                         _mm_cmpeq_epi8(block, single_quote)));
+        int mask = _mm_movemask_epi8(match);
+        if (mask != 0) {
+            return pos + __builtin_ctz(mask);
+        }
+        pos += 16;
+    }
+
+    return find_tag_end_scalar(pos, end);
+}
+
+
+/**
+ * @brief  Find the next given byte, 32 bytes at a time
+ *
+ * @param  pos    the position to start from
+ * @param  end    the end of the memory to scan
+ * @param  byte   the byte to find
+ * @return        the position of the byte, or the end if it is not found
+ */
+__attribute__((target("avx2")))
+char *find_byte_avx2(char *pos, char *end, char byte) {
+
+    __m256i needle = _mm256_set1_epi8(byte);
+
+    while (end - pos >= 32) {
+        __m256i block = _mm256_loadu_si256((__m256i *)pos);
+        unsigned mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle));
+        if (mask != 0) {
+            return pos + __builtin_ctz(mask);
+        }
+        pos += 32;
+    }
+
+    return find_byte_sse2(pos, end, byte);
+}
+
+
+/**
+ * @brief  Find the next end of tag or quotation mark, 32 bytes at a time
+ *
+ * @param  pos    the position to start from
+ * @param  end    the end of the memory to scan
+ * @return        the position of the byte, or the end if it is not found
+ */
+__attribute__((target("avx2")))
+char *find_tag_end_avx2(char *pos, char *end) {
+
+    __m256i tag_end      = _mm256_set1_epi8(TAG_END);
+    __m256i double_quote = _mm256_set1_epi8(DOUBLE_QUOTE);
+    __m256i single_quote = _mm256_set1_epi8(SINGLE_QUOTE);
+
+    while (end - pos >= 32) {
+        __m256i block = _mm256_loadu_si256((__m256i *)pos);
+        __m256i match = _mm256_or_si256(
+            _mm256_cmpeq_epi8(block, tag_end),
+            _mm256_or_si256(_mm256_cmpeq_epi8(block, double_quote),
+                            _mm256_cmpeq_epi8(block, single_quote)));
+        unsigned mask = _mm256_movemask_epi8(match);
+        if (mask != 0) {
+            return pos + __builtin_ctz(mask);
+        }
+        pos += 32;
+    }
+
+    return find_tag_end_sse2(pos, end);
+}
+#endif
@@ -0,0 +1,54 @@
+/**
+ * @file      byteScan.h
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     Vectorised byte scanning module. It includes
+ *              1. choosing the scanning method supported by the CPU
+ *                 (AVX2, SSE2, or scalar) when it is first used
+ *              2. finding the next given byte in a block of memory
+ *              3. finding the next end of tag or quotation mark
+ *            All methods give the same results, the SIMD ones compare 16 or
+ *            32 bytes at a time.
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#ifndef BYTESCAN_H
+#define BYTESCAN_H
+
+#include <stdbool.h>
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+/**
+ * @brief  The method used to scan the bytes
+ */
+typedef enum {
+    BYTE_SCAN_SCALAR,
+    BYTE_SCAN_SSE2,
+    BYTE_SCAN_AVX2
+} ByteScanMode;
+
+
+// ============================================================================
+// == | Module Functions
+// ============================================================================
+// Choose the fastest scanning method supported by the CPU
+ByteScanMode init_byte_scan();
+
+// Use the given scanning method, if it is supported by the CPU
+bool set_byte_scan_mode(ByteScanMode mode);
+
+// Return the name of a scanning method
+char *get_byte_scan_name(ByteScanMode mode);
+
+// Find the next given byte, return the end if it is not found
+char *scan_find_byte(char *pos, char *end, char byte);
+
+// Find the next '>', '"' or '\'', return the end if it is not found
+char *scan_find_tag_end(char *pos, char *end);
+
+
+#endif
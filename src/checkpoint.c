@@ -0,0 +1,521 @@
+/**
+ * @file      checkpoint.c
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     Implementation of crawl checkpoint module. It includes
+ *              1. creating a checkpoint journal (or appending to the one
+ *                 of a crawl resumed), and closing it
+ *              2. recording the URLs found, fetched and requeued, and the
+ *                 state of the hosts backing off
+ *              3. writing the records kept so far into the journal
+ *              4. reading the records of a journal back to resume a crawl
+ *              5. reporting the checkpoint statistics
+ *            The journal starts with a magic string, followed by the
+ *            records: a fixed size entry, then the hostname and filepath
+ *            (not NULL terminated). The records are appended into a buffer
+ *            under a lock. The thread flushing swaps it with a spare buffer
+ *            and writes it without the lock, so recording never waits for
+ *            the disk (only for another thread recording)
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#include "checkpoint.h"
+
+#include "urlInfo.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+// ============================================================================
+// == | Constant Definitions
+// ============================================================================
+#define CHECKPOINT_MAGIC        "CRWLCKP1"
+#define CHECKPOINT_MAGIC_LEN    8
+#define CHECKPOINT_INIT_BUFFER  65536
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+typedef struct checkpoint_entry CheckpointEntry;
+/**
+ * @brief  The fixed size entry of a record in the journal, it is followed
+ *         by the hostname and the filepath
+ */
+struct checkpoint_entry {
+    uint8_t type;
+    uint8_t isAuthorization;
+    uint16_t retries;
+    uint16_t hostname_len;
+    uint16_t filepath_len;
+    int32_t delay_ms;
+    uint16_t failures;
+    uint16_t pauses;
+};
+
+
+/**
+ * @brief  A checkpoint include the journal file, the buffer of records kept
+ *         (and the lock guarding it), the spare buffer being written (and
+ *         the lock of the thread flushing), and the number of records,
+ *         bytes and flushes written so far
+ */
+struct checkpoint {
+    int fd;
+    pthread_mutex_t lock;
+    char *buffer;
+    size_t len;
+    size_t capacity;
+    pthread_mutex_t flush_lock;
+    char *spare;
+    size_t spare_capacity;
+    long records;
+    long long bytes;
+    long flushes;
+};
+
+
+/**
+ * @brief  A checkpoint reader include the journal mapped, its size, and the
+ *         offset of the next record
+ */
+struct checkpoint_reader {
+    char *map;
+    size_t size;
+    size_t offset;
+};
+
+
+// ============================================================================
+// == | Function Prototypes
+// ============================================================================
+// Append a record into the buffer of records kept
+void append_checkpoint_record(Checkpoint *checkpoint, CheckpointType type,
+                              UrlInfo *url, char *hostname, int delay_ms,
+                              int failures, int pauses);
+
+// Write all bytes into a file, retrying the partial writes
+bool write_all(int fd, char *data, size_t len);
+
+
+// ============================================================================
+// == | Module Functions
+// ============================================================================
+/**
+ * @brief  Create a new checkpoint journal (replacing the file), or append
+ *         to the journal of a crawl resumed. A new journal starts with the
+ *         magic string
+ *
+ * @param  path         the path of the journal
+ * @param  isAppended   if the records are appended to the journal
+ * @return              the pointer of new checkpoint
+ */
+Checkpoint *new_Checkpoint(char *path, bool isAppended) {
+
+    struct stat st;
+
+    assert(path != NULL);
+
+    int flags = O_WRONLY | O_CREAT | O_APPEND | (isAppended ? 0 : O_TRUNC);
+    int fd = open(path, flags, 0600);
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        fprintf(stderr, "Error: new_Checkpoint() cannot open %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    if (st.st_size == 0
+        && !write_all(fd, CHECKPOINT_MAGIC, CHECKPOINT_MAGIC_LEN)) {
+        fprintf(stderr, "Error: new_Checkpoint() cannot write %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+
+    Checkpoint *checkpoint = (Checkpoint *)malloc(sizeof *checkpoint);
+    char *buffer = (char *)malloc(CHECKPOINT_INIT_BUFFER);
+    char *spare  = (char *)malloc(CHECKPOINT_INIT_BUFFER);
+    if (checkpoint == NULL || buffer == NULL || spare == NULL) {
+        fprintf(stderr, "Error: new_Checkpoint() malloc returned NULL\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Initalise value of the checkpoint
+    checkpoint->fd             = fd;
+    checkpoint->buffer         = buffer;
+    checkpoint->len            = 0;
+    checkpoint->capacity       = CHECKPOINT_INIT_BUFFER;
+    checkpoint->spare          = spare;
+    checkpoint->spare_capacity = CHECKPOINT_INIT_BUFFER;
+    checkpoint->records        = 0;
+    checkpoint->bytes          = 0;
+    checkpoint->flushes        = 0;
+    pthread_mutex_init(&checkpoint->lock, NULL);
+    pthread_mutex_init(&checkpoint->flush_lock, NULL);
+
+    return checkpoint;
+}
+
+
+/**
+ * @brief  Write the records left into the journal, close it, and free the
+ *         memory associated with a checkpoint
+ *
+ * @param  checkpoint   a checkpoint
+ */
+void free_Checkpoint(Checkpoint *checkpoint) {
+
+    assert(checkpoint != NULL);
+
+    flush_Checkpoint(checkpoint);
+    close(checkpoint->fd);
+
+    free(checkpoint->buffer);
+    free(checkpoint->spare);
+    checkpoint->buffer = NULL;
+    checkpoint->spare  = NULL;
+    pthread_mutex_destroy(&checkpoint->lock);
+    pthread_mutex_destroy(&checkpoint->flush_lock);
+
+    free(checkpoint);
+    checkpoint = NULL;
+}
+
+
+/**
+ * @brief  Record a URL found (it is new, and will be fetched)
+ *
+ * @param  checkpoint   a checkpoint
+ * @param  url          a UrlInfo data
+ */
+void checkpoint_found(Checkpoint *checkpoint, UrlInfo *url) {
+
+    append_checkpoint_record(checkpoint, CHECKPOINT_FOUND, url, NULL,
+                             0, 0, 0);
+}
+
+
+/**
+ * @brief  Record a URL fetched (in the order they are fetched)
+ *
+ * @param  checkpoint   a checkpoint
+ * @param  url          a UrlInfo data
+ */
+void checkpoint_visited(Checkpoint *checkpoint, UrlInfo *url) {
+
+    append_checkpoint_record(checkpoint, CHECKPOINT_VISITED, url, NULL,
+                             0, 0, 0);
+}
+
+
+/**
+ * @brief  Record a URL which will be fetched again (e.g. it is retried, or
+ *         the authorization is required)
+ *
+ * @param  checkpoint   a checkpoint
+ * @param  url          a UrlInfo data
+ */
+void checkpoint_requeued(Checkpoint *checkpoint, UrlInfo *url) {
+
+    append_checkpoint_record(checkpoint, CHECKPOINT_REQUEUED, url, NULL,
+                             0, 0, 0);
+}
+
+
+/**
+ * @brief  Record the state of a host backing off: the time until it can be
+ *         fetched again, and the state of its circuit breaker
+ *
+ * @param  checkpoint   a checkpoint
+ * @param  hostname     the hostname
+ * @param  delay_ms     the time until the host can be fetched again
+ * @param  failures     the overloaded responses in a row
+ * @param  pauses       the pauses of its circuit breaker in a row
+ */
+void checkpoint_host(Checkpoint *checkpoint, char *hostname, int delay_ms,
+                     int failures, int pauses) {
+
+    append_checkpoint_record(checkpoint, CHECKPOINT_HOST, NULL, hostname,
+                             delay_ms, failures, pauses);
+}
+
+
+/**
+ * @brief  Write the records kept so far into the journal and sync it. The
+ *         buffer is swapped with the spare buffer first, so the threads
+ *         recording keep going while it is written
+ *
+ * @param  checkpoint   a checkpoint
+ */
+void flush_Checkpoint(Checkpoint *checkpoint) {
+
+    assert(checkpoint != NULL);
+
+    pthread_mutex_lock(&checkpoint->flush_lock);
+
+    pthread_mutex_lock(&checkpoint->lock);
+    char *data                 = checkpoint->buffer;
+    size_t len                 = checkpoint->len;
+    size_t capacity            = checkpoint->capacity;
+    checkpoint->buffer         = checkpoint->spare;
+    checkpoint->capacity       = checkpoint->spare_capacity;
+    checkpoint->len            = 0;
+    checkpoint->spare          = data;
+    checkpoint->spare_capacity = capacity;
+    pthread_mutex_unlock(&checkpoint->lock);
+
+    if (len > 0) {
+        if (!write_all(checkpoint->fd, data, len)
+            || fdatasync(checkpoint->fd) != 0) {
+            fprintf(stderr, "Error: flush_Checkpoint() write failed\n");
+            exit(EXIT_FAILURE);
+        }
+        checkpoint->bytes   += len;
+        checkpoint->flushes += 1;
+    }
+
+    pthread_mutex_unlock(&checkpoint->flush_lock);
+}
+
+
+/**
+ * @brief  Print out the number of records, bytes and flushes written
+ *
+ * @param  checkpoint   a checkpoint
+ * @param  fp           the file to print into
+ */
+void print_checkpoint_stats(Checkpoint *checkpoint, FILE *fp) {
+
+    assert(checkpoint != NULL);
+
+    pthread_mutex_lock(&checkpoint->flush_lock);
+    fprintf(fp, "checkpoint: %ld records, %lld bytes in %ld flushes\n",
+            checkpoint->records, checkpoint->bytes, checkpoint->flushes);
+    pthread_mutex_unlock(&checkpoint->flush_lock);
+}
+
+
+/**
+ * @brief  Open a journal to read its records back, it is mapped into memory
+ *         and read sequentially
+ *
+ * @param  path     the path of the journal
+ * @return          the pointer of new reader, or NULL if the journal cannot
+ *                  be read or does not start with the magic string
+ */
+CheckpointReader *open_CheckpointReader(char *path) {
+
+    struct stat st;
+
+    assert(path != NULL);
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size < CHECKPOINT_MAGIC_LEN) {
+        close(fd);
+        return NULL;
+    }
+
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return NULL;
+    }
+    if (memcmp(map, CHECKPOINT_MAGIC, CHECKPOINT_MAGIC_LEN) != 0) {
+        munmap(map, st.st_size);
+        return NULL;
+    }
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+    CheckpointReader *reader = (CheckpointReader *)malloc(sizeof *reader);
+    if (reader == NULL) {
+        fprintf(stderr, "Error: open_CheckpointReader() malloc returned "
+                        "NULL\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Initalise value of the reader
+    reader->map    = (char *)map;
+    reader->size   = st.st_size;
+    reader->offset = CHECKPOINT_MAGIC_LEN;
+
+    return reader;
+}
+
+
+/**
+ * @brief  Read the next record of a journal. A record cut off (or not valid)
+ *         ends the journal
+ *
+ * @param  reader   a checkpoint reader
+ * @param  record   the record will be set (its URL is a new UrlInfo data)
+ * @return true     If a record is read
+ * @return false    If the journal ends
+ */
+bool read_checkpoint_record(CheckpointReader *reader,
+                            CheckpointRecord *record) {
+
+    CheckpointEntry entry;
+
+    assert(reader != NULL);
+    assert(record != NULL);
+
+    if (reader->offset + sizeof entry > reader->size) {
+        return false;
+    }
+    memcpy(&entry, reader->map + reader->offset, sizeof entry);
+
+    size_t len = sizeof entry + entry.hostname_len + entry.filepath_len;
+    if (reader->offset + len > reader->size || entry.hostname_len == 0
+        || (entry.type != CHECKPOINT_FOUND && entry.type != CHECKPOINT_VISITED
+            && entry.type != CHECKPOINT_REQUEUED
+            && entry.type != CHECKPOINT_HOST)) {
+        return false;
+    }
+
+    char *hostname = reader->map + reader->offset + sizeof entry;
+    UrlInfo *url = new_UrlInfo(hostname, entry.hostname_len,
+                               hostname + entry.hostname_len,
+                               entry.filepath_len);
+    url->isAuthorization = entry.isAuthorization;
+    url->retries         = entry.retries;
+
+    record->type     = (CheckpointType)entry.type;
+    record->url      = url;
+    record->delay_ms = entry.delay_ms;
+    record->failures = entry.failures;
+    record->pauses   = entry.pauses;
+
+    reader->offset += len;
+
+    return true;
+}
+
+
+/**
+ * @brief  Close a journal read back, and free the memory associated with
+ *         its reader
+ *
+ * @param  reader   a checkpoint reader
+ */
+void close_CheckpointReader(CheckpointReader *reader) {
+
+    assert(reader != NULL);
+
+    munmap(reader->map, reader->size);
+    reader->map = NULL;
+
+    free(reader);
+    reader = NULL;
+}
+
+
+// ============================================================================
+// == | Auxillary Functions
+// ============================================================================
+/**
+ * @brief  Append a record into the buffer of records kept, growing it if it
+ *         is full. A URL too long for a record is not recorded
+ *
+ * @param  checkpoint   a checkpoint
+ * @param  type         the type of the record
+ * @param  url          the URL of the record, or NULL for a host record
+ * @param  hostname     the hostname of a host record
+ * @param  delay_ms     the time until the host can be fetched again
+ * @param  failures     the overloaded responses of the host in a row
+ * @param  pauses       the pauses of the circuit breaker of the host
+ */
+void append_checkpoint_record(Checkpoint *checkpoint, CheckpointType type,
+                              UrlInfo *url, char *hostname, int delay_ms,
+                              int failures, int pauses) {
+
+    char *filepath = "";
+
+    if (url != NULL) {
+        hostname = url->hostname;
+        filepath = url->filepath;
+    }
+
+    size_t hostname_len = strlen(hostname);
+    size_t filepath_len = strlen(filepath);
+    if (hostname_len == 0 || hostname_len > UINT16_MAX
+        || filepath_len > UINT16_MAX) {
+        return;
+    }
+
+    CheckpointEntry entry = {
+        .type            = (uint8_t)type,
+        .isAuthorization = url != NULL && url->isAuthorization,
+        .retries         = url != NULL ? url->retries : 0,
+        .hostname_len    = (uint16_t)hostname_len,
+        .filepath_len    = (uint16_t)filepath_len,
+        .delay_ms        = delay_ms,
+        .failures        = (uint16_t)failures,
+        .pauses          = (uint16_t)pauses
+    };
+    size_t len = sizeof entry + hostname_len + filepath_len;
+
+    pthread_mutex_lock(&checkpoint->lock);
+
+    if (checkpoint->len + len > checkpoint->capacity) {
+        while (checkpoint->len + len > checkpoint->capacity) {
+            checkpoint->capacity *= 2;
+        }
+        checkpoint->buffer = (char *)realloc(checkpoint->buffer,
+                                             checkpoint->capacity);
+        if (checkpoint->buffer == NULL) {
+            fprintf(stderr, "Error: append_checkpoint_record() realloc "
+                            "returned NULL\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    char *dest = checkpoint->buffer + checkpoint->len;
+    memcpy(dest, &entry, sizeof entry);
+    memcpy(dest + sizeof entry, hostname, hostname_len);
+    memcpy(dest + sizeof entry + hostname_len, filepath, filepath_len);
+    checkpoint->len     += len;
+    checkpoint->records += 1;
+
+    pthread_mutex_unlock(&checkpoint->lock);
+}
+
+
+/**
+ * @brief  Write all bytes into a file, retrying the partial writes (and the
+ *         writes interrupted)
+ *
+ * @param  fd       the file descriptor
+ * @param  data     the bytes
+ * @param  len      the number of bytes
+ * @return true     If all bytes are written
+ * @return false    If the write fails
+ */
+bool write_all(int fd, char *data, size_t len) {
+
+    while (len > 0) {
+        ssize_t written = write(fd, data, len);
+
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        len  -= written;
+    }
+
+    return true;
+}
@@ -0,0 +1,105 @@
+/**
+ * @file      checkpoint.h
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     Crawl checkpoint module. It includes
+ *              1. creating a checkpoint journal (or appending to the one
+ *                 of a crawl resumed), and closing it
+ *              2. recording the URLs found, fetched and requeued, and the
+ *                 state of the hosts backing off
+ *              3. writing the records kept so far into the journal
+ *              4. reading the records of a journal back to resume a crawl
+ *              5. reporting the checkpoint statistics
+ *            The records are kept in memory by the threads crawling and
+ *            written into the journal file in a batch (and synced) by the
+ *            thread flushing it, so the crawl does not wait for the disk.
+ *            A journal is read back through a memory mapping, and a record
+ *            cut off by a crash is ignored
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "urlInfo.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+typedef struct checkpoint Checkpoint;
+typedef struct checkpoint_reader CheckpointReader;
+
+/**
+ * @brief  The type of a checkpoint record
+ */
+typedef enum {
+    CHECKPOINT_FOUND     = 'S',
+    CHECKPOINT_VISITED   = 'V',
+    CHECKPOINT_REQUEUED  = 'Q',
+    CHECKPOINT_HOST      = 'H'
+} CheckpointType;
+
+
+typedef struct checkpoint_record CheckpointRecord;
+/**
+ * @brief  A checkpoint record read back: its type, and its URL (a new
+ *         UrlInfo data, the caller frees it). A host record has the host
+ *         as the hostname of its URL (with an empty filepath), the time
+ *         until it can be fetched again, and the state of its circuit
+ *         breaker
+ */
+struct checkpoint_record {
+    CheckpointType type;
+    UrlInfo *url;
+    int delay_ms;
+    int failures;
+    int pauses;
+};
+
+
+// ============================================================================
+// == | Module Functions
+// ============================================================================
+// Create a new checkpoint journal, or append to the journal of a crawl
+// resumed
+Checkpoint *new_Checkpoint(char *path, bool isAppended);
+
+// Write the records left, close the journal and free its memory
+void free_Checkpoint(Checkpoint *checkpoint);
+
+// Record a URL found, which will be fetched
+void checkpoint_found(Checkpoint *checkpoint, UrlInfo *url);
+
+// Record a URL fetched
+void checkpoint_visited(Checkpoint *checkpoint, UrlInfo *url);
+
+// Record a URL which will be fetched again
+void checkpoint_requeued(Checkpoint *checkpoint, UrlInfo *url);
+
+// Record the state of a host backing off
+void checkpoint_host(Checkpoint *checkpoint, char *hostname, int delay_ms,
+                     int failures, int pauses);
+
+// Write the records kept so far into the journal, and sync it
+void flush_Checkpoint(Checkpoint *checkpoint);
+
+// Print out the checkpoint statistics
+void print_checkpoint_stats(Checkpoint *checkpoint, FILE *fp);
+
+// Open a journal to read its records back, or NULL if it cannot be read
+CheckpointReader *open_CheckpointReader(char *path);
+
+// Read the next record of a journal, return false at its end
+bool read_checkpoint_record(CheckpointReader *reader,
+                            CheckpointRecord *record);
+
+// Close a journal read back and free its memory
+void close_CheckpointReader(CheckpointReader *reader);
+
+
+#endif
@@ -0,0 +1,282 @@
+/**
+ * @file      connectionPool.c
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     Implementation of keep-alive connection pool module. It includes
+ *              1. creating and destroying a connection pool
+ *              2. taking an idle connection to a host, and putting a
+ *                 connection back to the pool once its response is received
+ *              3. closing the connections idle for too long
+ *              4. reporting how often the connections are reused
+ *            The idle connections are kept in a small array, the most
+ *            recently used connection to a host is taken first.
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#include "connectionPool.h"
+
+#include "socketHandler.h"
+#include "utilities.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <assert.h>
+#include <string.h>
+#include <strings.h>
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+typedef struct idle_connection IdleConnection;
+/**
+ * @brief  An idle connection include its hostname, socket, and the time it
+ *         was put back to the pool
+ */
+struct idle_connection {
+    char *hostname;
+    int connfd;
+    long long idle_since;
+};
+
+
+/**
+ * @brief  A connection pool include the idle connections, the limits of idle
+ *         connections, and the number of connections taken, reused, and
+ *         found closed by the server when reused
+ */
+struct connection_pool {
+    IdleConnection *idle;
+    int idle_size;
+    int max_idle;
+    int idle_timeout_ms;
+    long taken;
+    long reused;
+    long stale;
+};
+
+
+// ============================================================================
+// == | Function Prototypes
+// ============================================================================
+// Close an idle connection and remove it from the pool
+void connection_pool_remove(ConnectionPool *pool, int index);
+
+
+// ============================================================================
+// == | Module Functions
+// ============================================================================
+/**
+ * @brief  Create a new empty connection pool
+ *
+ * @param  max_idle         the maximum number of idle connections kept
+ * @param  idle_timeout_ms  the time an idle connection is kept
+ * @return                  the pointer of new connection pool
+ */
+ConnectionPool *new_ConnectionPool(int max_idle, int idle_timeout_ms) {
+
+    assert(max_idle > 0);
+
+    ConnectionPool *pool = (ConnectionPool *)malloc(sizeof *pool);
+    if (pool == NULL) {
+        fprintf(stderr, "Error: new_ConnectionPool() malloc returned NULL\n");
+        exit(EXIT_FAILURE);
+    }
+
+    pool->idle = (IdleConnection *)malloc(max_idle * sizeof *pool->idle);
+    if (pool->idle == NULL) {
+        fprintf(stderr, "Error: new_ConnectionPool() malloc returned NULL\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Initalise value of the connection pool
+    pool->idle_size       = 0;
+    pool->max_idle        = max_idle;
+    pool->idle_timeout_ms = idle_timeout_ms;
+    pool->taken           = 0;
+    pool->reused          = 0;
+    pool->stale           = 0;
+
+    return pool;
+}
+
+
+/**
+ * @brief  Close all idle connections, destroy and free the memory
+ *         associated with a connection pool
+ *
+ * @param  pool   a connection pool
+ */
+void free_ConnectionPool(ConnectionPool *pool) {
+
+    // Error if the pool does not initalise
+    assert(pool != NULL);
+
+    while (pool->idle_size > 0) {
+        connection_pool_remove(pool, pool->idle_size - 1);
+    }
+
+    free(pool->idle);
+    pool->idle = NULL;
+
+    free(pool);
+    pool = NULL;
+}
+
+
+/**
+ * @brief  Take an idle connection to the hostname out of the pool
+ *
+ * @param  pool       a connection pool
+ * @param  hostname   the hostname of the connection
+ * @return            the socket connection ID,
+ *                    or -1 if there is no idle connection to the hostname
+ */
+int connection_pool_take(ConnectionPool *pool, char *hostname) {
+
+    assert(pool != NULL);
+
+    pool->taken++;
+
+    // Take the most recently used connection, as it is least likely to be
+    // closed by the server
+    for (int i = pool->idle_size - 1; i >= 0; i--) {
+        if (strcasecmp(pool->idle[i].hostname, hostname) == SUCCESS) {
+            int connfd = pool->idle[i].connfd;
+
+            // Remove it from the pool without closing it
+            free(pool->idle[i].hostname);
+            pool->idle_size--;
+            memmove(&pool->idle[i], &pool->idle[i + 1],
+                    (pool->idle_size - i) * sizeof *pool->idle);
+
+            pool->reused++;
+            return connfd;
+        }
+    }
+
+    return -1;
+}
+
+
+/**
+ * @brief  Put a connection to the hostname back to the pool, so the next
+ *         request to the hostname can reuse it. If the pool is full, the
+ *         connection idle for the longest time is closed
+ *
+ * @param  pool       a connection pool
+ * @param  hostname   the hostname of the connection
+ * @param  connfd     the socket connection ID
+ */
+void connection_pool_put(ConnectionPool *pool, char *hostname, int connfd) {
+
+    assert(pool != NULL);
+
+    if (pool->idle_size == pool->max_idle) {
+        connection_pool_remove(pool, 0);
+    }
+
+    // The connections are kept in the order they are put back
+    IdleConnection *conn = &pool->idle[pool->idle_size++];
+    conn->hostname   = deep_copy_str(hostname, strlen(hostname),
+                                     IS_COPY_WHOLE);
+    conn->connfd     = connfd;
+    conn->idle_since = get_monotonic_ms();
+}
+
+
+/**
+ * @brief  Record that a reused connection was already closed by the server,
+ *         so the request was sent again on a new connection
+ *
+ * @param  pool   a connection pool
+ */
+void connection_pool_discard_stale(ConnectionPool *pool) {
+
+    assert(pool != NULL);
+
+    pool->reused--;
+    pool->stale++;
+}
+
+
+/**
+ * @brief  Close the connections idle for longer than the idle timeout
+ *
+ * @param  pool   a connection pool
+ */
+void connection_pool_evict_idle(ConnectionPool *pool) {
+
+    assert(pool != NULL);
+
+    long long now = get_monotonic_ms();
+
+    // The oldest idle connections are at the front of the pool
+    while (pool->idle_size > 0
+           && now - pool->idle[0].idle_since >= pool->idle_timeout_ms) {
+        connection_pool_remove(pool, 0);
+    }
+}
+
+
+/**
+ * @brief  Get the time until the next idle connection expires
+ *
+ * @param  pool   a connection pool
+ * @return        the time in milliseconds, or -1 if there is no idle
+ *                connection
+ */
+int get_connection_pool_timeout(ConnectionPool *pool) {
+
+    assert(pool != NULL);
+
+    if (pool->idle_size == 0) {
+        return -1;
+    }
+
+    long long expire = pool->idle[0].idle_since + pool->idle_timeout_ms;
+    long long now    = get_monotonic_ms();
+
+    return (expire > now) ? (int)(expire - now) : 0;
+}
+
+
+/**
+ * @brief  Print out the number of connections opened and reused
+ *
+ * @param  pool   a connection pool
+ * @param  fp     the file to print into
+ */
+void print_connection_pool_stats(ConnectionPool *pool, FILE *fp) {
+
+    assert(pool != NULL);
+
+    double ratio = (pool->taken > 0)
+                 ? 100.0 * pool->reused / pool->taken : 0.0;
+
+    fprintf(fp, "connections: %ld opened, %ld reused (%.1f%% reuse), "
+                "%ld stale\n",
+            pool->taken - pool->reused, pool->reused, ratio, pool->stale);
+}
+
+
+// ============================================================================
+// == | Auxillary Functions
+// ============================================================================
+/**
+ * @brief  Close an idle connection and remove it from the pool
+ *
+ * @param  pool     a connection pool
+ * @param  index    the index of the idle connection
+ */
+void connection_pool_remove(ConnectionPool *pool, int index) {
+
+    close_socket(pool->idle[index].connfd);
+    free(pool->idle[index].hostname);
+
+    pool->idle_size--;
+    memmove(&pool->idle[index], &pool->idle[index + 1],
+            (pool->idle_size - index) * sizeof *pool->idle);
+}
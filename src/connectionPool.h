@@ -0,0 +1,55 @@
+/**
+ * @file      connectionPool.h
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     Keep-alive connection pool module. It includes
+ *              1. creating and destroying a connection pool
+ *              2. taking an idle connection to a host, and putting a
+ *                 connection back to the pool once its response is received
+ *              3. closing the connections idle for too long
+ *              4. reporting how often the connections are reused
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#ifndef CONNECTIONPOOL_H
+#define CONNECTIONPOOL_H
+
+#include <stdio.h>
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+typedef struct connection_pool ConnectionPool;
+
+
+// ============================================================================
+// == | Module Functions
+// ============================================================================
+// Create a new empty connection pool
+ConnectionPool *new_ConnectionPool(int max_idle, int idle_timeout_ms);
+
+// Close all idle connections, destroy a connection pool and free its memory
+void free_ConnectionPool(ConnectionPool *pool);
+
+// Take an idle connection to the hostname, return -1 if there is none
+int connection_pool_take(ConnectionPool *pool, char *hostname);
+
+// Put a connection to the hostname back to the pool
+void connection_pool_put(ConnectionPool *pool, char *hostname, int connfd);
+
+// Record that a reused connection was already closed by the server
+void connection_pool_discard_stale(ConnectionPool *pool);
+
+// Close the connections idle for longer than the idle timeout
+void connection_pool_evict_idle(ConnectionPool *pool);
+
+// Return the time in milliseconds until the next idle connection expires
+int get_connection_pool_timeout(ConnectionPool *pool);
+
+// Print out the number of connections opened and reused
+void print_connection_pool_stats(ConnectionPool *pool, FILE *fp);
+
+
+#endif
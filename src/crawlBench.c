@@ -0,0 +1,475 @@
+/**
+ * @file      crawlBench.c
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     Loopback benchmark of the crawler. It
+ *              1. starts the mock HTTP server with a generated site, on a
+ *                 free port of the loopback interface
+ *              2. crawls the whole site with the crawler (through the port),
+ *                 timing it and taking its peak memory
+ *              3. stops the server, which reports the bytes it sent
+ *              4. prints the pages and bytes per second, the latency of the
+ *                 fetches (p50 and p99, from the crawler statistics) and
+ *                 the peak RSS as JSON, to compare between runs. The pages
+ *                 are the unique URLs fetched, the fetches also count the
+ *                 URLs fetched again (after a 401, or a 503 or 504)
+ *            The options of the site are passed to the server, and the
+ *            arguments after "--" to the crawler. "make bench" builds and
+ *            runs it (with the arguments in BENCH_ARGS).
+ *
+ *            Usage: ./crawlbench [-n <pages>] [-l <links>] [-b <page bytes>]
+ *                                [-r <301 %>] [-a <401 %>] [-u <503 %>]
+ *                                [-c <chunked %>] [-o <file.json>]
+ *                                [-- <crawler options>]
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <assert.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+
+// ============================================================================
+// == | Constant Definitions
+// ============================================================================
+#define MOCK_SERVER             "./mockserver"
+#define CRAWLER                 "./crawler"
+#define FIRST_PAGE              "http://localhost/p0"
+#define DEFAULT_PAGES           "1000"
+#define DEFAULT_RETRY_BASE      "10"
+#define MAX_ARGS                64
+#define MAX_LINE                512
+#define LATENCY_PREFIX          "latency:"
+#define URL_PREFIX              "http://"
+#define URL_END                 "\",\t\r\n "
+#define INIT_URLS               1024
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+typedef struct bench_result BenchResult;
+/**
+ * @brief  The result of a run: the pages fetched (unique URLs), the
+ *         fetches (every URL printed), the requests served and bytes sent
+ *         by the server, the time of the crawl, the latency of the fetches,
+ *         the peak RSS of the crawler, and its exit status
+ */
+struct bench_result {
+    long pages;
+    long fetches;
+    long requests;
+    long long bytes;
+    double seconds;
+    double latency_p50_ms;
+    double latency_p99_ms;
+    double latency_max_ms;
+    long peak_rss_kb;
+    int exit_status;
+};
+
+
+// ============================================================================
+// == | Function Prototypes
+// ============================================================================
+// Start the mock server, and read the port it listens on
+pid_t start_server(char **server_args, int num_args, FILE **output,
+                   int *port);
+
+// Crawl the site with the crawler, and take its result
+void run_crawler(char **crawler_args, int num_args, int port,
+                 BenchResult *result);
+
+// Count the unique URLs in an array (it is sorted)
+long count_unique_urls(char **urls, long num_urls);
+
+// Compare two URL strings (for qsort)
+int compare_urls(const void *a, const void *b);
+
+// Stop the mock server, and read the requests served and bytes sent
+void stop_server(pid_t pid, FILE *output, BenchResult *result);
+
+// Print out the result as JSON
+void print_result(FILE *fp, BenchResult *result, char **server_args,
+                  int num_args);
+
+// Get the time of the monotonic clock in seconds
+double get_seconds();
+
+
+// ============================================================================
+// == | Main Functions
+// ============================================================================
+/**
+ * @brief  Run the loopback benchmark and print out its result as JSON
+ *
+ * @param  argc   number of inputs
+ * @param  argv   an array of inputs
+ * @return        0 if the crawler succeeded
+ */
+int main(int argc, char **argv) {
+
+    char *server_args[MAX_ARGS];
+    char server_flags[MAX_ARGS][3];
+    char *crawler_args[MAX_ARGS];
+    int num_server_args = 0;
+    int num_crawler_args = 0;
+    char *pages = DEFAULT_PAGES;
+    char *output_path = NULL;
+    BenchResult result;
+    FILE *server_output;
+    int port;
+    int opt;
+
+    memset(&result, 0, sizeof result);
+
+    while ((opt = getopt(argc, argv, "n:l:b:r:a:u:c:o:")) != -1) {
+        if (opt == 'o') {
+            output_path = optarg;
+            continue;
+        }
+        if (opt == '?' || num_server_args + 2 > MAX_ARGS / 2) {
+            fprintf(stderr, "Usage: %s [-n <pages>] [-l <links>] "
+                            "[-b <page bytes>] [-r <301 %%>] [-a <401 %%>] "
+                            "[-u <503 %%>] [-c <chunked %%>] "
+                            "[-o <file.json>] [-- <crawler options>]\n",
+                    argv[0]);
+            exit(EXIT_FAILURE);
+        }
+        if (opt == 'n') {
+            pages = optarg;
+        }
+
+        // The options of the site are passed to the server as they are
+        snprintf(server_flags[num_server_args], 3, "-%c", opt);
+        server_args[num_server_args]     = server_flags[num_server_args];
+        server_args[num_server_args + 1] = optarg;
+        num_server_args += 2;
+    }
+
+    // The whole site is crawled, unless the crawler options say otherwise
+    crawler_args[num_crawler_args++] = "--max-pages";
+    crawler_args[num_crawler_args++] = pages;
+    crawler_args[num_crawler_args++] = "--retry-base";
+    crawler_args[num_crawler_args++] = DEFAULT_RETRY_BASE;
+    for (int i = optind; i < argc && num_crawler_args < MAX_ARGS - 8; i++) {
+        crawler_args[num_crawler_args++] = argv[i];
+    }
+
+    pid_t server = start_server(server_args, num_server_args,
+                                &server_output, &port);
+    run_crawler(crawler_args, num_crawler_args, port, &result);
+    stop_server(server, server_output, &result);
+
+    FILE *fp = stdout;
+    if (output_path != NULL && (fp = fopen(output_path, "w")) == NULL) {
+        perror("ERROR opening the output file");
+        exit(EXIT_FAILURE);
+    }
+    print_result(fp, &result, server_args, num_server_args);
+    if (fp != stdout) {
+        fclose(fp);
+    }
+
+    return result.exit_status;
+}
+
+
+// ============================================================================
+// == | Auxillary Functions
+// ============================================================================
+/**
+ * @brief  Start the mock server on a free port, and read the port from the
+ *         first line it prints once it is listening
+ *
+ * @param  server_args  the options of the site
+ * @param  num_args     the number of options
+ * @param  output       returns the output of the server
+ * @param  port         returns the port the server listens on
+ * @return              the process of the server
+ */
+pid_t start_server(char **server_args, int num_args, FILE **output,
+                   int *port) {
+
+    char *args[MAX_ARGS];
+    char line[MAX_LINE];
+    int fds[2];
+    int num = 0;
+
+    args[num++] = MOCK_SERVER;
+    args[num++] = "-p";
+    args[num++] = "0";
+    for (int i = 0; i < num_args; i++) {
+        args[num++] = server_args[i];
+    }
+    args[num] = NULL;
+
+    if (pipe(fds) < 0) {
+        perror("ERROR creating pipe");
+        exit(EXIT_FAILURE);
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("ERROR forking");
+        exit(EXIT_FAILURE);
+    }
+    if (pid == 0) {
+        dup2(fds[1], STDOUT_FILENO);
+        close(fds[0]);
+        close(fds[1]);
+        execv(MOCK_SERVER, args);
+        perror("ERROR starting " MOCK_SERVER);
+        _exit(EXIT_FAILURE);
+    }
+    close(fds[1]);
+
+    *output = fdopen(fds[0], "r");
+    if (*output == NULL || fgets(line, sizeof line, *output) == NULL
+        || sscanf(line, "port %d", port) != 1) {
+        fprintf(stderr, "Error: start_server() the server did not start\n");
+        exit(EXIT_FAILURE);
+    }
+
+    return pid;
+}
+
+
+/**
+ * @brief  Crawl the site with the crawler through the port of the server:
+ *         time it, count the URLs it prints (all of them, and the unique
+ *         ones), take the latency from its statistics and its peak RSS
+ *
+ * @param  crawler_args   the options of the crawler
+ * @param  num_args       the number of options
+ * @param  port           the port of the server
+ * @param  result         the result will be set
+ */
+void run_crawler(char **crawler_args, int num_args, int port,
+                 BenchResult *result) {
+
+    char *args[MAX_ARGS];
+    char port_arg[16];
+    char line[MAX_LINE];
+    struct rusage usage;
+    int fds[2];
+    int status;
+    int num = 0;
+
+    snprintf(port_arg, sizeof port_arg, "%d", port);
+    args[num++] = CRAWLER;
+    args[num++] = "--port";
+    args[num++] = port_arg;
+    args[num++] = "--stats";
+    for (int i = 0; i < num_args; i++) {
+        args[num++] = crawler_args[i];
+    }
+    args[num++] = FIRST_PAGE;
+    args[num]   = NULL;
+
+    // The statistics go into a temporary file, the URLs into a pipe
+    FILE *stats = tmpfile();
+    if (stats == NULL || pipe(fds) < 0) {
+        perror("ERROR creating the crawler output");
+        exit(EXIT_FAILURE);
+    }
+
+    double start = get_seconds();
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("ERROR forking");
+        exit(EXIT_FAILURE);
+    }
+    if (pid == 0) {
+        dup2(fds[1], STDOUT_FILENO);
+        dup2(fileno(stats), STDERR_FILENO);
+        close(fds[0]);
+        close(fds[1]);
+        execv(CRAWLER, args);
+        perror("ERROR starting " CRAWLER);
+        _exit(EXIT_FAILURE);
+    }
+    close(fds[1]);
+
+    // Keep the URL at the start of each line (in any output format)
+    long num_fetched = 0;
+    long max_fetched = INIT_URLS;
+    char **fetched = (char **)malloc(max_fetched * sizeof *fetched);
+    if (fetched == NULL) {
+        fprintf(stderr, "Error: run_crawler() malloc returned NULL\n");
+        exit(EXIT_FAILURE);
+    }
+
+    FILE *urls = fdopen(fds[0], "r");
+    bool isLineStart = true;
+    while (fgets(line, sizeof line, urls) != NULL) {
+        bool isLineEnd = strchr(line, '\n') != NULL;
+        char *url = strstr(line, URL_PREFIX);
+        if (isLineStart && url != NULL) {
+            if (num_fetched == max_fetched) {
+                max_fetched *= 2;
+                fetched = (char **)realloc(fetched,
+                                           max_fetched * sizeof *fetched);
+                if (fetched == NULL) {
+                    fprintf(stderr, "Error: run_crawler() realloc returned "
+                                    "NULL\n");
+                    exit(EXIT_FAILURE);
+                }
+            }
+            url[strcspn(url, URL_END)] = '\0';
+            fetched[num_fetched++] = strdup(url);
+        }
+
+        isLineStart = isLineEnd;
+        if (isLineEnd) {
+            result->fetches++;
+        }
+    }
+    fclose(urls);
+
+    result->pages = count_unique_urls(fetched, num_fetched);
+    for (long i = 0; i < num_fetched; i++) {
+        free(fetched[i]);
+    }
+    free(fetched);
+
+    if (wait4(pid, &status, 0, &usage) < 0) {
+        perror("ERROR waiting for the crawler");
+        exit(EXIT_FAILURE);
+    }
+    result->seconds     = get_seconds() - start;
+    result->peak_rss_kb = usage.ru_maxrss;
+    result->exit_status = WIFEXITED(status) ? WEXITSTATUS(status)
+                                            : EXIT_FAILURE;
+
+    rewind(stats);
+    while (fgets(line, sizeof line, stats) != NULL) {
+        if (strncmp(line, LATENCY_PREFIX, strlen(LATENCY_PREFIX)) == 0) {
+            sscanf(line, LATENCY_PREFIX " %*d fetches, p50 %lf ms, "
+                         "p99 %lf ms, max %lf ms",
+                   &result->latency_p50_ms, &result->latency_p99_ms,
+                   &result->latency_max_ms);
+        } else if (strncmp(line, "Error", strlen("Error")) == 0) {
+            fputs(line, stderr);
+        }
+    }
+    fclose(stats);
+}
+
+
+/**
+ * @brief  Count the unique URLs in an array, sorting it first
+ *
+ * @param  urls       an array of URL strings
+ * @param  num_urls   the number of URLs
+ * @return            the number of unique URLs
+ */
+long count_unique_urls(char **urls, long num_urls) {
+
+    qsort(urls, num_urls, sizeof *urls, compare_urls);
+
+    long unique = 0;
+    for (long i = 0; i < num_urls; i++) {
+        if (i == 0 || strcmp(urls[i], urls[i - 1]) != 0) {
+            unique++;
+        }
+    }
+
+    return unique;
+}
+
+
+/**
+ * @brief  Compare two URL strings (for qsort)
+ *
+ * @param  a      a pointer to a URL string
+ * @param  b      a pointer to another URL string
+ * @return        negative, zero or positive as a is before, the same as
+ *                or after b
+ */
+int compare_urls(const void *a, const void *b) {
+
+    return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+
+/**
+ * @brief  Stop the mock server, and read the requests served and the bytes
+ *         sent from the last line it prints
+ *
+ * @param  pid      the process of the server
+ * @param  output   the output of the server
+ * @param  result   the result will be set
+ */
+void stop_server(pid_t pid, FILE *output, BenchResult *result) {
+
+    char line[MAX_LINE];
+
+    kill(pid, SIGTERM);
+    while (fgets(line, sizeof line, output) != NULL) {
+        sscanf(line, "requests %ld bytes %lld", &result->requests,
+               &result->bytes);
+    }
+    fclose(output);
+    waitpid(pid, NULL, 0);
+}
+
+
+/**
+ * @brief  Print out the result as JSON, with the options of the site
+ *
+ * @param  fp           the file to print into
+ * @param  result       the result
+ * @param  server_args  the options of the site
+ * @param  num_args     the number of options
+ */
+void print_result(FILE *fp, BenchResult *result, char **server_args,
+                  int num_args) {
+
+    double seconds = (result->seconds > 0) ? result->seconds : 1;
+
+    fprintf(fp, "{\n  \"site\": {");
+    for (int i = 0; i + 1 < num_args; i += 2) {
+        fprintf(fp, "%s\"%c\": %s", (i > 0) ? ", " : "",
+                server_args[i][1], server_args[i + 1]);
+    }
+    fprintf(fp, "},\n");
+    fprintf(fp, "  \"pages\": %ld,\n", result->pages);
+    fprintf(fp, "  \"fetches\": %ld,\n", result->fetches);
+    fprintf(fp, "  \"requests\": %ld,\n", result->requests);
+    fprintf(fp, "  \"bytes\": %lld,\n", result->bytes);
+    fprintf(fp, "  \"seconds\": %.6f,\n", result->seconds);
+    fprintf(fp, "  \"pages_per_sec\": %.1f,\n", result->pages / seconds);
+    fprintf(fp, "  \"bytes_per_sec\": %.1f,\n", result->bytes / seconds);
+    fprintf(fp, "  \"latency_p50_ms\": %.3f,\n", result->latency_p50_ms);
+    fprintf(fp, "  \"latency_p99_ms\": %.3f,\n", result->latency_p99_ms);
+    fprintf(fp, "  \"latency_max_ms\": %.3f,\n", result->latency_max_ms);
+    fprintf(fp, "  \"peak_rss_kb\": %ld,\n", result->peak_rss_kb);
+    fprintf(fp, "  \"exit_status\": %d\n}\n", result->exit_status);
+}
+
+
+/**
+ * @brief  Get the time of the monotonic clock in seconds
+ *
+ * @return        the current time in seconds
+ */
+double get_seconds() {
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
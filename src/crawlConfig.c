@@ -0,0 +1,636 @@
+/**
+ * @file      crawlConfig.c
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     Implementation of crawler configuration module. It includes
+ *              1. the default value of each crawler option
+ *              2. parsing the command line options and the first URL
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#include "crawlConfig.h"
+
+#include "utilities.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <assert.h>
+#include <getopt.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+
+// ============================================================================
+// == | Constant Definitions
+// ============================================================================
+#define SHORT_OPTIONS           "c:p:i:t:w:s"
+#define OPT_DNS_CACHE_SIZE      1000
+#define OPT_DNS_TTL             1001
+#define OPT_DNS_NEG_TTL         1002
+#define OPT_MAX_BODY            1003
+#define OPT_SORT_OUTPUT         1004
+#define OPT_SHARDED             1005
+#define OPT_HOST_DELAY          1006
+#define OPT_MAX_RETRIES         1007
+#define OPT_RETRY_BASE          1008
+#define OPT_MAX_PAGES           1009
+#define OPT_SPILL_DIR           1010
+#define OPT_SPILL_HIGH          1011
+#define OPT_SPILL_LOW           1012
+#define OPT_VISITED_FILTER      1013
+#define OPT_FILTER_FP           1014
+#define OPT_FILTER_CONFIRM      1015
+#define OPT_FILTER_LOAD         1016
+#define OPT_FILTER_SAVE         1017
+#define OPT_CHECKPOINT          1018
+#define OPT_CHECKPOINT_INTERVAL 1019
+#define OPT_RESUME              1020
+#define OPT_PORT                1021
+#define OPT_METRICS             1022
+#define OPT_TRACE               1023
+#define OPT_TRACE_EVENTS        1024
+#define OPT_PERF_STAGES         1025
+#define OPT_STATS_INTERVAL      1026
+#define OPT_STATS_SOCKET        1027
+#define OPT_FORMAT              1028
+#define OPT_OUTPUT              1029
+#define OPT_FLUSH_INTERVAL      1030
+#define MAX_OPTION_VALUE        65535
+#define MAX_BODY_OPTION_VALUE   (1 << 30)
+#define MAX_WORKERS_OPTION_VALUE 1024
+#define MAX_TRACE_OPTION_VALUE  (1 << 24)
+#define MAX_PAGES_OPTION_VALUE  (1 << 30)
+#define MAX_FILTER_OPTION_VALUE INT_MAX
+
+
+// ============================================================================
+// == | Function Prototypes
+// ============================================================================
+// Parse a positive integer option value up to the maximum
+bool parse_positive_int(char *value, int max, int *result);
+
+// Parse an integer option value in a range
+bool parse_int_range(char *value, int min, int max, int *result);
+
+// Parse a rate option value between 0 and 1 (both excluded)
+bool parse_rate(char *value, double *result);
+
+// Get the number of online processor cores
+int get_num_cores();
+
+
+// ============================================================================
+// == | Module Functions
+// ============================================================================
+/**
+ * @brief  Parse the command line options and the first URL into a CrawlConfig
+ *         Options which are not given keep their default value
+ *
+ * @param  argc     number of inputs
+ * @param  argv     an array of inputs
+ * @param  config   a CrawlConfig data
+ * @return true     If the options are valid and the first URL is given
+ * @return false    If any option is invalid or the first URL is missing
+ */
+bool parse_config(int argc, char **argv, CrawlConfig *config) {
+
+    static struct option long_options[] = {
+        {"concurrency",      required_argument, NULL, 'c'},
+        {"per-host",         required_argument, NULL, 'p'},
+        {"idle-timeout",     required_argument, NULL, 'i'},
+        {"fetch-timeout",    required_argument, NULL, 't'},
+        {"workers",          required_argument, NULL, 'w'},
+        {"stats",            no_argument,       NULL, 's'},
+        {"dns-cache-size",   required_argument, NULL, OPT_DNS_CACHE_SIZE},
+        {"dns-ttl",          required_argument, NULL, OPT_DNS_TTL},
+        {"dns-negative-ttl", required_argument, NULL, OPT_DNS_NEG_TTL},
+        {"max-body",         required_argument, NULL, OPT_MAX_BODY},
+        {"sort-output",      no_argument,       NULL, OPT_SORT_OUTPUT},
+        {"sharded",          no_argument,       NULL, OPT_SHARDED},
+        {"host-delay",       required_argument, NULL, OPT_HOST_DELAY},
+        {"max-retries",      required_argument, NULL, OPT_MAX_RETRIES},
+        {"retry-base",       required_argument, NULL, OPT_RETRY_BASE},
+        {"max-pages",        required_argument, NULL, OPT_MAX_PAGES},
+        {"spill-dir",        required_argument, NULL, OPT_SPILL_DIR},
+        {"spill-high",       required_argument, NULL, OPT_SPILL_HIGH},
+        {"spill-low",        required_argument, NULL, OPT_SPILL_LOW},
+        {"visited-filter",   required_argument, NULL, OPT_VISITED_FILTER},
+        {"filter-fp",        required_argument, NULL, OPT_FILTER_FP},
+        {"filter-confirm",   required_argument, NULL, OPT_FILTER_CONFIRM},
+        {"filter-load",      required_argument, NULL, OPT_FILTER_LOAD},
+        {"filter-save",      required_argument, NULL, OPT_FILTER_SAVE},
+        {"checkpoint",       required_argument, NULL, OPT_CHECKPOINT},
+        {"checkpoint-interval", required_argument, NULL,
+                                                OPT_CHECKPOINT_INTERVAL},
+        {"resume",           no_argument,       NULL, OPT_RESUME},
+        {"port",             required_argument, NULL, OPT_PORT},
+        {"metrics",          required_argument, NULL, OPT_METRICS},
+        {"trace",            required_argument, NULL, OPT_TRACE},
+        {"trace-events",     required_argument, NULL, OPT_TRACE_EVENTS},
+        {"perf-stages",      no_argument,       NULL, OPT_PERF_STAGES},
+        {"stats-interval",   required_argument, NULL, OPT_STATS_INTERVAL},
+        {"stats-socket",     required_argument, NULL, OPT_STATS_SOCKET},
+        {"format",           required_argument, NULL, OPT_FORMAT},
+        {"output",           required_argument, NULL, OPT_OUTPUT},
+        {"flush-interval",   required_argument, NULL, OPT_FLUSH_INTERVAL},
+        {NULL,               0,                 NULL, 0}
+    };
+
+    int opt;
+
+    assert(config != NULL);
+
+    // Initialise the default value of the options
+    config->first_url          = NULL;
+    config->spill_dir          = NULL;
+    config->filter_confirm     = NULL;
+    config->filter_load        = NULL;
+    config->filter_save        = NULL;
+    config->checkpoint         = NULL;
+    config->metrics            = NULL;
+    config->trace              = NULL;
+    config->stats_socket       = NULL;
+    config->output             = NULL;
+    config->server_port        = DEFAULT_SERVER_PORT;
+    config->max_inflight       = DEFAULT_MAX_INFLIGHT;
+    config->max_per_host       = DEFAULT_MAX_PER_HOST;
+    config->host_delay_ms      = DEFAULT_HOST_DELAY_MS;
+    config->max_retries        = DEFAULT_MAX_RETRIES;
+    config->retry_base_ms      = DEFAULT_RETRY_BASE_MS;
+    config->idle_timeout_ms    = DEFAULT_IDLE_TIMEOUT_MS;
+    config->fetch_timeout_ms   = DEFAULT_FETCH_TIMEOUT_MS;
+    config->dns_cache_size     = DEFAULT_DNS_CACHE_SIZE;
+    config->dns_ttl_s          = DEFAULT_DNS_TTL_S;
+    config->dns_negative_ttl_s = DEFAULT_DNS_NEG_TTL_S;
+    config->max_body_bytes     = DEFAULT_MAX_BODY_BYTES;
+    config->max_pages          = MAX_FETCH;
+    config->spill_high         = DEFAULT_SPILL_HIGH;
+    config->spill_low          = DEFAULT_SPILL_LOW;
+    config->filter_size        = 0;
+    config->filter_fp_rate     = DEFAULT_FILTER_FP_RATE;
+    config->checkpoint_ms      = DEFAULT_CHECKPOINT_MS;
+    config->trace_events       = DEFAULT_TRACE_EVENTS;
+    config->stats_interval_ms  = 0;
+    config->flush_ms           = 0;
+    config->output_format      = FORMAT_PLAIN;
+    config->num_workers        = get_num_cores();
+    config->sort_output        = false;
+    config->sharded            = false;
+    config->resume             = false;
+    config->perf_stages        = false;
+    config->show_stats         = false;
+
+    while ((opt = getopt_long(argc, argv, SHORT_OPTIONS, long_options, NULL))
+           != -1) {
+        switch (opt) {
+            case 'c':
+                // The maximum number of requests in flight
+                if (!parse_positive_int(optarg, MAX_OPTION_VALUE,
+                                        &config->max_inflight)) {
+                    return false;
+                }
+                break;
+            case 'p':
+                // The maximum number of requests in flight to one host
+                if (!parse_positive_int(optarg, MAX_OPTION_VALUE,
+                                        &config->max_per_host)) {
+                    return false;
+                }
+                break;
+            case 'i':
+                // The time an idle keep-alive connection is kept
+                if (!parse_positive_int(optarg, MAX_OPTION_VALUE,
+                                        &config->idle_timeout_ms)) {
+                    return false;
+                }
+                break;
+            case 't':
+                // The time a fetch waits to connect, send or receive
+                if (!parse_positive_int(optarg, MAX_OPTION_VALUE,
+                                        &config->fetch_timeout_ms)) {
+                    return false;
+                }
+                break;
+            case 'w':
+                // The number of crawl worker threads
+                if (!parse_positive_int(optarg, MAX_WORKERS_OPTION_VALUE,
+                                        &config->num_workers)) {
+                    return false;
+                }
+                break;
+            case OPT_SORT_OUTPUT:
+                // Print out the fetched URLs in sorted order
+                config->sort_output = true;
+                break;
+            case OPT_HOST_DELAY:
+                // The delay between two fetches of a host
+                if (!parse_int_range(optarg, 0, MAX_OPTION_VALUE,
+                                     &config->host_delay_ms)) {
+                    return false;
+                }
+                break;
+            case OPT_MAX_RETRIES:
+                // The number of times a URL is retried if the server is
+                // unavailable
+                if (!parse_int_range(optarg, 0, MAX_OPTION_VALUE,
+                                     &config->max_retries)) {
+                    return false;
+                }
+                break;
+            case OPT_RETRY_BASE:
+                // The delay before the first retry
+                if (!parse_positive_int(optarg, MAX_OPTION_VALUE,
+                                        &config->retry_base_ms)) {
+                    return false;
+                }
+                break;
+            case OPT_SHARDED:
+                // Partition the URLs between the workers
+                config->sharded = true;
+                break;
+            case 's':
+                // Print out the crawl statistics when it finishes
+                config->show_stats = true;
+                break;
+            case OPT_DNS_CACHE_SIZE:
+                // The maximum number of hostnames in the DNS cache
+                if (!parse_positive_int(optarg, MAX_OPTION_VALUE,
+                                        &config->dns_cache_size)) {
+                    return false;
+                }
+                break;
+            case OPT_DNS_TTL:
+                // The time a valid hostname is cached
+                if (!parse_positive_int(optarg, MAX_OPTION_VALUE,
+                                        &config->dns_ttl_s)) {
+                    return false;
+                }
+                break;
+            case OPT_DNS_NEG_TTL:
+                // The time an invalid hostname is cached
+                if (!parse_positive_int(optarg, MAX_OPTION_VALUE,
+                                        &config->dns_negative_ttl_s)) {
+                    return false;
+                }
+                break;
+            case OPT_MAX_BODY:
+                // The maximum content of a response kept
+                if (!parse_positive_int(optarg, MAX_BODY_OPTION_VALUE,
+                                        &config->max_body_bytes)) {
+                    return false;
+                }
+                break;
+            case OPT_MAX_PAGES:
+                // The maximum number of URLs fetched
+                if (!parse_positive_int(optarg, MAX_PAGES_OPTION_VALUE,
+                                        &config->max_pages)) {
+                    return false;
+                }
+                break;
+            case OPT_SPILL_DIR:
+                // Spill the URLs will be fetched into this directory
+                config->spill_dir = optarg;
+                break;
+            case OPT_SPILL_HIGH:
+                // The number of URLs in memory to spill at
+                if (!parse_positive_int(optarg, MAX_PAGES_OPTION_VALUE,
+                                        &config->spill_high)) {
+                    return false;
+                }
+                break;
+            case OPT_SPILL_LOW:
+                // The number of URLs in memory to reload the spilled below
+                if (!parse_positive_int(optarg, MAX_PAGES_OPTION_VALUE,
+                                        &config->spill_low)) {
+                    return false;
+                }
+                break;
+            case OPT_VISITED_FILTER:
+                // Check the seen URLs with a Bloom filter for this many
+                if (!parse_positive_int(optarg, MAX_FILTER_OPTION_VALUE,
+                                        &config->filter_size)) {
+                    return false;
+                }
+                break;
+            case OPT_FILTER_FP:
+                // The target false positive rate of the filter
+                if (!parse_rate(optarg, &config->filter_fp_rate)) {
+                    return false;
+                }
+                break;
+            case OPT_FILTER_CONFIRM:
+                // Confirm the URLs the filter takes as seen in this file
+                config->filter_confirm = optarg;
+                break;
+            case OPT_FILTER_LOAD:
+                // Start with the filter saved into this file
+                config->filter_load = optarg;
+                break;
+            case OPT_FILTER_SAVE:
+                // Save the filter into this file once the crawl finishes
+                config->filter_save = optarg;
+                break;
+            case OPT_CHECKPOINT:
+                // Keep a journal of the crawl in this file
+                config->checkpoint = optarg;
+                break;
+            case OPT_CHECKPOINT_INTERVAL:
+                // The time between two writes of the journal
+                if (!parse_positive_int(optarg, MAX_OPTION_VALUE,
+                                        &config->checkpoint_ms)) {
+                    return false;
+                }
+                break;
+            case OPT_RESUME:
+                // Resume the crawl kept in the journal
+                config->resume = true;
+                break;
+            case OPT_PORT:
+                // The port the servers are connected on
+                if (!parse_positive_int(optarg, MAX_OPTION_VALUE,
+                                        &config->server_port)) {
+                    return false;
+                }
+                break;
+            case OPT_METRICS:
+                // Write the crawl metrics into this file ("-" for stderr)
+                config->metrics = optarg;
+                break;
+            case OPT_TRACE:
+                // Write the trace of the fetches into this file
+                config->trace = optarg;
+                break;
+            case OPT_TRACE_EVENTS:
+                // The events a worker keeps before they are written
+                if (!parse_positive_int(optarg, MAX_TRACE_OPTION_VALUE,
+                                        &config->trace_events)) {
+                    return false;
+                }
+                break;
+            case OPT_PERF_STAGES:
+                // Count each stage with the hardware performance counters
+                config->perf_stages = true;
+                break;
+            case OPT_STATS_INTERVAL:
+                // Print a line of the statistics at this interval
+                if (!parse_positive_int(optarg, MAX_OPTION_VALUE,
+                                        &config->stats_interval_ms)) {
+                    return false;
+                }
+                break;
+            case OPT_STATS_SOCKET:
+                // Serve the statistics as JSON on this Unix socket
+                config->stats_socket = optarg;
+                break;
+            case OPT_FORMAT:
+                // The format the results are written in
+                if (!parse_output_format(optarg, &config->output_format)) {
+                    return false;
+                }
+                break;
+            case OPT_OUTPUT:
+                // Write the results into this file instead of stdout
+                config->output = optarg;
+                break;
+            case OPT_FLUSH_INTERVAL:
+                // Write the results buffered out at this interval
+                if (!parse_positive_int(optarg, MAX_OPTION_VALUE,
+                                        &config->flush_ms)) {
+                    return false;
+                }
+                break;
+            default:
+                return false;
+        }
+    }
+
+    // The URLs spilled are reloaded before the URLs in memory run out
+    if (config->spill_low > config->spill_high) {
+        fprintf(stderr, "Invalid option value: --spill-low %d is above "
+                        "--spill-high %d\n",
+                config->spill_low, config->spill_high);
+        return false;
+    }
+
+    // The filter options need a filter, sized or loaded
+    if (config->filter_size == 0 && config->filter_load == NULL
+        && (config->filter_confirm != NULL || config->filter_save != NULL)) {
+        fprintf(stderr, "Invalid option: the filter options need "
+                        "--visited-filter or --filter-load\n");
+        return false;
+    }
+
+    // The crawl is resumed from its journal
+    if (config->resume && config->checkpoint == NULL) {
+        fprintf(stderr, "Invalid option: --resume needs --checkpoint\n");
+        return false;
+    }
+
+    // Only the plain results are kept to be sorted, the others are written
+    // as each fetch is completed
+    if (config->sort_output && config->output_format != FORMAT_PLAIN) {
+        fprintf(stderr, "Invalid option: --sort-output needs the plain "
+                        "format\n");
+        return false;
+    }
+
+    // Exactly one URL should be given after the options
+    if (optind != argc - 1) {
+        return false;
+    }
+    config->first_url = argv[optind];
+
+    return true;
+}
+
+
+/**
+ * @brief  Print out the usage of the crawler
+ *
+ * @param  program  the name of the program
+ */
+void print_usage(char *program) {
+    fprintf(stderr, "Usage: %s [options] <URL> \n"
+                    "  -c, --concurrency <n>   maximum requests in flight "
+                    "(default %d)\n"
+                    "  -p, --per-host <n>      maximum requests in flight "
+                    "to one host (default %d)\n"
+                    "      --host-delay <ms>   delay between two fetches of "
+                    "a host (default %d)\n"
+                    "      --max-retries <n>   retries of a URL the server "
+                    "is unavailable for (default %d)\n"
+                    "      --retry-base <ms>   delay before the first retry, "
+                    "doubled each retry (default %d)\n"
+                    "  -i, --idle-timeout <ms> time an idle connection is "
+                    "kept (default %d)\n"
+                    "  -t, --fetch-timeout <ms> time a fetch waits to "
+                    "connect, send or receive\n"
+                    "                          (default %d)\n"
+                    "  -w, --workers <n>       crawl worker threads "
+                    "(default one per core, at most -c)\n"
+                    "  -s, --stats             print crawl statistics to "
+                    "stderr\n"
+                    "      --dns-cache-size <n>   maximum hostnames cached "
+                    "(default %d)\n"
+                    "      --dns-ttl <s>          time a valid hostname is "
+                    "cached (default %d)\n"
+                    "      --dns-negative-ttl <s> time an invalid hostname "
+                    "is cached (default %d)\n"
+                    "      --max-body <bytes>     maximum content of a page "
+                    "kept (default %d)\n"
+                    "      --sort-output          print the fetched URLs in "
+                    "sorted order\n"
+                    "      --sharded              partition the URLs "
+                    "between the workers\n"
+                    "      --max-pages <n>        maximum URLs fetched "
+                    "(default %d)\n"
+                    "      --spill-dir <dir>      spill the URLs will be "
+                    "fetched to disk in dir\n"
+                    "      --spill-high <n>       URLs in memory of a worker "
+                    "to spill at (default %d)\n"
+                    "      --spill-low <n>        URLs in memory of a worker "
+                    "to reload below (default %d)\n"
+                    "      --visited-filter <n>   check the seen URLs with "
+                    "a Bloom filter sized for n\n"
+                    "      --filter-fp <rate>     target false positive rate "
+                    "of the filter (default %g)\n"
+                    "      --filter-confirm <file> confirm the URLs the "
+                    "filter takes as seen on disk\n"
+                    "      --filter-load <file>   start with the filter "
+                    "saved into file\n"
+                    "      --filter-save <file>   save the filter into file "
+                    "once the crawl finishes\n"
+                    "      --checkpoint <file>    keep a journal of the "
+                    "crawl in file\n"
+                    "      --checkpoint-interval <ms> time between two "
+                    "writes of the journal (default %d)\n"
+                    "      --resume               resume the crawl kept in "
+                    "the journal\n"
+                    "      --port <n>             port the servers are "
+                    "connected on (default %d)\n"
+                    "      --metrics <file>       write the crawl metrics "
+                    "as JSON into file at exit\n"
+                    "                             and on SIGUSR1 (\"-\" "
+                    "for stderr)\n"
+                    "      --trace <file>         write a trace of the "
+                    "lifecycle of each URL into file\n"
+                    "      --trace-events <n>     events a worker keeps "
+                    "before they are written\n"
+                    "                             (default %d, dropped "
+                    "beyond)\n"
+                    "      --perf-stages          count cycles, "
+                    "instructions and misses of each\n"
+                    "                             stage, reported per "
+                    "page and KB of HTML\n"
+                    "      --stats-interval <ms>  print a line of the "
+                    "crawl statistics to stderr\n"
+                    "                             at this interval\n"
+                    "      --stats-socket <path>  serve the crawl "
+                    "statistics as JSON on a Unix\n"
+                    "                             socket\n"
+                    "      --format <name>        format of the results: "
+                    "plain (default), jsonl\n"
+                    "                             or binary\n"
+                    "      --output <file>        write the results into "
+                    "file instead of stdout\n"
+                    "      --flush-interval <ms>  write the results "
+                    "buffered out at this interval\n",
+            program, DEFAULT_MAX_INFLIGHT, DEFAULT_MAX_PER_HOST,
+            DEFAULT_HOST_DELAY_MS, DEFAULT_MAX_RETRIES, DEFAULT_RETRY_BASE_MS,
+            DEFAULT_IDLE_TIMEOUT_MS, DEFAULT_FETCH_TIMEOUT_MS,
+            DEFAULT_DNS_CACHE_SIZE,
+            DEFAULT_DNS_TTL_S, DEFAULT_DNS_NEG_TTL_S, DEFAULT_MAX_BODY_BYTES,
+            MAX_FETCH, DEFAULT_SPILL_HIGH, DEFAULT_SPILL_LOW,
+            DEFAULT_FILTER_FP_RATE, DEFAULT_CHECKPOINT_MS,
+            DEFAULT_SERVER_PORT, DEFAULT_TRACE_EVENTS);
+}
+
+
+// ============================================================================
+// == | Auxillary Functions
+// ============================================================================
+/**
+ * @brief  Parse a positive integer option value up to the maximum
+ *
+ * @param  value    the option value string
+ * @param  max      the maximum value
+ * @param  result   the integer will be set
+ * @return true     If the value is a positive integer up to the maximum
+ * @return false    If the value is not a positive integer or too large
+ */
+bool parse_positive_int(char *value, int max, int *result) {
+
+    return parse_int_range(value, 1, max, result);
+}
+
+
+/**
+ * @brief  Parse an integer option value from the minimum up to the maximum
+ *
+ * @param  value    the option value string
+ * @param  min      the minimum value
+ * @param  max      the maximum value
+ * @param  result   the integer will be set
+ * @return true     If the value is an integer from the minimum to maximum
+ * @return false    If the value is not an integer or out of the range
+ */
+bool parse_int_range(char *value, int min, int max, int *result) {
+
+    char *end;
+    long num = strtol(value, &end, 10);
+
+    if (end == value || *end != NULL_TERMINATED || num < min || num > max) {
+        fprintf(stderr, "Invalid option value: %s\n", value);
+        return false;
+    }
+
+    *result = (int)num;
+    return true;
+}
+
+
+/**
+ * @brief  Parse a rate option value between 0 and 1 (both excluded)
+ *
+ * @param  value    the option value string
+ * @param  result   the rate will be set
+ * @return true     If the value is a number between 0 and 1
+ * @return false    If the value is not a number or out of the range
+ */
+bool parse_rate(char *value, double *result) {
+
+    char *end;
+    double rate = strtod(value, &end);
+
+    if (end == value || *end != NULL_TERMINATED || !(rate > 0 && rate < 1)) {
+        fprintf(stderr, "Invalid option value: %s\n", value);
+        return false;
+    }
+
+    *result = rate;
+    return true;
+}
+
+
+/**
+ * @brief  Get the number of online processor cores
+ *
+ * @return          the number of cores (at least one)
+ */
+int get_num_cores() {
+
+    long num_cores = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (num_cores < 1) {
+        return 1;
+    }
+    if (num_cores > MAX_WORKERS_OPTION_VALUE) {
+        return MAX_WORKERS_OPTION_VALUE;
+    }
+
+    return (int)num_cores;
+}
@@ -0,0 +1,102 @@
+/**
+ * @file      crawlConfig.h
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     Crawler configuration module. It includes
+ *              1. the default value of each crawler option
+ *              2. parsing the command line options and the first URL
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#ifndef CRAWLCONFIG_H
+#define CRAWLCONFIG_H
+
+#include "resultWriter.h"
+
+#include <stdbool.h>
+
+
+// ============================================================================
+// == | Constant Definitions
+// ============================================================================
+#define DEFAULT_MAX_INFLIGHT    16
+#define DEFAULT_MAX_PER_HOST    8
+#define DEFAULT_HOST_DELAY_MS   0
+#define DEFAULT_MAX_RETRIES     5
+#define DEFAULT_RETRY_BASE_MS   500
+#define DEFAULT_IDLE_TIMEOUT_MS 4000
+#define DEFAULT_FETCH_TIMEOUT_MS 10000
+#define DEFAULT_DNS_CACHE_SIZE  4096
+#define DEFAULT_DNS_TTL_S       300
+#define DEFAULT_DNS_NEG_TTL_S   30
+#define DEFAULT_MAX_BODY_BYTES  1048576
+#define DEFAULT_SPILL_HIGH      65536
+#define DEFAULT_SPILL_LOW       16384
+#define DEFAULT_FILTER_FP_RATE  0.001
+#define DEFAULT_CHECKPOINT_MS   1000
+#define DEFAULT_SERVER_PORT     80
+#define DEFAULT_TRACE_EVENTS    16384
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+typedef struct crawl_config CrawlConfig;
+/**
+ * @brief  The CrawlConfig include the first URL (the input) and the
+ *         options of the crawler
+ */
+struct crawl_config {
+    char *first_url;
+    char *spill_dir;
+    char *filter_confirm;
+    char *filter_load;
+    char *filter_save;
+    char *checkpoint;
+    char *metrics;
+    char *trace;
+    char *stats_socket;
+    char *output;
+    int server_port;
+    int max_inflight;
+    int max_per_host;
+    int host_delay_ms;
+    int max_retries;
+    int retry_base_ms;
+    int idle_timeout_ms;
+    int fetch_timeout_ms;
+    int dns_cache_size;
+    int dns_ttl_s;
+    int dns_negative_ttl_s;
+    int max_body_bytes;
+    int max_pages;
+    int spill_high;
+    int spill_low;
+    int filter_size;
+    double filter_fp_rate;
+    int checkpoint_ms;
+    int trace_events;
+    int stats_interval_ms;
+    int flush_ms;
+    OutputFormat output_format;
+    int num_workers;
+    bool sort_output;
+    bool sharded;
+    bool resume;
+    bool perf_stages;
+    bool show_stats;
+};
+
+
+// ============================================================================
+// == | Module Functions
+// ============================================================================
+// Parse the command line options and the first URL into a CrawlConfig
+bool parse_config(int argc, char **argv, CrawlConfig *config);
+
+// Print out the usage of the crawler
+void print_usage(char *program);
+
+
+#endif
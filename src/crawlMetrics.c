@@ -0,0 +1,252 @@
+/**
+ * @file      crawlMetrics.c
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     Implementation of crawl metrics module. It includes
+ *              1. creating and destroying the metrics of a crawl worker
+ *              2. recording the time of each phase of a fetch into a
+ *                 histogram, and counting bytes, responses by status code
+ *                 and links
+ *              3. merging the metrics of the workers, and printing them
+ *                 out as JSON
+ *            Only the worker writes its metrics, so a counter is not
+ *            updated atomically, but it is stored and loaded whole, like
+ *            the histograms, so another thread can merge them at any time
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#include "crawlMetrics.h"
+
+#include "histogram.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <assert.h>
+#include <stdbool.h>
+
+
+// ============================================================================
+// == | Constant Definitions
+// ============================================================================
+#define MIN_STATUS_CODE     100
+#define MAX_STATUS_CODE     599
+#define NUM_STATUS_CODES    (MAX_STATUS_CODE - MIN_STATUS_CODE + 2)
+#define OTHER_STATUS        (NUM_STATUS_CODES - 1)
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+/**
+ * @brief  The metrics include a histogram of the time of each phase (in
+ *         microseconds), the counters, and the number of responses of each
+ *         status code (the last one counts the codes out of range)
+ */
+struct crawl_metrics {
+    Histogram *phases[NUM_PHASES];
+    long counters[NUM_COUNTERS];
+    long statuses[NUM_STATUS_CODES];
+};
+
+
+// ============================================================================
+// == | Global Variables
+// ============================================================================
+// The names of the phases and counters in the JSON object
+static const char *phase_names[NUM_PHASES] = {
+    "setup", "connect", "send", "wait", "receive", "header", "parse_html"
+};
+static const char *counter_names[NUM_COUNTERS] = {
+    "bytes_sent", "bytes_received", "connections", "connections_reused",
+    "fetch_errors", "pages_parsed", "links_extracted", "links_new",
+    "links_deduped", "links_rejected"
+};
+
+
+// ============================================================================
+// == | Module Functions
+// ============================================================================
+/**
+ * @brief  Create new empty metrics
+ *
+ * @return        the pointer of new metrics
+ */
+CrawlMetrics *new_CrawlMetrics() {
+
+    CrawlMetrics *metrics = (CrawlMetrics *)calloc(1, sizeof *metrics);
+    if (metrics == NULL) {
+        fprintf(stderr, "Error: new_CrawlMetrics() calloc returned NULL\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int i = 0; i < NUM_PHASES; i++) {
+        metrics->phases[i] = new_Histogram();
+    }
+
+    return metrics;
+}
+
+
+/**
+ * @brief  Destroy and free the memory associated with metrics
+ *
+ * @param  metrics  metrics
+ */
+void free_CrawlMetrics(CrawlMetrics *metrics) {
+
+    assert(metrics != NULL);
+
+    for (int i = 0; i < NUM_PHASES; i++) {
+        free_Histogram(metrics->phases[i]);
+        metrics->phases[i] = NULL;
+    }
+
+    free(metrics);
+    metrics = NULL;
+}
+
+
+/**
+ * @brief  Record the time of a phase
+ *
+ * @param  metrics  metrics, or NULL if they are not kept
+ * @param  phase    the phase
+ * @param  us       the time of the phase in microseconds
+ */
+void metrics_record_phase(CrawlMetrics *metrics, MetricsPhase phase,
+                          long long us) {
+
+    if (metrics == NULL) {
+        return;
+    }
+
+    histogram_record(metrics->phases[phase], us);
+}
+
+
+/**
+ * @brief  Add to a counter
+ *
+ * @param  metrics  metrics, or NULL if they are not kept
+ * @param  counter  the counter
+ * @param  n        the number added
+ */
+void metrics_count(CrawlMetrics *metrics, MetricsCounter counter, long n) {
+
+    if (metrics == NULL) {
+        return;
+    }
+
+    __atomic_store_n(&metrics->counters[counter],
+                     metrics->counters[counter] + n, __ATOMIC_RELAXED);
+}
+
+
+/**
+ * @brief  Count a response by its status code
+ *
+ * @param  metrics      metrics, or NULL if they are not kept
+ * @param  status_code  the status code of the response
+ */
+void metrics_count_status(CrawlMetrics *metrics, int status_code) {
+
+    if (metrics == NULL) {
+        return;
+    }
+
+    int index = OTHER_STATUS;
+    if (status_code >= MIN_STATUS_CODE && status_code <= MAX_STATUS_CODE) {
+        index = status_code - MIN_STATUS_CODE;
+    }
+
+    __atomic_store_n(&metrics->statuses[index],
+                     metrics->statuses[index] + 1, __ATOMIC_RELAXED);
+}
+
+
+/**
+ * @brief  Add the metrics of a worker into another, while the worker may
+ *         still record into them
+ *
+ * @param  dest   the metrics added into (not shared)
+ * @param  src    the metrics added
+ */
+void metrics_merge(CrawlMetrics *dest, CrawlMetrics *src) {
+
+    assert(dest != NULL);
+    assert(src != NULL);
+
+    for (int i = 0; i < NUM_PHASES; i++) {
+        histogram_merge(dest->phases[i], src->phases[i]);
+    }
+    for (int i = 0; i < NUM_COUNTERS; i++) {
+        dest->counters[i] += __atomic_load_n(&src->counters[i],
+                                             __ATOMIC_RELAXED);
+    }
+    for (int i = 0; i < NUM_STATUS_CODES; i++) {
+        dest->statuses[i] += __atomic_load_n(&src->statuses[i],
+                                             __ATOMIC_RELAXED);
+    }
+}
+
+
+/**
+ * @brief  Print out the metrics as a JSON object: if they are recorded
+ *         (not built without them), the time since the crawl is started,
+ *         the counters, the responses of each status code seen, and the
+ *         count, percentiles and maximum time of each phase (in
+ *         microseconds)
+ *
+ * @param  metrics      metrics
+ * @param  elapsed_ms   the time since the crawl is started
+ * @param  fp           the file to print into
+ */
+void print_metrics_json(CrawlMetrics *metrics, long long elapsed_ms,
+                        FILE *fp) {
+
+    assert(metrics != NULL);
+
+    fprintf(fp, "{\n  \"enabled\": %s,\n  \"elapsed_ms\": %lld,\n",
+            METRICS_ENABLED ? "true" : "false", elapsed_ms);
+
+    fprintf(fp, "  \"counters\": {");
+    for (int i = 0; i < NUM_COUNTERS; i++) {
+        fprintf(fp, "%s\n    \"%s\": %ld", (i > 0) ? "," : "",
+                counter_names[i], metrics->counters[i]);
+    }
+    fprintf(fp, "\n  },\n");
+
+    bool isFirst = true;
+    fprintf(fp, "  \"status\": {");
+    for (int i = 0; i < NUM_STATUS_CODES; i++) {
+        if (metrics->statuses[i] == 0) {
+            continue;
+        }
+        if (i == OTHER_STATUS) {
+            fprintf(fp, "%s\n    \"other\": %ld", isFirst ? "" : ",",
+                    metrics->statuses[i]);
+        } else {
+            fprintf(fp, "%s\n    \"%d\": %ld", isFirst ? "" : ",",
+                    i + MIN_STATUS_CODE, metrics->statuses[i]);
+        }
+        isFirst = false;
+    }
+    fprintf(fp, "%s},\n", isFirst ? "" : "\n  ");
+
+    fprintf(fp, "  \"phases_us\": {");
+    for (int i = 0; i < NUM_PHASES; i++) {
+        Histogram *hist = metrics->phases[i];
+
+        fprintf(fp, "%s\n    \"%s\": {\"count\": %ld, \"p50\": %lld, "
+                    "\"p90\": %lld, \"p99\": %lld, \"max\": %lld}",
+                (i > 0) ? "," : "", phase_names[i],
+                get_histogram_count(hist),
+                get_histogram_percentile(hist, 50),
+                get_histogram_percentile(hist, 90),
+                get_histogram_percentile(hist, 99),
+                get_histogram_max(hist));
+    }
+    fprintf(fp, "\n  }\n}\n");
+}
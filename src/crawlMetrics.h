@@ -0,0 +1,118 @@
+/**
+ * @file      crawlMetrics.h
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     Crawl metrics module. It includes
+ *              1. creating and destroying the metrics of a crawl worker
+ *              2. recording the time of each phase of a fetch into a
+ *                 histogram, and counting bytes, responses by status code
+ *                 and links
+ *              3. merging the metrics of the workers, and printing them
+ *                 out as JSON
+ *            Each worker records into its own metrics (without a lock),
+ *            and any thread can merge them while they are recorded.
+ *            The METRICS_* macros are used to record, so the crawler can be
+ *            built without the metrics (with NO_METRICS defined): they do
+ *            nothing then, and the clock is not read
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#ifndef CRAWLMETRICS_H
+#define CRAWLMETRICS_H
+
+#include "utilities.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+
+
+// ============================================================================
+// == | Constant Definitions
+// ============================================================================
+#ifndef NO_METRICS
+#define METRICS_ENABLED                     true
+#define METRICS_NOW()                       get_monotonic_us()
+#define METRICS_PHASE(metrics, phase, us)   \
+        metrics_record_phase(metrics, phase, us)
+#define METRICS_COUNT(metrics, counter, n)  \
+        metrics_count(metrics, counter, n)
+#define METRICS_STATUS(metrics, code)       \
+        metrics_count_status(metrics, code)
+#else
+#define METRICS_ENABLED                     false
+#define METRICS_NOW()                       0LL
+#define METRICS_PHASE(metrics, phase, us)   \
+        ((void)(metrics), (void)(phase), (void)(us))
+#define METRICS_COUNT(metrics, counter, n)  \
+        ((void)(metrics), (void)(counter), (void)(n))
+#define METRICS_STATUS(metrics, code)       \
+        ((void)(metrics), (void)(code))
+#endif
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+/**
+ * @brief  The phases of a fetch (and of handling its response) timed
+ */
+typedef enum {
+    PHASE_SETUP,
+    PHASE_CONNECT,
+    PHASE_SEND,
+    PHASE_WAIT,
+    PHASE_RECEIVE,
+    PHASE_HEADER,
+    PHASE_PARSE_HTML,
+    NUM_PHASES
+} MetricsPhase;
+
+/**
+ * @brief  The counters of a crawl
+ */
+typedef enum {
+    COUNTER_BYTES_SENT,
+    COUNTER_BYTES_RECEIVED,
+    COUNTER_CONNECTIONS,
+    COUNTER_CONNECTIONS_REUSED,
+    COUNTER_FETCH_ERRORS,
+    COUNTER_PAGES_PARSED,
+    COUNTER_LINKS_EXTRACTED,
+    COUNTER_LINKS_NEW,
+    COUNTER_LINKS_DEDUPED,
+    COUNTER_LINKS_REJECTED,
+    NUM_COUNTERS
+} MetricsCounter;
+
+typedef struct crawl_metrics CrawlMetrics;
+
+
+// ============================================================================
+// == | Module Functions
+// ============================================================================
+// Create new empty metrics
+CrawlMetrics *new_CrawlMetrics();
+
+// Destroy metrics and free their memory
+void free_CrawlMetrics(CrawlMetrics *metrics);
+
+// Record the time of a phase in microseconds (NULL metrics are ignored)
+void metrics_record_phase(CrawlMetrics *metrics, MetricsPhase phase,
+                          long long us);
+
+// Add to a counter (NULL metrics are ignored)
+void metrics_count(CrawlMetrics *metrics, MetricsCounter counter, long n);
+
+// Count a response by its status code (NULL metrics are ignored)
+void metrics_count_status(CrawlMetrics *metrics, int status_code);
+
+// Add the metrics of a worker into another
+void metrics_merge(CrawlMetrics *dest, CrawlMetrics *src);
+
+// Print out the metrics as a JSON object
+void print_metrics_json(CrawlMetrics *metrics, long long elapsed_ms,
+                        FILE *fp);
+
+
+#endif
@@ -0,0 +1,209 @@
+/**
+ * @file      crawlStats.c
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     Implementation of live crawl statistics module. It includes
+ *              1. printing out a line of the statistics of a crawl running
+ *                 (with the rates since the line before)
+ *              2. opening a Unix domain socket, and sending the statistics
+ *                 as JSON to each client connecting to it
+ *              3. getting the resident memory of the crawler
+ *            A client gone before it is sent to does not raise SIGPIPE,
+ *            the statistics are dropped
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#include "crawlStats.h"
+
+#include "utilities.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+
+// ============================================================================
+// == | Constant Definitions
+// ============================================================================
+#define STATS_BACKLOG       16
+#define STATS_JSON_BYTES    1024
+#define MS_PER_S            1000.0
+#define BYTES_PER_MB        (1024.0 * 1024.0)
+#define STATM_PATH          "/proc/self/statm"
+
+
+// ============================================================================
+// == | Function Prototypes
+// ============================================================================
+// Get the hit rate of the DNS caches in percent
+double get_dns_hit_rate(CrawlStats *stats);
+
+
+// ============================================================================
+// == | Module Functions
+// ============================================================================
+/**
+ * @brief  Print out a line of the statistics: the time since the crawl is
+ *         started, the pages fetched, the pages and MB received per second
+ *         since the last line, the URLs in the frontiers, the fetches in
+ *         flight, the URLs waiting to be retried, the DNS hit rate, and the
+ *         resident memory
+ *
+ * @param  stats  the statistics now
+ * @param  last   the statistics of the last line (zero for the first)
+ * @param  fp     the file to print into
+ */
+void print_stats_line(CrawlStats *stats, CrawlStats *last, FILE *fp) {
+
+    double seconds = (stats->elapsed_ms - last->elapsed_ms) / MS_PER_S;
+    if (seconds <= 0) {
+        seconds = 1.0 / MS_PER_S;
+    }
+
+    fprintf(fp, "stats: %.1f s, %ld pages (%.1f/s), %.2f MB/s, frontier "
+                "%ld, inflight %ld, retrying %ld, dns %.1f%% hit, "
+                "rss %.1f MB\n",
+            stats->elapsed_ms / MS_PER_S, stats->pages,
+            (stats->pages - last->pages) / seconds,
+            (stats->bytes_received - last->bytes_received)
+                / BYTES_PER_MB / seconds,
+            stats->frontier, stats->inflight, stats->retrying,
+            get_dns_hit_rate(stats), stats->rss_bytes / BYTES_PER_MB);
+    fflush(fp);
+}
+
+
+/**
+ * @brief  Open a Unix domain socket listening for the clients of the
+ *         statistics. A socket left at the path (by a crawler killed
+ *         before) is replaced, any other file is not
+ *
+ * @param  path   the path of the socket
+ * @return        the listening socket
+ */
+int open_stats_socket(char *path) {
+
+    struct sockaddr_un addr;
+    struct stat st;
+
+    if (strlen(path) >= sizeof addr.sun_path) {
+        fprintf(stderr, "Error: open_stats_socket() path too long %s\n",
+                path);
+        exit(EXIT_FAILURE);
+    }
+
+    if (lstat(path, &st) == SUCCESS && S_ISSOCK(st.st_mode)) {
+        unlink(path);
+    }
+
+    int listenfd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listenfd < 0) {
+        perror("ERROR opening the stats socket");
+        exit(EXIT_FAILURE);
+    }
+
+    memset(&addr, 0, sizeof addr);
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    if (bind(listenfd, (struct sockaddr *)&addr, sizeof addr) < 0
+        || listen(listenfd, STATS_BACKLOG) < 0) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+
+    return listenfd;
+}
+
+
+/**
+ * @brief  Close the socket of the statistics and remove it from its path
+ *
+ * @param  listenfd   the listening socket
+ * @param  path       the path of the socket
+ */
+void close_stats_socket(int listenfd, char *path) {
+
+    close(listenfd);
+    unlink(path);
+}
+
+
+/**
+ * @brief  Send the statistics as a JSON object to a client (with the rates
+ *         since the crawl is started), and close its connection
+ *
+ * @param  clientfd   the connection of the client
+ * @param  stats      the statistics now
+ */
+void send_stats_json(int clientfd, CrawlStats *stats) {
+
+    char buffer[STATS_JSON_BYTES];
+    double seconds = stats->elapsed_ms / MS_PER_S;
+    if (seconds <= 0) {
+        seconds = 1.0 / MS_PER_S;
+    }
+
+    int len = snprintf(buffer, sizeof buffer,
+                       "{\"elapsed_ms\": %lld, \"pages\": %ld, "
+                       "\"pages_per_s\": %.2f, \"bytes_received\": %ld, "
+                       "\"bytes_per_s\": %.0f, \"frontier\": %ld, "
+                       "\"inflight\": %ld, \"retrying\": %ld, "
+                       "\"dns_hits\": %ld, \"dns_misses\": %ld, "
+                       "\"dns_hit_rate\": %.1f, \"rss_bytes\": %ld}\n",
+                       stats->elapsed_ms, stats->pages,
+                       stats->pages / seconds, stats->bytes_received,
+                       stats->bytes_received / seconds, stats->frontier,
+                       stats->inflight, stats->retrying, stats->dns_hits,
+                       stats->dns_misses, get_dns_hit_rate(stats),
+                       stats->rss_bytes);
+
+    // The object is small enough to be sent at once
+    send(clientfd, buffer, len, MSG_NOSIGNAL);
+    close(clientfd);
+}
+
+
+/**
+ * @brief  Get the resident memory of the crawler (from /proc)
+ *
+ * @return        the resident memory in bytes, or 0 if it is not known
+ */
+long get_rss_bytes() {
+
+    long size = 0, resident = 0;
+
+    FILE *fp = fopen(STATM_PATH, "r");
+    if (fp == NULL) {
+        return 0;
+    }
+    if (fscanf(fp, "%ld %ld", &size, &resident) != 2) {
+        resident = 0;
+    }
+    fclose(fp);
+
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+
+// ============================================================================
+// == | Auxillary Functions
+// ============================================================================
+/**
+ * @brief  Get the hit rate of the DNS caches
+ *
+ * @param  stats  the statistics
+ * @return        the hits in percent of the lookups (0 if none)
+ */
+double get_dns_hit_rate(CrawlStats *stats) {
+
+    long lookups = stats->dns_hits + stats->dns_misses;
+
+    return (lookups > 0) ? 100.0 * stats->dns_hits / lookups : 0.0;
+}
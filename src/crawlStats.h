@@ -0,0 +1,66 @@
+/**
+ * @file      crawlStats.h
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     Live crawl statistics module. It includes
+ *              1. printing out a line of the statistics of a crawl running
+ *                 (with the rates since the line before)
+ *              2. opening a Unix domain socket, and sending the statistics
+ *                 as JSON to each client connecting to it
+ *              3. getting the resident memory of the crawler
+ *            The statistics are collected by the worker pool, this module
+ *            only formats and serves them. A client reads the JSON object
+ *            until the socket is closed (e.g. `nc -U <path>`)
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#ifndef CRAWLSTATS_H
+#define CRAWLSTATS_H
+
+#include <stdio.h>
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+typedef struct crawl_stats CrawlStats;
+/**
+ * @brief  The CrawlStats include the time since the crawl is started, the
+ *         pages fetched and the bytes received, the URLs in the frontiers,
+ *         the fetches in flight, the URLs waiting to be retried, the hits
+ *         and misses of the DNS caches, and the resident memory
+ */
+struct crawl_stats {
+    long long elapsed_ms;
+    long pages;
+    long bytes_received;
+    long frontier;
+    long inflight;
+    long retrying;
+    long dns_hits;
+    long dns_misses;
+    long rss_bytes;
+};
+
+
+// ============================================================================
+// == | Module Functions
+// ============================================================================
+// Print out a line of the statistics, with the rates since the last line
+void print_stats_line(CrawlStats *stats, CrawlStats *last, FILE *fp);
+
+// Open a Unix domain socket listening for the clients of the statistics
+int open_stats_socket(char *path);
+
+// Close the socket of the statistics and remove it
+void close_stats_socket(int listenfd, char *path);
+
+// Send the statistics as JSON to a client, and close its connection
+void send_stats_json(int clientfd, CrawlStats *stats);
+
+// Get the resident memory of the crawler in bytes
+long get_rss_bytes();
+
+
+#endif
@@ -0,0 +1,516 @@
+/**
+ * @file      crawlTrace.c
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     Implementation of crawl trace module. It includes
+ *              1. creating a trace file and a ring of events for each
+ *                 crawl worker, and closing it
+ *              2. recording the spans of the phases of each URL (fetching
+ *                 it, extracting its links, and inserting it into the
+ *                 frontier) and the instant events of its responses
+ *              3. writing the events recorded into the trace file, in the
+ *                 trace event format of Chrome and Perfetto
+ *            A ring is a power of two of fixed size events. The producer
+ *            publishes an event by storing the head after it (release), and
+ *            the consumer frees the events written by storing the tail
+ *            (release), so neither takes a lock. An event keeps a copy of
+ *            its URL, as the URL may be freed before it is written.
+ *            A span is written as a pair of async begin and end events, an
+ *            instant event as an async instant event. The timestamps are
+ *            microseconds since the trace is created
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#include "crawlTrace.h"
+
+#include "urlInfo.h"
+#include "urlSet.h"
+#include "utilities.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+
+// ============================================================================
+// == | Constant Definitions
+// ============================================================================
+#define TRACE_URL_BYTES     96
+#define TRACE_PID           1
+#define TRACE_SPAN          'X'
+#define TRACE_INSTANT       'n'
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+/**
+ * @brief  An event include its kind (span or instant), name, the id of the
+ *         track of its URL, its start and duration (or value), and the URL
+ *         (its hostname and filepath, cut to fit)
+ */
+struct trace_event {
+    char kind;
+    unsigned char name;
+    uint64_t id;
+    long long start_us;
+    long long value;
+    char url[TRACE_URL_BYTES];
+};
+
+
+/**
+ * @brief  A ring include its events (the mask of their number), the count
+ *         of events published (head, by the producer) and written (tail,
+ *         by the consumer), and the number of events dropped as it is full
+ */
+struct trace_ring {
+    TraceEvent *events;
+    unsigned long mask;
+    unsigned long head;
+    unsigned long tail;
+    long dropped;
+    long long base_us;
+};
+
+
+/**
+ * @brief  A trace include the trace file, a ring for each worker, the time
+ *         it is created, the number of events written, and the lock taken
+ *         to write the file (by one thread at a time)
+ */
+struct crawl_trace {
+    FILE *fp;
+    TraceRing *rings;
+    int num_rings;
+    long long base_us;
+    long written;
+    pthread_mutex_t lock;
+};
+
+
+// ============================================================================
+// == | Function Prototypes
+// ============================================================================
+// Take a free event of a ring, or NULL if it is full
+TraceEvent *reserve_trace_event(TraceRing *ring);
+
+// Fill in the track and URL of an event
+void fill_trace_event(TraceEvent *event, UrlInfo *url);
+
+// Publish an event to the consumer
+void publish_trace_event(TraceRing *ring);
+
+// Write the events of a ring into the trace file
+long write_trace_ring(Trace *trace, TraceRing *ring, int tid);
+
+// Write a string into the trace file as a JSON string
+void write_json_string(FILE *fp, char *str);
+
+
+// ============================================================================
+// == | Global Variables
+// ============================================================================
+// The names of the events in the trace file
+static const char *trace_names[NUM_TRACE_NAMES] = {
+    "setup", "connect", "send", "wait", "receive", "header",
+    "extract_links", "frontier_insert", "redirect", "unauthorized",
+    "retry", "gave_up"
+};
+
+
+// ============================================================================
+// == | Module Functions
+// ============================================================================
+/**
+ * @brief  Create a trace file with a ring of events for each worker, and
+ *         name the thread of each worker in it
+ *
+ * @param  path         the path of the trace file
+ * @param  num_rings    the number of workers
+ * @param  ring_events  the events in a ring (rounded up to a power of two)
+ * @return              the pointer of new trace
+ */
+Trace *new_Trace(char *path, int num_rings, int ring_events) {
+
+    assert(path != NULL);
+    assert(num_rings > 0);
+
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL) {
+        fprintf(stderr, "Error: new_Trace() cannot open %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+
+    Trace *trace = (Trace *)malloc(sizeof *trace);
+    TraceRing *rings = (TraceRing *)calloc(num_rings, sizeof *rings);
+    if (trace == NULL || rings == NULL) {
+        fprintf(stderr, "Error: new_Trace() malloc returned NULL\n");
+        exit(EXIT_FAILURE);
+    }
+
+    unsigned long capacity = 1;
+    while (capacity < (unsigned long)ring_events) {
+        capacity *= 2;
+    }
+
+    // Initalise value of the trace
+    trace->fp        = fp;
+    trace->rings     = rings;
+    trace->num_rings = num_rings;
+    trace->base_us   = get_monotonic_us();
+    trace->written   = 0;
+    pthread_mutex_init(&trace->lock, NULL);
+
+    fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (int i = 0; i < num_rings; i++) {
+        rings[i].events = (TraceEvent *)malloc(capacity * sizeof(TraceEvent));
+        if (rings[i].events == NULL) {
+            fprintf(stderr, "Error: new_Trace() malloc returned NULL\n");
+            exit(EXIT_FAILURE);
+        }
+        rings[i].mask    = capacity - 1;
+        rings[i].base_us = trace->base_us;
+
+        fprintf(fp, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,"
+                    "\"tid\":%d,\"args\":{\"name\":\"worker %d\"}},\n",
+                TRACE_PID, i, i);
+    }
+
+    return trace;
+}
+
+
+/**
+ * @brief  Write the events left, close the trace file and free the memory
+ *         associated with a trace. The workers should be stopped before
+ *
+ * @param  trace  a trace
+ */
+void free_Trace(Trace *trace) {
+
+    assert(trace != NULL);
+
+    flush_Trace(trace);
+
+    // The last event is the number of events dropped, so the events
+    // before it are all followed by a comma
+    long dropped = 0;
+    for (int i = 0; i < trace->num_rings; i++) {
+        dropped += trace->rings[i].dropped;
+        free(trace->rings[i].events);
+        trace->rings[i].events = NULL;
+    }
+    fprintf(trace->fp, "{\"name\":\"dropped_events\",\"ph\":\"M\","
+                       "\"pid\":%d,\"args\":{\"count\":%ld}}\n]}\n",
+            TRACE_PID, dropped);
+    fclose(trace->fp);
+    trace->fp = NULL;
+
+    pthread_mutex_destroy(&trace->lock);
+    free(trace->rings);
+    trace->rings = NULL;
+
+    free(trace);
+    trace = NULL;
+}
+
+
+/**
+ * @brief  Get the ring of events of a worker
+ *
+ * @param  trace  a trace
+ * @param  index  the index of the worker
+ * @return        the ring of the worker
+ */
+TraceRing *get_trace_ring(Trace *trace, int index) {
+
+    assert(trace != NULL);
+    assert(index >= 0 && index < trace->num_rings);
+
+    return &trace->rings[index];
+}
+
+
+/**
+ * @brief  Record a span of a URL (only the worker of the ring records it)
+ *
+ * @param  ring       a ring of events, or NULL if it is not traced
+ * @param  name       the name of the span
+ * @param  url        the URL
+ * @param  start_us   the start of the span (monotonic clock)
+ * @param  end_us     the end of the span (monotonic clock)
+ */
+void trace_span(TraceRing *ring, TraceName name, UrlInfo *url,
+                long long start_us, long long end_us) {
+
+    if (ring == NULL) {
+        return;
+    }
+
+    TraceEvent *event = reserve_trace_event(ring);
+    if (event == NULL) {
+        return;
+    }
+
+    event->kind     = TRACE_SPAN;
+    event->name     = (unsigned char)name;
+    event->start_us = start_us - ring->base_us;
+    event->value    = end_us - start_us;
+    fill_trace_event(event, url);
+    publish_trace_event(ring);
+}
+
+
+/**
+ * @brief  Start a span of a URL now. The URL is copied into the span, so
+ *         it can be freed before the span ends (e.g. it is spilled). A span
+ *         not ended is not recorded
+ *
+ * @param  ring   a ring of events, or NULL if it is not traced
+ * @param  name   the name of the span
+ * @param  url    the URL
+ * @return        the span, or NULL if the ring is full (or NULL)
+ */
+TraceEvent *start_trace_span(TraceRing *ring, TraceName name, UrlInfo *url) {
+
+    if (ring == NULL) {
+        return NULL;
+    }
+
+    TraceEvent *event = reserve_trace_event(ring);
+    if (event == NULL) {
+        return NULL;
+    }
+
+    event->kind     = TRACE_SPAN;
+    event->name     = (unsigned char)name;
+    fill_trace_event(event, url);
+    event->start_us = get_monotonic_us() - ring->base_us;
+
+    return event;
+}
+
+
+/**
+ * @brief  End a span started now and record it, no other event is recorded
+ *         into the ring in between
+ *
+ * @param  ring     a ring of events
+ * @param  event    the span started
+ */
+void end_trace_span(TraceRing *ring, TraceEvent *event) {
+
+    event->value = get_monotonic_us() - ring->base_us - event->start_us;
+    publish_trace_event(ring);
+}
+
+
+/**
+ * @brief  Record an instant event of a URL, at the current time (only the
+ *         worker of the ring records it)
+ *
+ * @param  ring     a ring of events, or NULL if it is not traced
+ * @param  name     the name of the event
+ * @param  url      the URL
+ * @param  value    the value of the event (e.g. the delay of a retry)
+ */
+void trace_instant(TraceRing *ring, TraceName name, UrlInfo *url,
+                   long value) {
+
+    if (ring == NULL) {
+        return;
+    }
+
+    TraceEvent *event = reserve_trace_event(ring);
+    if (event == NULL) {
+        return;
+    }
+
+    event->kind     = TRACE_INSTANT;
+    event->name     = (unsigned char)name;
+    event->start_us = get_monotonic_us() - ring->base_us;
+    event->value    = value;
+    fill_trace_event(event, url);
+    publish_trace_event(ring);
+}
+
+
+/**
+ * @brief  Write the events recorded in all rings into the trace file,
+ *         freeing them for the workers
+ *
+ * @param  trace  a trace
+ * @return        the number of events written
+ */
+long flush_Trace(Trace *trace) {
+
+    long written = 0;
+
+    assert(trace != NULL);
+
+    pthread_mutex_lock(&trace->lock);
+    for (int i = 0; i < trace->num_rings; i++) {
+        written += write_trace_ring(trace, &trace->rings[i], i);
+    }
+    fflush(trace->fp);
+    trace->written += written;
+    pthread_mutex_unlock(&trace->lock);
+
+    return written;
+}
+
+
+/**
+ * @brief  Print out the statistics of the trace: the events written and
+ *         dropped (as a ring is full)
+ *
+ * @param  trace  a trace
+ * @param  fp     the file to print into
+ */
+void print_trace_stats(Trace *trace, FILE *fp) {
+
+    long dropped = 0;
+
+    assert(trace != NULL);
+
+    for (int i = 0; i < trace->num_rings; i++) {
+        dropped += __atomic_load_n(&trace->rings[i].dropped,
+                                   __ATOMIC_RELAXED);
+    }
+
+    pthread_mutex_lock(&trace->lock);
+    fprintf(fp, "trace: %ld events written, %ld dropped\n",
+            trace->written, dropped);
+    pthread_mutex_unlock(&trace->lock);
+}
+
+
+// ============================================================================
+// == | Auxillary Functions
+// ============================================================================
+/**
+ * @brief  Take the free event after the head of a ring, or count the event
+ *         dropped if the ring is full
+ *
+ * @param  ring   a ring of events
+ * @return        the event, or NULL if the ring is full
+ */
+TraceEvent *reserve_trace_event(TraceRing *ring) {
+
+    unsigned long tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+    if (ring->head - tail > ring->mask) {
+        __atomic_store_n(&ring->dropped, ring->dropped + 1,
+                         __ATOMIC_RELAXED);
+        return NULL;
+    }
+
+    return &ring->events[ring->head & ring->mask];
+}
+
+
+/**
+ * @brief  Fill in the track (from the hash of the URL) and a copy of the
+ *         URL of an event
+ *
+ * @param  event    the event taken from the ring
+ * @param  url      the URL of the event
+ */
+void fill_trace_event(TraceEvent *event, UrlInfo *url) {
+
+    event->id = hash_url_key(url);
+    snprintf(event->url, TRACE_URL_BYTES, "%s%s%s", HTTP_HEADER,
+             url->hostname, url->filepath);
+}
+
+
+/**
+ * @brief  Publish the event after the head of a ring to the consumer
+ *
+ * @param  ring     a ring of events
+ */
+void publish_trace_event(TraceRing *ring) {
+
+    __atomic_store_n(&ring->head, ring->head + 1, __ATOMIC_RELEASE);
+}
+
+
+/**
+ * @brief  Write the events published in a ring into the trace file, and
+ *         free them for the producer
+ *
+ * @param  trace  a trace
+ * @param  ring   a ring of events
+ * @param  tid    the thread id of the events (the index of the worker)
+ * @return        the number of events written
+ */
+long write_trace_ring(Trace *trace, TraceRing *ring, int tid) {
+
+    unsigned long head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    unsigned long tail = ring->tail;
+    FILE *fp = trace->fp;
+
+    for (; tail != head; tail++) {
+        TraceEvent *event = &ring->events[tail & ring->mask];
+        const char *name  = trace_names[event->name];
+
+        if (event->kind == TRACE_SPAN) {
+            fprintf(fp, "{\"name\":\"%s\",\"cat\":\"url\",\"ph\":\"b\","
+                        "\"id\":\"0x%llx\",\"ts\":%lld,\"pid\":%d,"
+                        "\"tid\":%d,\"args\":{\"url\":",
+                    name, (unsigned long long)event->id, event->start_us,
+                    TRACE_PID, tid);
+            write_json_string(fp, event->url);
+            fprintf(fp, "}},\n{\"name\":\"%s\",\"cat\":\"url\",\"ph\":\"e\","
+                        "\"id\":\"0x%llx\",\"ts\":%lld,\"pid\":%d,"
+                        "\"tid\":%d},\n",
+                    name, (unsigned long long)event->id,
+                    event->start_us + event->value, TRACE_PID, tid);
+        } else {
+            fprintf(fp, "{\"name\":\"%s\",\"cat\":\"url\",\"ph\":\"n\","
+                        "\"id\":\"0x%llx\",\"ts\":%lld,\"pid\":%d,"
+                        "\"tid\":%d,\"args\":{\"value\":%lld,\"url\":",
+                    name, (unsigned long long)event->id, event->start_us,
+                    TRACE_PID, tid, event->value);
+            write_json_string(fp, event->url);
+            fprintf(fp, "}},\n");
+        }
+    }
+
+    long written = (long)(head - ring->tail);
+    __atomic_store_n(&ring->tail, head, __ATOMIC_RELEASE);
+
+    return written;
+}
+
+
+/**
+ * @brief  Write a string into the trace file as a JSON string, escaping
+ *         the quotation marks, backslashes and control characters
+ *
+ * @param  fp     the trace file
+ * @param  str    a NULL terminated string
+ */
+void write_json_string(FILE *fp, char *str) {
+
+    putc('"', fp);
+    for (; *str != NULL_TERMINATED; str++) {
+        unsigned char c = (unsigned char)*str;
+
+        if (c == '"' || c == '\\') {
+            putc('\\', fp);
+            putc(c, fp);
+        } else if (c < 0x20) {
+            fprintf(fp, "\\u%04x", c);
+        } else {
+            putc(c, fp);
+        }
+    }
+    putc('"', fp);
+}
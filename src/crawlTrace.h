@@ -0,0 +1,95 @@
+/**
+ * @file      crawlTrace.h
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     Crawl trace module. It includes
+ *              1. creating a trace file and a ring of events for each
+ *                 crawl worker, and closing it
+ *              2. recording the spans of the phases of each URL (fetching
+ *                 it, extracting its links, and inserting it into the
+ *                 frontier) and the instant events of its responses
+ *              3. writing the events recorded into the trace file, in the
+ *                 trace event format of Chrome and Perfetto
+ *            Each worker records into its own ring without a lock (it is
+ *            the only producer), and one thread at a time takes the events
+ *            out of the rings and writes them (the only consumer). If a
+ *            ring is full, the event is dropped and counted.
+ *            The events of a URL share its track (an async event id from
+ *            the hash of the URL), so its lifecycle reads left to right
+ *            and the fetches in flight at the same time are side by side
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#ifndef CRAWLTRACE_H
+#define CRAWLTRACE_H
+
+#include "urlInfo.h"
+
+#include <stdio.h>
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+/**
+ * @brief  The events traced: the spans of a URL, then its instant events
+ */
+typedef enum {
+    TRACE_SETUP,
+    TRACE_CONNECT,
+    TRACE_SEND,
+    TRACE_WAIT,
+    TRACE_RECEIVE,
+    TRACE_HEADER,
+    TRACE_EXTRACT,
+    TRACE_INSERT,
+    TRACE_REDIRECT,
+    TRACE_UNAUTHORIZED,
+    TRACE_RETRY,
+    TRACE_GAVE_UP,
+    NUM_TRACE_NAMES
+} TraceName;
+
+typedef struct crawl_trace Trace;
+
+typedef struct trace_ring TraceRing;
+
+typedef struct trace_event TraceEvent;
+
+
+// ============================================================================
+// == | Module Functions
+// ============================================================================
+// Create a trace file with a ring of events for each worker
+Trace *new_Trace(char *path, int num_rings, int ring_events);
+
+// Write the events left, close the trace file and free its memory
+void free_Trace(Trace *trace);
+
+// Return the ring of events of a worker
+TraceRing *get_trace_ring(Trace *trace, int index);
+
+// Record a span of a URL, from its start to its end (in microseconds)
+// (a NULL ring is ignored, as for the functions below)
+void trace_span(TraceRing *ring, TraceName name, UrlInfo *url,
+                long long start_us, long long end_us);
+
+// Start a span of a URL now, or return NULL if the ring is full
+TraceEvent *start_trace_span(TraceRing *ring, TraceName name, UrlInfo *url);
+
+// End a span started now and record it
+void end_trace_span(TraceRing *ring, TraceEvent *event);
+
+// Record an instant event of a URL, with a value (e.g. a delay)
+void trace_instant(TraceRing *ring, TraceName name, UrlInfo *url,
+                   long value);
+
+// Write the events recorded into the trace file
+long flush_Trace(Trace *trace);
+
+// Print out the statistics of the trace
+void print_trace_stats(Trace *trace, FILE *fp);
+
+
+#endif
@@ -15,6 +15,7 @@
 
 #include "dlist.h"
 
+#include "arena.h"
 #include "urlInfo.h"
 
 #include <stdio.h>
@@ -55,6 +56,9 @@ struct dlist {
 // Create a new node and return its address
 Node *new_node(UrlInfo *url);
 
+// Free the memory of a node (not its data)
+void free_node(Node *node);
+
 
 // ============================================================================
 // == | Module Functions
@@ -100,7 +104,7 @@ void free_dlist(Dlist *dlist) {
     }
 
     // Free the last node and dlist itself
-    free(dlist->last);
+    free_node(dlist->last);
     dlist->head = NULL;
     dlist->last = NULL;
 
@@ -194,11 +198,16 @@ UrlInfo *dlist_remove_end(Dlist *dlist) {
 
     if (dlist->size == 1) {
         // If we're removing the last node, the head also needs clearing
+        // and free the memory
+        free_node(dlist->last);
         dlist->head = NULL;
+        dlist->last = NULL;
     } else {
         // Otherwise, the previous node becomes the last node
         dlist->last = dlist->last->prev;
-        free(dlist->last->prev);
+
+        // free the memory
+        free_node(dlist->last->next);
         dlist->last->next = NULL;
     }
 
@@ -229,14 +238,15 @@ UrlInfo *dlist_remove_start(Dlist *dlist) {
     if (dlist->size == 1) {
         // If it was the last node in the dlist, the last needs to be cleared
         // and free the memory
-        free(dlist->head);
+        free_node(dlist->head);
+        dlist->head = NULL;
         dlist->last = NULL;
     } else {
         // Otherwise, the next node becomes the first node
         dlist->head = dlist->head->next;
 
         // free the memory
-        free(dlist->head->prev);
+        free_node(dlist->head->prev);
         dlist->head->prev = NULL;
     }
 
@@ -315,11 +325,8 @@ UrlInfo *get_dlist_point(Dlist *dlist, int index) {
  */
 Node *new_node(UrlInfo *url) {
     
-    Node *node = (Node *)malloc(sizeof(*node));
-    if (node == NULL) {
-        fprintf(stderr, "Error: new_node() malloc returned NULL\n");
-        exit(EXIT_FAILURE);
-    }
+    // The nodes live as long as the URLs, so they share the URL arena
+    Node *node = (Node *)arena_alloc(get_url_arena(), sizeof(*node));
 
 
     // Assign the data value
@@ -332,3 +339,14 @@ Node *new_node(UrlInfo *url) {
     return node;
 }
 
+
+/**
+ * @brief  Free the memory of a node (not its data), 
+ *         it goes back to the URL arena
+ * 
+ * @param  node   a node
+ */
+void free_node(Node *node) {
+
+    arena_free(get_url_arena(), node, sizeof(*node));
+}
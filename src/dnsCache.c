@@ -0,0 +1,773 @@
+/**
+ * @file      dnsCache.c
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     Implementation of DNS resolution cache module. It includes
+ *              1. creating and destroying a DNS cache
+ *              2. looking up a hostname without blocking (starting an
+ *                 asynchronous resolution if it is not cached)
+ *              3. resolving a hostname to its address (blocking if needed)
+ *              4. collecting the asynchronous resolutions completed
+ *              5. reporting the cache hits and misses
+ *            The entries are kept in a fixed array, chained by the hash of
+ *            the hostname. When the cache is full, the entry inserted
+ *            earliest is replaced. Asynchronous resolutions use
+ *            getaddrinfo_a and are collected by polling. The cache is
+ *            shared by the crawl threads, each call holds the cache lock,
+ *            but never while it blocks: a hostname resolved by a thread is
+ *            marked pending and resolved without the lock, and a request
+ *            which can not be cancelled is parked until it is completed.
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#include "dnsCache.h"
+
+#include "utilities.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <assert.h>
+#include <ctype.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+
+// ============================================================================
+// == | Constant Definitions
+// ============================================================================
+#define NO_ENTRY                -1
+#define FNV_OFFSET_BASIS        14695981039346656037ULL
+#define FNV_PRIME               1099511628211ULL
+#define DNS_WAIT_INTERVAL_US    1000
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+typedef struct dns_entry DnsEntry;
+/**
+ * @brief  A DNS entry include the hostname, its address (if it is valid),
+ *         when the entry expires, if it is still being resolved (by the
+ *         asynchronous request, or by a thread if there is no request, and
+ *         if the thread has completed it), and the next entry in the same
+ *         hash chain
+ */
+struct dns_entry {
+    char *hostname;
+    struct in_addr addr;
+    bool isValid;
+    bool isPending;
+    bool isCompleted;
+    long long expires;
+    struct gaicb *request;
+    int next;
+};
+
+
+typedef struct dns_parked DnsParked;
+/**
+ * @brief  An asynchronous request which could not be cancelled once its
+ *         entry is replaced. It is kept (with the hostname it resolves)
+ *         until it is completed
+ */
+struct dns_parked {
+    struct gaicb *request;
+    char *hostname;
+    DnsParked *next;
+};
+
+
+/**
+ * @brief  A DNS cache include the entries, the heads of the hash chains,
+ *         the entry will be replaced next, the TTL of valid and invalid
+ *         entries, the requests parked, the number of hits and misses, and
+ *         the lock of the cache
+ */
+struct dns_cache {
+    pthread_mutex_t lock;
+    DnsEntry *entries;
+    int max_entries;
+    int *buckets;
+    int num_buckets;
+    int next_slot;
+    int ttl_ms;
+    int negative_ttl_ms;
+    int pending;
+    DnsParked *parked;
+    struct addrinfo hints;
+    long hits;
+    long negative_hits;
+    long misses;
+};
+
+
+// ============================================================================
+// == | Function Prototypes
+// ============================================================================
+// Compute the bucket of a hostname (case insensitive)
+int dns_bucket(DnsCache *cache, char *hostname);
+
+// Find the entry of a hostname
+int dns_find(DnsCache *cache, char *hostname);
+
+// Take the oldest entry for a new hostname
+int dns_new_entry(DnsCache *cache, char *hostname);
+
+// Release the hostname and pending request of an entry
+void dns_release_entry(DnsCache *cache, int index);
+
+// Start resolving the hostname of an entry asynchronously
+bool dns_start_async(DnsCache *cache, int index);
+
+// Resolve the hostname of an entry without holding the cache lock
+bool dns_resolve_unlocked(DnsCache *cache, int index, char *hostname,
+                          struct in_addr *addr);
+
+// Check if the resolution of a pending entry is completed
+bool dns_is_completed(DnsEntry *entry);
+
+// Free the parked requests completed (or wait for all of them)
+void dns_reclaim_parked(DnsCache *cache, bool isWaiting);
+
+// Collect a completed resolution into its entry
+void dns_collect(DnsCache *cache, int index);
+
+// Store the address (or that it is invalid) into an entry
+void dns_store(DnsCache *cache, int index, struct addrinfo *result);
+
+
+// ============================================================================
+// == | Module Functions
+// ============================================================================
+/**
+ * @brief  Create a new empty DNS cache
+ *
+ * @param  max_entries      the maximum number of hostnames cached
+ * @param  ttl_ms           the time a valid hostname is cached
+ * @param  negative_ttl_ms  the time an invalid hostname is cached
+ * @return                  the pointer of new DNS cache
+ */
+DnsCache *new_DnsCache(int max_entries, int ttl_ms, int negative_ttl_ms) {
+
+    assert(max_entries > 0);
+
+    DnsCache *cache = (DnsCache *)malloc(sizeof *cache);
+    if (cache == NULL) {
+        fprintf(stderr, "Error: new_DnsCache() malloc returned NULL\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Use a power of two number of hash chains, at least one per entry
+    cache->num_buckets = 1;
+    while (cache->num_buckets < max_entries) {
+        cache->num_buckets *= 2;
+    }
+
+    cache->entries = (DnsEntry *)calloc(max_entries, sizeof *cache->entries);
+    cache->buckets = (int *)malloc(cache->num_buckets * sizeof(int));
+    if (cache->entries == NULL || cache->buckets == NULL) {
+        fprintf(stderr, "Error: new_DnsCache() malloc returned NULL\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < cache->num_buckets; i++) {
+        cache->buckets[i] = NO_ENTRY;
+    }
+
+    // Only IPv4 addresses of stream sockets are used
+    memset(&cache->hints, 0, sizeof cache->hints);
+    cache->hints.ai_family   = AF_INET;
+    cache->hints.ai_socktype = SOCK_STREAM;
+
+    // Initalise value of the DNS cache
+    cache->max_entries     = max_entries;
+    cache->next_slot       = 0;
+    cache->ttl_ms          = ttl_ms;
+    cache->negative_ttl_ms = negative_ttl_ms;
+    cache->pending         = 0;
+    cache->parked          = NULL;
+    cache->hits            = 0;
+    cache->negative_hits   = 0;
+    cache->misses          = 0;
+    pthread_mutex_init(&cache->lock, NULL);
+
+    return cache;
+}
+
+
+/**
+ * @brief  Destroy and free the memory associated with a DNS cache.
+ *         The resolutions still in progress are cancelled (or waited for,
+ *         if they have started)
+ *
+ * @param  cache  a DNS cache
+ */
+void free_DnsCache(DnsCache *cache) {
+
+    // Error if the cache does not initalise
+    assert(cache != NULL);
+
+    for (int i = 0; i < cache->max_entries; i++) {
+        dns_release_entry(cache, i);
+    }
+    dns_reclaim_parked(cache, true);
+
+    free(cache->entries);
+    free(cache->buckets);
+    cache->entries = NULL;
+    cache->buckets = NULL;
+    pthread_mutex_destroy(&cache->lock);
+
+    free(cache);
+    cache = NULL;
+}
+
+
+/**
+ * @brief  Look up a hostname without blocking. If it is not cached (or its
+ *         entry expired), start resolving it asynchronously
+ *
+ * @param  cache      a DNS cache
+ * @param  hostname   a hostname string
+ * @return            DNS_RESOLVED if the hostname is valid,
+ *                    DNS_INVALID if the hostname is invalid,
+ *                    DNS_PENDING if the hostname is being resolved
+ */
+DnsStatus dns_cache_lookup(DnsCache *cache, char *hostname) {
+
+    assert(cache != NULL);
+
+    DnsStatus status;
+
+    pthread_mutex_lock(&cache->lock);
+
+    int index = dns_find(cache, hostname);
+    DnsEntry *entry = (index != NO_ENTRY) ? &cache->entries[index] : NULL;
+
+    if (entry != NULL && entry->isPending) {
+        status = DNS_PENDING;
+
+    } else if (entry != NULL && get_monotonic_ms() < entry->expires) {
+        // If the entry is not expired, it is a cache hit
+        cache->hits++;
+        if (!entry->isValid) {
+            cache->negative_hits++;
+        }
+        status = entry->isValid ? DNS_RESOLVED : DNS_INVALID;
+
+    } else {
+        // If it is not cached or expired, resolve it again
+        if (index == NO_ENTRY) {
+            index = dns_new_entry(cache, hostname);
+        }
+        cache->misses++;
+
+        if (dns_start_async(cache, index)) {
+            status = DNS_PENDING;
+        } else {
+            // If it can not be queued, resolve it now (without the lock)
+            struct in_addr addr;
+            status = dns_resolve_unlocked(cache, index, hostname, &addr)
+                   ? DNS_RESOLVED : DNS_INVALID;
+        }
+    }
+
+    pthread_mutex_unlock(&cache->lock);
+
+    return status;
+}
+
+
+/**
+ * @brief  Resolve a hostname to its address. If it is being resolved
+ *         (asynchronously or by another thread), wait for it. If it is not
+ *         cached (or its entry expired), resolve it now, other threads can
+ *         use the cache meanwhile
+ *
+ * @param  cache      a DNS cache
+ * @param  hostname   a hostname string
+ * @param  addr       the address will be set
+ * @return true       If the hostname is valid
+ * @return false      If the hostname is invalid
+ */
+bool dns_cache_resolve(DnsCache *cache, char *hostname, struct in_addr *addr) {
+
+    assert(cache != NULL);
+    assert(addr != NULL);
+
+    pthread_mutex_lock(&cache->lock);
+
+    int index = dns_find(cache, hostname);
+
+    while (index != NO_ENTRY && cache->entries[index].isPending
+           && !dns_is_completed(&cache->entries[index])) {
+        // Wait until the resolution is completed, without holding the
+        // lock (another thread may collect it meanwhile)
+        pthread_mutex_unlock(&cache->lock);
+        usleep(DNS_WAIT_INTERVAL_US);
+        pthread_mutex_lock(&cache->lock);
+        index = dns_find(cache, hostname);
+    }
+
+    if (index != NO_ENTRY && cache->entries[index].isPending) {
+        // Collect the completed asynchronous resolution
+        dns_collect(cache, index);
+
+    } else if (index != NO_ENTRY
+               && get_monotonic_ms() < cache->entries[index].expires) {
+        // If the entry is not expired, it is a cache hit
+        cache->hits++;
+        if (!cache->entries[index].isValid) {
+            cache->negative_hits++;
+        }
+
+    } else {
+        // If it is not cached or expired, resolve it now
+        if (index == NO_ENTRY) {
+            index = dns_new_entry(cache, hostname);
+        }
+        cache->misses++;
+
+        bool isValid = dns_resolve_unlocked(cache, index, hostname, addr);
+        pthread_mutex_unlock(&cache->lock);
+
+        return isValid;
+    }
+
+    DnsEntry *entry = &cache->entries[index];
+    bool isValid = entry->isValid;
+    *addr = entry->addr;
+
+    pthread_mutex_unlock(&cache->lock);
+
+    return isValid;
+}
+
+
+/**
+ * @brief  Collect the resolutions completed into the cache, and free the
+ *         requests parked which are completed
+ *
+ * @param  cache  a DNS cache
+ * @return        the number of resolutions completed
+ */
+int dns_cache_poll(DnsCache *cache) {
+
+    assert(cache != NULL);
+
+    int completed = 0;
+
+    pthread_mutex_lock(&cache->lock);
+
+    for (int i = 0; i < cache->max_entries && cache->pending > 0; i++) {
+        DnsEntry *entry = &cache->entries[i];
+
+        if (entry->isPending && dns_is_completed(entry)) {
+            dns_collect(cache, i);
+            completed++;
+        }
+    }
+    dns_reclaim_parked(cache, false);
+
+    pthread_mutex_unlock(&cache->lock);
+
+    return completed;
+}
+
+
+/**
+ * @brief  Get the number of asynchronous resolutions not completed yet
+ *
+ * @param  cache  a DNS cache
+ * @return        the number of pending resolutions
+ */
+int get_dns_cache_pending(DnsCache *cache) {
+
+    assert(cache != NULL);
+
+    pthread_mutex_lock(&cache->lock);
+    int pending = cache->pending;
+    pthread_mutex_unlock(&cache->lock);
+
+    return pending;
+}
+
+
+/**
+ * @brief  Get the number of cache hits and misses
+ *
+ * @param  cache    a DNS cache
+ * @param  hits     the number of hits, will be updated
+ * @param  misses   the number of misses, will be updated
+ */
+void get_dns_cache_lookups(DnsCache *cache, long *hits, long *misses) {
+
+    assert(cache != NULL);
+
+    pthread_mutex_lock(&cache->lock);
+    *hits   = cache->hits;
+    *misses = cache->misses;
+    pthread_mutex_unlock(&cache->lock);
+}
+
+
+/**
+ * @brief  Print out the number of cache hits and misses
+ *
+ * @param  cache  a DNS cache
+ * @param  fp     the file to print into
+ */
+void print_dns_cache_stats(DnsCache *cache, FILE *fp) {
+
+    assert(cache != NULL);
+
+    pthread_mutex_lock(&cache->lock);
+
+    long lookups = cache->hits + cache->misses;
+    double ratio = (lookups > 0) ? 100.0 * cache->hits / lookups : 0.0;
+
+    fprintf(fp, "dns: %ld hits (%ld negative), %ld misses (%.1f%% hit)\n",
+            cache->hits, cache->negative_hits, cache->misses, ratio);
+
+    pthread_mutex_unlock(&cache->lock);
+}
+
+
+// ============================================================================
+// == | Auxillary Functions
+// ============================================================================
+/**
+ * @brief  Compute the bucket of a hostname by its FNV-1a hash
+ *         (case insensitive)
+ *
+ * @param  cache      a DNS cache
+ * @param  hostname   a hostname string
+ * @return            the index of the hash chain
+ */
+int dns_bucket(DnsCache *cache, char *hostname) {
+
+    uint64_t hash = FNV_OFFSET_BASIS;
+
+    for (char *c = hostname; *c != NULL_TERMINATED; c++) {
+        hash ^= (unsigned char)tolower((unsigned char)*c);
+        hash *= FNV_PRIME;
+    }
+
+    return (int)(hash & (uint64_t)(cache->num_buckets - 1));
+}
+
+
+/**
+ * @brief  Find the entry of a hostname
+ *
+ * @param  cache      a DNS cache
+ * @param  hostname   a hostname string
+ * @return            the index of the entry, or NO_ENTRY if it is not cached
+ */
+int dns_find(DnsCache *cache, char *hostname) {
+
+    int index = cache->buckets[dns_bucket(cache, hostname)];
+
+    while (index != NO_ENTRY) {
+        if (strcasecmp(cache->entries[index].hostname, hostname) == SUCCESS) {
+            return index;
+        }
+        index = cache->entries[index].next;
+    }
+
+    return NO_ENTRY;
+}
+
+
+/**
+ * @brief  Take the entry inserted earliest for a new hostname
+ *
+ * @param  cache      a DNS cache
+ * @param  hostname   a hostname string
+ * @return            the index of the new entry
+ */
+int dns_new_entry(DnsCache *cache, char *hostname) {
+
+    int index = cache->next_slot;
+    cache->next_slot = (cache->next_slot + 1) % cache->max_entries;
+
+    // Replace the old hostname in the entry
+    dns_release_entry(cache, index);
+
+    DnsEntry *entry = &cache->entries[index];
+    entry->hostname = deep_copy_str(hostname, strlen(hostname),
+                                    IS_COPY_WHOLE);
+    entry->isValid     = false;
+    entry->isPending   = false;
+    entry->isCompleted = false;
+    entry->expires     = 0;
+    entry->request     = NULL;
+
+    // Insert it at the head of its hash chain
+    int bucket = dns_bucket(cache, hostname);
+    entry->next = cache->buckets[bucket];
+    cache->buckets[bucket] = index;
+
+    return index;
+}
+
+
+/**
+ * @brief  Release the hostname and pending request of an entry, and
+ *         remove it from its hash chain. A request which has started can
+ *         not be cancelled, it is parked (with the hostname it resolves)
+ *         until it is completed. A thread resolving the entry stores its
+ *         result nowhere once the entry is released
+ *
+ * @param  cache    a DNS cache
+ * @param  index    the index of the entry
+ */
+void dns_release_entry(DnsCache *cache, int index) {
+
+    DnsEntry *entry = &cache->entries[index];
+
+    if (entry->hostname == NULL) {
+        return;
+    }
+
+    // Cancel the resolution in progress, or park it if it has started
+    bool isParked = false;
+    if (entry->isPending) {
+        if (entry->request != NULL
+            && gai_cancel(entry->request) != EAI_CANCELED) {
+            DnsParked *parked = (DnsParked *)malloc(sizeof *parked);
+            if (parked == NULL) {
+                fprintf(stderr, "Error: dns_release_entry() malloc "
+                                "returned NULL\n");
+                exit(EXIT_FAILURE);
+            }
+            parked->request  = entry->request;
+            parked->hostname = entry->hostname;
+            parked->next     = cache->parked;
+            cache->parked    = parked;
+            isParked = true;
+        } else {
+            free(entry->request);
+        }
+        entry->request     = NULL;
+        entry->isPending   = false;
+        entry->isCompleted = false;
+        cache->pending--;
+    }
+
+    // Remove it from its hash chain
+    int *link = &cache->buckets[dns_bucket(cache, entry->hostname)];
+    while (*link != index) {
+        link = &cache->entries[*link].next;
+    }
+    *link = entry->next;
+
+    if (!isParked) {
+        free(entry->hostname);
+    }
+    entry->hostname = NULL;
+}
+
+
+/**
+ * @brief  Start resolving the hostname of an entry asynchronously
+ *
+ * @param  cache    a DNS cache
+ * @param  index    the index of the entry
+ * @return true     If the request is queued (the entry is pending)
+ * @return false    If the request can not be queued
+ */
+bool dns_start_async(DnsCache *cache, int index) {
+
+    DnsEntry *entry = &cache->entries[index];
+
+    struct gaicb *request = (struct gaicb *)calloc(1, sizeof *request);
+    if (request == NULL) {
+        fprintf(stderr, "Error: dns_start_async() calloc returned NULL\n");
+        exit(EXIT_FAILURE);
+    }
+    request->ar_name    = entry->hostname;
+    request->ar_request = &cache->hints;
+
+    struct gaicb *list[1] = {request};
+    if (getaddrinfo_a(GAI_NOWAIT, list, 1, NULL) == SUCCESS) {
+        entry->request     = request;
+        entry->isPending   = true;
+        entry->isCompleted = false;
+        cache->pending++;
+        return true;
+    }
+
+    free(request);
+    return false;
+}
+
+
+/**
+ * @brief  Resolve the hostname of an entry now, without holding the cache
+ *         lock while it blocks. The entry is pending meanwhile, so the
+ *         other threads wait for it (or look up other hostnames). Once it
+ *         is resolved, the result is stored into the entry (if it is not
+ *         replaced meanwhile), and collected by the next poll.
+ *         The cache lock is held when it is called and when it returns
+ *
+ * @param  cache      a DNS cache
+ * @param  index      the index of the entry
+ * @param  hostname   the hostname of the entry (owned by the caller)
+ * @param  addr       the address will be set
+ * @return true       If the hostname is valid
+ * @return false      If the hostname is invalid
+ */
+bool dns_resolve_unlocked(DnsCache *cache, int index, char *hostname,
+                          struct in_addr *addr) {
+
+    DnsEntry *entry = &cache->entries[index];
+    entry->request     = NULL;
+    entry->isPending   = true;
+    entry->isCompleted = false;
+    cache->pending++;
+
+    pthread_mutex_unlock(&cache->lock);
+
+    struct addrinfo *result = NULL;
+    if (getaddrinfo(hostname, NULL, &cache->hints, &result) != SUCCESS) {
+        result = NULL;
+    }
+    bool isValid = result != NULL;
+    if (isValid) {
+        *addr = ((struct sockaddr_in *)result->ai_addr)->sin_addr;
+    }
+
+    pthread_mutex_lock(&cache->lock);
+
+    // The entry may be replaced while the lock is not held
+    index = dns_find(cache, hostname);
+    if (index != NO_ENTRY) {
+        entry = &cache->entries[index];
+        if (entry->isPending && entry->request == NULL
+            && !entry->isCompleted) {
+            dns_store(cache, index, result);
+            entry->isCompleted = true;
+        }
+    }
+
+    if (result != NULL) {
+        freeaddrinfo(result);
+    }
+
+    return isValid;
+}
+
+
+/**
+ * @brief  Check if the resolution of a pending entry is completed (by its
+ *         asynchronous request, or by the thread resolving it)
+ *
+ * @param  entry    a pending DNS entry
+ * @return true     If it can be collected
+ * @return false    If it is still in progress
+ */
+bool dns_is_completed(DnsEntry *entry) {
+
+    if (entry->request == NULL) {
+        return entry->isCompleted;
+    }
+
+    return gai_error(entry->request) != EAI_INPROGRESS;
+}
+
+
+/**
+ * @brief  Free the requests parked which are completed, with their results
+ *         and hostnames. When the cache is destroyed, wait for all of them
+ *
+ * @param  cache      a DNS cache
+ * @param  isWaiting  if the requests in progress are waited for
+ */
+void dns_reclaim_parked(DnsCache *cache, bool isWaiting) {
+
+    DnsParked **link = &cache->parked;
+
+    while (*link != NULL) {
+        DnsParked *parked = *link;
+        const struct gaicb *list[1] = {parked->request};
+
+        while (isWaiting && gai_error(parked->request) == EAI_INPROGRESS) {
+            gai_suspend(list, 1, NULL);
+        }
+        if (gai_error(parked->request) == EAI_INPROGRESS) {
+            link = &parked->next;
+            continue;
+        }
+
+        if (parked->request->ar_result != NULL) {
+            freeaddrinfo(parked->request->ar_result);
+        }
+        *link = parked->next;
+        free(parked->request);
+        free(parked->hostname);
+        free(parked);
+    }
+}
+
+
+/**
+ * @brief  Store the result of a completed asynchronous resolution into
+ *         its entry, and mark the entry as not pending
+ *
+ * @param  cache    a DNS cache
+ * @param  index    the index of the entry
+ */
+void dns_collect(DnsCache *cache, int index) {
+
+    DnsEntry *entry = &cache->entries[index];
+    struct gaicb *request = entry->request;
+
+    // The thread resolving the entry (without a request) has already
+    // stored its result
+    if (request != NULL) {
+        if (gai_error(request) == SUCCESS) {
+            dns_store(cache, index, request->ar_result);
+            freeaddrinfo(request->ar_result);
+        } else {
+            dns_store(cache, index, NULL);
+        }
+        free(request);
+    }
+
+    entry->request     = NULL;
+    entry->isPending   = false;
+    entry->isCompleted = false;
+    cache->pending--;
+}
+
+
+/**
+ * @brief  Store the first IPv4 address of a resolution into an entry
+ *         (or that the hostname is invalid), and when the entry expires
+ *
+ * @param  cache    a DNS cache
+ * @param  index    the index of the entry
+ * @param  result   the result of the resolution, or NULL if it failed
+ */
+void dns_store(DnsCache *cache, int index, struct addrinfo *result) {
+
+    DnsEntry *entry = &cache->entries[index];
+    long long now   = get_monotonic_ms();
+
+    if (result != NULL) {
+        entry->addr    = ((struct sockaddr_in *)result->ai_addr)->sin_addr;
+        entry->isValid = true;
+        entry->expires = now + cache->ttl_ms;
+    } else {
+        entry->isValid = false;
+        entry->expires = now + cache->negative_ttl_ms;
+    }
+}
@@ -0,0 +1,76 @@
+/**
+ * @file      dnsCache.h
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     DNS resolution cache module. It includes
+ *              1. creating and destroying a DNS cache
+ *              2. looking up a hostname without blocking (starting an
+ *                 asynchronous resolution if it is not cached)
+ *              3. resolving a hostname to its address (blocking if needed)
+ *              4. collecting the asynchronous resolutions completed
+ *              5. reporting the cache hits and misses
+ *            Both valid and invalid hostnames are cached until their TTL
+ *            expires, and the cache keeps up to a maximum number of entries.
+ *            The cache can be shared by threads
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#ifndef DNSCACHE_H
+#define DNSCACHE_H
+
+#include <netinet/in.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+
+// ============================================================================
+// == | Constant Definitions
+// ============================================================================
+#define DNS_POLL_INTERVAL_MS    5
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+typedef struct dns_cache DnsCache;
+
+/**
+ * @brief  The status of a hostname in the DNS cache
+ */
+typedef enum {
+    DNS_RESOLVED,
+    DNS_INVALID,
+    DNS_PENDING
+} DnsStatus;
+
+
+// ============================================================================
+// == | Module Functions
+// ============================================================================
+// Create a new empty DNS cache
+DnsCache *new_DnsCache(int max_entries, int ttl_ms, int negative_ttl_ms);
+
+// Destroy a DNS cache and free its memory
+void free_DnsCache(DnsCache *cache);
+
+// Look up a hostname without blocking, start resolving it if not cached
+DnsStatus dns_cache_lookup(DnsCache *cache, char *hostname);
+
+// Resolve a hostname to its address, blocking until it is resolved
+bool dns_cache_resolve(DnsCache *cache, char *hostname, struct in_addr *addr);
+
+// Collect the asynchronous resolutions completed, return how many
+int dns_cache_poll(DnsCache *cache);
+
+// Return the number of asynchronous resolutions not completed yet
+int get_dns_cache_pending(DnsCache *cache);
+
+// Get the number of cache hits and misses
+void get_dns_cache_lookups(DnsCache *cache, long *hits, long *misses);
+
+// Print out the number of cache hits and misses
+void print_dns_cache_stats(DnsCache *cache, FILE *fp);
+
+
+#endif
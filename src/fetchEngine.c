@@ -0,0 +1,935 @@
+/**
+ * @file      fetchEngine.c
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     Implementation of concurrent fetch engine module. It includes
+ *              1. creating and destroying a fetch engine
+ *              2. starting to fetch a URL with a non-blocking socket
+ *              3. waiting (with epoll) until a fetch is completed, or an
+ *                 asynchronous DNS resolution is completed
+ *              4. reporting the engine statistics, and recording the phases
+ *                 of the fetches into metrics and a trace, and counting the
+ *                 parsing of the headers with performance counters
+ *            Each fetch goes through connecting, sending the request and
+ *            receiving the response. The engine only waits on epoll when
+ *            there is no completed fetch to return. Connections are kept
+ *            alive and reused by later fetches to the same host. A fetch
+ *            which does not connect, send or receive anything within the
+ *            fetch timeout is completed as failed.
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#include "fetchEngine.h"
+
+#include "connectionPool.h"
+#include "crawlConfig.h"
+#include "crawlMetrics.h"
+#include "crawlTrace.h"
+#include "dnsCache.h"
+#include "histogram.h"
+#include "httpHandler.h"
+#include "perfCounters.h"
+#include "responseInfo.h"
+#include "socketHandler.h"
+#include "urlInfo.h"
+#include "utilities.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/epoll.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+/**
+ * @brief  The state of a fetch
+ */
+typedef enum {
+    FETCH_FREE,
+    FETCH_CONNECTING,
+    FETCH_SENDING,
+    FETCH_RECEIVING,
+    FETCH_DONE
+} FetchState;
+
+
+typedef struct fetch Fetch;
+/**
+ * @brief  A fetch include its state, socket (and if it is reused from the
+ *         connection pool), the URL be fetched, the request (and how much of
+ *         it is sent), the response received (the size of its buffer,
+ *         and how much is framed), the time it is started (and the time to
+ *         complete it), the time its current phase is started (if the
+ *         metrics are kept or the crawl is traced), and the time it fails
+ *         if it makes no progress (in milliseconds)
+ */
+struct fetch {
+    FetchState state;
+    int connfd;
+    bool isReused;
+    UrlInfo *url;
+    char *request;
+    int request_len;
+    int request_sent;
+    char *buffer;
+    int buffer_size;
+    int buffer_used;
+    ResponseFrame frame;
+    ResponseInfo *resp;
+    bool isHandled;
+    unsigned long done_seq;
+    long long start_us;
+    long long phase_us;
+    long long elapsed_us;
+    long long deadline_ms;
+};
+
+
+/**
+ * @brief  A fetch engine include the epoll instance, a slot for each request
+ *         in flight, the pool of idle keep-alive connections, the DNS cache 
+ *         used to resolve the hostnames, the port of the servers, the limit
+ *         of requests in flight, the maximum content of a response kept, the
+ *         time a fetch waits to make progress, the latency of the fetches
+ *         completed, the bytes received (the number in flight and the bytes
+ *         are read by other threads), and the metrics and the ring of trace
+ *         events the phases of the fetches are recorded into, and the
+ *         performance counters the parsing of the responses is counted with
+ *         (NULL if they are not kept)
+ */
+struct fetch_engine {
+    int epollfd;
+    ConnectionPool *pool;
+    DnsCache *dnsCache;
+    Fetch *fetches;
+    struct epoll_event *events;
+    int port;
+    int max_inflight;
+    int max_body;
+    int fetch_timeout_ms;
+    int inflight;
+    unsigned long done_count;
+    long recv_bytes;
+    Histogram *latency;
+    CrawlMetrics *metrics;
+    TraceRing *traceRing;
+    PerfCounters *perf;
+};
+
+
+// ============================================================================
+// == | Function Prototypes
+// ============================================================================
+// Handle the epoll events of a fetch according to its state
+void fetch_handle_event(FetchEngine *engine, Fetch *fetch);
+
+// Send the rest of the request of a fetch
+void fetch_send_request(FetchEngine *engine, Fetch *fetch);
+
+// Receive the response of a fetch
+void fetch_receive_response(FetchEngine *engine, Fetch *fetch);
+
+// Send the request again on a new connection if the reused one was closed
+bool fetch_retry_stale(FetchEngine *engine, Fetch *fetch);
+
+// Register the socket of a fetch in epoll for the events
+void fetch_watch(FetchEngine *engine, Fetch *fetch, int op, uint32_t events);
+
+// Release the socket of a fetch and parse its response
+void fetch_finish(FetchEngine *engine, Fetch *fetch, bool isReceived);
+
+// Record the time of the current phase of a fetch, and start the next one
+void fetch_end_phase(FetchEngine *engine, Fetch *fetch, MetricsPhase phase);
+
+// Give a fetch the fetch timeout from now to make progress
+void fetch_extend_deadline(FetchEngine *engine, Fetch *fetch);
+
+// Return the time until the earliest fetch in flight times out
+int get_fetch_timeout(FetchEngine *engine);
+
+// Complete the fetches in flight which have timed out as failed
+void fetch_expire_overdue(FetchEngine *engine);
+
+
+// ============================================================================
+// == | Global Variables
+// ============================================================================
+// The span traced for each phase of a fetch
+static const TraceName phase_trace_names[NUM_PHASES] = {
+    TRACE_SETUP, TRACE_CONNECT, TRACE_SEND, TRACE_WAIT, TRACE_RECEIVE,
+    TRACE_HEADER, TRACE_EXTRACT
+};
+
+
+// ============================================================================
+// == | Module Functions
+// ============================================================================
+/**
+ * @brief  Create a new fetch engine
+ *
+ * @param  config     the crawler configuration (the limits of requests in
+ *                    flight, the time an idle connection is kept, the time
+ *                    a fetch waits to make progress, and the port of the
+ *                    servers)
+ * @param  dnsCache   the DNS cache used to resolve the hostnames
+ * @return            the pointer of new fetch engine
+ */
+FetchEngine *new_FetchEngine(CrawlConfig *config, DnsCache *dnsCache) {
+
+    assert(config != NULL);
+
+    int max_inflight = config->max_inflight;
+
+    FetchEngine *engine = (FetchEngine *)malloc(sizeof *engine);
+    if (engine == NULL) {
+        fprintf(stderr, "Error: new_FetchEngine() malloc returned NULL\n");
+        exit(EXIT_FAILURE);
+    }
+
+    engine->fetches = (Fetch *)calloc(max_inflight, sizeof *engine->fetches);
+    engine->events  = (struct epoll_event *)calloc(max_inflight,
+                                                   sizeof *engine->events);
+    if (engine->fetches == NULL || engine->events == NULL) {
+        fprintf(stderr, "Error: new_FetchEngine() calloc returned NULL\n");
+        exit(EXIT_FAILURE);
+    }
+
+    engine->epollfd = epoll_create1(0);
+    if (engine->epollfd < 0) {
+        perror("ERROR creating epoll instance");
+        exit(EXIT_FAILURE);
+    }
+
+    // Initalise value of the fetch engine
+    for (int i = 0; i < max_inflight; i++) {
+        engine->fetches[i].state  = FETCH_FREE;
+        engine->fetches[i].connfd = -1;
+    }
+    engine->pool         = new_ConnectionPool(max_inflight,
+                                              config->idle_timeout_ms);
+    engine->dnsCache     = dnsCache;
+    engine->port         = config->server_port;
+    engine->max_inflight = max_inflight;
+    engine->max_body     = config->max_body_bytes;
+    engine->fetch_timeout_ms = config->fetch_timeout_ms;
+    engine->inflight     = 0;
+    engine->done_count   = 0;
+    engine->recv_bytes   = 0;
+    engine->latency      = new_Histogram();
+    engine->metrics      = NULL;
+    engine->traceRing    = NULL;
+    engine->perf         = NULL;
+
+    return engine;
+}
+
+
+/**
+ * @brief  Destroy and free the memory associated with a fetch engine.
+ *         All fetches should be completed before
+ *
+ * @param  engine   a fetch engine
+ */
+void free_FetchEngine(FetchEngine *engine) {
+
+    // Error if the engine does not initalise or fetches are not completed
+    assert(engine != NULL);
+    assert(engine->inflight == 0);
+
+    free_ConnectionPool(engine->pool);
+    free_Histogram(engine->latency);
+    engine->pool    = NULL;
+    engine->latency = NULL;
+
+    close(engine->epollfd);
+    free(engine->fetches);
+    free(engine->events);
+    engine->fetches = NULL;
+    engine->events  = NULL;
+
+    free(engine);
+    engine = NULL;
+}
+
+
+/**
+ * @brief  Check if the engine reaches the limit of requests in flight
+ *
+ * @param  engine   a fetch engine
+ * @return true     If no more fetch can be started now
+ * @return false    If there are less requests in flight than the maximum
+ */
+bool fetch_engine_is_full(FetchEngine *engine) {
+
+    assert(engine != NULL);
+
+    return engine->inflight >= engine->max_inflight;
+}
+
+
+/**
+ * @brief  Record the phases of the fetches, the bytes sent and received,
+ *         the connections and the responses into metrics
+ *
+ * @param  engine   a fetch engine
+ * @param  metrics  the metrics (of the worker the engine belongs to)
+ */
+void fetch_engine_use_metrics(FetchEngine *engine, CrawlMetrics *metrics) {
+
+    assert(engine != NULL);
+
+    engine->metrics = metrics;
+}
+
+
+/**
+ * @brief  Record the phases of the fetches as spans of their URLs into a
+ *         ring of trace events
+ *
+ * @param  engine     a fetch engine
+ * @param  traceRing  the ring (of the worker the engine belongs to)
+ */
+void fetch_engine_use_trace(FetchEngine *engine, TraceRing *traceRing) {
+
+    assert(engine != NULL);
+
+    engine->traceRing = traceRing;
+}
+
+
+/**
+ * @brief  Count the parsing of the responses (the status line and the
+ *         headers) with performance counters
+ *
+ * @param  engine   a fetch engine
+ * @param  perf     the counters (of the worker the engine belongs to)
+ */
+void fetch_engine_use_perf(FetchEngine *engine, PerfCounters *perf) {
+
+    assert(engine != NULL);
+
+    engine->perf = perf;
+}
+
+
+/**
+ * @brief  Start fetching a URL. Reuse an idle connection to its host, or 
+ *         set up a non-blocking socket and wait for it to be connected. 
+ *         If it can not be connected, the fetch is completed and its 
+ *         response will not be handled
+ *
+ * @param  engine   a fetch engine
+ * @param  url      a UrlInfo data
+ */
+void fetch_engine_start(FetchEngine *engine, UrlInfo *url) {
+
+    assert(engine != NULL);
+    assert(url != NULL);
+    assert(engine->inflight < engine->max_inflight);
+
+    // Find a free slot for the fetch
+    Fetch *fetch = engine->fetches;
+    while (fetch->state != FETCH_FREE) {
+        fetch++;
+    }
+
+    __atomic_store_n(&engine->inflight, engine->inflight + 1,
+                     __ATOMIC_RELAXED);
+
+    fetch->url          = url;
+    fetch->request      = construct_req_header(url);
+    fetch->request_len  = strlen(fetch->request);
+    fetch->request_sent = 0;
+    fetch->buffer       = NULL;
+    fetch->buffer_size  = 0;
+    fetch->buffer_used  = 0;
+    fetch->resp         = NULL;
+    fetch->isHandled    = false;
+    fetch->start_us     = get_monotonic_us();
+    fetch->phase_us     = fetch->start_us;
+    init_response_frame(&fetch->frame, engine->max_body);
+    fetch_extend_deadline(engine, fetch);
+
+    // Reuse an idle connection to the host if there is one
+    fetch->connfd = connection_pool_take(engine->pool, url->hostname);
+    fetch->isReused = fetch->connfd >= 0;
+    if (fetch->isReused) {
+        METRICS_COUNT(engine->metrics, COUNTER_CONNECTIONS_REUSED, 1);
+        fetch->state = FETCH_SENDING;
+        fetch_watch(engine, fetch, EPOLL_CTL_ADD, EPOLLOUT);
+        return;
+    }
+
+    // Otherwise, set up socket and start connecting it
+    fetch->connfd = setup_socket(url->hostname, engine->port,
+                                 engine->dnsCache);
+    fetch_end_phase(engine, fetch, PHASE_SETUP);
+    if (fetch->connfd < 0) {
+        fetch_finish(engine, fetch, false);
+        return;
+    }
+
+    // The socket is writable once it is connected
+    METRICS_COUNT(engine->metrics, COUNTER_CONNECTIONS, 1);
+    fetch->state = FETCH_CONNECTING;
+    fetch_watch(engine, fetch, EPOLL_CTL_ADD, EPOLLOUT);
+}
+
+
+/**
+ * @brief  Wait until a fetch is completed and return its result.
+ *         Completed fetches are returned in the order they are completed.
+ *         If some asynchronous DNS resolutions are completed first, it 
+ *         returns without a URL, so the resolved URLs can be fetched.
+ *         It also returns without a URL if there is nothing to wait for,
+ *         or no fetch is completed within the maximum time (e.g. another
+ *         host will be ready to be fetched by then). Fetches which time
+ *         out are completed as failed (their responses are not handled)
+ *
+ * @param  engine       a fetch engine
+ * @param  max_wait_ms  the maximum time to wait, or -1 to wait until a
+ *                      fetch is completed
+ * @return              the URL, response of the completed fetch, and
+ *                      if the response will be handled
+ */
+FetchResult fetch_engine_complete(FetchEngine *engine, int max_wait_ms) {
+
+    assert(engine != NULL);
+
+    long long deadline = get_monotonic_ms() + max_wait_ms;
+
+    while (true) {
+
+        // Return without a URL if nothing is in flight and no hostname is
+        // being resolved (another engine sharing the cache collected them)
+        if (engine->inflight == 0 
+            && get_dns_cache_pending(engine->dnsCache) == 0) {
+            FetchResult result = {NULL, NULL, false, 0, 0, 0};
+            return result;
+        }
+
+        // Find the earliest completed fetch
+        Fetch *done = NULL;
+        for (int i = 0; i < engine->max_inflight; i++) {
+            Fetch *fetch = &engine->fetches[i];
+
+            if (fetch->state == FETCH_DONE
+                && (done == NULL || fetch->done_seq < done->done_seq)) {
+                done = fetch;
+            }
+        }
+
+        if (done != NULL) {
+            // Release the slot and return the result
+            FetchResult result;
+            result.url        = done->url;
+            result.resp       = done->resp;
+            result.isHandled  = done->isHandled;
+            result.bytes      = done->buffer_used;
+            result.start_us   = done->start_us;
+            result.elapsed_us = done->elapsed_us;
+
+            done->state = FETCH_FREE;
+            done->url   = NULL;
+            done->resp  = NULL;
+            __atomic_store_n(&engine->inflight, engine->inflight - 1,
+                             __ATOMIC_RELAXED);
+
+            return result;
+        }
+
+        // If no fetch is completed, wait for the sockets to be ready,
+        // or until the next idle connection expires, 
+        // or until the next fetch times out,
+        // or until the DNS resolutions should be polled again
+        int timeout = get_connection_pool_timeout(engine->pool);
+        int fetch_timeout = get_fetch_timeout(engine);
+        if (fetch_timeout >= 0 && (timeout < 0 || timeout > fetch_timeout)) {
+            timeout = fetch_timeout;
+        }
+        if (get_dns_cache_pending(engine->dnsCache) > 0
+            && (timeout < 0 || timeout > DNS_POLL_INTERVAL_MS)) {
+            timeout = DNS_POLL_INTERVAL_MS;
+        }
+        if (max_wait_ms >= 0) {
+            long long left = deadline - get_monotonic_ms();
+            if (left < 0) {
+                left = 0;
+            }
+            if (timeout < 0 || timeout > left) {
+                timeout = (int)left;
+            }
+        }
+        int nevents = epoll_wait(engine->epollfd, engine->events,
+                                 engine->max_inflight, timeout);
+        if (nevents < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("ERROR waiting for epoll events");
+            exit(EXIT_FAILURE);
+        }
+
+        for (int i = 0; i < nevents; i++) {
+            fetch_handle_event(engine, (Fetch *)engine->events[i].data.ptr);
+        }
+
+        // Fail the fetches which make no progress, they are returned next
+        fetch_expire_overdue(engine);
+
+        // Close the connections idle for too long
+        connection_pool_evict_idle(engine->pool);
+
+        // Return without a URL if some hostnames are resolved
+        if (get_dns_cache_pending(engine->dnsCache) > 0
+            && dns_cache_poll(engine->dnsCache) > 0) {
+            FetchResult result = {NULL, NULL, false, 0, 0, 0};
+            return result;
+        }
+
+        // Return without a URL if the wait is over (and nothing is done)
+        if (max_wait_ms >= 0 && nevents == 0
+            && get_monotonic_ms() >= deadline) {
+            FetchResult result = {NULL, NULL, false, 0, 0, 0};
+            return result;
+        }
+    }
+}
+
+
+/**
+ * @brief  Get the number of fetches started but not completed yet
+ *         (including completed fetches not returned yet)
+ *
+ * @param  engine   a fetch engine
+ * @return          the number of fetches in flight
+ */
+int get_fetch_engine_inflight(FetchEngine *engine) {
+
+    assert(engine != NULL);
+
+    return __atomic_load_n(&engine->inflight, __ATOMIC_RELAXED);
+}
+
+
+/**
+ * @brief  Get the bytes of the responses received so far (by any thread,
+ *         while the engine is fetching)
+ *
+ * @param  engine   a fetch engine
+ * @return          the bytes received
+ */
+long get_fetch_engine_bytes(FetchEngine *engine) {
+
+    assert(engine != NULL);
+
+    return __atomic_load_n(&engine->recv_bytes, __ATOMIC_RELAXED);
+}
+
+
+/**
+ * @brief  Get the latency of the fetches completed (in microseconds, from
+ *         the time each fetch is started until its response is received)
+ *
+ * @param  engine   a fetch engine
+ * @return          the latency histogram of the engine
+ */
+Histogram *get_fetch_engine_latency(FetchEngine *engine) {
+
+    assert(engine != NULL);
+
+    return engine->latency;
+}
+
+
+/**
+ * @brief  Print out the statistics of the fetch engine
+ *
+ * @param  engine   a fetch engine
+ * @param  fp       the file to print into
+ */
+void print_fetch_engine_stats(FetchEngine *engine, FILE *fp) {
+
+    assert(engine != NULL);
+
+    print_connection_pool_stats(engine->pool, fp);
+}
+
+
+// ============================================================================
+// == | Auxillary Functions
+// ============================================================================
+/**
+ * @brief  Handle the epoll events of a fetch according to its state
+ *
+ * @param  engine   a fetch engine
+ * @param  fetch    a fetch whose socket is ready
+ */
+void fetch_handle_event(FetchEngine *engine, Fetch *fetch) {
+
+    if (fetch->state == FETCH_CONNECTING) {
+        // If the socket is writable, the connection is completed
+        if (!socket_connected(fetch->connfd)) {
+            fetch_finish(engine, fetch, false);
+            return;
+        }
+        fetch_end_phase(engine, fetch, PHASE_CONNECT);
+        fetch_extend_deadline(engine, fetch);
+        fetch->state = FETCH_SENDING;
+    }
+
+    if (fetch->state == FETCH_SENDING) {
+        fetch_send_request(engine, fetch);
+    } else if (fetch->state == FETCH_RECEIVING) {
+        fetch_receive_response(engine, fetch);
+    }
+}
+
+
+/**
+ * @brief  Send the rest of the request of a fetch. Once the whole request
+ *         is sent, wait for the response
+ *
+ * @param  engine   a fetch engine
+ * @param  fetch    a fetch whose socket is writable
+ */
+void fetch_send_request(FetchEngine *engine, Fetch *fetch) {
+
+    while (fetch->request_sent < fetch->request_len) {
+
+        ssize_t nbytes = send(fetch->connfd,
+                              fetch->request + fetch->request_sent,
+                              fetch->request_len - fetch->request_sent,
+                              MSG_NOSIGNAL);
+        if (nbytes < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                // Wait until the socket is writable again
+                return;
+            }
+            if (fetch_retry_stale(engine, fetch)) {
+                return;
+            }
+            perror("ERROR sending HTTP request");
+            fetch_finish(engine, fetch, false);
+            return;
+        }
+        fetch->request_sent += nbytes;
+        METRICS_COUNT(engine->metrics, COUNTER_BYTES_SENT, nbytes);
+    }
+    fetch_end_phase(engine, fetch, PHASE_SEND);
+
+    // The whole request is sent, wait for the response
+    if (fetch->buffer == NULL) {
+        fetch->buffer_size = RESPONSE_BUFFER_INIT;
+        fetch->buffer = (char *)malloc(fetch->buffer_size * sizeof(char));
+        if (fetch->buffer == NULL) {
+            fprintf(stderr, "Error: fetch_send_request() malloc "
+                            "returned NULL\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    fetch_extend_deadline(engine, fetch);
+    fetch->state = FETCH_RECEIVING;
+    fetch_watch(engine, fetch, EPOLL_CTL_MOD, EPOLLIN);
+}
+
+
+/**
+ * @brief  Receive the response of a fetch until the whole response is 
+ *         received (by its frame), the server closes the connection, 
+ *         or the maximum content is reached. 
+ *         The buffer grows as the response is received
+ *
+ * @param  engine   a fetch engine
+ * @param  fetch    a fetch whose socket is readable
+ */
+void fetch_receive_response(FetchEngine *engine, Fetch *fetch) {
+
+    while (true) {
+
+        // Double the buffer once it is full (keeping a byte for '\0')
+        if (fetch->buffer_used == fetch->buffer_size - 1) {
+            fetch->buffer_size *= 2;
+            fetch->buffer = (char *)realloc(fetch->buffer, 
+                                            fetch->buffer_size);
+            if (fetch->buffer == NULL) {
+                fprintf(stderr, "Error: fetch_receive_response() realloc "
+                                "returned NULL\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        ssize_t nbytes = read(fetch->connfd,
+                              fetch->buffer + fetch->buffer_used,
+                              fetch->buffer_size - fetch->buffer_used - 1);
+        if (nbytes < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                // Wait until the socket is readable again
+                return;
+            }
+            if (fetch_retry_stale(engine, fetch)) {
+                return;
+            }
+            perror("ERROR receiving resp");
+            fetch_finish(engine, fetch, false);
+            return;
+        }
+
+        if (nbytes == 0 && fetch_retry_stale(engine, fetch)) {
+            return;
+        }
+
+        // The time waited for the response ends with its first bytes
+        if (fetch->buffer_used == 0 && nbytes > 0) {
+            fetch_end_phase(engine, fetch, PHASE_WAIT);
+        }
+        METRICS_COUNT(engine->metrics, COUNTER_BYTES_RECEIVED, nbytes);
+        __atomic_store_n(&engine->recv_bytes,
+                         engine->recv_bytes + nbytes, __ATOMIC_RELAXED);
+
+        fetch->buffer_used += nbytes;
+        fetch->buffer[fetch->buffer_used] = NULL_TERMINATED;
+        fetch_extend_deadline(engine, fetch);
+
+        // The response is completed if the whole response is received
+        // (or the content is over the maximum kept), 
+        // or the server closes the connection
+        if (update_response_frame(&fetch->frame, fetch->buffer,
+                                  &fetch->buffer_used)
+            || nbytes == 0) {
+            fetch_finish(engine, fetch, true);
+            return;
+        }
+    }
+}
+
+
+/**
+ * @brief  Send the request again on a new connection if the reused 
+ *         connection was already closed by the server (nothing is received)
+ *
+ * @param  engine   a fetch engine
+ * @param  fetch    a fetch whose connection fails
+ * @return true     If the request will be sent on a new connection 
+ *                  (or the fetch is completed as it can not be connected)
+ * @return false    If the connection is not a reused one
+ */
+bool fetch_retry_stale(FetchEngine *engine, Fetch *fetch) {
+
+    if (!fetch->isReused || fetch->buffer_used > 0) {
+        return false;
+    }
+
+    connection_pool_discard_stale(engine->pool);
+    close_socket(fetch->connfd);
+
+    fetch->isReused     = false;
+    fetch->request_sent = 0;
+    init_response_frame(&fetch->frame, engine->max_body);
+
+    fetch->phase_us = get_monotonic_us();
+    fetch_extend_deadline(engine, fetch);
+    fetch->connfd = setup_socket(fetch->url->hostname, engine->port,
+                                 engine->dnsCache);
+    fetch_end_phase(engine, fetch, PHASE_SETUP);
+    if (fetch->connfd < 0) {
+        fetch_finish(engine, fetch, false);
+        return true;
+    }
+
+    METRICS_COUNT(engine->metrics, COUNTER_CONNECTIONS, 1);
+    fetch->state = FETCH_CONNECTING;
+    fetch_watch(engine, fetch, EPOLL_CTL_ADD, EPOLLOUT);
+
+    return true;
+}
+
+
+/**
+ * @brief  Register (or modify) the socket of a fetch in epoll for the events
+ *
+ * @param  engine   a fetch engine
+ * @param  fetch    a fetch
+ * @param  op       EPOLL_CTL_ADD or EPOLL_CTL_MOD
+ * @param  events   the events will be waited for
+ */
+void fetch_watch(FetchEngine *engine, Fetch *fetch, int op, uint32_t events) {
+
+    struct epoll_event event;
+    event.events   = events;
+    event.data.ptr = fetch;
+
+    if (epoll_ctl(engine->epollfd, op, fetch->connfd, &event) < 0) {
+        perror("ERROR registering socket in epoll");
+        exit(EXIT_FAILURE);
+    }
+}
+
+
+/**
+ * @brief  Release the socket of a fetch and parse its response. 
+ *         If the whole response is received and the server keeps the 
+ *         connection alive, it goes back to the connection pool. 
+ *         Otherwise, the socket is closed
+ *
+ * @param  engine       a fetch engine
+ * @param  fetch        a fetch
+ * @param  isReceived   if the response is received
+ */
+void fetch_finish(FetchEngine *engine, Fetch *fetch, bool isReceived) {
+
+    ResponseFrame *frame = &fetch->frame;
+    bool isReusable = isReceived 
+                   && frame->isKeepAlive
+                   && frame->total_len == fetch->buffer_used;
+
+    if (fetch->connfd >= 0) {
+        if (isReusable) {
+            // Stop watching the socket and keep it for the next request
+            epoll_ctl(engine->epollfd, EPOLL_CTL_DEL, fetch->connfd, NULL);
+            connection_pool_put(engine->pool, fetch->url->hostname, 
+                                fetch->connfd);
+        } else {
+            // Close the socket connection (also removes it from epoll)
+            close_socket(fetch->connfd);
+        }
+        fetch->connfd = -1;
+    }
+
+    free(fetch->request);
+    fetch->request = NULL;
+
+    fetch->resp = new_ResponseInfo();
+
+    if (isReceived) {
+        fetch_end_phase(engine, fetch, PHASE_RECEIVE);
+
+        // Parse the response, it owns the buffer from now on
+        fetch->buffer[fetch->buffer_used] = NULL_TERMINATED;
+        fetch->resp->buffer = fetch->buffer;
+
+        PerfSample start;
+        perf_stage_begin(engine->perf, &start);
+        fetch->isHandled = parse_response(fetch->buffer, frame, fetch->resp);
+        perf_stage_end(engine->perf, STAGE_HEADER, &start);
+
+        fetch_end_phase(engine, fetch, PHASE_HEADER);
+        METRICS_STATUS(engine->metrics, fetch->resp->status_code);
+    } else {
+        free(fetch->buffer);
+        fetch->isHandled = false;
+        METRICS_COUNT(engine->metrics, COUNTER_FETCH_ERRORS, 1);
+    }
+    fetch->buffer = NULL;
+
+    fetch->state    = FETCH_DONE;
+    fetch->done_seq = engine->done_count++;
+    fetch->elapsed_us = get_monotonic_us() - fetch->start_us;
+    histogram_record(engine->latency, fetch->elapsed_us);
+}
+
+
+/**
+ * @brief  Record the time of the current phase of a fetch into the
+ *         metrics and as a span into the trace, and start the next phase
+ *         from now (if the metrics are kept or the crawl is traced)
+ *
+ * @param  engine   a fetch engine
+ * @param  fetch    a fetch
+ * @param  phase    the phase ended
+ */
+void fetch_end_phase(FetchEngine *engine, Fetch *fetch, MetricsPhase phase) {
+
+    // The clock is not read for metrics built without
+    bool isTimed = METRICS_ENABLED && engine->metrics != NULL;
+    if (!isTimed && engine->traceRing == NULL) {
+        return;
+    }
+
+    long long now = get_monotonic_us();
+
+    METRICS_PHASE(engine->metrics, phase, now - fetch->phase_us);
+    trace_span(engine->traceRing, phase_trace_names[phase], fetch->url,
+               fetch->phase_us, now);
+    fetch->phase_us = now;
+}
+
+
+/**
+ * @brief  Give a fetch the fetch timeout from now to make progress (to
+ *         connect, to send its request, or to receive more of its response)
+ *
+ * @param  engine   a fetch engine
+ * @param  fetch    a fetch starting or moving on
+ */
+void fetch_extend_deadline(FetchEngine *engine, Fetch *fetch) {
+
+    fetch->deadline_ms = get_monotonic_ms() + engine->fetch_timeout_ms;
+}
+
+
+/**
+ * @brief  Get the time until the earliest fetch in flight times out
+ *
+ * @param  engine   a fetch engine
+ * @return          the time in milliseconds (0 if a fetch is already
+ *                  overdue), or -1 if no fetch is in flight
+ */
+int get_fetch_timeout(FetchEngine *engine) {
+
+    long long earliest = -1;
+
+    for (int i = 0; i < engine->max_inflight; i++) {
+        Fetch *fetch = &engine->fetches[i];
+
+        if (fetch->state != FETCH_FREE && fetch->state != FETCH_DONE
+            && (earliest < 0 || fetch->deadline_ms < earliest)) {
+            earliest = fetch->deadline_ms;
+        }
+    }
+
+    if (earliest < 0) {
+        return -1;
+    }
+
+    long long now = get_monotonic_ms();
+
+    return (earliest > now) ? (int)(earliest - now) : 0;
+}
+
+
+/**
+ * @brief  Complete the fetches in flight which have made no progress
+ *         within the fetch timeout (e.g. a connection never completed, or
+ *         a server gone silent) as failed. Their sockets are closed, and
+ *         their URLs are returned with the responses not handled
+ *
+ * @param  engine   a fetch engine
+ */
+void fetch_expire_overdue(FetchEngine *engine) {
+
+    long long now = get_monotonic_ms();
+
+    for (int i = 0; i < engine->max_inflight; i++) {
+        Fetch *fetch = &engine->fetches[i];
+
+        if (fetch->state != FETCH_FREE && fetch->state != FETCH_DONE
+            && fetch->deadline_ms <= now) {
+            fprintf(stderr, "ERROR fetch timed out: %s%s%s\n", HTTP_HEADER,
+                    fetch->url->hostname, fetch->url->filepath);
+            fetch_finish(engine, fetch, false);
+        }
+    }
+}
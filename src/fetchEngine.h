@@ -0,0 +1,99 @@
+/**
+ * @file      fetchEngine.h
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     Concurrent fetch engine module. It includes
+ *              1. creating and destroying a fetch engine
+ *              2. starting to fetch a URL with a non-blocking socket
+ *              3. waiting (with epoll) until a fetch is completed, or an
+ *                 asynchronous DNS resolution is completed
+ *              4. reporting the engine statistics, and recording the phases
+ *                 of the fetches into metrics and a trace, and counting the
+ *                 parsing of the headers with performance counters
+ *            The engine keeps up to a maximum number of requests in flight,
+ *            and reuses keep-alive connections (the requests to each host
+ *            are limited by the host limiter of the frontier)
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#ifndef FETCHENGINE_H
+#define FETCHENGINE_H
+
+#include "crawlConfig.h"
+#include "crawlMetrics.h"
+#include "crawlTrace.h"
+#include "dnsCache.h"
+#include "histogram.h"
+#include "perfCounters.h"
+#include "responseInfo.h"
+#include "urlInfo.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+typedef struct fetch_engine FetchEngine;
+
+typedef struct fetch_result FetchResult;
+/**
+ * @brief  A FetchResult include the URL be fetched, its response, if the
+ *         response will be handled, the bytes received, the time the fetch
+ *         is started (monotonic clock) and the time to fetch it (in
+ *         microseconds). The URL is NULL if no fetch is completed but some
+ *         hostnames are resolved (or the wait is over)
+ */
+struct fetch_result {
+    UrlInfo *url;
+    ResponseInfo *resp;
+    bool isHandled;
+    int bytes;
+    long long start_us;
+    long long elapsed_us;
+};
+
+
+// ============================================================================
+// == | Module Functions
+// ============================================================================
+// Create a new fetch engine
+FetchEngine *new_FetchEngine(CrawlConfig *config, DnsCache *dnsCache);
+
+// Destroy a fetch engine and free its memory
+void free_FetchEngine(FetchEngine *engine);
+
+// Check if the engine reaches the limit of requests in flight
+bool fetch_engine_is_full(FetchEngine *engine);
+
+// Record the phases of the fetches and their bytes into metrics
+void fetch_engine_use_metrics(FetchEngine *engine, CrawlMetrics *metrics);
+
+// Record the phases of the fetches as spans into a ring of trace events
+void fetch_engine_use_trace(FetchEngine *engine, TraceRing *traceRing);
+
+// Count the parsing of the responses with performance counters
+void fetch_engine_use_perf(FetchEngine *engine, PerfCounters *perf);
+
+// Start fetching a URL
+void fetch_engine_start(FetchEngine *engine, UrlInfo *url);
+
+// Wait until a fetch is completed (or hostnames are resolved), up to a time
+FetchResult fetch_engine_complete(FetchEngine *engine, int max_wait_ms);
+
+// Return the number of fetches started but not completed yet
+int get_fetch_engine_inflight(FetchEngine *engine);
+
+// Return the bytes of the responses received so far
+long get_fetch_engine_bytes(FetchEngine *engine);
+
+// Return the latency of the fetches completed
+Histogram *get_fetch_engine_latency(FetchEngine *engine);
+
+// Print out the statistics of the fetch engine
+void print_fetch_engine_stats(FetchEngine *engine, FILE *fp);
+
+
+#endif
@@ -4,8 +4,21 @@
  * @brief     Implementation of fetching method. It includes
  *              1. initialising doubly linked list of already be fetched URLs
  *                 and inserting elements into it
- *              2. initialising doubly linked list of URLs will be fetched
- *                 and inserting elements into it
+ *              2. initialising the frontier (URLs will be fetched, URLs 
+ *                 waiting for their hostname to be resolved, and the hash 
+ *                 set of URLs already seen) and inserting elements into it
+ *              3. moving the URLs whose hostname is resolved into the list 
+ *                 of URLs will be fetched
+ *              4. taking the next URL whose host can be fetched now, and
+ *                 giving back its host once it is fetched
+ *              5. stealing URLs will be fetched from another frontier
+ *              6. retrying URLs after a delay (the server was unavailable)
+ *              7. forwarding URLs to the frontier of the shard they belong
+ *                 to, when the crawl is sharded
+ *              8. spilling the URLs will be fetched to disk when there are
+ *                 too many in memory, and reloading them later
+ *              9. recording the URLs found, fetched and requeued into a
+ *                 checkpoint, so the crawl can be resumed
  *
  * @copyright created for COMP30023 Computer System 2020
  *
@@ -13,18 +26,55 @@
 
 #include "fetchHandler.h"
 
+#include "checkpoint.h"
+#include "crawlTrace.h"
 #include "dlist.h"
+#include "dnsCache.h"
+#include "fetchEngine.h"
+#include "hostScheduler.h"
+#include "httpHeader.h"
+#include "mailbox.h"
+#include "perfCounters.h"
+#include "responseInfo.h"
+#include "retryQueue.h"
+#include "spillQueue.h"
 #include "urlHandler.h"
 #include "urlInfo.h"
+#include "urlSet.h"
 #include "utilities.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 
 #include <assert.h>
+#include <pthread.h>
 #include <string.h>
 
 
+// ============================================================================
+// == | Constant Definitions
+// ============================================================================
+#define MAX_STEAL_BATCH         32
+#define SHARD_MAILBOX_CAPACITY  256
+#define MS_PER_S                1000
+
+
+// ============================================================================
+// == | Function Prototypes
+// ============================================================================
+// Forward a URL to the frontier of another shard
+void forward_Found(Frontier *frontier, int shard, UrlInfo *url);
+
+// Read back the URLs spilled once there are few URLs in memory
+void reload_spilled_Wait(Frontier *frontier);
+
+// Add a URL to the queue of its host, or spill it if there are too many
+void push_Wait(Frontier *frontier, UrlInfo *url);
+
+// Publish the number of URLs waiting for their hostname to be resolved
+void update_num_resolving(Frontier *frontier);
+
+
 // ============================================================================
 // == | Module Functions
 // ============================================================================
@@ -40,75 +90,793 @@ Dlist *new_Visited() {
 
 
 /**
- * @brief  Create new list of URLs which will be fetched
+ * @brief  Create new empty frontier
  * 
- * @return The address of the list
+ * @param  dnsCache     the DNS cache used to check the hostnames
+ * @param  seenSet      the set of URLs already seen (shared by frontiers)
+ * @param  limiter      the limiter pacing each host (shared by frontiers)
+ * @return              The address of the frontier
+ */
+Frontier *new_Frontier(DnsCache *dnsCache, UrlSet *seenSet,
+                       HostLimiter *limiter) {
+
+    Frontier *frontier = (Frontier *)malloc(sizeof *frontier);
+    if (frontier == NULL) {
+        fprintf(stderr, "Error: new_Frontier() malloc returned NULL\n");
+        exit(EXIT_FAILURE);
+    }
+
+    frontier->scheduler     = new_HostScheduler(limiter);
+    frontier->limiter       = limiter;
+    frontier->retryQueue    = new_RetryQueue();
+    frontier->spillQueue    = NULL;
+    frontier->spill_high    = 0;
+    frontier->spill_low     = 0;
+    frontier->checkpoint    = NULL;
+    frontier->metrics       = NULL;
+    frontier->traceRing     = NULL;
+    frontier->perf          = NULL;
+    frontier->resolvingList = new_dlist();
+    frontier->num_resolving = 0;
+    frontier->seenSet       = seenSet;
+    frontier->dnsCache      = dnsCache;
+    frontier->shard         = 0;
+    frontier->num_shards    = 1;
+    frontier->outboxes      = NULL;
+    frontier->inboxes       = NULL;
+    frontier->overflowLists = NULL;
+    frontier->in_transit    = NULL;
+    pthread_mutex_init(&frontier->lock, NULL);
+
+    return frontier;
+}
+
+
+/**
+ * @brief  Destroy and free the memory associated with a frontier 
+ *         (the DNS cache and the URL set are not owned by the frontier)
+ * 
+ * @param  frontier     a frontier
+ */
+void free_Frontier(Frontier *frontier) {
+
+    assert(frontier != NULL);
+
+    free_HostScheduler(frontier->scheduler);
+    free_RetryQueue(frontier->retryQueue);
+    if (frontier->spillQueue != NULL) {
+        free_SpillQueue(frontier->spillQueue);
+    }
+    free_dlist(frontier->resolvingList);
+    pthread_mutex_destroy(&frontier->lock);
+
+    // The frontier owns the mailboxes from the other shards
+    if (frontier->num_shards > 1) {
+        for (int i = 0; i < frontier->num_shards; i++) {
+            if (i != frontier->shard) {
+                free_Mailbox(frontier->inboxes[i]);
+                free_dlist(frontier->overflowLists[i]);
+            }
+        }
+        free(frontier->inboxes);
+        free(frontier->outboxes);
+        free(frontier->overflowLists);
+        frontier->inboxes       = NULL;
+        frontier->outboxes      = NULL;
+        frontier->overflowLists = NULL;
+    }
+    frontier->scheduler     = NULL;
+    frontier->limiter       = NULL;
+    frontier->retryQueue    = NULL;
+    frontier->spillQueue    = NULL;
+    frontier->checkpoint    = NULL;
+    frontier->metrics       = NULL;
+    frontier->traceRing     = NULL;
+    frontier->perf          = NULL;
+    frontier->resolvingList = NULL;
+    frontier->seenSet       = NULL;
+    frontier->dnsCache      = NULL;
+
+    free(frontier);
+    frontier = NULL;
+}
+
+
+/**
+ * @brief  Connect the frontiers of a sharded crawl: each pair of frontiers
+ *         get a mailbox each way, owned by the receiving frontier
+ * 
+ * @param  frontiers    the frontier of each shard
+ * @param  num_shards   the number of shards
+ * @param  in_transit   the number of URLs forwarded but not received 
+ *                      (shared by all frontiers)
+ */
+void connect_Frontier_shards(Frontier **frontiers, int num_shards,
+                             long *in_transit) {
+
+    for (int i = 0; i < num_shards; i++) {
+        Frontier *frontier = frontiers[i];
+
+        frontier->shard         = i;
+        frontier->num_shards    = num_shards;
+        frontier->in_transit    = in_transit;
+        frontier->outboxes      = (Mailbox **)calloc(num_shards, 
+                                                     sizeof(Mailbox *));
+        frontier->inboxes       = (Mailbox **)calloc(num_shards, 
+                                                     sizeof(Mailbox *));
+        frontier->overflowLists = (Dlist **)calloc(num_shards, 
+                                                   sizeof(Dlist *));
+        if (frontier->outboxes == NULL || frontier->inboxes == NULL
+            || frontier->overflowLists == NULL) {
+            fprintf(stderr, "Error: connect_Frontier_shards() calloc "
+                            "returned NULL\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    for (int i = 0; i < num_shards; i++) {
+        for (int j = 0; j < num_shards; j++) {
+            if (i != j) {
+                Mailbox *mailbox = new_Mailbox(SHARD_MAILBOX_CAPACITY);
+                frontiers[i]->outboxes[j]      = mailbox;
+                frontiers[j]->inboxes[i]       = mailbox;
+                frontiers[i]->overflowLists[j] = new_dlist();
+            }
+        }
+    }
+}
+
+
+/**
+ * @brief  Spill the URLs will be fetched to disk once the frontier holds
+ *         the high threshold of them in memory, and read them back once it
+ *         holds less than the low threshold
+ * 
+ * @param  frontier     a frontier
+ * @param  dir          the directory of the spill segment files
+ * @param  id           the id of the frontier, naming its segment files
+ * @param  spill_high   the number of URLs in memory to spill at
+ * @param  spill_low    the number of URLs in memory to reload below
  */
-Dlist *new_Wait() {
-    Dlist *waitedList = new_dlist();
-    return waitedList;
+void enable_Frontier_spill(Frontier *frontier, char *dir, int id,
+                           int spill_high, int spill_low) {
+
+    assert(spill_low <= spill_high);
+
+    frontier->spillQueue = new_SpillQueue(dir, id);
+    frontier->spill_high = spill_high;
+    frontier->spill_low  = spill_low;
+}
+
+
+/**
+ * @brief  Insert a URL found (in a webpage or a redirect) into the frontier
+ *         if its hostname is valid: into the waiting list, or the resolving
+ *         list if its hostname is still being resolved. If the crawl is 
+ *         sharded and the URL belongs to another shard, forward it instead
+ *         (the shard it belongs to counts it in the metrics, as a new,
+ *         duplicate or rejected link)
+ * 
+ * @param  frontier     a frontier
+ * @param  nexturl      a UrlInfo data
+ * @return true         If the URL is inserted or forwarded
+ * @return false        If the hostname is invalid, or the URL is already 
+ *                      in the frontier or be fetched
+ */
+bool insert_new_Found(Frontier *frontier, UrlInfo *nexturl) {
+
+    if (frontier->num_shards > 1) {
+        int shard = (int)(hash_url_key(nexturl) % frontier->num_shards);
+
+        if (shard != frontier->shard) {
+            forward_Found(frontier, shard, nexturl);
+            return true;
+        }
+    }
+
+    // Start the span of the insertion if the crawl is traced, it is only
+    // recorded if the URL is inserted
+    TraceEvent *event = start_trace_span(frontier->traceRing, TRACE_INSERT,
+                                         nexturl);
+
+    PerfSample start;
+    perf_stage_begin(frontier->perf, &start);
+
+    // Check if the hostname of the URL is valid
+    DnsStatus status = dns_cache_lookup(frontier->dnsCache, 
+                                        nexturl->hostname);
+
+    bool isInserted;
+
+    if (status == DNS_RESOLVED) {
+        // if URL is never be fetched before and is unique, insert it
+        // into waited list
+        isInserted = insert_new_Wait(frontier, nexturl);
+    } else if (status == DNS_PENDING) {
+        // if the hostname is still being resolved, wait for it
+        isInserted = insert_new_Resolving(frontier, nexturl);
+    } else {
+        perf_stage_end(frontier->perf, STAGE_DEDUP, &start);
+        METRICS_COUNT(frontier->metrics, COUNTER_LINKS_REJECTED, 1);
+        return false;
+    }
+
+    perf_stage_end(frontier->perf, STAGE_DEDUP, &start);
+    METRICS_COUNT(frontier->metrics, isInserted ? COUNTER_LINKS_NEW
+                                                : COUNTER_LINKS_DEDUPED, 1);
+    if (isInserted && event != NULL) {
+        end_trace_span(frontier->traceRing, event);
+    }
+    return isInserted;
+}
+
+
+/**
+ * @brief  Publish the URLs forwarded to the other shards, moving the URLs 
+ *         not fit into the mailboxes before into them first
+ * 
+ * @param  frontier     a frontier
+ * @return              the number of URLs published
+ */
+int flush_Found(Frontier *frontier) {
+
+    int published = 0;
+
+    for (int i = 0; i < frontier->num_shards; i++) {
+        if (i == frontier->shard) {
+            continue;
+        }
+
+        Dlist *overflowList = frontier->overflowLists[i];
+        while (get_dlist_size(overflowList) > 0) {
+            UrlInfo *url = dlist_remove_start(overflowList);
+
+            if (!mailbox_push(frontier->outboxes[i], url)) {
+                dlist_add_start(overflowList, url);
+                break;
+            }
+        }
+
+        published += mailbox_publish(frontier->outboxes[i]);
+    }
+
+    return published;
+}
+
+
+/**
+ * @brief  Insert the URLs forwarded by the other shards into the frontier
+ *         (and free the URLs not inserted)
+ * 
+ * @param  frontier     a frontier
+ * @return              the number of URLs received
+ */
+int receive_Found(Frontier *frontier) {
+
+    int received = 0;
+    UrlInfo *url;
+
+    for (int i = 0; i < frontier->num_shards; i++) {
+        if (i == frontier->shard) {
+            continue;
+        }
+
+        while ((url = mailbox_pop(frontier->inboxes[i])) != NULL) {
+            if (!insert_new_Found(frontier, url)) {
+                free_urlInfo(url);
+            }
+            received++;
+        }
+    }
+
+    if (received > 0) {
+        __atomic_sub_fetch(frontier->in_transit, received, __ATOMIC_RELEASE);
+    }
+
+    return received;
+}
+
+
+/**
+ * @brief  Get the number of URLs forwarded to the other shards, but not fit
+ *         into the mailboxes yet
+ * 
+ * @param  frontier     a frontier
+ * @return              the number of URLs not fit into the mailboxes
+ */
+int get_frontier_outgoing(Frontier *frontier) {
+
+    int outgoing = 0;
+
+    for (int i = 0; i < frontier->num_shards; i++) {
+        if (i != frontier->shard) {
+            outgoing += get_dlist_size(frontier->overflowLists[i]);
+        }
+    }
+
+    return outgoing;
 }
 
 
 /**
  * @brief  Insert the UrlInfo data which will be fetched into list
  * 
- * @param  waitedList   a dlist of UrlInfo data will be fetched 
- * @param  vistedList   a dlist of UrlInfo data already be fetched 
+ * @param  frontier     a frontier
  * @param  nexturl      a UrlInfo data
  * 
  * @return true         If the UrlInfo data not exist in the list,
  *                      and be inserted into the list successfully
  * @return false        If the UrlInfo data already in the list or be fetched
  */
-bool insert_new_Wait(Dlist *waitedList, 
-                     Dlist *vistedList, 
-                     UrlInfo *nexturl) {
+bool insert_new_Wait(Frontier *frontier, UrlInfo *nexturl) {
 
-    UrlInfo *existUrl;
+    // Look up the new UrlInfo data in the set of URLs already waiting or 
+    // be fetched to ensure the same webpage will only be fetched once
+    // If the data already in the set, then return false 
+    if (!urlSet_insert(frontier->seenSet, nexturl)) {
+        return false;
+    }
+    if (frontier->checkpoint != NULL) {
+        checkpoint_found(frontier->checkpoint, nexturl);
+    }
 
-    int waitSize  = get_dlist_size(waitedList);
-    int visitSize = get_dlist_size(vistedList);
+    // If the URL is not be fetched or already in the waiting list, 
+    // insert it into the queue of its host (or spill it to disk if there
+    // are too many in memory), and return true
+    push_Wait(frontier, nexturl);
+    return true;
+}
 
-    // Compare the new UrlInfo data with each data already in the waiting list 
-    // to ensure there is no duplicate URL
-    // If the data already in the list, then return false 
-    for (int i = 0; i < waitSize; i++) {
-        existUrl = get_dlist_point(waitedList, i);
-        if (!compare_two_URL_diff(existUrl, nexturl)) {
-            return false;
-        }
+
+/**
+ * @brief  Insert the UrlInfo data restored from a checkpoint (found but not
+ *         fetched, or requeued) into list, and into the set of URLs seen if
+ *         it is not there yet
+ * 
+ * @param  frontier     a frontier
+ * @param  url          a UrlInfo data
+ */
+void restore_Wait(Frontier *frontier, UrlInfo *url) {
+
+    urlSet_insert(frontier->seenSet, url);
+    push_Wait(frontier, url);
+}
+
+
+/**
+ * @brief  Insert the UrlInfo data which will be fetched again into list
+ *         (e.g. the server is unavailable, or the authorization is required),
+ *         it is already in the set of URLs seen
+ * 
+ * @param  frontier     a frontier
+ * @param  url          a UrlInfo data
+ */
+void requeue_Wait(Frontier *frontier, UrlInfo *url) {
+
+    if (frontier->checkpoint != NULL) {
+        checkpoint_requeued(frontier->checkpoint, url);
     }
 
-    // Compare the new UrlInfo data with each data already be fetched 
-    // to ensure the same webpage will only be fetched once
-    // If the data already in the list, then return false
-    for (int i = 0; i < visitSize; i++) {
-        existUrl = get_dlist_point(vistedList, i);
-        if (!compare_two_URL_diff(existUrl, nexturl)) {
-            return false;
-        }
+    pthread_mutex_lock(&frontier->lock);
+    host_scheduler_push(frontier->scheduler, url, true);
+    pthread_mutex_unlock(&frontier->lock);
+}
+
+
+/**
+ * @brief  Put back the UrlInfo data taken from the frontier but not fetched
+ *         (e.g. the maximum number of URLs are fetched), and give back the
+ *         request slot of its host
+ * 
+ * @param  frontier     a frontier
+ * @param  url          a UrlInfo data
+ */
+void cancel_Wait(Frontier *frontier, UrlInfo *url) {
+
+    host_limiter_release(frontier->limiter, url->hostname);
+    requeue_Wait(frontier, url);
+}
+
+
+/**
+ * @brief  Insert the UrlInfo data which will be fetched again after a delay
+ *         (e.g. the server is unavailable), it is already in the set of URLs
+ *         seen. The other URLs can be fetched meanwhile
+ * 
+ * @param  frontier     a frontier
+ * @param  url          a UrlInfo data
+ * @param  delay_ms     the delay before it is fetched again
+ */
+void schedule_Retry(Frontier *frontier, UrlInfo *url, int delay_ms) {
+
+    long long due = get_monotonic_ms() + delay_ms;
+
+    if (frontier->checkpoint != NULL) {
+        checkpoint_requeued(frontier->checkpoint, url);
     }
 
-    // If the URL is not be fetched or already in the waiting list, 
-    // insert it into the waiting list, and return true
-    dlist_add_start(waitedList, nexturl);
+    pthread_mutex_lock(&frontier->lock);
+    retry_queue_push(frontier->retryQueue, url, due);
+    pthread_mutex_unlock(&frontier->lock);
+}
+
+
+/**
+ * @brief  Insert the UrlInfo data waiting for its hostname to be resolved 
+ *         into list. It is reserved in the set of URLs seen, so the same
+ *         URL found again meanwhile is not inserted twice. It is moved
+ *         into the waiting list once the hostname is resolved
+ * 
+ * @param  frontier     a frontier
+ * @param  nexturl      a UrlInfo data
+ * 
+ * @return true         If the UrlInfo data is not be fetched, waiting or
+ *                      resolving, and be inserted into the list successfully
+ * @return false        If the UrlInfo data already in the set of URLs seen
+ *                      (be fetched, waiting or resolving)
+ */
+bool insert_new_Resolving(Frontier *frontier, UrlInfo *nexturl) {
+
+    if (!urlSet_insert(frontier->seenSet, nexturl)) {
+        return false;
+    }
+    if (frontier->checkpoint != NULL) {
+        checkpoint_found(frontier->checkpoint, nexturl);
+    }
+
+    dlist_add_end(frontier->resolvingList, nexturl);
+    update_num_resolving(frontier);
     return true;
 }
 
 
 /**
  * @brief  Insert the already be fetched UrlInfo data into the list 
+ *         (the caller checks the maximum number of URLs fetched)
  * 
  * @param  vistedList   a dlist of UrlInfo data already be fetched 
+ * @param  frontier     a frontier
  * @param  nexturl      UrlInfo data already be fetched
  */
-void insert_new_Visit(Dlist *vistedList, UrlInfo *nexturl) {
+void insert_new_Visit(Dlist *vistedList, Frontier *frontier, UrlInfo *nexturl) {
+
+    dlist_add_end(vistedList, nexturl);
+
+    // Ensure the fetched URL will never be inserted into waiting list
+    urlSet_insert(frontier->seenSet, nexturl);
+}
+
+
+/**
+ * @brief  Give back the request slot of the host of a fetched URL, so the
+ *         host can be fetched again (by this frontier first). If the server
+ *         asks with Retry-After (up to a maximum), the host is not fetched
+ *         again until then. If the server is unavailable (503 or 504), the
+ *         host is reported as overloaded, so its circuit breaker can pause it.
+ *         The URL is recorded as fetched once its fetch is completed, so a
+ *         crawl resumed fetches again the URLs in flight
+ * 
+ * @param  frontier     a frontier
+ * @param  url          the UrlInfo data fetched
+ * @param  resp         its response, or NULL if there is none
+ */
+void finish_Visit(Frontier *frontier, UrlInfo *url, ResponseInfo *resp) {
+
+    long long now = get_monotonic_ms();
+
+    host_limiter_release(frontier->limiter, url->hostname);
+    if (frontier->checkpoint != NULL) {
+        checkpoint_visited(frontier->checkpoint, url);
+    }
+
+    if (resp != NULL) {
+        host_limiter_report(frontier->limiter, url->hostname,
+                            resp->status_code == 503 
+                            || resp->status_code == 504, now);
+
+        long retry_after = get_header_retry_after(&resp->header);
+        if (retry_after > MAX_RETRY_AFTER_S) {
+            retry_after = MAX_RETRY_AFTER_S;
+        }
+        if (retry_after > 0) {
+            host_limiter_defer(frontier->limiter, url->hostname,
+                               now + retry_after * MS_PER_S);
+        }
+    }
+
+    pthread_mutex_lock(&frontier->lock);
+    host_scheduler_wake(frontier->scheduler, url->hostname, now);
+    pthread_mutex_unlock(&frontier->lock);
+}
+
+
+/**
+ * @brief  Move the UrlInfo data whose hostname is resolved into the waiting 
+ *         list (it is already in the set of URLs seen), free the UrlInfo
+ *         data whose hostname is invalid, and keep the others in the
+ *         resolving list
+ * 
+ * @param  frontier     a frontier
+ */
+void resolve_pending_Wait(Frontier *frontier) {
+
+    int size = get_dlist_size(frontier->resolvingList);
+    if (size == 0) {
+        return;
+    }
+
+    // Collect the resolutions completed so far
+    dns_cache_poll(frontier->dnsCache);
+
+    for (int i = 0; i < size; i++) {
+        UrlInfo *url = dlist_remove_start(frontier->resolvingList);
+        DnsStatus status = dns_cache_lookup(frontier->dnsCache, 
+                                            url->hostname);
+
+        if (status == DNS_PENDING) {
+            // Keep waiting for the hostname to be resolved
+            dlist_add_end(frontier->resolvingList, url);
+        } else if (status == DNS_RESOLVED) {
+            push_Wait(frontier, url);
+        } else {
+            // Free the memory for URL not valid (it stays seen, so it is
+            // not resolved again)
+            free_urlInfo(url);
+        }
+    }
+    update_num_resolving(frontier);
+}
+
+
+/**
+ * @brief  Remove and return the newest UrlInfo data of the first host ready,
+ *         which can be fetched now (the delay since the last fetch of the 
+ *         host has passed, and the host does not reach the limit of requests
+ *         in flight). The request slot of the host is taken. The URLs
+ *         spilled are read back first if there are few left in memory
+ * 
+ * @param  frontier     a frontier
+ * @param  engine       a fetch engine
+ * @return              the UrlInfo data will be fetched next,
+ *                      or NULL if no URL can be fetched now
+ */
+UrlInfo *take_next_Wait(Frontier *frontier, FetchEngine *engine) {
+
+    UrlInfo *nexturl;
+    UrlInfo *url;
+
+    // If the engine is full, no URL can be fetched now
+    if (fetch_engine_is_full(engine)) {
+        return NULL;
+    }
+
+    long long now = get_monotonic_ms();
 
-    int visitSize = get_dlist_size(vistedList);
+    pthread_mutex_lock(&frontier->lock);
 
-    // Insert the data if the size of list haven't reached the maximum
-    if (visitSize < MAX_FETCH) {
-        dlist_add_end(vistedList, nexturl);
+    // The URLs whose retry time has come wait for their host again
+    while ((url = retry_queue_pop_due(frontier->retryQueue, now)) != NULL) {
+        host_scheduler_push(frontier->scheduler, url, true);
     }
-}
\ No newline at end of file
+    reload_spilled_Wait(frontier);
+
+    nexturl = host_scheduler_pop(frontier->scheduler, now);
+    pthread_mutex_unlock(&frontier->lock);
+
+    return nexturl;
+}
+
+
+/**
+ * @brief  Get the time until the first host of the URLs will be fetched is
+ *         ready (or the first URL is retried), so the worker knows how long
+ *         it can wait
+ * 
+ * @param  frontier     a frontier
+ * @return              the time in milliseconds (0 if a host is ready now),
+ *                      or -1 if there is no URL will be fetched
+ */
+int get_frontier_wait_ms(Frontier *frontier) {
+
+    pthread_mutex_lock(&frontier->lock);
+    long long ready = get_host_scheduler_ready(frontier->scheduler);
+    long long due   = get_retry_queue_due(frontier->retryQueue);
+    pthread_mutex_unlock(&frontier->lock);
+
+    if (ready < 0 || (due >= 0 && due < ready)) {
+        ready = due;
+    }
+
+    if (ready < 0) {
+        return -1;
+    }
+
+    long long wait = ready - get_monotonic_ms();
+    return (wait > 0) ? (int)wait : 0;
+}
+
+
+/**
+ * @brief  Move the oldest half of the URLs will be fetched (up to a batch)
+ *         from another frontier to this frontier, taking from the hosts in
+ *         turn. The moved URLs stay the oldest
+ * 
+ * @param  frontier     the frontier of an idle worker
+ * @param  victim       the frontier of another worker
+ * @return              the number of URLs moved
+ */
+int steal_Wait(Frontier *frontier, Frontier *victim) {
+
+    UrlInfo *stolen[MAX_STEAL_BATCH];
+    int num_stolen;
+
+    assert(frontier != victim);
+
+    // Only one frontier lock is held at a time
+    pthread_mutex_lock(&victim->lock);
+    num_stolen = (get_host_scheduler_size(victim->scheduler) + 1) / 2;
+    if (num_stolen > MAX_STEAL_BATCH) {
+        num_stolen = MAX_STEAL_BATCH;
+    }
+    num_stolen = host_scheduler_steal(victim->scheduler, stolen, num_stolen);
+    pthread_mutex_unlock(&victim->lock);
+
+    if (num_stolen == 0) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&frontier->lock);
+    for (int i = 0; i < num_stolen; i++) {
+        host_scheduler_push(frontier->scheduler, stolen[i], false);
+    }
+    pthread_mutex_unlock(&frontier->lock);
+
+    return num_stolen;
+}
+
+
+/**
+ * @brief  Get the number of URLs will be fetched (not waiting for their 
+ *         hostname to be resolved)
+ * 
+ * @param  frontier     a frontier
+ * @return              the number of URLs will be fetched
+ */
+int get_waited_size(Frontier *frontier) {
+
+    pthread_mutex_lock(&frontier->lock);
+    int size = get_host_scheduler_size(frontier->scheduler);
+    pthread_mutex_unlock(&frontier->lock);
+
+    return size;
+}
+
+
+/**
+ * @brief  Get the number of URLs will be fetched (in memory or spilled),
+ *         waiting to be retried, or waiting for their hostname to be
+ *         resolved (by any thread, while the crawl is running)
+ * 
+ * @param  frontier     a frontier
+ * @return              the number of URLs in the frontier
+ */
+int get_frontier_size(Frontier *frontier) {
+
+    pthread_mutex_lock(&frontier->lock);
+    int queued_size = get_retry_queue_size(frontier->retryQueue);
+    if (frontier->spillQueue != NULL) {
+        queued_size += (int)get_spill_queue_size(frontier->spillQueue);
+    }
+    pthread_mutex_unlock(&frontier->lock);
+
+    return get_waited_size(frontier) + queued_size
+         + __atomic_load_n(&frontier->num_resolving, __ATOMIC_RELAXED);
+}
+
+
+/**
+ * @brief  Get the number of URLs waiting to be retried
+ * 
+ * @param  frontier     a frontier
+ * @return              the number of URLs waiting to be retried
+ */
+int get_retrying_size(Frontier *frontier) {
+
+    pthread_mutex_lock(&frontier->lock);
+    int size = get_retry_queue_size(frontier->retryQueue);
+    pthread_mutex_unlock(&frontier->lock);
+
+    return size;
+}
+
+
+// ============================================================================
+// == | Auxillary Functions
+// ============================================================================
+/**
+ * @brief  Forward a URL to the frontier of another shard. It is counted as
+ *         in transit until that shard receives it. It waits in the overflow
+ *         list if the mailbox is full (keeping the order). It is recorded
+ *         as found, so it is not lost in transit if the crawl is resumed
+ * 
+ * @param  frontier     a frontier
+ * @param  shard        the shard the URL belongs to
+ * @param  url          a UrlInfo data
+ */
+void forward_Found(Frontier *frontier, int shard, UrlInfo *url) {
+
+    if (frontier->checkpoint != NULL) {
+        checkpoint_found(frontier->checkpoint, url);
+    }
+
+    __atomic_add_fetch(frontier->in_transit, 1, __ATOMIC_RELEASE);
+
+    if (get_dlist_size(frontier->overflowLists[shard]) > 0
+        || !mailbox_push(frontier->outboxes[shard], url)) {
+        dlist_add_end(frontier->overflowLists[shard], url);
+    }
+}
+
+
+/**
+ * @brief  Read back the URLs spilled (oldest first) once the frontier holds
+ *         less than the low threshold of URLs in memory, until it holds
+ *         half way to the high threshold. The frontier lock is held
+ * 
+ * @param  frontier     a frontier
+ */
+void reload_spilled_Wait(Frontier *frontier) {
+
+    UrlInfo *url;
+
+    if (frontier->spillQueue == NULL
+        || get_host_scheduler_size(frontier->scheduler)
+           >= frontier->spill_low) {
+        return;
+    }
+
+    int target = frontier->spill_low
+               + (frontier->spill_high - frontier->spill_low) / 2;
+
+    while (get_host_scheduler_size(frontier->scheduler) < target
+           && (url = spill_queue_pop(frontier->spillQueue)) != NULL) {
+        host_scheduler_push(frontier->scheduler, url, false);
+    }
+}
+
+
+/**
+ * @brief  Add a URL to the queue of its host as the newest, or spill it to
+ *         disk if the frontier holds the high threshold of URLs in memory
+ * 
+ * @param  frontier     a frontier
+ * @param  url          a UrlInfo data
+ */
+void push_Wait(Frontier *frontier, UrlInfo *url) {
+
+    pthread_mutex_lock(&frontier->lock);
+    if (frontier->spillQueue != NULL
+        && get_host_scheduler_size(frontier->scheduler)
+           >= frontier->spill_high
+        && spill_queue_push(frontier->spillQueue, url)) {
+        free_urlInfo(url);
+    } else {
+        host_scheduler_push(frontier->scheduler, url, true);
+    }
+    pthread_mutex_unlock(&frontier->lock);
+}
+
+
+/**
+ * @brief  Publish the number of URLs waiting for their hostname to be
+ *         resolved, so other threads read it without the resolving list
+ *         (only the worker of the frontier changes the list)
+ * 
+ * @param  frontier     a frontier
+ */
+void update_num_resolving(Frontier *frontier) {
+
+    __atomic_store_n(&frontier->num_resolving,
+                     get_dlist_size(frontier->resolvingList),
+                     __ATOMIC_RELAXED);
+}
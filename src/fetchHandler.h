@@ -4,8 +4,33 @@
  * @brief     Fetching method. It includes
  *              1. initialising doubly linked list of already be fetched URLs
  *                 and inserting elements into it
- *              2. initialising doubly linked list of URLs will be fetched
- *                 and inserting elements into it
+ *              2. initialising the frontier (URLs will be fetched, URLs 
+ *                 waiting for their hostname to be resolved, and the hash 
+ *                 set of URLs already seen) and inserting elements into it
+ *              3. moving the URLs whose hostname is resolved into the list 
+ *                 of URLs will be fetched
+ *              4. taking the next URL whose host can be fetched now, and
+ *                 giving back its host once it is fetched
+ *              5. stealing URLs will be fetched from another frontier
+ *              6. retrying URLs after a delay (the server was unavailable)
+ *              7. forwarding URLs to the frontier of the shard they belong
+ *                 to, when the crawl is sharded
+ *              8. spilling the URLs will be fetched to disk when there are
+ *                 too many in memory, and reloading them later
+ *              9. recording the URLs found, fetched and requeued into a
+ *                 checkpoint, so the crawl can be resumed
+ *            Each crawl worker has its own frontier. The URLs will be 
+ *            fetched are queued by host and guarded by the frontier lock:
+ *            the worker takes the newest URL of the first host ready (as the
+ *            host limiter paces each host), and other workers steal the 
+ *            oldest URLs. The set of URLs already seen is
+ *            shared by all frontiers, unless the crawl is sharded: then each
+ *            frontier has its own set and DNS cache, and only keeps URLs
+ *            whose canonical form hashes to its shard.
+ *            If spilling is enabled, the URLs found once the frontier holds
+ *            the high threshold in memory are appended to its spill queue
+ *            on disk, and read back (oldest first) once it falls below the
+ *            low threshold
  *
  * @copyright created for COMP30023 Computer System 2020
  *
@@ -16,7 +41,81 @@
 
 #include "dlist.h"
 
+#include "checkpoint.h"
+#include "crawlMetrics.h"
+#include "crawlTrace.h"
+#include "dnsCache.h"
+#include "fetchEngine.h"
+#include "hostScheduler.h"
+#include "mailbox.h"
+#include "perfCounters.h"
+#include "responseInfo.h"
+#include "retryQueue.h"
+#include "spillQueue.h"
 #include "urlInfo.h"
+#include "urlSet.h"
+
+#include <pthread.h>
+
+
+// ============================================================================
+// == | Constant Definitions
+// ============================================================================
+// The longest Retry-After honoured (a host is deferred, or a URL retried)
+#define MAX_RETRY_AFTER_S       120
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+typedef struct frontier Frontier;
+/**
+ * @brief  The frontier include the URLs will be fetched in a queue for each
+ *         host (and the lock guarding them), the limiter deciding when a host
+ *         can be fetched (shared), the URLs waiting to be retried, the list
+ *         of URLs waiting for their hostname to be resolved (and their
+ *         number, read by other threads), the set of URLs
+ *         already be fetched or will be fetched, and the DNS cache used to
+ *         check the hostnames.
+ *         If spilling is enabled, it also include the spill queue of the
+ *         URLs will be fetched on disk, and the thresholds of URLs in memory
+ *         to spill at and reload below.
+ *         If the crawl is checkpointed, it also include the checkpoint the
+ *         URLs found, fetched and requeued are recorded into (shared).
+ *         If the metrics are kept, it also include the metrics of its
+ *         worker, the links found are counted into.
+ *         If the crawl is traced, it also include the ring of events of its
+ *         worker, the insertions of the URLs found are recorded into.
+ *         If the stages are profiled, it also include the performance
+ *         counters of its worker, the URLs parsed and inserted are counted
+ *         into.
+ *         If the crawl is sharded, it also include its shard, the mailboxes
+ *         to and from each other shard, the URLs not fit into the mailboxes
+ *         yet, and the number of URLs forwarded but not received (shared)
+ */
+struct frontier {
+    pthread_mutex_t lock;
+    HostScheduler *scheduler;
+    HostLimiter *limiter;
+    RetryQueue *retryQueue;
+    SpillQueue *spillQueue;
+    int spill_high;
+    int spill_low;
+    Checkpoint *checkpoint;
+    CrawlMetrics *metrics;
+    TraceRing *traceRing;
+    PerfCounters *perf;
+    Dlist *resolvingList;
+    int num_resolving;
+    UrlSet *seenSet;
+    DnsCache *dnsCache;
+    int shard;
+    int num_shards;
+    Mailbox **outboxes;
+    Mailbox **inboxes;
+    Dlist **overflowLists;
+    long *in_transit;
+};
 
 
 // ============================================================================
@@ -25,16 +124,80 @@
 // Create new list of URLs which already be fetched 
 Dlist *new_Visited();
 
-// Create new list of URLs which will be fetched
-Dlist *new_Wait();
+// Create new empty frontier
+Frontier *new_Frontier(DnsCache *dnsCache, UrlSet *seenSet,
+                       HostLimiter *limiter);
+
+// Destroy a frontier and free its memory (except the DNS cache and URL set)
+void free_Frontier(Frontier *frontier);
+
+// Connect the frontiers of a sharded crawl with mailboxes
+void connect_Frontier_shards(Frontier **frontiers, int num_shards,
+                             long *in_transit);
+
+// Spill the URLs will be fetched to disk once there are too many in memory
+void enable_Frontier_spill(Frontier *frontier, char *dir, int id,
+                           int spill_high, int spill_low);
+
+// Insert a URL found into the frontier, or forward it to its shard
+bool insert_new_Found(Frontier *frontier, UrlInfo *nexturl);
+
+// Publish the URLs forwarded to the other shards
+int flush_Found(Frontier *frontier);
+
+// Insert the URLs forwarded by the other shards
+int receive_Found(Frontier *frontier);
+
+// Return the number of URLs forwarded but not fit into the mailboxes yet
+int get_frontier_outgoing(Frontier *frontier);
 
 // Insert the UrlInfo data which will be fetched into list
-bool insert_new_Wait(Dlist *waitedList, 
-                     Dlist *visitedList, 
-                     UrlInfo *nexturl);
+bool insert_new_Wait(Frontier *frontier, UrlInfo *nexturl);
+
+// Insert the UrlInfo data which will be fetched again into list
+void requeue_Wait(Frontier *frontier, UrlInfo *url);
+
+// Insert the UrlInfo data restored from a checkpoint into list
+void restore_Wait(Frontier *frontier, UrlInfo *url);
+
+// Put back the UrlInfo data taken but not fetched, and give back its host
+void cancel_Wait(Frontier *frontier, UrlInfo *url);
+
+// Insert the UrlInfo data which will be fetched again after a delay
+void schedule_Retry(Frontier *frontier, UrlInfo *url, int delay_ms);
+
+// Insert the UrlInfo data waiting for its hostname to be resolved into list
+bool insert_new_Resolving(Frontier *frontier, UrlInfo *nexturl);
 
 // Insert the already be fetched UrlInfo data into the list 
-void insert_new_Visit(Dlist *vistedList, UrlInfo *nexturl);
+void insert_new_Visit(Dlist *vistedList, Frontier *frontier, UrlInfo *nexturl);
+
+// Give back the host of a fetched URL, honour its Retry-After, and report
+// if the host is overloaded
+void finish_Visit(Frontier *frontier, UrlInfo *url, ResponseInfo *resp);
+
+// Move the UrlInfo data whose hostname is resolved into the waiting list
+void resolve_pending_Wait(Frontier *frontier);
+
+// Remove and return the next UrlInfo data whose host can be fetched now
+UrlInfo *take_next_Wait(Frontier *frontier, FetchEngine *engine);
+
+// Return the time until a host of the URLs will be fetched is ready
+// (or a URL is retried)
+int get_frontier_wait_ms(Frontier *frontier);
+
+// Move the oldest half of the URLs will be fetched from another frontier
+int steal_Wait(Frontier *frontier, Frontier *victim);
+
+// Return the number of URLs will be fetched (not waiting to be resolved)
+int get_waited_size(Frontier *frontier);
+
+// Return the number of URLs will be fetched (in memory or spilled),
+// retried or waiting to be resolved
+int get_frontier_size(Frontier *frontier);
+
+// Return the number of URLs waiting to be retried
+int get_retrying_size(Frontier *frontier);
 
 
 #endif
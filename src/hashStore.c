@@ -0,0 +1,356 @@
+/**
+ * @file      hashStore.c
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     Implementation of disk-backed hash store module. It includes
+ *              1. creating and destroying a store in a file, and loading
+ *                 a store from the file of an earlier one
+ *              2. adding a key (a 64-bit hash value), and checking if a key
+ *                 is added before
+ *            The file is an open addressing hash table (linear probing) of
+ *            keys with a power of two capacity, mapped into memory, and its
+ *            pages are written back by the kernel. An empty slot is 0, so
+ *            the key 0 is stored as 1. Once the table is too full, the keys
+ *            are rehashed into a file twice as large, which replaces it
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#include "hashStore.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <assert.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+// ============================================================================
+// == | Constant Definitions
+// ============================================================================
+#define HASH_STORE_INIT_CAPACITY    (1 << 16)
+#define HASH_STORE_MAX_LOAD_NUM     7
+#define HASH_STORE_MAX_LOAD_DEN     10
+#define HASH_STORE_GROW_SUFFIX      ".grow"
+#define EMPTY_KEY                   0
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+/**
+ * @brief  A hash store include the path of its file, the slots mapped from
+ *         it, the capacity, the number of keys, and the lock guarding them
+ */
+struct hash_store {
+    char *path;
+    uint64_t *slots;
+    long capacity;
+    long size;
+    pthread_mutex_t lock;
+};
+
+
+// ============================================================================
+// == | Function Prototypes
+// ============================================================================
+// Create a file of slots, and map it into memory
+uint64_t *map_store_file(char *path, long capacity);
+
+// Find the slot of a key, or the empty slot it should go
+uint64_t *hash_store_find(uint64_t *slots, long capacity, uint64_t key);
+
+// Double the capacity of a store, rehashing its keys into a new file
+void hash_store_grow(HashStore *store);
+
+
+// ============================================================================
+// == | Module Functions
+// ============================================================================
+/**
+ * @brief  Create a new empty store in a file (replacing the file if it
+ *         exists)
+ *
+ * @param  path   the path of the file (not copied)
+ * @return        the pointer of new store
+ */
+HashStore *new_HashStore(char *path) {
+
+    assert(path != NULL);
+
+    HashStore *store = (HashStore *)malloc(sizeof *store);
+    if (store == NULL) {
+        fprintf(stderr, "Error: new_HashStore() malloc returned NULL\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Initalise value of the store
+    store->path     = path;
+    store->slots    = map_store_file(path, HASH_STORE_INIT_CAPACITY);
+    store->capacity = HASH_STORE_INIT_CAPACITY;
+    store->size     = 0;
+    pthread_mutex_init(&store->lock, NULL);
+
+    return store;
+}
+
+
+/**
+ * @brief  Load a store from the file of an earlier store (which is kept as
+ *         the file of the store). Its capacity is the size of the file, and
+ *         its keys are counted
+ *
+ * @param  path   the path of the file (not copied)
+ * @return        the pointer of the store loaded, or NULL if the file
+ *                cannot be read or is not the file of a store
+ */
+HashStore *load_HashStore(char *path) {
+
+    struct stat st;
+
+    assert(path != NULL);
+
+    int fd = open(path, O_RDWR);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    // The capacity is a power of two, at least the initial capacity
+    long capacity = 0;
+    if (fstat(fd, &st) == 0) {
+        capacity = (long)(st.st_size / sizeof(uint64_t));
+    }
+    if (capacity < HASH_STORE_INIT_CAPACITY
+        || (capacity & (capacity - 1)) != 0
+        || (size_t)st.st_size != capacity * sizeof(uint64_t)) {
+        close(fd);
+        return NULL;
+    }
+
+    void *map = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                     fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return NULL;
+    }
+
+    HashStore *store = (HashStore *)malloc(sizeof *store);
+    if (store == NULL) {
+        fprintf(stderr, "Error: load_HashStore() malloc returned NULL\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Initalise value of the store
+    store->path     = path;
+    store->slots    = (uint64_t *)map;
+    store->capacity = capacity;
+    store->size     = 0;
+    pthread_mutex_init(&store->lock, NULL);
+
+    for (long i = 0; i < capacity; i++) {
+        if (store->slots[i] != EMPTY_KEY) {
+            store->size++;
+        }
+    }
+
+    return store;
+}
+
+
+/**
+ * @brief  Destroy and free the memory associated with a store, the file is
+ *         kept
+ *
+ * @param  store  a store
+ */
+void free_HashStore(HashStore *store) {
+
+    assert(store != NULL);
+
+    munmap(store->slots, store->capacity * sizeof(uint64_t));
+    store->slots = NULL;
+    pthread_mutex_destroy(&store->lock);
+
+    free(store);
+    store = NULL;
+}
+
+
+/**
+ * @brief  Add a key to the store
+ *
+ * @param  store    a store
+ * @param  key      the key
+ * @return true     If the key is not in the store and is added
+ * @return false    If the key is already in the store
+ */
+bool hash_store_add(HashStore *store, uint64_t key) {
+
+    assert(store != NULL);
+
+    if (key == EMPTY_KEY) {
+        key = EMPTY_KEY + 1;
+    }
+
+    pthread_mutex_lock(&store->lock);
+
+    // Keep the load factor below the maximum before adding
+    if ((store->size + 1) * HASH_STORE_MAX_LOAD_DEN
+        > store->capacity * HASH_STORE_MAX_LOAD_NUM) {
+        hash_store_grow(store);
+    }
+
+    uint64_t *slot = hash_store_find(store->slots, store->capacity, key);
+    bool isNew = *slot == EMPTY_KEY;
+    if (isNew) {
+        *slot = key;
+        store->size++;
+    }
+
+    pthread_mutex_unlock(&store->lock);
+
+    return isNew;
+}
+
+
+/**
+ * @brief  Check if a key is added to the store before
+ *
+ * @param  store    a store
+ * @param  key      the key
+ * @return true     If the key is in the store
+ * @return false    If the key is not in the store
+ */
+bool hash_store_contains(HashStore *store, uint64_t key) {
+
+    assert(store != NULL);
+
+    if (key == EMPTY_KEY) {
+        key = EMPTY_KEY + 1;
+    }
+
+    pthread_mutex_lock(&store->lock);
+    bool isFound
+        = *hash_store_find(store->slots, store->capacity, key) != EMPTY_KEY;
+    pthread_mutex_unlock(&store->lock);
+
+    return isFound;
+}
+
+
+/**
+ * @brief  Get the number of keys in the store
+ *
+ * @param  store    a store
+ * @return          the number of keys
+ */
+long get_hash_store_size(HashStore *store) {
+
+    assert(store != NULL);
+
+    pthread_mutex_lock(&store->lock);
+    long size = store->size;
+    pthread_mutex_unlock(&store->lock);
+
+    return size;
+}
+
+
+// ============================================================================
+// == | Auxillary Functions
+// ============================================================================
+/**
+ * @brief  Create a file of empty slots (its blocks allocated, so writing
+ *         into the mapping cannot fail), and map it into memory
+ *
+ * @param  path       the path of the file
+ * @param  capacity   the number of slots
+ * @return            the slots mapped
+ */
+uint64_t *map_store_file(char *path, long capacity) {
+
+    size_t bytes = capacity * sizeof(uint64_t);
+
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        fprintf(stderr, "Error: map_store_file() cannot create %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    if (posix_fallocate(fd, 0, bytes) != 0) {
+        fprintf(stderr, "Error: map_store_file() cannot allocate %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+
+    void *map = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "Error: map_store_file() mmap failed\n");
+        exit(EXIT_FAILURE);
+    }
+    close(fd);
+
+    return (uint64_t *)map;
+}
+
+
+/**
+ * @brief  Find the slot of a key by linear probing
+ *
+ * @param  slots      the slots of a store
+ * @param  capacity   the number of slots (a power of two)
+ * @param  key        the key (not 0)
+ * @return            the slot holding the key, or the empty slot where the
+ *                    key should be added
+ */
+uint64_t *hash_store_find(uint64_t *slots, long capacity, uint64_t key) {
+
+    uint64_t mask = (uint64_t)capacity - 1;
+    uint64_t i    = (key ^ (key >> 32)) & mask;
+
+    while (slots[i] != EMPTY_KEY && slots[i] != key) {
+        i = (i + 1) & mask;
+    }
+
+    return &slots[i];
+}
+
+
+/**
+ * @brief  Double the capacity of a store: rehash its keys into a new file,
+ *         which then replaces the file of the store. The lock is held
+ *
+ * @param  store    a store
+ */
+void hash_store_grow(HashStore *store) {
+
+    char path[PATH_MAX];
+    long capacity = store->capacity * 2;
+
+    snprintf(path, PATH_MAX, "%s%s", store->path, HASH_STORE_GROW_SUFFIX);
+    uint64_t *slots = map_store_file(path, capacity);
+
+    for (long i = 0; i < store->capacity; i++) {
+        uint64_t key = store->slots[i];
+
+        if (key != EMPTY_KEY) {
+            *hash_store_find(slots, capacity, key) = key;
+        }
+    }
+
+    munmap(store->slots, store->capacity * sizeof(uint64_t));
+    if (rename(path, store->path) != 0) {
+        fprintf(stderr, "Error: hash_store_grow() cannot replace %s\n",
+                store->path);
+        exit(EXIT_FAILURE);
+    }
+
+    store->slots    = slots;
+    store->capacity = capacity;
+}
@@ -0,0 +1,52 @@
+/**
+ * @file      hashStore.h
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     Disk-backed hash store module. It includes
+ *              1. creating and destroying a store in a file, and loading
+ *                 a store from the file of an earlier one
+ *              2. adding a key (a 64-bit hash value), and checking if a key
+ *                 is added before
+ *            The keys are kept in an open addressing hash table in a
+ *            memory-mapped file, so the store is not limited by memory.
+ *            The store has its own lock, it may be used by many threads
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#ifndef HASHSTORE_H
+#define HASHSTORE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+typedef struct hash_store HashStore;
+
+
+// ============================================================================
+// == | Module Functions
+// ============================================================================
+// Create a new empty store in a file (replacing the file)
+HashStore *new_HashStore(char *path);
+
+// Load a store from the file of an earlier store, or NULL if it cannot
+HashStore *load_HashStore(char *path);
+
+// Destroy a store and free its memory (the file is kept)
+void free_HashStore(HashStore *store);
+
+// Add a key to the store, return false if it is added before
+bool hash_store_add(HashStore *store, uint64_t key);
+
+// Check if a key is added to the store before
+bool hash_store_contains(HashStore *store, uint64_t key);
+
+// Return the number of keys in the store
+long get_hash_store_size(HashStore *store);
+
+
+#endif
@@ -0,0 +1,261 @@
+/**
+ * @file      histogram.c
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     Implementation of latency histogram module. It includes
+ *              1. creating and destroying a histogram
+ *              2. recording a value, and merging two histograms
+ *              3. getting a percentile, the count and the maximum of the
+ *                 values recorded
+ *            A value below 16 has a bucket of its own. A larger value is
+ *            bucketed by the position of its highest bit (its level) and
+ *            the 4 bits after it, so the width of a bucket is 1/16 of the
+ *            values in it at most.
+ *            Only one thread records into a histogram, so the counts are
+ *            not updated atomically, but they are stored and loaded whole
+ *            so another thread can merge it while it is recorded
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#include "histogram.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <assert.h>
+#include <string.h>
+
+
+// ============================================================================
+// == | Constant Definitions
+// ============================================================================
+#define HISTOGRAM_SUB_BITS      4
+#define HISTOGRAM_SUB_BUCKETS   (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_LEVELS        (64 - HISTOGRAM_SUB_BITS + 1)
+#define HISTOGRAM_BUCKETS       (HISTOGRAM_LEVELS * HISTOGRAM_SUB_BUCKETS)
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+/**
+ * @brief  A histogram include the count of values in each bucket, the
+ *         number of values recorded, and the largest value
+ */
+struct histogram {
+    long counts[HISTOGRAM_BUCKETS];
+    long count;
+    long long max;
+};
+
+
+// ============================================================================
+// == | Function Prototypes
+// ============================================================================
+// Get the bucket of a value
+int get_histogram_bucket(long long value);
+
+// Get the value in the middle of a bucket
+long long get_bucket_value(int bucket);
+
+
+// ============================================================================
+// == | Module Functions
+// ============================================================================
+/**
+ * @brief  Create a new empty histogram
+ *
+ * @return        the pointer of new histogram
+ */
+Histogram *new_Histogram() {
+
+    Histogram *hist = (Histogram *)calloc(1, sizeof *hist);
+    if (hist == NULL) {
+        fprintf(stderr, "Error: new_Histogram() calloc returned NULL\n");
+        exit(EXIT_FAILURE);
+    }
+
+    return hist;
+}
+
+
+/**
+ * @brief  Destroy and free the memory associated with a histogram
+ *
+ * @param  hist   a histogram
+ */
+void free_Histogram(Histogram *hist) {
+
+    assert(hist != NULL);
+
+    free(hist);
+    hist = NULL;
+}
+
+
+/**
+ * @brief  Record a value into its bucket
+ *
+ * @param  hist     a histogram
+ * @param  value    the value (negative values are recorded as 0)
+ */
+void histogram_record(Histogram *hist, long long value) {
+
+    assert(hist != NULL);
+
+    if (value < 0) {
+        value = 0;
+    }
+
+    // Only this thread writes the histogram, so a plain increment is
+    // enough, but it is stored whole for the threads merging it
+    int bucket = get_histogram_bucket(value);
+    __atomic_store_n(&hist->counts[bucket], hist->counts[bucket] + 1,
+                     __ATOMIC_RELAXED);
+    __atomic_store_n(&hist->count, hist->count + 1, __ATOMIC_RELAXED);
+    if (value > hist->max) {
+        __atomic_store_n(&hist->max, value, __ATOMIC_RELAXED);
+    }
+}
+
+
+/**
+ * @brief  Add the values recorded in a histogram into another. The
+ *         histogram added may be recorded into by another thread at the
+ *         same time, the count added is the sum of the buckets read
+ *
+ * @param  dest   the histogram added into (not shared)
+ * @param  src    the histogram added
+ */
+void histogram_merge(Histogram *dest, Histogram *src) {
+
+    assert(dest != NULL);
+    assert(src != NULL);
+
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        long count = __atomic_load_n(&src->counts[i], __ATOMIC_RELAXED);
+
+        dest->counts[i] += count;
+        dest->count     += count;
+    }
+
+    long long max = __atomic_load_n(&src->max, __ATOMIC_RELAXED);
+    if (max > dest->max) {
+        dest->max = max;
+    }
+}
+
+
+/**
+ * @brief  Get the value below which the given percent of the values
+ *         recorded are (the middle of the bucket it falls in, and not above
+ *         the largest value)
+ *
+ * @param  hist     a histogram
+ * @param  percent  the percent, from 0 to 100
+ * @return          the value at the percentile, or 0 if no value is
+ *                  recorded
+ */
+long long get_histogram_percentile(Histogram *hist, double percent) {
+
+    assert(hist != NULL);
+
+    if (hist->count == 0) {
+        return 0;
+    }
+
+    // The rank of the value at the percentile, from 1 to the count
+    long rank = (long)(percent / 100 * hist->count + 0.5);
+    if (rank < 1) {
+        rank = 1;
+    }
+
+    long seen = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += hist->counts[i];
+        if (seen >= rank) {
+            long long value = get_bucket_value(i);
+            return (value < hist->max) ? value : hist->max;
+        }
+    }
+
+    return hist->max;
+}
+
+
+/**
+ * @brief  Get the number of values recorded
+ *
+ * @param  hist   a histogram
+ * @return        the number of values
+ */
+long get_histogram_count(Histogram *hist) {
+
+    assert(hist != NULL);
+
+    return hist->count;
+}
+
+
+/**
+ * @brief  Get the largest value recorded
+ *
+ * @param  hist   a histogram
+ * @return        the largest value, or 0 if no value is recorded
+ */
+long long get_histogram_max(Histogram *hist) {
+
+    assert(hist != NULL);
+
+    return hist->max;
+}
+
+
+// ============================================================================
+// == | Auxillary Functions
+// ============================================================================
+/**
+ * @brief  Get the bucket of a value: its level is the position of its
+ *         highest bit (above the sub-bucket bits), and its sub-bucket is
+ *         the bits after the highest bit
+ *
+ * @param  value  a value (not negative)
+ * @return        the bucket
+ */
+int get_histogram_bucket(long long value) {
+
+    unsigned long long v = (unsigned long long)value;
+
+    if (v < HISTOGRAM_SUB_BUCKETS) {
+        return (int)v;
+    }
+
+    int shift = 63 - __builtin_clzll(v) - HISTOGRAM_SUB_BITS;
+
+    return (shift + 1) * HISTOGRAM_SUB_BUCKETS
+         + (int)((v >> shift) - HISTOGRAM_SUB_BUCKETS);
+}
+
+
+/**
+ * @brief  Get the value in the middle of a bucket
+ *
+ * @param  bucket   a bucket
+ * @return          the value
+ */
+long long get_bucket_value(int bucket) {
+
+    int level = bucket / HISTOGRAM_SUB_BUCKETS;
+    int sub   = bucket % HISTOGRAM_SUB_BUCKETS;
+
+    if (level == 0) {
+        return sub;
+    }
+
+    int shift = level - 1;
+    unsigned long long lowest
+        = (unsigned long long)(HISTOGRAM_SUB_BUCKETS + sub) << shift;
+
+    return (long long)(lowest + ((1ULL << shift) >> 1));
+}
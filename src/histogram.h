@@ -0,0 +1,55 @@
+/**
+ * @file      histogram.h
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     Latency histogram module. It includes
+ *              1. creating and destroying a histogram
+ *              2. recording a value, and merging two histograms
+ *              3. getting a percentile, the count and the maximum of the
+ *                 values recorded
+ *            The values are counted in log-linear buckets: each power of
+ *            two is split into 16 buckets, so a percentile is within about
+ *            6% of the value recorded, and any value fits in a fixed number
+ *            of buckets. A histogram is not locked, each thread records into
+ *            its own and they are merged (a histogram can be merged by
+ *            another thread while it is recorded)
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+typedef struct histogram Histogram;
+
+
+// ============================================================================
+// == | Module Functions
+// ============================================================================
+// Create a new empty histogram
+Histogram *new_Histogram();
+
+// Destroy a histogram and free its memory
+void free_Histogram(Histogram *hist);
+
+// Record a value (negative values are recorded as 0)
+void histogram_record(Histogram *hist, long long value);
+
+// Add the values recorded in a histogram into another
+void histogram_merge(Histogram *dest, Histogram *src);
+
+// Return the value below which the given percent of the values are
+long long get_histogram_percentile(Histogram *hist, double percent);
+
+// Return the number of values recorded
+long get_histogram_count(Histogram *hist);
+
+// Return the largest value recorded
+long long get_histogram_max(Histogram *hist);
+
+
+#endif
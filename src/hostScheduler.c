@@ -0,0 +1,969 @@
+/**
+ * @file      hostScheduler.c
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     Implementation of per-host politeness scheduler module. It
+ *            includes
+ *              1. the host limiter shared by all workers: the next time each
+ *                 host may be fetched, and its requests in flight
+ *              2. the host scheduler of a frontier: a queue of URLs for each
+ *                 host, and the hosts ordered by the time they are ready
+ *              3. taking the next URL whose host is ready, and stealing the
+ *                 oldest URLs
+ *              4. pausing a host after repeated overloaded responses
+ *                 (a circuit breaker)
+ *              5. reporting the politeness statistics
+ *              6. saving the state of the hosts backing off into a
+ *                 checkpoint, and restoring it
+ *            Both keep their hosts in a hash table (linear probing, keyed by
+ *            the lowercase hostname). The hosts with URLs left are also in a
+ *            min-heap by the time they are ready, so the first host ready is
+ *            found without looking at the others. The time a host is ready in
+ *            a scheduler is only a hint: the limiter decides, and the hint is
+ *            moved to the time the limiter gives if the host is not ready
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#include "hostScheduler.h"
+
+#include "checkpoint.h"
+#include "dlist.h"
+#include "urlInfo.h"
+#include "utilities.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <assert.h>
+#include <ctype.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+
+
+// ============================================================================
+// == | Constant Definitions
+// ============================================================================
+#define HOST_TABLE_INIT_CAPACITY    16
+#define HOST_TABLE_MAX_LOAD_NUM     7
+#define HOST_TABLE_MAX_LOAD_DEN     10
+#define HOST_BUSY_RETRY_MS          50
+#define CIRCUIT_MAX_FAILURES        3
+#define CIRCUIT_PAUSE_MS            1000
+#define CIRCUIT_MAX_PAUSES          3
+#define FNV_OFFSET_BASIS            14695981039346656037ULL
+#define FNV_PRIME                   1099511628211ULL
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+typedef struct host_slot HostSlot;
+/**
+ * @brief  The politeness state of a host: the next time it may be fetched,
+ *         its requests in flight, its overloaded responses in a row, how
+ *         many times in a row its circuit breaker paused it, and if it is
+ *         backing off in the last checkpoint saved. The hostname is NULL if
+ *         it is empty
+ */
+struct host_slot {
+    char *hostname;
+    uint64_t hash;
+    long long next_allowed;
+    int inflight;
+    int failures;
+    int pauses;
+    bool isCheckpointed;
+};
+
+
+/**
+ * @brief  A host limiter include the hash table of hosts (and the lock
+ *         guarding it), the delay between two fetches of a host, the maximum
+ *         requests in flight to a host, and the politeness statistics
+ */
+struct host_limiter {
+    pthread_mutex_t lock;
+    HostSlot *slots;
+    int capacity;
+    int num_hosts;
+    int delay_ms;
+    int max_per_host;
+    long granted;
+    long delayed;
+    long busy;
+    long deferred;
+    long paused;
+};
+
+
+typedef struct host_queue HostQueue;
+/**
+ * @brief  The queue of URLs of a host (newest first), the time the host is
+ *         ready, and its position in the heap (-1 if its queue is empty)
+ */
+struct host_queue {
+    char *hostname;
+    uint64_t hash;
+    Dlist *urls;
+    long long ready;
+    int heap_pos;
+    bool isBusy;
+};
+
+
+/**
+ * @brief  A host scheduler include the limiter it asks, the hash table of
+ *         host queues, the heap of host queues with URLs left (by the time
+ *         they are ready), and the number of URLs left
+ */
+struct host_scheduler {
+    HostLimiter *limiter;
+    HostQueue **table;
+    int capacity;
+    int num_hosts;
+    HostQueue **heap;
+    int heap_size;
+    int size;
+};
+
+
+// ============================================================================
+// == | Function Prototypes
+// ============================================================================
+// Compute the hash value of a hostname (case insensitive)
+uint64_t hash_hostname(char *hostname);
+
+// Find the slot of a host in the limiter, inserting it if it is not there
+HostSlot *host_limiter_find(HostLimiter *limiter, char *hostname);
+
+// Find the queue of a host in the scheduler, inserting it if it is not there
+HostQueue *host_scheduler_find(HostScheduler *sched, char *hostname,
+                               bool isInsert);
+
+// Move a host queue up the heap until its parent is ready before it
+void heap_sift_up(HostScheduler *sched, int pos);
+
+// Move a host queue down the heap until its children are ready after it
+void heap_sift_down(HostScheduler *sched, int pos);
+
+// Remove the host queue at a position of the heap
+void heap_remove(HostScheduler *sched, int pos);
+
+
+// ============================================================================
+// == | Module Functions
+// ============================================================================
+/**
+ * @brief  Create a new host limiter
+ *
+ * @param  delay_ms       the delay between two fetches of a host
+ * @param  max_per_host   the maximum requests in flight to a host
+ * @return                the pointer of new host limiter
+ */
+HostLimiter *new_HostLimiter(int delay_ms, int max_per_host) {
+
+    assert(max_per_host > 0);
+
+    HostLimiter *limiter = (HostLimiter *)malloc(sizeof *limiter);
+    if (limiter == NULL) {
+        fprintf(stderr, "Error: new_HostLimiter() malloc returned NULL\n");
+        exit(EXIT_FAILURE);
+    }
+
+    limiter->slots = (HostSlot *)calloc(HOST_TABLE_INIT_CAPACITY,
+                                        sizeof *limiter->slots);
+    if (limiter->slots == NULL) {
+        fprintf(stderr, "Error: new_HostLimiter() calloc returned NULL\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Initalise value of the host limiter
+    limiter->capacity     = HOST_TABLE_INIT_CAPACITY;
+    limiter->num_hosts    = 0;
+    limiter->delay_ms     = delay_ms;
+    limiter->max_per_host = max_per_host;
+    limiter->granted      = 0;
+    limiter->delayed      = 0;
+    limiter->busy         = 0;
+    limiter->deferred     = 0;
+    limiter->paused       = 0;
+    pthread_mutex_init(&limiter->lock, NULL);
+
+    return limiter;
+}
+
+
+/**
+ * @brief  Destroy and free the memory associated with a host limiter
+ *
+ * @param  limiter  a host limiter
+ */
+void free_HostLimiter(HostLimiter *limiter) {
+
+    assert(limiter != NULL);
+
+    for (int i = 0; i < limiter->capacity; i++) {
+        free(limiter->slots[i].hostname);
+    }
+    free(limiter->slots);
+    limiter->slots = NULL;
+
+    pthread_mutex_destroy(&limiter->lock);
+
+    free(limiter);
+    limiter = NULL;
+}
+
+
+/**
+ * @brief  Take a request slot of a host if it may be fetched now: the delay
+ *         since its last fetch has passed, and it has less requests in
+ *         flight than the maximum
+ *
+ * @param  limiter    a host limiter
+ * @param  hostname   the hostname
+ * @param  now        the current time (of the monotonic clock)
+ * @param  ready      returns the time the host may be fetched next
+ * @return            HOST_GRANTED if the slot is taken, HOST_DELAYED if it
+ *                    is too early, or HOST_BUSY if too many requests to the
+ *                    host are in flight
+ */
+HostGrant host_limiter_acquire(HostLimiter *limiter, char *hostname,
+                               long long now, long long *ready) {
+
+    assert(limiter != NULL);
+
+    HostGrant grant;
+
+    pthread_mutex_lock(&limiter->lock);
+
+    HostSlot *slot = host_limiter_find(limiter, hostname);
+    if (slot->next_allowed > now) {
+        *ready = slot->next_allowed;
+        limiter->delayed++;
+        grant = HOST_DELAYED;
+    } else if (slot->inflight >= limiter->max_per_host) {
+        // Check again later, if no request of this frontier wakes it
+        *ready = now + HOST_BUSY_RETRY_MS;
+        limiter->busy++;
+        grant = HOST_BUSY;
+    } else {
+        slot->inflight++;
+        slot->next_allowed = now + limiter->delay_ms;
+        *ready = slot->next_allowed;
+        limiter->granted++;
+        grant = HOST_GRANTED;
+    }
+
+    pthread_mutex_unlock(&limiter->lock);
+
+    return grant;
+}
+
+
+/**
+ * @brief  Give back the request slot of a host once its fetch is completed
+ *
+ * @param  limiter    a host limiter
+ * @param  hostname   the hostname
+ */
+void host_limiter_release(HostLimiter *limiter, char *hostname) {
+
+    assert(limiter != NULL);
+
+    pthread_mutex_lock(&limiter->lock);
+
+    HostSlot *slot = host_limiter_find(limiter, hostname);
+    assert(slot->inflight > 0);
+    slot->inflight--;
+
+    pthread_mutex_unlock(&limiter->lock);
+}
+
+
+/**
+ * @brief  Do not fetch a host again until the given time
+ *         (e.g. as the server asks with Retry-After)
+ *
+ * @param  limiter    a host limiter
+ * @param  hostname   the hostname
+ * @param  until      the time the host may be fetched again
+ */
+void host_limiter_defer(HostLimiter *limiter, char *hostname,
+                        long long until) {
+
+    assert(limiter != NULL);
+
+    pthread_mutex_lock(&limiter->lock);
+
+    HostSlot *slot = host_limiter_find(limiter, hostname);
+    if (until > slot->next_allowed) {
+        slot->next_allowed = until;
+    }
+    limiter->deferred++;
+
+    pthread_mutex_unlock(&limiter->lock);
+}
+
+
+/**
+ * @brief  Report if a response of a host shows it is overloaded (e.g. 503
+ *         Service Unavailable). After too many overloaded responses in a
+ *         row, the circuit breaker of the host pauses it, for twice as long
+ *         each time it pauses the host again. A response which is not
+ *         overloaded closes the circuit breaker
+ *
+ * @param  limiter        a host limiter
+ * @param  hostname       the hostname
+ * @param  isOverloaded   if the response shows the host is overloaded
+ * @param  now            the current time (of the monotonic clock)
+ * @return true           If the host is paused
+ * @return false          Otherwise
+ */
+bool host_limiter_report(HostLimiter *limiter, char *hostname,
+                         bool isOverloaded, long long now) {
+
+    assert(limiter != NULL);
+
+    bool isPaused = false;
+
+    pthread_mutex_lock(&limiter->lock);
+
+    HostSlot *slot = host_limiter_find(limiter, hostname);
+    if (!isOverloaded) {
+        slot->failures = 0;
+        slot->pauses   = 0;
+    } else if (++slot->failures >= CIRCUIT_MAX_FAILURES) {
+        long long pause = (long long)CIRCUIT_PAUSE_MS
+                          << (slot->pauses < CIRCUIT_MAX_PAUSES
+                              ? slot->pauses : CIRCUIT_MAX_PAUSES - 1);
+
+        if (now + pause > slot->next_allowed) {
+            slot->next_allowed = now + pause;
+        }
+        slot->failures = 0;
+        slot->pauses++;
+        limiter->paused++;
+        isPaused = true;
+    }
+
+    pthread_mutex_unlock(&limiter->lock);
+
+    return isPaused;
+}
+
+
+/**
+ * @brief  Check if a host is down: its circuit breaker paused it too many
+ *         times in a row, so its overloaded responses should not be retried
+ *
+ * @param  limiter    a host limiter
+ * @param  hostname   the hostname
+ * @return true       If the host is down
+ * @return false      Otherwise
+ */
+bool host_limiter_is_down(HostLimiter *limiter, char *hostname) {
+
+    assert(limiter != NULL);
+
+    pthread_mutex_lock(&limiter->lock);
+    bool isDown = host_limiter_find(limiter, hostname)->pauses
+                  >= CIRCUIT_MAX_PAUSES;
+    pthread_mutex_unlock(&limiter->lock);
+
+    return isDown;
+}
+
+
+/**
+ * @brief  Save the state of the hosts backing off into a checkpoint: a host
+ *         not fetched again until later than the delay (Retry-After, or the
+ *         pause of its circuit breaker), or with overloaded responses or
+ *         pauses in a row. A host backing off in the last checkpoint but
+ *         not anymore is saved as well, so its state is cleared
+ *
+ * @param  limiter      a host limiter
+ * @param  checkpoint   a checkpoint
+ * @param  now          the current time (of the monotonic clock)
+ */
+void save_host_limiter_state(HostLimiter *limiter, Checkpoint *checkpoint,
+                             long long now) {
+
+    assert(limiter != NULL);
+    assert(checkpoint != NULL);
+
+    pthread_mutex_lock(&limiter->lock);
+
+    for (int i = 0; i < limiter->capacity; i++) {
+        HostSlot *slot = &limiter->slots[i];
+        if (slot->hostname == NULL) {
+            continue;
+        }
+
+        long long delay = slot->next_allowed - now;
+        bool isBackingOff = delay > limiter->delay_ms || slot->failures > 0
+                            || slot->pauses > 0;
+
+        if (isBackingOff || slot->isCheckpointed) {
+            checkpoint_host(checkpoint, slot->hostname,
+                            isBackingOff && delay > 0 ? (int)delay : 0,
+                            slot->failures, slot->pauses);
+            slot->isCheckpointed = isBackingOff;
+        }
+    }
+
+    pthread_mutex_unlock(&limiter->lock);
+}
+
+
+/**
+ * @brief  Restore the state of a host saved into a checkpoint (the time
+ *         until it can be fetched again counts from now)
+ *
+ * @param  limiter    a host limiter
+ * @param  hostname   the hostname
+ * @param  delay_ms   the time until the host can be fetched again
+ * @param  failures   the overloaded responses in a row
+ * @param  pauses     the pauses of its circuit breaker in a row
+ * @param  now        the current time (of the monotonic clock)
+ */
+void restore_host_limiter_state(HostLimiter *limiter, char *hostname,
+                                int delay_ms, int failures, int pauses,
+                                long long now) {
+
+    assert(limiter != NULL);
+
+    pthread_mutex_lock(&limiter->lock);
+
+    HostSlot *slot = host_limiter_find(limiter, hostname);
+    slot->next_allowed = (delay_ms > 0) ? now + delay_ms : 0;
+    slot->failures     = failures;
+    slot->pauses       = pauses;
+
+    pthread_mutex_unlock(&limiter->lock);
+}
+
+
+/**
+ * @brief  Print out the politeness statistics: the number of hosts, and how
+ *         many times a host is granted, too early, too busy, deferred, or
+ *         paused by its circuit breaker
+ *
+ * @param  limiter  a host limiter
+ * @param  fp       the file to print into
+ */
+void print_host_limiter_stats(HostLimiter *limiter, FILE *fp) {
+
+    assert(limiter != NULL);
+
+    pthread_mutex_lock(&limiter->lock);
+    fprintf(fp, "hosts: %d hosts, %ld granted, %ld delayed, %ld busy, "
+                "%ld deferred, %ld paused\n",
+            limiter->num_hosts, limiter->granted, limiter->delayed,
+            limiter->busy, limiter->deferred, limiter->paused);
+    pthread_mutex_unlock(&limiter->lock);
+}
+
+
+/**
+ * @brief  Create a new empty host scheduler
+ *
+ * @param  limiter  the host limiter it asks (shared by the schedulers)
+ * @return          the pointer of new host scheduler
+ */
+HostScheduler *new_HostScheduler(HostLimiter *limiter) {
+
+    assert(limiter != NULL);
+
+    HostScheduler *sched = (HostScheduler *)malloc(sizeof *sched);
+    if (sched == NULL) {
+        fprintf(stderr, "Error: new_HostScheduler() malloc returned NULL\n");
+        exit(EXIT_FAILURE);
+    }
+
+    sched->table = (HostQueue **)calloc(HOST_TABLE_INIT_CAPACITY,
+                                        sizeof(HostQueue *));
+    sched->heap  = (HostQueue **)malloc(HOST_TABLE_INIT_CAPACITY
+                                        * sizeof(HostQueue *));
+    if (sched->table == NULL || sched->heap == NULL) {
+        fprintf(stderr, "Error: new_HostScheduler() calloc returned NULL\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Initalise value of the host scheduler
+    sched->limiter   = limiter;
+    sched->capacity  = HOST_TABLE_INIT_CAPACITY;
+    sched->num_hosts = 0;
+    sched->heap_size = 0;
+    sched->size      = 0;
+
+    return sched;
+}
+
+
+/**
+ * @brief  Destroy and free the memory associated with a host scheduler,
+ *         and the URLs left in it (the limiter is not owned)
+ *
+ * @param  sched  a host scheduler
+ */
+void free_HostScheduler(HostScheduler *sched) {
+
+    assert(sched != NULL);
+
+    for (int i = 0; i < sched->capacity; i++) {
+        HostQueue *queue = sched->table[i];
+
+        if (queue != NULL) {
+            free_dlist(queue->urls);
+            free(queue->hostname);
+            free(queue);
+        }
+    }
+    free(sched->table);
+    free(sched->heap);
+    sched->table = NULL;
+    sched->heap  = NULL;
+
+    free(sched);
+    sched = NULL;
+}
+
+
+/**
+ * @brief  Add a URL to the queue of its host. A host without URLs before
+ *         joins the heap by the time it is ready
+ *
+ * @param  sched      a host scheduler
+ * @param  url        a UrlInfo data
+ * @param  isNewest   true to add it as the newest URL (fetched first),
+ *                    false to add it as the oldest
+ */
+void host_scheduler_push(HostScheduler *sched, UrlInfo *url, bool isNewest) {
+
+    assert(sched != NULL);
+    assert(url != NULL);
+
+    HostQueue *queue = host_scheduler_find(sched, url->hostname, true);
+
+    if (isNewest) {
+        dlist_add_start(queue->urls, url);
+    } else {
+        dlist_add_end(queue->urls, url);
+    }
+    sched->size++;
+
+    if (queue->heap_pos < 0) {
+        queue->heap_pos = sched->heap_size;
+        sched->heap[sched->heap_size++] = queue;
+        heap_sift_up(sched, queue->heap_pos);
+    }
+}
+
+
+/**
+ * @brief  Remove and return the newest URL of the first host ready, which
+ *         the limiter lets be fetched now. The hosts the limiter does not
+ *         let be fetched are moved to the time it gives
+ *
+ * @param  sched  a host scheduler
+ * @param  now    the current time (of the monotonic clock)
+ * @return        the UrlInfo data will be fetched next,
+ *                or NULL if no host is ready now
+ */
+UrlInfo *host_scheduler_pop(HostScheduler *sched, long long now) {
+
+    assert(sched != NULL);
+
+    // Each host is asked at most once
+    for (int tries = sched->heap_size; tries > 0; tries--) {
+        HostQueue *queue = sched->heap[0];
+        long long ready;
+
+        if (queue->ready > now) {
+            break;
+        }
+
+        HostGrant grant = host_limiter_acquire(sched->limiter,
+                                               queue->hostname, now, &ready);
+        queue->ready  = ready;
+        queue->isBusy = grant == HOST_BUSY;
+
+        if (grant == HOST_GRANTED) {
+            UrlInfo *url = dlist_remove_start(queue->urls);
+            sched->size--;
+
+            if (get_dlist_size(queue->urls) == 0) {
+                heap_remove(sched, 0);
+            } else {
+                heap_sift_down(sched, 0);
+            }
+            return url;
+        }
+
+        heap_sift_down(sched, 0);
+    }
+
+    return NULL;
+}
+
+
+/**
+ * @brief  Remove the oldest URLs, taking one from the back of each host
+ *         queue in turn, so the URLs of one host are not all taken
+ *
+ * @param  sched  a host scheduler
+ * @param  urls   returns the URLs removed (oldest first)
+ * @param  max    the maximum number of URLs removed
+ * @return        the number of URLs removed
+ */
+int host_scheduler_steal(HostScheduler *sched, UrlInfo **urls, int max) {
+
+    assert(sched != NULL);
+
+    int num_stolen = 0;
+
+    while (num_stolen < max && sched->heap_size > 0) {
+
+        // The hosts ready last are at the end of the heap
+        for (int pos = sched->heap_size - 1; pos >= 0 && num_stolen < max;
+             pos--) {
+            HostQueue *queue = sched->heap[pos];
+
+            urls[num_stolen++] = dlist_remove_end(queue->urls);
+            sched->size--;
+
+            if (get_dlist_size(queue->urls) == 0) {
+                heap_remove(sched, pos);
+            }
+        }
+    }
+
+    return num_stolen;
+}
+
+
+/**
+ * @brief  Make a host ready again once one of its requests is completed,
+ *         if it is waiting because too many requests were in flight
+ *
+ * @param  sched      a host scheduler
+ * @param  hostname   the hostname
+ * @param  now        the current time (of the monotonic clock)
+ */
+void host_scheduler_wake(HostScheduler *sched, char *hostname,
+                         long long now) {
+
+    assert(sched != NULL);
+
+    HostQueue *queue = host_scheduler_find(sched, hostname, false);
+
+    if (queue != NULL && queue->isBusy && queue->heap_pos >= 0
+        && queue->ready > now) {
+        queue->ready  = now;
+        queue->isBusy = false;
+        heap_sift_up(sched, queue->heap_pos);
+    }
+}
+
+
+/**
+ * @brief  Get the time the first host is ready
+ *
+ * @param  sched  a host scheduler
+ * @return        the time (of the monotonic clock), or -1 if no URL is left
+ */
+long long get_host_scheduler_ready(HostScheduler *sched) {
+
+    assert(sched != NULL);
+
+    if (sched->heap_size == 0) {
+        return -1;
+    }
+
+    return sched->heap[0]->ready;
+}
+
+
+/**
+ * @brief  Get the number of URLs in the scheduler
+ *
+ * @param  sched  a host scheduler
+ * @return        the number of URLs of all hosts
+ */
+int get_host_scheduler_size(HostScheduler *sched) {
+
+    assert(sched != NULL);
+
+    return sched->size;
+}
+
+
+// ============================================================================
+// == | Auxillary Functions
+// ============================================================================
+/**
+ * @brief  Compute the FNV-1a hash value of a hostname (case insensitive)
+ *
+ * @param  hostname   the hostname
+ * @return            the hash value
+ */
+uint64_t hash_hostname(char *hostname) {
+
+    uint64_t hash = FNV_OFFSET_BASIS;
+
+    for (char *c = hostname; *c != NULL_TERMINATED; c++) {
+        hash ^= (unsigned char)tolower((unsigned char)*c);
+        hash *= FNV_PRIME;
+    }
+
+    return hash;
+}
+
+
+/**
+ * @brief  Find the slot of a host in the limiter by linear probing, and
+ *         insert it if it is not there (the table grows when it is 70% full)
+ *
+ * @param  limiter    a host limiter (its lock is held)
+ * @param  hostname   the hostname
+ * @return            the slot of the host
+ */
+HostSlot *host_limiter_find(HostLimiter *limiter, char *hostname) {
+
+    uint64_t hash = hash_hostname(hostname);
+    int mask = limiter->capacity - 1;
+    int index = (int)(hash & mask);
+
+    while (limiter->slots[index].hostname != NULL) {
+        HostSlot *slot = &limiter->slots[index];
+
+        if (slot->hash == hash
+            && strcasecmp(slot->hostname, hostname) == SUCCESS) {
+            return slot;
+        }
+        index = (index + 1) & mask;
+    }
+
+    // Grow the table first if it will be too full
+    if ((limiter->num_hosts + 1) * HOST_TABLE_MAX_LOAD_DEN
+        > limiter->capacity * HOST_TABLE_MAX_LOAD_NUM) {
+        HostSlot *old_slots = limiter->slots;
+        int old_capacity = limiter->capacity;
+
+        limiter->capacity *= 2;
+        limiter->slots = (HostSlot *)calloc(limiter->capacity,
+                                            sizeof *limiter->slots);
+        if (limiter->slots == NULL) {
+            fprintf(stderr, "Error: host_limiter_find() calloc returned "
+                            "NULL\n");
+            exit(EXIT_FAILURE);
+        }
+
+        mask = limiter->capacity - 1;
+        for (int i = 0; i < old_capacity; i++) {
+            if (old_slots[i].hostname != NULL) {
+                int j = (int)(old_slots[i].hash & mask);
+                while (limiter->slots[j].hostname != NULL) {
+                    j = (j + 1) & mask;
+                }
+                limiter->slots[j] = old_slots[i];
+            }
+        }
+        free(old_slots);
+
+        index = (int)(hash & mask);
+        while (limiter->slots[index].hostname != NULL) {
+            index = (index + 1) & mask;
+        }
+    }
+
+    HostSlot *slot = &limiter->slots[index];
+    slot->hostname       = deep_copy_str(hostname, strlen(hostname),
+                                         IS_COPY_WHOLE);
+    slot->hash           = hash;
+    slot->next_allowed   = 0;
+    slot->inflight       = 0;
+    slot->failures       = 0;
+    slot->pauses         = 0;
+    slot->isCheckpointed = false;
+    limiter->num_hosts++;
+
+    return slot;
+}
+
+
+/**
+ * @brief  Find the queue of a host in the scheduler by linear probing, and
+ *         insert it if it is not there (the table grows when it is 70% full)
+ *
+ * @param  sched      a host scheduler
+ * @param  hostname   the hostname
+ * @param  isInsert   if the queue is inserted when it is not there
+ * @return            the queue of the host, or NULL if it is not there
+ */
+HostQueue *host_scheduler_find(HostScheduler *sched, char *hostname,
+                               bool isInsert) {
+
+    uint64_t hash = hash_hostname(hostname);
+    int mask = sched->capacity - 1;
+    int index = (int)(hash & mask);
+
+    while (sched->table[index] != NULL) {
+        HostQueue *queue = sched->table[index];
+
+        if (queue->hash == hash
+            && strcasecmp(queue->hostname, hostname) == SUCCESS) {
+            return queue;
+        }
+        index = (index + 1) & mask;
+    }
+
+    if (!isInsert) {
+        return NULL;
+    }
+
+    // Grow the table (and the heap) first if it will be too full
+    if ((sched->num_hosts + 1) * HOST_TABLE_MAX_LOAD_DEN
+        > sched->capacity * HOST_TABLE_MAX_LOAD_NUM) {
+        HostQueue **old_table = sched->table;
+        int old_capacity = sched->capacity;
+
+        sched->capacity *= 2;
+        sched->table = (HostQueue **)calloc(sched->capacity,
+                                            sizeof(HostQueue *));
+        sched->heap  = (HostQueue **)realloc(sched->heap, sched->capacity
+                                             * sizeof(HostQueue *));
+        if (sched->table == NULL || sched->heap == NULL) {
+            fprintf(stderr, "Error: host_scheduler_find() calloc returned "
+                            "NULL\n");
+            exit(EXIT_FAILURE);
+        }
+
+        mask = sched->capacity - 1;
+        for (int i = 0; i < old_capacity; i++) {
+            if (old_table[i] != NULL) {
+                int j = (int)(old_table[i]->hash & mask);
+                while (sched->table[j] != NULL) {
+                    j = (j + 1) & mask;
+                }
+                sched->table[j] = old_table[i];
+            }
+        }
+        free(old_table);
+
+        index = (int)(hash & mask);
+        while (sched->table[index] != NULL) {
+            index = (index + 1) & mask;
+        }
+    }
+
+    HostQueue *queue = (HostQueue *)malloc(sizeof *queue);
+    if (queue == NULL) {
+        fprintf(stderr, "Error: host_scheduler_find() malloc returned "
+                        "NULL\n");
+        exit(EXIT_FAILURE);
+    }
+
+    queue->hostname = deep_copy_str(hostname, strlen(hostname),
+                                    IS_COPY_WHOLE);
+    queue->hash     = hash;
+    queue->urls     = new_dlist();
+    queue->ready    = 0;
+    queue->heap_pos = -1;
+    queue->isBusy   = false;
+
+    sched->table[index] = queue;
+    sched->num_hosts++;
+
+    return queue;
+}
+
+
+/**
+ * @brief  Move a host queue up the heap until its parent is ready before it
+ *
+ * @param  sched  a host scheduler
+ * @param  pos    the position of the host queue in the heap
+ */
+void heap_sift_up(HostScheduler *sched, int pos) {
+
+    HostQueue *queue = sched->heap[pos];
+
+    while (pos > 0) {
+        int parent = (pos - 1) / 2;
+
+        if (sched->heap[parent]->ready <= queue->ready) {
+            break;
+        }
+        sched->heap[pos] = sched->heap[parent];
+        sched->heap[pos]->heap_pos = pos;
+        pos = parent;
+    }
+
+    sched->heap[pos] = queue;
+    queue->heap_pos  = pos;
+}
+
+
+/**
+ * @brief  Move a host queue down the heap until its children are ready
+ *         after it
+ *
+ * @param  sched  a host scheduler
+ * @param  pos    the position of the host queue in the heap
+ */
+void heap_sift_down(HostScheduler *sched, int pos) {
+
+    HostQueue *queue = sched->heap[pos];
+
+    while (true) {
+        int child = 2 * pos + 1;
+
+        if (child >= sched->heap_size) {
+            break;
+        }
+        if (child + 1 < sched->heap_size
+            && sched->heap[child + 1]->ready < sched->heap[child]->ready) {
+            child++;
+        }
+        if (queue->ready <= sched->heap[child]->ready) {
+            break;
+        }
+        sched->heap[pos] = sched->heap[child];
+        sched->heap[pos]->heap_pos = pos;
+        pos = child;
+    }
+
+    sched->heap[pos] = queue;
+    queue->heap_pos  = pos;
+}
+
+
+/**
+ * @brief  Remove the host queue at a position of the heap (its queue is
+ *         empty), and move the last host queue into its place
+ *
+ * @param  sched  a host scheduler
+ * @param  pos    the position of the host queue in the heap
+ */
+void heap_remove(HostScheduler *sched, int pos) {
+
+    sched->heap[pos]->heap_pos = -1;
+    sched->heap_size--;
+
+    if (pos == sched->heap_size) {
+        return;
+    }
+
+    // The last host queue may belong above or below the position
+    HostQueue *last = sched->heap[sched->heap_size];
+    sched->heap[pos] = last;
+    last->heap_pos   = pos;
+    heap_sift_down(sched, pos);
+    heap_sift_up(sched, last->heap_pos);
+}
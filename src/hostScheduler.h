@@ -0,0 +1,116 @@
+/**
+ * @file      hostScheduler.h
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     Per-host politeness scheduler module. It includes
+ *              1. the host limiter shared by all workers: the next time each
+ *                 host may be fetched, and its requests in flight
+ *              2. the host scheduler of a frontier: a queue of URLs for each
+ *                 host, and the hosts ordered by the time they are ready
+ *              3. taking the next URL whose host is ready, and stealing the
+ *                 oldest URLs
+ *              4. pausing a host after repeated overloaded responses
+ *                 (a circuit breaker)
+ *              5. reporting the politeness statistics
+ *              6. saving the state of the hosts backing off into a
+ *                 checkpoint, and restoring it
+ *            A host may be fetched again once the delay since its last fetch
+ *            has passed (or the time given by Retry-After, or the pause of
+ *            its circuit breaker), and while it has less requests in flight
+ *            than the maximum per host
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#ifndef HOSTSCHEDULER_H
+#define HOSTSCHEDULER_H
+
+#include "checkpoint.h"
+#include "urlInfo.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+typedef struct host_limiter HostLimiter;
+typedef struct host_scheduler HostScheduler;
+
+/**
+ * @brief  If a host may be fetched now, or why not
+ */
+typedef enum {
+    HOST_GRANTED,
+    HOST_DELAYED,
+    HOST_BUSY
+} HostGrant;
+
+
+// ============================================================================
+// == | Module Functions
+// ============================================================================
+// Create a new host limiter
+HostLimiter *new_HostLimiter(int delay_ms, int max_per_host);
+
+// Destroy a host limiter and free its memory
+void free_HostLimiter(HostLimiter *limiter);
+
+// Take a request slot of a host if it may be fetched now
+HostGrant host_limiter_acquire(HostLimiter *limiter, char *hostname,
+                               long long now, long long *ready);
+
+// Give back the request slot of a host once its fetch is completed
+void host_limiter_release(HostLimiter *limiter, char *hostname);
+
+// Do not fetch a host again until the given time
+void host_limiter_defer(HostLimiter *limiter, char *hostname,
+                        long long until);
+
+// Report if a response of a host shows it is overloaded (e.g. 503)
+bool host_limiter_report(HostLimiter *limiter, char *hostname,
+                         bool isOverloaded, long long now);
+
+// Check if a host is down (paused by its circuit breaker too many times)
+bool host_limiter_is_down(HostLimiter *limiter, char *hostname);
+
+// Save the state of the hosts backing off into a checkpoint
+void save_host_limiter_state(HostLimiter *limiter, Checkpoint *checkpoint,
+                             long long now);
+
+// Restore the state of a host saved into a checkpoint
+void restore_host_limiter_state(HostLimiter *limiter, char *hostname,
+                                int delay_ms, int failures, int pauses,
+                                long long now);
+
+// Print out the politeness statistics
+void print_host_limiter_stats(HostLimiter *limiter, FILE *fp);
+
+// Create a new empty host scheduler
+HostScheduler *new_HostScheduler(HostLimiter *limiter);
+
+// Destroy a host scheduler and free its memory (and the URLs left)
+void free_HostScheduler(HostScheduler *sched);
+
+// Add a URL to the queue of its host, as the newest or the oldest
+void host_scheduler_push(HostScheduler *sched, UrlInfo *url, bool isNewest);
+
+// Remove and return the newest URL of the first host ready, or NULL
+UrlInfo *host_scheduler_pop(HostScheduler *sched, long long now);
+
+// Remove the oldest URLs, and return how many
+int host_scheduler_steal(HostScheduler *sched, UrlInfo **urls, int max);
+
+// Make a host ready again once one of its requests is completed
+void host_scheduler_wake(HostScheduler *sched, char *hostname,
+                         long long now);
+
+// Return the time the first host is ready, or -1 if no URL is left
+long long get_host_scheduler_ready(HostScheduler *sched);
+
+// Return the number of URLs in the scheduler
+int get_host_scheduler_size(HostScheduler *sched);
+
+
+#endif
@@ -0,0 +1,406 @@
+/**
+ * @file      htmlBench.c
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     Benchmark of finding the links in HTML files. It compares
+ *              1. the single pass HTML scanner used by the crawler, with
+ *                 each byte scanning method supported by the CPU (scalar,
+ *                 SSE2, AVX2), checking they find exactly the same links
+ *              2. the previous regex based method (compiling the regex for
+ *                 every file, and copying every link twice)
+ *            The HTML files are given as arguments, or a generated page is
+ *            used if no file is given. The bytes scanned per second are
+ *            printed for each method.
+ *
+ *            Usage: ./htmlbench [-n <rounds>] [file.html ...]
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#include "byteScan.h"
+#include "htmlHandler.h"
+#include "utilities.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <assert.h>
+#include <regex.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+
+// ============================================================================
+// == | Constant Definitions
+// ============================================================================
+#define DEFAULT_ROUNDS        200
+#define GENERATED_SECTIONS    400
+#define ANCHOR_FORMAT         "<a" SPACE_REGEX_EXP_MUST
+#define HREF_FORMAT           \
+        "href" SPACE_REGEX_EXP_MAY "=" SPACE_REGEX_EXP_MAY "(\"|')"
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+typedef struct corpus Corpus;
+/**
+ * @brief  A corpus include the HTML files and their total length
+ */
+struct corpus {
+    char **pages;
+    int *page_lens;
+    int size;
+    long total_len;
+};
+
+
+// ============================================================================
+// == | Function Prototypes
+// ============================================================================
+// Add a HTML file into the corpus
+void add_page(Corpus *corpus, char *page, int len);
+
+// Read a HTML file into the corpus
+void read_page(Corpus *corpus, char *path);
+
+// Generate a HTML page with text, links, comments, scripts and styles
+void generate_page(Corpus *corpus);
+
+// Time the single pass scanner with the current byte scanning method
+double time_scanner(Corpus *corpus, int rounds, long *links,
+                    unsigned long *checksum);
+
+// Count the links in a HTML file with the single pass scanner
+long count_links_scanner(char *page, int len, unsigned long *checksum);
+
+// Count the links in a HTML file with the regex based method
+long count_links_regex(char *page);
+
+// Get the current time of the monotonic clock in seconds
+double get_seconds();
+
+
+// ============================================================================
+// == | Main Functions
+// ============================================================================
+/**
+ * @brief  Run the benchmark and print out the bytes scanned per second
+ *
+ * @param  argc   number of inputs
+ * @param  argv   an array of inputs
+ * @return        if no fail exits, return 0
+ */
+int main(int argc, char **argv) {
+
+    Corpus corpus = {NULL, NULL, 0, 0};
+    int rounds = DEFAULT_ROUNDS;
+    int i = 1;
+
+    if (argc > 2 && strcmp(argv[1], "-n") == SUCCESS) {
+        rounds = atoi(argv[2]);
+        i = 3;
+    }
+    for (; i < argc; i++) {
+        read_page(&corpus, argv[i]);
+    }
+    if (corpus.size == 0) {
+        generate_page(&corpus);
+    }
+
+    printf("corpus:         %d pages, %ld bytes\n",
+           corpus.size, corpus.total_len);
+
+    // Time the single pass scanner with each byte scanning method,
+    // the scalar method is the reference of the links found
+    ByteScanMode modes[] = {BYTE_SCAN_SCALAR, BYTE_SCAN_SSE2, BYTE_SCAN_AVX2};
+    unsigned long scalar_checksum = 0;
+    double scalar_rate = 0, best_rate = 0;
+    int mismatch = 0;
+
+    for (int m = 0; m < (int)(sizeof modes / sizeof modes[0]); m++) {
+        if (!set_byte_scan_mode(modes[m])) {
+            printf("scanner %-6s  not supported\n",
+                   get_byte_scan_name(modes[m]));
+            continue;
+        }
+
+        long links = 0;
+        unsigned long checksum = 0;
+        double rate = corpus.total_len * rounds
+                    / time_scanner(&corpus, rounds, &links, &checksum);
+
+        if (modes[m] == BYTE_SCAN_SCALAR) {
+            scalar_checksum = checksum;
+            scalar_rate     = rate;
+        } else if (checksum != scalar_checksum) {
+            mismatch = 1;
+        }
+        best_rate = (rate > best_rate) ? rate : best_rate;
+
+        printf("scanner %-6s %10.1f MB/s  (%ld links per round, %s)\n",
+               get_byte_scan_name(modes[m]), rate / 1e6, links / rounds,
+               (checksum == scalar_checksum) ? "same links" : "MISMATCH");
+    }
+    init_byte_scan();
+
+    // Time the regex based method, with fewer rounds as it is much slower
+    int regex_rounds = (rounds / 10 > 0) ? rounds / 10 : 1;
+    long regex_links = 0;
+    double start = get_seconds();
+    for (int r = 0; r < regex_rounds; r++) {
+        for (int p = 0; p < corpus.size; p++) {
+            regex_links += count_links_regex(corpus.pages[p]);
+        }
+    }
+    double regex_rate = corpus.total_len * regex_rounds
+                      / (get_seconds() - start);
+
+    printf("regex          %10.1f MB/s  (%ld links per round)\n",
+           regex_rate / 1e6, regex_links / regex_rounds);
+    printf("speedup:       %10.1fx SIMD over scalar, %.1fx over regex\n",
+           best_rate / scalar_rate, best_rate / regex_rate);
+
+    for (int p = 0; p < corpus.size; p++) {
+        free(corpus.pages[p]);
+    }
+    free(corpus.pages);
+    free(corpus.page_lens);
+
+    return mismatch ? EXIT_FAILURE : 0;
+}
+
+
+// ============================================================================
+// == | Auxillary Functions
+// ============================================================================
+/**
+ * @brief  Add a HTML file into the corpus, the corpus takes its memory
+ *
+ * @param  corpus   a corpus
+ * @param  page     a NULL terminated HTML file
+ * @param  len      the length of the HTML file
+ */
+void add_page(Corpus *corpus, char *page, int len) {
+
+    int size = corpus->size + 1;
+
+    corpus->pages     = realloc(corpus->pages, size * sizeof(char *));
+    corpus->page_lens = realloc(corpus->page_lens, size * sizeof(int));
+    if (corpus->pages == NULL || corpus->page_lens == NULL) {
+        fprintf(stderr, "Error: add_page() realloc returned NULL\n");
+        exit(EXIT_FAILURE);
+    }
+
+    corpus->pages[corpus->size]     = page;
+    corpus->page_lens[corpus->size] = len;
+    corpus->size       = size;
+    corpus->total_len += len;
+}
+
+
+/**
+ * @brief  Read a HTML file into the corpus
+ *
+ * @param  corpus   a corpus
+ * @param  path     the path of the HTML file
+ */
+void read_page(Corpus *corpus, char *path) {
+
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+
+    fseek(fp, 0, SEEK_END);
+    long len = ftell(fp);
+    rewind(fp);
+
+    char *page = (char *)malloc(len + 1);
+    if (page == NULL) {
+        fprintf(stderr, "Error: read_page() malloc returned NULL\n");
+        exit(EXIT_FAILURE);
+    }
+    if (fread(page, 1, len, fp) != (size_t)len) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+    page[len] = NULL_TERMINATED;
+    fclose(fp);
+
+    // The crawler treats the content as a string, so does the benchmark
+    add_page(corpus, page, strlen(page));
+}
+
+
+/**
+ * @brief  Generate a HTML page with text, links, comments, scripts and
+ *         styles, similar to a real page
+ *
+ * @param  corpus   a corpus
+ */
+void generate_page(Corpus *corpus) {
+
+    static const char *section =
+        "<div class=\"item\" id=\"item-%d\">\n"
+        "  <h2 class=\"title\">Section %d</h2>\n"
+        "  <p>Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed "
+        "do eiusmod tempor incididunt ut labore et dolore magna aliqua. Ut "
+        "enim ad minim veniam, quis nostrud exercitation ullamco.</p>\n"
+        "  <ul><li><a href=\"/section/%d.html\">next</a></li>\n"
+        "  <li><a class=\"ext\" title=\"a > b\" href='http://example.com/%d'"
+        ">external</a></li>\n"
+        "  <li><A HREF = \" relative%d.html \" >relative</A></li>\n"
+        "  <li><abbr title=\"not a link\">abbr</abbr> <a name=x>anchor</a>"
+        "</li></ul>\n"
+        "  <!-- <a href=\"/commented/%d\">old</a> -->\n"
+        "  <img src=\"/img/%d.png\" alt=\"image\" width=\"100\">\n"
+        "</div>\n";
+    static const char *script =
+        "<script type=\"text/javascript\">\n"
+        "  var s = '<a href=\"/in-script\">x</a>'; if (a < b) { f(s); }\n"
+        "</script>\n"
+        "<style>a > span { color: red; }</style>\n";
+
+    int cap = GENERATED_SECTIONS * (strlen(section) + strlen(script) + 64);
+    char *page = (char *)malloc(cap);
+    if (page == NULL) {
+        fprintf(stderr, "Error: generate_page() malloc returned NULL\n");
+        exit(EXIT_FAILURE);
+    }
+
+    int len = sprintf(page, "<!DOCTYPE html>\n<html><head><title>bench"
+                            "</title></head><body>\n");
+    for (int i = 0; i < GENERATED_SECTIONS; i++) {
+        len += sprintf(page + len, section, i, i, i, i, i, i, i);
+        if (i % 10 == 0) {
+            len += sprintf(page + len, "%s", script);
+        }
+    }
+    len += sprintf(page + len, "</body></html>\n");
+
+    add_page(corpus, page, len);
+}
+
+
+/**
+ * @brief  Time the single pass scanner with the current byte scanning
+ *         method over the corpus
+ *
+ * @param  corpus     a corpus
+ * @param  rounds     the number of times the corpus is scanned
+ * @param  links      the number of links found will be set
+ * @param  checksum   the checksum of the links found will be set
+ * @return            the time taken in seconds
+ */
+double time_scanner(Corpus *corpus, int rounds, long *links,
+                    unsigned long *checksum) {
+
+    double start = get_seconds();
+
+    for (int r = 0; r < rounds; r++) {
+        for (int p = 0; p < corpus->size; p++) {
+            *links += count_links_scanner(corpus->pages[p],
+                                          corpus->page_lens[p], checksum);
+        }
+    }
+
+    return get_seconds() - start;
+}
+
+
+/**
+ * @brief  Count the links in a HTML file with the single pass scanner
+ *
+ * @param  page       a HTML file
+ * @param  len        the length of the HTML file
+ * @param  checksum   the checksum of the links found (where each link is
+ *                    and its length) will be updated
+ * @return            the number of links found
+ */
+long count_links_scanner(char *page, int len, unsigned long *checksum) {
+
+    HtmlScanner scanner;
+    char *link;
+    int link_len;
+    long count = 0;
+
+    init_html_scanner(&scanner, page, len);
+    while (next_html_link(&scanner, &link, &link_len)) {
+        *checksum = *checksum * 31 + (link - page);
+        *checksum = *checksum * 31 + link_len;
+        count++;
+    }
+
+    return count;
+}
+
+
+/**
+ * @brief  Count the links in a HTML file with the regex based method,
+ *         as the crawler previously parsed the HTML files
+ *
+ * @param  page   a HTML file
+ * @return        the number of links found
+ */
+long count_links_regex(char *page) {
+
+    regex_t     aTag_format, href_format;
+    regmatch_t  pmatch[2];
+    long        count = 0;
+
+    if (regcomp(&aTag_format, ANCHOR_FORMAT, REG_EXTENDED | REG_ICASE)
+        != SUCCESS
+        || regcomp(&href_format, HREF_FORMAT, REG_EXTENDED | REG_ICASE)
+        != SUCCESS) {
+        fprintf(stderr, "ERROR: compile regex format");
+        exit(EXIT_FAILURE);
+    }
+
+    while (regexec(&aTag_format, page, 1, &pmatch[0], REG_NOTBOL)
+           == SUCCESS) {
+        char *currMatch = page + pmatch[0].rm_eo;
+
+        if (regexec(&href_format, currMatch, 1, &pmatch[1], REG_NOTBOL)
+            == SUCCESS) {
+            currMatch += pmatch[1].rm_eo;
+
+            char *after_close_qotation = strchr(currMatch, currMatch[-1]);
+            if (after_close_qotation == NULL) {
+                break;
+            }
+
+            int link_len  = after_close_qotation - currMatch;
+            char *link_sp = deep_copy_str(currMatch, link_len, !IS_COPY_WHOLE);
+            char *link    = remove_spaces(link_sp);
+            free(link_sp);
+            free(link);
+            count++;
+
+            page = after_close_qotation;
+        } else {
+            page = currMatch;
+        }
+    }
+
+    regfree(&aTag_format);
+    regfree(&href_format);
+
+    return count;
+}
+
+
+/**
+ * @brief  Get the current time of the monotonic clock in seconds
+ *
+ * @return    the time in seconds
+ */
+double get_seconds() {
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
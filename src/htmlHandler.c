@@ -1,8 +1,15 @@
 /**
- * @file      fetchHandler.c
+ * @file      htmlHandler.c
  * @author    Erya Wen (eryaw@student.unimelb.edu.au)
  * @brief     Implementation of parsing HTML method. It includes
- *              1. find and parsing the URL inside anchor tags href field         
+ *              1. scanning a HTML file once for the links inside anchor tags
+ *                 href field (skipping comments, scripts and styles)
+ *              2. find and parsing the URL inside anchor tags href field
+ *            The scanner is a small state machine over the tags and their
+ *            attributes. The links found are views (pointer and length)
+ *            into the HTML file, so no memory is allocated while scanning.
+ *            The text between tags and the tags other than anchor tags are
+ *            skipped with the vectorised byte scanning functions.
  *
  * @copyright created for COMP30023 Computer System 2020
  *
@@ -10,7 +17,8 @@
 
 #include "htmlHandler.h"
 
-#include "dlist.h"
+#include "byteScan.h"
+#include "fetchHandler.h"
 #include "urlHandler.h"
 #include "urlInfo.h"
 #include "utilities.h"
@@ -20,103 +28,362 @@
 
 #include <assert.h>
 #include <ctype.h>
-#include <regex.h>
+#include <stdbool.h>
 #include <string.h>
+#include <strings.h>
 
 
 // ============================================================================
-// == | Constant Definitions 
+// == | Constant Definitions
 // ============================================================================
-#define ANCHOR_TAG_START      "<a"
+#define TAG_START             '<'
+#define TAG_END               '>'
+#define TAG_CLOSE             '/'
+#define ATTR_ASSIGN           '='
+#define COMMENT_START         "!--"
+#define COMMENT_END           "-->"
+#define ANCHOR_TAG            "a"
 #define HREF                  "href"
-#define ANCHOR_FORMAT         ANCHOR_TAG_START SPACE_REGEX_EXP_MUST
-#define HREF_FORMAT           \
-        HREF SPACE_REGEX_EXP_MAY "=" SPACE_REGEX_EXP_MAY "(\"|')"
+#define SCRIPT_TAG            "script"
+#define STYLE_TAG             "style"
+
+
+// ============================================================================
+// == | Function Prototypes
+// ============================================================================
+// Scan the attributes of an anchor tag, finding its href field
+char *scan_html_attributes(char *pos, char *end, char **link, int *link_len);
+
+// Skip up to and after the end of a tag
+char *skip_html_tag(char *pos, char *end);
+
+// Skip the text of a script or style element up to its end tag
+char *skip_raw_text(char *pos, char *end, char *name, int name_len);
+
+// Skip up to and after the given pattern
+char *skip_past(char *pos, char *end, char *pattern);
+
+// Skip the whitespace
+char *skip_html_spaces(char *pos, char *end);
+
+// Check if a tag or attribute name is the given name (case insensitive)
+bool is_html_name(char *name, int name_len, char *expected);
 
 
 // ============================================================================
 // == | Module Functions
 // ============================================================================
+/**
+ * @brief  Initialise a scanner over a HTML file of given length
+ *
+ * @param  scanner  a HtmlScanner data
+ * @param  html     a HTML file
+ * @param  len      the length of the HTML file
+ */
+void init_html_scanner(HtmlScanner *scanner, char *html, int len) {
+
+    assert(scanner != NULL);
+    assert(html != NULL);
+
+    scanner->pos = html;
+    scanner->end = html + len;
+}
+
+
+/**
+ * @brief  Find the next link inside an anchor tag href field. The link is
+ *         a view into the HTML file (without the whitespace around it),
+ *         it is not copied or NULL terminated.
+ *         Links inside comments, scripts and styles are skipped
+ *
+ * @param  scanner    a HtmlScanner data
+ * @param  link       the start of the link will be set
+ * @param  link_len   the length of the link will be set
+ * @return true       If a link is found
+ * @return false      If the end of the HTML file is reached
+ */
+bool next_html_link(HtmlScanner *scanner, char **link, int *link_len) {
+
+    assert(scanner != NULL);
+
+    char *pos = scanner->pos;
+    char *end = scanner->end;
+
+    while (pos < end) {
+
+        // Move to the next tag, the text between tags is not needed
+        pos = scan_find_byte(pos, end, TAG_START);
+        if (end - pos < 2) {
+            break;
+        }
+        pos++;
+
+        if (end - pos >= (int)strlen(COMMENT_START)
+            && memcmp(pos, COMMENT_START, strlen(COMMENT_START)) == SUCCESS) {
+            // If it is a comment, skip up to the end of the comment
+            pos = skip_past(pos + strlen(COMMENT_START), end, COMMENT_END);
+
+        } else if (*pos == '!' || *pos == '?' || *pos == TAG_CLOSE) {
+            // If it is a declaration, processing instruction or end tag,
+            // skip up to the end of the tag
+            pos = scan_find_byte(pos, end, TAG_END);
+
+        } else if (isalpha((unsigned char)*pos)) {
+            // If it is a start tag, find the tag name
+            char *name = pos;
+            while (pos < end && !isspace((unsigned char)*pos)
+                   && *pos != TAG_END && *pos != TAG_CLOSE) {
+                pos++;
+            }
+            int name_len = pos - name;
+
+            // Scan its attributes if it is an anchor tag, 
+            // otherwise only the end of the tag is needed
+            *link = NULL;
+            if (is_html_name(name, name_len, ANCHOR_TAG)) {
+                pos = scan_html_attributes(pos, end, link, link_len);
+            } else {
+                pos = skip_html_tag(pos, end);
+            }
+
+            // The text of a script or style is not HTML, skip it
+            if (is_html_name(name, name_len, SCRIPT_TAG)
+                || is_html_name(name, name_len, STYLE_TAG)) {
+                pos = skip_raw_text(pos, end, name, name_len);
+            }
+
+            if (*link != NULL) {
+                scanner->pos = pos;
+                return true;
+            }
+        }
+        // Otherwise, the '<' is part of the text
+    }
+
+    scanner->pos = end;
+    return false;
+}
+
+
 /**
  * @brief  Parse HTML file, finding and parsing URL inside anchor tags
- * 
- * @param  input        a HTML file
- * @param  original     the UrlInfo data that currently be fetched 
+ *
+ * @param  file         a HTML file (it may contain '\0')
+ * @param  file_len     the length of the HTML file
+ * @param  original     the UrlInfo data that currently be fetched
  *                      (the HTML file belong to this URL)
- * @param  waitedList   a dlist of UrlInfo data will be fetched 
- * @param  visitedList  a dlist of UrlInfo data already be fetched 
+ * @param  frontier     the frontier of URLs will be fetched
  */
 void parse_html(char *file,
+                int file_len,
                 UrlInfo *original,
-                Dlist *waitedList,
-                Dlist *visitedList) {
-
-    regex_t     aTag_format, href_format;
-    regmatch_t  pmatch[2];
-    int         regStatus;
-
-    // Compile the anchor tag start regex format 
-    // If compile fail, exit the program
-    regStatus = regcomp(&aTag_format, ANCHOR_FORMAT, REG_EXTENDED | REG_ICASE);
-    if (regStatus != SUCCESS) {
-        fprintf(stderr, "ERROR: compile anchor tag format");
-        exit(EXIT_FAILURE);
-    }
+                Frontier *frontier) {
 
-    // Compile the href field regex format 
-    // If compile fail, exit the program
-    regStatus = regcomp(&href_format, HREF_FORMAT, REG_EXTENDED | REG_ICASE);
-    if (regStatus != SUCCESS) {
-        fprintf(stderr, "ERROR: compile href field regex format");
-        exit(EXIT_FAILURE);
-    }
+    HtmlScanner scanner;
+    char *link;
+    int link_len;
+
+    init_html_scanner(&scanner, file, file_len);
 
     // Parsing the HTML file to find URL inside the anchor tag
-    // Match the anchor tag start ("<a ")
-    while ((regStatus = regexec(&aTag_format, file, 1, &pmatch[0], REG_NOTBOL))
-           == SUCCESS) {
-
-        // If there is a match
-        // Find the string after the anchor tag start ("<a "), 
-        char *currMatch = file + pmatch[0].rm_eo;
-
-        // Match the href field
-        if (regexec(&href_format, currMatch, 1, &pmatch[1], REG_NOTBOL) 
-            == SUCCESS){
-            // If there is a match, find the string after the href field
-            currMatch += pmatch[1].rm_eo;
-
-            // Find the start and close qotation mark 
-            // It maybe " or ', and it should be same
-            char *start_qotation       = currMatch - 1;
-            char *after_close_qotation = strchr(currMatch, *start_qotation);
-
-            // Find the URL (between the qotation marks), 
-            // and remove the whiteshpace of it
-            int link_len  = after_close_qotation - currMatch;
-            char *link_sp = deep_copy_str(currMatch, link_len, !IS_COPY_WHOLE);
-            char *link    = remove_spaces(link_sp);
-
-            // Parsing URL 
-            url_will_be_fetched(link, original, waitedList, visitedList);
-
-            // Free the memory allocation
-            free(link_sp);
-            link_sp = NULL;
-            free(link);
-            link = NULL;
-
-            file = after_close_qotation;
+    // Each link is followed by at least its close quotation mark
+    while (next_html_link(&scanner, &link, &link_len)) {
+        url_will_be_fetched(link, link_len, original, frontier);
+    }
+}
+
+
+// ============================================================================
+// == | Auxillary Functions
+// ============================================================================
+/**
+ * @brief  Scan the attributes of an anchor tag up to the end of the tag,
+ *         finding its first quoted href field
+ *
+ * @param  pos        the position after the tag name
+ * @param  end        the end of the HTML file
+ * @param  link       the start of the link will be set if it is found
+ * @param  link_len   the length of the link will be set if it is found
+ * @return            the position after the end of the tag
+ */
+char *scan_html_attributes(char *pos, char *end, char **link, int *link_len) {
+
+    while (pos < end) {
+
+        // Skip the whitespace and '/' between attributes
+        while (pos < end && (isspace((unsigned char)*pos)
+                             || *pos == TAG_CLOSE)) {
+            pos++;
+        }
+        if (pos == end || *pos == TAG_END) {
+            break;
+        }
+
+        // Find the attribute name
+        char *name = pos;
+        while (pos < end && !isspace((unsigned char)*pos) && *pos != TAG_END
+               && *pos != TAG_CLOSE && *pos != ATTR_ASSIGN) {
+            pos++;
+        }
+        int name_len = pos - name;
+
+        // An attribute without value
+        pos = skip_html_spaces(pos, end);
+        if (pos == end || *pos != ATTR_ASSIGN) {
+            continue;
+        }
+        pos = skip_html_spaces(pos + 1, end);
+        if (pos == end) {
+            break;
+        }
+
+        if (*pos == '"' || *pos == '\'') {
+            // A quoted value ends at the same quotation mark,
+            // it may contain '>'
+            char *value = pos + 1;
+            char *close = scan_find_byte(value, end, *pos);
+            if (close == end) {
+                return end;
+            }
+            pos = close + 1;
+
+            if (*link == NULL && is_html_name(name, name_len, HREF)) {
+                // Remove the whitespace around the link
+                while (value < close && isspace((unsigned char)*value)) {
+                    value++;
+                }
+                while (close > value && isspace((unsigned char)close[-1])) {
+                    close--;
+                }
+                *link     = value;
+                *link_len = close - value;
+            }
 
         } else {
-          // If the anchor tag does not have href field, 
-          // Move to the next anchor file
-            file = currMatch;
+            // An unquoted value ends at whitespace or the end of the tag
+            while (pos < end && !isspace((unsigned char)*pos)
+                   && *pos != TAG_END) {
+                pos++;
+            }
+        }
+    }
+
+    return (pos < end) ? pos + 1 : end;
+}
+
+
+/**
+ * @brief  Skip up to and after the end of a tag. A quotation mark after
+ *         '=' starts a quoted value, which may contain '>'
+ *
+ * @param  pos        the position after the tag name
+ * @param  end        the end of the HTML file
+ * @return            the position after the end of the tag
+ */
+char *skip_html_tag(char *pos, char *end) {
+
+    char *tag = pos;
+
+    while ((pos = scan_find_tag_end(pos, end)) < end) {
+        if (*pos == TAG_END) {
+            return pos + 1;
+        }
+
+        // Check if the quotation mark follows '=' (with whitespace between)
+        char *before = pos;
+        while (before > tag && isspace((unsigned char)before[-1])) {
+            before--;
+        }
+
+        if (before > tag && before[-1] == ATTR_ASSIGN) {
+            // Skip the quoted value
+            pos = scan_find_byte(pos + 1, end, *pos);
+            if (pos == end) {
+                return end;
+            }
+        }
+        pos++;
+    }
+
+    return end;
+}
+
+
+/**
+ * @brief  Skip the text of a script or style element up to its end tag
+ *
+ * @param  pos        the position after the start tag
+ * @param  end        the end of the HTML file
+ * @param  name       the tag name
+ * @param  name_len   the length of the tag name
+ * @return            the position after the end tag
+ */
+char *skip_raw_text(char *pos, char *end, char *name, int name_len) {
+
+    while ((pos = scan_find_byte(pos, end, TAG_START)) < end) {
+        pos++;
+
+        // The end tag is "</" followed by the same tag name
+        if (end - pos > name_len && *pos == TAG_CLOSE
+            && strncasecmp(pos + 1, name, name_len) == SUCCESS) {
+            char *after_name = pos + 1 + name_len;
+            if (after_name == end || isspace((unsigned char)*after_name)
+                || *after_name == TAG_END) {
+                return skip_past(after_name, end, ">");
+            }
         }
     }
 
-    // Free the regex format
-    regfree(&aTag_format);
-    regfree(&href_format);
+    return end;
+}
+
+
+/**
+ * @brief  Skip up to and after the given pattern
+ *
+ * @param  pos        the position to start from
+ * @param  end        the end of the HTML file
+ * @param  pattern    the pattern string
+ * @return            the position after the pattern,
+ *                    or the end if it is not found
+ */
+char *skip_past(char *pos, char *end, char *pattern) {
+
+    int pattern_len = strlen(pattern);
+    char *found = memmem(pos, end - pos, pattern, pattern_len);
+
+    return (found != NULL) ? found + pattern_len : end;
 }
 
+
+/**
+ * @brief  Skip the whitespace
+ *
+ * @param  pos    the position to start from
+ * @param  end    the end of the HTML file
+ * @return        the position of the first non-space character
+ */
+char *skip_html_spaces(char *pos, char *end) {
+
+    while (pos < end && isspace((unsigned char)*pos)) {
+        pos++;
+    }
+    return pos;
+}
+
+
+/**
+ * @brief  Check if a tag or attribute name is the given name
+ *         (case insensitive)
+ *
+ * @param  name       the name in the HTML file (not NULL terminated)
+ * @param  name_len   the length of the name
+ * @param  expected   the given name in lower case
+ * @return true       If they are the same
+ * @return false      If they are different
+ */
+bool is_html_name(char *name, int name_len, char *expected) {
+
+    return name_len == (int)strlen(expected)
+        && strncasecmp(name, expected, name_len) == SUCCESS;
+}
@@ -1,8 +1,10 @@
 /**
- * @file      fetchHandler.h
+ * @file      htmlHandler.h
  * @author    Erya Wen (eryaw@student.unimelb.edu.au)
  * @brief     Parsing HTML method. It includes
- *              1. find and parsing the URL inside anchor tags href field        
+ *              1. scanning a HTML file once for the links inside anchor tags
+ *                 href field (skipping comments, scripts and styles)
+ *              2. find and parsing the URL inside anchor tags href field
  *
  * @copyright created for COMP30023 Computer System 2020
  *
@@ -11,18 +13,39 @@
 #ifndef HTMLHANDLER_H
 #define HTMLHANDLER_H
 
-#include "dlist.h"
-
+#include "fetchHandler.h"
 #include "urlInfo.h"
 
+#include <stdbool.h>
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+typedef struct html_scanner HtmlScanner;
+/**
+ * @brief  A HtmlScanner include the position it has scanned up to and the
+ *         end of the HTML file
+ */
+struct html_scanner {
+    char *pos;
+    char *end;
+};
+
 
 // ============================================================================
 // == | Module Functions
 // ============================================================================
+// Initialise a scanner over a HTML file of given length
+void init_html_scanner(HtmlScanner *scanner, char *html, int len);
+
+// Find the next link inside an anchor tag href field, without copying it
+bool next_html_link(HtmlScanner *scanner, char **link, int *link_len);
+
 // Parse HTML file, finding and parsing URL inside anchor tags
 void parse_html(char *input,
+                int input_len,
                 UrlInfo *original,
-                Dlist *waitedList,
-                Dlist *visitedList);
+                Frontier *frontier);
 
 #endif
@@ -2,11 +2,16 @@
  * @file      httpHandler.c
  * @author    Erya Wen (eryaw@student.unimelb.edu.au)
  * @brief     Implementation of HTTP method. It includes
- *              1. send HTTP request
- *              2. recieve HTTP response, including
+ *              1. construct HTTP request
+ *              2. find where a HTTP response ends (by its Content-Length 
+ *                 or chunked encoding), so the connection can be reused,
+ *                 decoding the chunks in place as they are received
+ *              3. parse HTTP response, including
  *                  a. get the response header
  *                  b. get the response status code
- *                  c. get the field information in header (e.g. Content length)    
+ *                  c. get the field information in header (e.g. Content length)
+ *            The header is parsed once (by httpHeader) when it is received, 
+ *            the framing and the response parsing both use its fields.
  *
  * @copyright created for COMP30023 Computer System 2020
  *
@@ -14,14 +19,14 @@
 
 #include "httpHandler.h"
 
+#include "httpHeader.h"
 #include "responseInfo.h"
-#include "socketHandler.h"
 #include "urlInfo.h"
 #include "utilities.h"
 
 #include <assert.h>
 #include <ctype.h>
-#include <regex.h>
+#include <limits.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -33,182 +38,41 @@
 // ============================================================================
 // == | Constant Definitions 
 // ============================================================================
-#define MAX_RESPONSE_BYTES    100000
 #define REQ_USER_AGENT        "eryaw"
 #define REQ_GET               "GET"
 #define REQ_AUTH_VAL          "Basic ZXJ5YXc6cGFzc3dvcmQ="
 #define REQ_AUTHORIZATION     "Authorization: "
-#define CONTENT_LEN_HEADER    "Content-Length"
-#define CONTENT_TYPE_HEADER   "Content-Type"
-#define CONTENT_LOC_HEADER    "Location"
+#define CHUNKED_ENCODING      "chunked"
+#define CONNECTION_CLOSE      "close"
+#define CONNECTION_KEEP_ALIVE "keep-alive"
+#define HTTP_1_0              10
+#define HEX_BASE              16
 #define ACCEPT_TYPE           "text/html"
-#define CONTENT_LEN_FIELD     \
-    CONTENT_LEN_HEADER SPACE_REGEX_EXP_MAY ":" SPACE_REGEX_EXP_MAY
-#define CONTENT_TYPE_FIELD    \
-    CONTENT_TYPE_HEADER SPACE_REGEX_EXP_MAY ":" SPACE_REGEX_EXP_MAY
-#define CONTENT_LOC_FIELD     \
-    CONTENT_LOC_HEADER SPACE_REGEX_EXP_MAY ":" SPACE_REGEX_EXP_MAY
 
 // The format of part of the HTTP request 
 const char *part_of_http_request
-    = "%s %s HTTP/1.1\r\nHost: %s\r\nUser-Agent: %s\r\nConnection: close\r\n";
+    = "%s %s HTTP/1.1\r\nHost: %s\r\nUser-Agent: %s\r\nConnection: keep-alive\r\n";
 
 
 // ============================================================================
 // == | Function Prototypes
 // ============================================================================
-// Construct the HTTP request header
-char *construct_req_header(UrlInfo *url);
+// Frame the response header once it is received
+void frame_header(ResponseFrame *frame, char *buffer);
 
-// Extract the response header from whole response
-char *extract_header(char *buffer, ResponseInfo *resp);
+// Decode the chunks of a chunked response received so far
+bool decode_chunks(ResponseFrame *frame, char *buffer, int *len);
 
-// Extract the response status code from the header
-void extract_status_code(ResponseInfo *resp);
-
-// Extract the Content Length from the header if it has
-bool extract_content_length(ResponseInfo *response);
-
-// Extract the Content Type from the header if it has
-bool extract_content_type(ResponseInfo *resp);
+// Extract the Content Type from the header if it is accepted
+bool extract_content_type(HttpHeader *header, ResponseInfo *resp);
 
 // Extract the redirect Location from the header if it has
-bool extract_content_loc(ResponseInfo *resp);
+bool extract_content_loc(HttpHeader *header, ResponseInfo *resp);
 
 
 // ============================================================================
 // == | Module Functions 
 // ============================================================================
-/**
- * @brief  Send HTTP request with GET method
- * 
- * @param  connfd   socket connection ID
- * @param  url      a UrlInfo data
- */
-void send_request(int connfd, UrlInfo *url) {
-    // Construct the HTTP request header 
-    char *header_request = construct_req_header(url);
-
-    // Send HTTP request
-    // If fails, exits
-    if (write(connfd, header_request, strlen(header_request)) < 0) {
-        perror("ERROR sending HTTP request");
-        exit(EXIT_FAILURE);
-    }
-
-    // Free the memory allocated for header string 
-    free(header_request);
-    header_request = NULL;
-}
-
-
-/**
- * @brief  Recieve HTTP response from server 
- *         And get response header, status code and other field information 
- *         according to the status code 
- *         It will only handle response which 
- *            1. status code is one of 200, 301, 401, 404, 410, 414, 503, 504
- *            2. MIME-Type is "text/html"
- *            3. No truncated Pages (Content length equal to actual length)
- * 
- * @param  connfd   socket connection ID
- * @param  resp     a ResponseInfo data
- * 
- * @return true     If status code will be handled 
- *                  and it is 200, 301, 401, 503
- *                  and it satisfies the 3 handle rules listed above
- * @return false    If status code will not be handled 
- *                  or it is 410, 404, 414, 504
- *                  or it does not satisfies the 3 handle rules listed above
- */
-bool get_response_from_server(int connfd, ResponseInfo *resp) {
-
-    int nbytes = -1;
-    int bufferUsed = 0;
-
-    // Initialise the buffer for response
-    char buffer[MAX_RESPONSE_BYTES];
-    bzero(buffer, MAX_RESPONSE_BYTES);
-
-    // Recieve the HTTP response 
-    // The maximum response bytes it will handle is 100000
-    while ((nbytes = read(connfd, &buffer[bufferUsed],
-                          MAX_RESPONSE_BYTES - bufferUsed - 1))
-           > 0) {
-
-        // Check if it still have enough buffer for response
-        bufferUsed += nbytes;
-        if (bufferUsed == MAX_RESPONSE_BYTES - 1) {
-            break;
-        }
-    }
-
-    // If the response fails, exits
-    if (nbytes == -1) {
-        perror("ERROR receiving resp");
-        exit(EXIT_FAILURE);
-    }
-
-    // Close the socket connection
-    close_socket(connfd);
-
-
-    // Get the response header
-    char *content = extract_header(buffer, resp);
-    int len = strlen(content);
-
-    // If the response header exists, check the status code and other 
-    // field information according to the status code 
-    if (resp->header != NULL) {
-
-        // Get the status code 
-        extract_status_code(resp);
-
-        if (resp->status_code == 200) {
-            /** If the status code is 200 OK
-             * Get the Content Length and Content Type. 
-             * Check if the MIME-Type is the accpeted type and if it is 
-             * truncated pages.
-            */
-            if (content != NULL 
-                && extract_content_type(resp)
-                && extract_content_length(resp)) {
-                
-                if (len == resp->content_len) {
-
-                    // If the content length in header is equal to the actual  
-                    // content length, it is not truncated pages. 
-                    // Return true as it will be handled
-                    resp->content = content;
-                    return true;
-                }
-            }
-        } else if (resp->status_code == 301) {
-            /** If the status code is 301 Moved Permanently 
-             *  Check if there is a redirect Location. 
-             *  If yes, return true as it will be handled
-            */
-            if (extract_content_loc(resp)) {
-                return true;
-            }
-        } else if (resp->status_code == 401 
-                || resp->status_code == 503) {
-            /** If the status code is 401 Unauthorized Error, 
-             *  or 503 Service Unavailable
-             *  Return true as it will be handled
-            */
-            return true;
-        }
-    }
-
-    // If the response will not be handle, return false
-    return false;
-}
-
-
-// ============================================================================
-// == | Auxillary Functions 
-// ============================================================================
 /**
  * @brief  Construct the HTTP request header
  * 
@@ -266,212 +130,368 @@ char *construct_req_header(UrlInfo *url) {
 
 
 /**
- * @brief  Extract the response header from whole response
+ * @brief  Initialise the frame of a response before it is received
  * 
- * @param  buffer   the whole response
- * @param  resp     a ResponseInfo data
- * @return          the content of the response. 
- *                  If header is incomplete or there is no content, return NULL
+ * @param  frame      a ResponseFrame data
+ * @param  max_body   the maximum content kept, the rest is not received
  */
-char *extract_header(char *buffer, ResponseInfo *resp) {
-
-    // Get the content of the response 
-    char *content = strstr(buffer, CRLFCRLF);
+void init_response_frame(ResponseFrame *frame, int max_body) {
+
+    assert(frame != NULL);
+
+    frame->scan_pos    = 0;
+    frame->header_len  = -1;
+    frame->content_len = -1;
+    frame->isChunked   = false;
+    frame->chunk_state = CHUNK_SIZE;
+    frame->chunk_left  = 0;
+    frame->body_len    = 0;
+    frame->max_body    = max_body;
+    frame->isKeepAlive = false;
+    frame->isTruncated = false;
+    frame->total_len   = -1;
+}
 
-    if (content != NULL) {
 
-        int content_len = strlen(content);
+/**
+ * @brief  Update the frame of a response with the bytes received so far.
+ *         The response ends after Content-Length bytes of content, or after 
+ *         the last chunk if it is chunked. Otherwise, it ends when the 
+ *         server closes the connection (and it can not be reused).
+ *         The chunks are decoded in place, so the buffer holds the header,
+ *         the content decoded, and the bytes not decoded yet.
+ *         If the header or the content is too long, the response is 
+ *         truncated and the rest of it is not received
+ * 
+ * @param  frame    a ResponseFrame data
+ * @param  buffer   the response received so far (null terminated)
+ * @param  len      the number of bytes received so far, it is updated
+ *                  when the chunks are decoded
+ * @return true     If the whole response is received (total_len is set to 
+ *                  its length), or it is truncated
+ * @return false    If more of the response is still to be received
+ */
+bool update_response_frame(ResponseFrame *frame, char *buffer, int *len) {
+
+    assert(frame != NULL);
+
+    if (frame->header_len < 0) {
+        // Look for the end of the header from where the last search stopped
+        char *end = memmem(buffer + frame->scan_pos, *len - frame->scan_pos,
+                           CRLFCRLF, strlen(CRLFCRLF));
+        if (end == NULL) {
+            frame->scan_pos = (*len > 3) ? *len - 3 : 0;
+            if (*len >= MAX_HEADER_BYTES) {
+                frame->isTruncated = true;
+                return true;
+            }
+            return false;
+        }
+        frame->header_len = end - buffer + strlen(CRLFCRLF);
+        frame_header(frame, buffer);
+    }
 
-        // Ensure each field line in header end with \r\n
-        int header_len = strlen(buffer) - content_len + strlen(CRLF);
+    if (frame->isChunked) {
+        if (decode_chunks(frame, buffer, len)) {
+            return true;
+        }
+    } else {
+        frame->body_len = *len - frame->header_len;
 
-        // Get the response header 
-        char *header = deep_copy_str(buffer, header_len, !IS_COPY_WHOLE);
-        resp->header       = header;
+        if (frame->content_len >= 0 && frame->body_len >= frame->content_len) {
+            frame->body_len  = frame->content_len;
+            frame->total_len = frame->header_len + frame->content_len;
+            return true;
+        }
+    }
 
-        // Return the content
-        content += strlen(CRLFCRLF);
-        return content;
+    // Stop receiving once the content is over the maximum
+    if (frame->body_len >= frame->max_body) {
+        frame->body_len    = frame->max_body;
+        frame->isTruncated = true;
+        return true;
     }
 
-    // If header is incomplete or there is no content, return NULL
-    return NULL;
+    return false;
 }
 
 
 /**
- * @brief  Extract the response status code from the heade
+ * @brief  Parse a HTTP response received from server 
+ *         And get response header, status code and other field information 
+ *         according to the status code 
+ *         It will only handle response which 
+ *            1. status code is one of 200, 301, 401, 404, 410, 414, 503, 504
+ *            2. MIME-Type is "text/html"
+ *            3. No truncated Pages (Content length equal to actual length)
  * 
- * @param  resp   a ResponseInfo data
+ * @param  buffer   the whole response (followed by a spare byte)
+ * @param  frame    the frame of the response (with its parsed header)
+ * @param  resp     a ResponseInfo data
+ * 
+ * @return true     If status code will be handled 
+ *                  and it is 200, 301, 401, 503, 504
+ *                  and it satisfies the 3 handle rules listed above
+ * @return false    If status code will not be handled 
+ *                  or it is 410, 404, 414
+ *                  or it does not satisfies the 3 handle rules listed above
  */
-void extract_status_code(ResponseInfo *resp) {
-    int status_code;
-    sscanf(resp->header, "HTTP/1.1 %d \r\n", &status_code);
-    resp->status_code = status_code;
+bool parse_response(char *buffer, ResponseFrame *frame, ResponseInfo *resp) {
+
+    // If the response header is incomplete or not valid, it is not handled
+    if (frame->header_len < 0 || frame->header.status_code == 0) {
+        return false;
+    }
+
+    // Only the content decoded (or up to its length) is kept, it is 
+    // followed by '\0' so the last link in it can be NULL terminated
+    buffer[frame->header_len + frame->body_len] = NULL_TERMINATED;
+
+    // Get the response header fields (already parsed) and content
+    resp->header       = frame->header;
+    resp->header.base  = buffer;
+    resp->header_len   = frame->header_len;
+    HttpHeader *header = &resp->header;
+    char *content      = buffer + frame->header_len;
+
+    // Get the status code 
+    resp->status_code = header->status_code;
+
+    if (resp->status_code == 200) {
+        /** If the status code is 200 OK
+         * Get the Content Length and Content Type. 
+         * Check if the MIME-Type is the accpeted type and if it is 
+         * truncated pages.
+         * A page over the maximum content is handled with the part received,
+         * a page the server did not send completely is not handled
+        */
+        resp->content_len = frame->body_len;
+        resp->isTruncated = frame->isTruncated;
+
+        bool isComplete = frame->total_len >= 0 
+                       || (frame->isTruncated && frame->body_len > 0);
+
+        if (extract_content_type(header, resp) && isComplete) {
+            resp->content = content;
+            return true;
+        }
+    } else if (resp->status_code == 301) {
+        /** If the status code is 301 Moved Permanently 
+         *  Check if there is a redirect Location. 
+         *  If yes, return true as it will be handled
+        */
+        if (extract_content_loc(header, resp)) {
+            return true;
+        }
+    } else if (resp->status_code == 401 
+            || resp->status_code == 503
+            || resp->status_code == 504) {
+        /** If the status code is 401 Unauthorized Error, 
+         *  503 Service Unavailable or 504 Gateway Timeout
+         *  Return true as it will be handled (retried later)
+        */
+        return true;
+    }
+
+    // If the response will not be handle, return false
+    return false;
 }
 
+
+// ============================================================================
+// == | Auxillary Functions 
+// ============================================================================
 /**
- * @brief  Extract the Content Length from the header if it has
+ * @brief  Frame the response header once it is received. Parse its fields, 
+ *         find how the content length is given, and if the connection 
+ *         can be reused
  * 
- * @param  resp   a ResponseInfo data
- * @return true   the Content-Length field exist and content length is found
- * @return false  the Content-Length field does not exist
+ * @param  frame    a ResponseFrame data
+ * @param  buffer   the response received so far
  */
-bool extract_content_length(ResponseInfo *resp) {
-
-    regex_t cLengthFormat;
-    regmatch_t pmatch;
-    
-    int cLength;
-    int regStatus;
-
-    char *header = resp->header;
-
-    // Compile the Content length field name format 
-    // If compile fail, exit the program
-    regStatus
-        = regcomp(&cLengthFormat, CONTENT_LEN_FIELD, REG_EXTENDED | REG_ICASE);
-    if (regStatus != SUCCESS) {
-        fprintf(stderr, "ERROR: compile the Content length field name format ");
-        exit(EXIT_FAILURE);
+void frame_header(ResponseFrame *frame, char *buffer) {
+
+    HttpHeader *header = &frame->header;
+
+    if (!parse_http_header(buffer, frame->header_len, header)) {
+        // If the status line is not valid, read until the server closes 
+        // the connection
+        header->status_code = 0;
+        frame->isKeepAlive  = false;
+        return;
     }
 
-    // Parsing the header to find the Content-Length field
-    if (regexec(&cLengthFormat, header, 1, &pmatch, REG_NOTBOL) == SUCCESS) {
+    // HTTP/1.1 connections are persistent unless the server closes it,
+    // HTTP/1.0 connections are closed unless the server keeps it alive
+    frame->isKeepAlive = header->version > HTTP_1_0;
 
-        // find the content length and convert it into Integer
-        sscanf(header + pmatch.rm_eo, "%d \r\n", &cLength);
-        resp->content_len = cLength;
+    if (header_has_token(header, HEADER_CONNECTION, CONNECTION_CLOSE)) {
+        frame->isKeepAlive = false;
+    } else if (header_has_token(header, HEADER_CONNECTION, 
+                                CONNECTION_KEEP_ALIVE)) {
+        frame->isKeepAlive = true;
+    }
 
-        // Free the regex format
-        regfree(&cLengthFormat);
+    // The informational, No Content and Not Modified response has no content
+    int status_code = header->status_code;
+    if ((status_code >= 100 && status_code < 200) 
+        || status_code == 204 || status_code == 304) {
+        frame->content_len = 0;
+        return;
+    }
 
-        // the Content-Length field exist, return false
-        return true;
+    if (header_has_token(header, HEADER_TRANSFER_ENCODING, CHUNKED_ENCODING)) {
+        frame->isChunked = true;
+        return;
     }
 
-    // Free the regex format
-    regfree(&cLengthFormat);
+    frame->content_len = get_header_number(header, HEADER_CONTENT_LENGTH);
+    if (frame->content_len >= 0) {
+        return;
+    }
 
-    // the Content-Length field does not exist, return false
-    return false;
+    // Otherwise, the response ends when the server closes the connection
+    frame->isKeepAlive = false;
 }
 
+
 /**
- * @brief  Extract the Content Type from the header if it has
+ * @brief  Decode the chunks of a chunked response received so far. 
+ *         Each chunk is its size in hex, CRLF, the data and CRLF. 
+ *         The last chunk has size 0 and is followed by optional trailer 
+ *         field lines and an empty line.
+ *         The data is moved to follow the content decoded before, and the 
+ *         bytes not decoded yet (e.g. part of a size line) follow it
  * 
- * @param  resp   a ResponseInfo data
- * @return true   if the Content-Type field exists and the type is "text/html"
- * @return false  if the Content-Type field not exist or is not accpeted type
+ * @param  frame    a ResponseFrame data
+ * @param  buffer   the response received so far
+ * @param  len      the number of bytes received so far, it is set to the 
+ *                  number of bytes left after decoding
+ * @return true     If the last chunk is received (total_len is set), 
+ *                  or the chunks are not valid (it is truncated)
+ * @return false    If more chunks are still to be received
  */
-bool extract_content_type(ResponseInfo *resp) {
-
-    regex_t cTypeFormat;
-    regmatch_t pmatch;
-
-    int regStatus;
-
-    char *header = resp->header;
-    char *ctype;
-    char *after_ctype;
-    
-    // Compile the Content type field name format 
-    // If compile fail, exit the program
-    regStatus
-        = regcomp(&cTypeFormat, CONTENT_TYPE_FIELD, REG_EXTENDED | REG_ICASE);
-    if (regStatus != SUCCESS) {
-        fprintf(stderr, "ERROR: compile the Content type field name format");
-        exit(EXIT_FAILURE);
-    }
+bool decode_chunks(ResponseFrame *frame, char *buffer, int *len) {
 
-    // Parsing the header to find the Content-Type field
-    if (regexec(&cTypeFormat, header, 1, &pmatch, REG_NOTBOL) == SUCCESS) {
-        if ((after_ctype = strstr(header + pmatch.rm_eo, CRLF)) != NULL) {
+    // The content decoded ends at out, the bytes not decoded start at in
+    int out = frame->header_len + frame->body_len;
+    int in  = out;
+    bool isDone = false;
 
-            // Get the content type field line
-            int len = after_ctype - (header + pmatch.rm_eo);
-            ctype = deep_copy_str(header + pmatch.rm_eo, len, !IS_COPY_WHOLE);
+    while (in < *len && !isDone) {
 
-            if (strstr(ctype, ACCEPT_TYPE) != NULL) {
-          
-                // if content type is "text/html", return true
-                resp->content_type = ACCEPT_TYPE;
+        if (frame->chunk_state == CHUNK_DATA) {
+            // Move as much of the chunk data as received
+            int nbytes = *len - in;
+            if (nbytes > frame->chunk_left) {
+                nbytes = frame->chunk_left;
+            }
+            memmove(buffer + out, buffer + in, nbytes);
+            out += nbytes;
+            in  += nbytes;
+            frame->chunk_left -= nbytes;
+            if (frame->chunk_left == 0) {
+                frame->chunk_state = CHUNK_DATA_END;
+            }
+            continue;
+        }
 
-                // Free the memory and regex format
-                free(ctype);
-                ctype = NULL;
-                regfree(&cTypeFormat);
+        if (frame->chunk_state == CHUNK_DATA_END) {
+            // The chunk data is followed by CRLF
+            if (*len - in < (int)strlen(CRLF)) {
+                break;
+            }
+            in += strlen(CRLF);
+            frame->chunk_state = CHUNK_SIZE;
+            continue;
+        }
 
-                // If the Location field exists, return true
-                return true;
+        // The size line or a trailer field line ends with CRLF
+        char *line     = buffer + in;
+        char *line_end = memmem(line, *len - in, CRLF, strlen(CRLF));
+        if (line_end == NULL) {
+            break;
+        }
+        in = line_end - buffer + strlen(CRLF);
+
+        if (frame->chunk_state == CHUNK_TRAILER) {
+            // The empty line ends the response
+            if (line_end == line) {
+                frame->total_len = out;
+                isDone = true;
             }
+            continue;
+        }
 
-            // Free the memory
-            free(ctype);
-            ctype = NULL;
+        char *size_end;
+        long chunk_size = strtol(line, &size_end, HEX_BASE);
+        if (size_end == line || chunk_size < 0 || chunk_size > INT_MAX) {
+            // The chunk size is not valid, keep the content decoded
+            frame->isTruncated = true;
+            frame->isKeepAlive = false;
+            in = *len;
+            isDone = true;
+        } else if (chunk_size == 0) {
+            frame->chunk_state = CHUNK_TRAILER;
+        } else {
+            frame->chunk_left  = chunk_size;
+            frame->chunk_state = CHUNK_DATA;
         }
     }
 
-    // Free the regex format
-    regfree(&cTypeFormat);
+    // Move the bytes not decoded to follow the content decoded
+    memmove(buffer + out, buffer + in, *len - in);
+    *len = out + (*len - in);
+    buffer[*len] = NULL_TERMINATED;
 
-    // if Content-Type field not exist or type is not "text/html", return false
-    return false;
+    frame->body_len = out - frame->header_len;
+
+    return isDone;
 }
 
+
 /**
- * @brief  Extract the redirect URL Location from the header if it has
+ * @brief  Extract the Content Type from the header if it is accepted
  * 
- * @param  resp   a ResponseInfo data
- * @return true   if the Location field exists 
- * @return false  if the Location field not exist
+ * @param  header   the parsed response header
+ * @param  resp     a ResponseInfo data
+ * @return true     if the Content-Type field exists and the type is "text/html"
+ * @return false    if the Content-Type field not exist or is not accpeted type
  */
-bool extract_content_loc(ResponseInfo *resp) {
-    regex_t cLocationFormat;
-    regmatch_t pmatch;
-
-    int regStatus;
-
-    char *header = resp->header;
-    char *cLoc_sp, *cLoc;
-    char *aftercLoc;
-
-    // Compile the Location field name format 
-    // If compile fail, exit the program
-    regStatus = regcomp(&cLocationFormat, CONTENT_LOC_FIELD,
-                              REG_EXTENDED | REG_ICASE);
-    if (regStatus != SUCCESS) {
-        fprintf(stderr, "ERROR: compile the Location field name format");
-        exit(EXIT_FAILURE);
-    }
-
-    // Parsing the header to find the Location field
-    if (regexec(&cLocationFormat, header, 1, &pmatch, REG_NOTBOL) == SUCCESS) {
+bool extract_content_type(HttpHeader *header, ResponseInfo *resp) {
 
-        if ((aftercLoc = strstr(header + pmatch.rm_eo, CRLF)) != NULL) {
+    if (header_has_token(header, HEADER_CONTENT_TYPE, ACCEPT_TYPE)) {
+        // if content type is "text/html", return true
+        resp->content_type = ACCEPT_TYPE;
+        return true;
+    }
 
-            // Get the Location line and find the redirect URL
-            int len = aftercLoc - (header + pmatch.rm_eo);
-            cLoc_sp = deep_copy_str(header + pmatch.rm_eo, len, !IS_COPY_WHOLE);
+    // if Content-Type field not exist or type is not "text/html", return false
+    return false;
+}
 
-            // Remove whitespaces of the redirect URL
-            cLoc    = remove_spaces(cLoc_sp);
 
-            resp->redirect_loc = cLoc;
+/**
+ * @brief  Extract the redirect URL Location from the header if it has
+ * 
+ * @param  header   the parsed response header
+ * @param  resp     a ResponseInfo data
+ * @return true     if the Location field exists 
+ * @return false    if the Location field not exist
+ */
+bool extract_content_loc(HttpHeader *header, ResponseInfo *resp) {
 
-             // Free the memory and regex format
-            free(cLoc_sp);
-            cLoc_sp = NULL;
-            regfree(&cLocationFormat);
+    int len;
+    char *location = get_header_value(header, HEADER_LOCATION, &len);
 
-            // If the Location field exists, return true
-            return true;
-        }
+    if (location != NULL) {
+        // The whitespace around the redirect URL is already removed,
+        // it is followed by at least the CRLF of its field line
+        resp->redirect_loc = location;
+        resp->redirect_len = len;
+        return true;
     }
 
-    // Free the regex format
-    regfree(&cLocationFormat);
-
     // If the Location field does not exist, return false
     return false;
 }
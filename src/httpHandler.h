@@ -2,8 +2,10 @@
  * @file      httpHandler.h
  * @author    Erya Wen (eryaw@student.unimelb.edu.au)
  * @brief     HTTP method. It includes
- *              1. send HTTP request
- *              2. recieve HTTP response
+ *              1. construct HTTP request
+ *              2. find where a HTTP response ends (by its Content-Length 
+ *                 or chunked encoding), so the connection can be reused
+ *              3. parse HTTP response
  *
  * @copyright created for COMP30023 Computer System 2020
  *
@@ -12,21 +14,78 @@
 #ifndef HTTPHANDLER_H
 #define HTTPHANDLER_H
 
+#include "httpHeader.h"
 #include "responseInfo.h"
 #include "urlInfo.h"
 
 #include <stdbool.h>
 
 
+// ============================================================================
+// == | Constant Definitions 
+// ============================================================================
+#define RESPONSE_BUFFER_INIT  16384
+#define MAX_HEADER_BYTES      32768
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+/**
+ * @brief  What the chunked decoding expects next
+ */
+typedef enum {
+    CHUNK_SIZE,
+    CHUNK_DATA,
+    CHUNK_DATA_END,
+    CHUNK_TRAILER
+} ChunkState;
+
+
+typedef struct response_frame ResponseFrame;
+/**
+ * @brief  A ResponseFrame keeps how much of a response has been framed: 
+ *         the header length and its parsed fields, the content length 
+ *         (or if it is chunked, what the decoding expects next and how 
+ *         much of the chunk is left), the content received so far, the 
+ *         maximum content kept, and if the connection can be reused. 
+ *         The total length is set once the whole response is received,
+ *         it is truncated if the content is over the maximum
+ */
+struct response_frame {
+    int scan_pos;
+    int header_len;
+    HttpHeader header;
+    int content_len;
+    bool isChunked;
+    ChunkState chunk_state;
+    long chunk_left;
+    int body_len;
+    int max_body;
+    bool isKeepAlive;
+    bool isTruncated;
+    int total_len;
+};
+
+
 // ============================================================================
 // == | Module Functions
 // ============================================================================
-// Send HTTP request with GET method
-void send_request(int connfd, UrlInfo *url);
+// Construct the HTTP request header with GET method
+char *construct_req_header(UrlInfo *url);
+
+// Initialise the frame of a response before it is received
+void init_response_frame(ResponseFrame *frame, int max_body);
+
+// Update the frame of a response with the bytes received so far (decoding
+// the chunks in place), return true once the whole response is received 
+// or the content is over the maximum
+bool update_response_frame(ResponseFrame *frame, char *buffer, int *len);
 
-// Recieve HTTP response from server and extract header, status code 
+// Parse HTTP response received from server and extract header, status code 
 // and other field information according to the status code 
-bool get_response_from_server(int connfd, ResponseInfo *response);
+bool parse_response(char *buffer, ResponseFrame *frame, 
+                    ResponseInfo *response);
 
 
 #endif
@@ -0,0 +1,352 @@
+/**
+ * @file      httpHeader.c
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     Implementation of HTTP response header module. It includes
+ *              1. parsing the status line and the header fields of a
+ *                 response in one pass
+ *              2. looking up the header fields the crawler uses by name
+ *              3. reading a header field value as a number or a token
+ *              4. reading the delay asked by Retry-After
+ *            The recognised field names are found with a perfect hash on
+ *            the name length, its third and last characters (lower case).
+ *            The hash was chosen so every recognised name has its own slot,
+ *            so a lookup is one hash and one comparison.
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#include "httpHeader.h"
+
+#include "utilities.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <assert.h>
+#include <ctype.h>
+#include <stdbool.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+
+// ============================================================================
+// == | Constant Definitions
+// ============================================================================
+#define HTTP_VERSION_PREFIX   "HTTP/"
+#define FIELD_SEPARATOR       ':'
+#define HEADER_HASH_SIZE      32
+#define MIN_FIELD_NAME_LEN    4
+#define MAX_HEADER_NUMBER     1000000000L
+#define EMPTY_SLOT            0
+#define HTTP_DATE_FORMAT      "%a, %d %b %Y %H:%M:%S GMT"
+#define MAX_HTTP_DATE_LEN     64
+
+// The perfect hash of a field name, the name is at least 4 characters long
+#define HEADER_HASH(name, len)                                         \
+    (((len) * 3 + tolower((unsigned char)(name)[2])                    \
+      + tolower((unsigned char)(name)[(len) - 1])) & (HEADER_HASH_SIZE - 1))
+
+
+// ============================================================================
+// == | Global Variables
+// ============================================================================
+// The recognised field names in lower case, in the order of HeaderField
+static const char *header_names[NUM_HEADER_FIELDS] = {
+    [HEADER_CONTENT_LENGTH]    = "content-length",
+    [HEADER_CONTENT_TYPE]      = "content-type",
+    [HEADER_LOCATION]          = "location",
+    [HEADER_TRANSFER_ENCODING] = "transfer-encoding",
+    [HEADER_CONNECTION]        = "connection",
+    [HEADER_CONTENT_ENCODING]  = "content-encoding",
+    [HEADER_ETAG]              = "etag",
+    [HEADER_LAST_MODIFIED]     = "last-modified",
+    [HEADER_RETRY_AFTER]       = "retry-after",
+    [HEADER_WWW_AUTHENTICATE]  = "www-authenticate",
+};
+
+// The field in each slot of the perfect hash table (plus one, as the
+// empty slots are 0)
+static const unsigned char header_slots[HEADER_HASH_SIZE] = {
+    [0]  = HEADER_CONTENT_LENGTH + 1,
+    [23] = HEADER_CONTENT_TYPE + 1,
+    [9]  = HEADER_LOCATION + 1,
+    [27] = HEADER_TRANSFER_ENCODING + 1,
+    [26] = HEADER_CONNECTION + 1,
+    [5]  = HEADER_CONTENT_ENCODING + 1,
+    [20] = HEADER_ETAG + 1,
+    [30] = HEADER_LAST_MODIFIED + 1,
+    [7]  = HEADER_RETRY_AFTER + 1,
+    [12] = HEADER_WWW_AUTHENTICATE + 1,
+};
+
+
+// ============================================================================
+// == | Function Prototypes
+// ============================================================================
+// Parse the status line, return where the first field line starts
+char *parse_status_line(char *pos, char *end, HttpHeader *header);
+
+
+// ============================================================================
+// == | Module Functions
+// ============================================================================
+/**
+ * @brief  Parse the status line and header fields of a response in one
+ *         pass. Only the first value of a recognised field is kept
+ *
+ * @param  buffer       the response received
+ * @param  header_len   the length of the header (including the empty line)
+ * @param  header       a HttpHeader data
+ * @return true         If the status line is valid
+ * @return false        If the status line is not valid
+ */
+bool parse_http_header(char *buffer, int header_len, HttpHeader *header) {
+
+    assert(buffer != NULL);
+    assert(header != NULL);
+
+    char *end = buffer + header_len;
+
+    header->base = buffer;
+    for (int i = 0; i < NUM_HEADER_FIELDS; i++) {
+        header->fields[i].offset = -1;
+        header->fields[i].len    = 0;
+    }
+
+    char *line = parse_status_line(buffer, end, header);
+    if (line == NULL) {
+        return false;
+    }
+
+    while (line < end) {
+        // Each field line is the name, ':', the value, and CRLF
+        char *line_end = memchr(line, '\n', end - line);
+        if (line_end == NULL) {
+            line_end = end;
+        }
+        char *colon = memchr(line, FIELD_SEPARATOR, line_end - line);
+
+        if (colon != NULL) {
+            HeaderField field = lookup_header_field(line, colon - line);
+
+            if (field != NUM_HEADER_FIELDS
+                && header->fields[field].offset < 0) {
+                // Remove the whitespace around the value
+                char *value = colon + 1;
+                char *value_end = line_end;
+                while (value < value_end && isspace((unsigned char)*value)) {
+                    value++;
+                }
+                while (value_end > value
+                       && isspace((unsigned char)value_end[-1])) {
+                    value_end--;
+                }
+                header->fields[field].offset = value - buffer;
+                header->fields[field].len    = value_end - value;
+            }
+        }
+
+        line = line_end + 1;
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief  Find which recognised field a field name is (case insensitive)
+ *
+ * @param  name       the field name (not NULL terminated)
+ * @param  name_len   the length of the field name
+ * @return            the field, or NUM_HEADER_FIELDS if it is not recognised
+ */
+HeaderField lookup_header_field(char *name, int name_len) {
+
+    if (name_len < MIN_FIELD_NAME_LEN) {
+        return NUM_HEADER_FIELDS;
+    }
+
+    int slot = header_slots[HEADER_HASH(name, name_len)];
+    if (slot == EMPTY_SLOT) {
+        return NUM_HEADER_FIELDS;
+    }
+
+    HeaderField field = slot - 1;
+    if ((int)strlen(header_names[field]) == name_len
+        && strncasecmp(name, header_names[field], name_len) == SUCCESS) {
+        return field;
+    }
+
+    return NUM_HEADER_FIELDS;
+}
+
+
+/**
+ * @brief  Return the value of a field and its length
+ *
+ * @param  header   a HttpHeader data
+ * @param  field    the field
+ * @param  len      the length of the value will be set
+ * @return          the start of the value (not NULL terminated),
+ *                  or NULL if the field is not in the response
+ */
+char *get_header_value(HttpHeader *header, HeaderField field, int *len) {
+
+    assert(header != NULL);
+
+    HeaderValue *value = &header->fields[field];
+
+    if (value->offset < 0) {
+        *len = 0;
+        return NULL;
+    }
+
+    *len = value->len;
+    return header->base + value->offset;
+}
+
+
+/**
+ * @brief  Return the value of a field as a non-negative number
+ *
+ * @param  header   a HttpHeader data
+ * @param  field    the field
+ * @return          the number, or -1 if the field is not in the response
+ *                  or its value is not a number
+ */
+long get_header_number(HttpHeader *header, HeaderField field) {
+
+    assert(header != NULL);
+
+    int len;
+    char *value = get_header_value(header, field, &len);
+    long number = 0;
+
+    if (value == NULL || len == 0) {
+        return -1;
+    }
+
+    for (int i = 0; i < len; i++) {
+        if (!isdigit((unsigned char)value[i])) {
+            return -1;
+        }
+        number = number * 10 + (value[i] - '0');
+        if (number > MAX_HEADER_NUMBER) {
+            return -1;
+        }
+    }
+
+    return number;
+}
+
+
+/**
+ * @brief  Check if the value of a field contains a token (case insensitive)
+ *         e.g. "chunked" in Transfer-Encoding, "text/html" in Content-Type
+ *
+ * @param  header   a HttpHeader data
+ * @param  field    the field
+ * @param  token    the token in lower case
+ * @return true     If the field is in the response and contains the token
+ * @return false    Otherwise
+ */
+bool header_has_token(HttpHeader *header, HeaderField field, char *token) {
+
+    assert(header != NULL);
+
+    int len;
+    char *value = get_header_value(header, field, &len);
+    int token_len = strlen(token);
+
+    for (int i = 0; value != NULL && i + token_len <= len; i++) {
+        if (strncasecmp(value + i, token, token_len) == SUCCESS) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/**
+ * @brief  Get the delay the server asks with Retry-After, given as a number
+ *         of seconds or as a HTTP date (the delay is until then)
+ *
+ * @param  header   a HttpHeader data
+ * @return          the delay in seconds (0 if the date is passed), or -1 if
+ *                  it is not given or invalid
+ */
+long get_header_retry_after(HttpHeader *header) {
+
+    assert(header != NULL);
+
+    long seconds = get_header_number(header, HEADER_RETRY_AFTER);
+    if (seconds >= 0) {
+        return seconds;
+    }
+
+    int len;
+    char *value = get_header_value(header, HEADER_RETRY_AFTER, &len);
+    if (value == NULL || len == 0 || len >= MAX_HTTP_DATE_LEN) {
+        return -1;
+    }
+
+    // The value is not NULL terminated in the response
+    char date[MAX_HTTP_DATE_LEN];
+    memcpy(date, value, len);
+    date[len] = NULL_TERMINATED;
+
+    struct tm tm;
+    memset(&tm, 0, sizeof tm);
+    char *end = strptime(date, HTTP_DATE_FORMAT, &tm);
+    if (end == NULL || *end != NULL_TERMINATED) {
+        return -1;
+    }
+
+    long delay = (long)(timegm(&tm) - time(NULL));
+    return (delay > 0) ? delay : 0;
+}
+
+
+// ============================================================================
+// == | Auxillary Functions
+// ============================================================================
+/**
+ * @brief  Parse the status line ("HTTP/<major>.<minor> <code> <reason>")
+ *
+ * @param  pos      the start of the response
+ * @param  end      the end of the header
+ * @param  header   a HttpHeader data
+ * @return          the start of the first field line,
+ *                  or NULL if the status line is not valid
+ */
+char *parse_status_line(char *pos, char *end, HttpHeader *header) {
+
+    int prefix_len = strlen(HTTP_VERSION_PREFIX);
+
+    // The version and status code take at least 12 characters
+    if (end - pos < prefix_len + 7
+        || memcmp(pos, HTTP_VERSION_PREFIX, prefix_len) != SUCCESS) {
+        return NULL;
+    }
+    pos += prefix_len;
+
+    if (!isdigit((unsigned char)pos[0]) || pos[1] != '.'
+        || !isdigit((unsigned char)pos[2]) || pos[3] != ' ') {
+        return NULL;
+    }
+    header->version = (pos[0] - '0') * 10 + (pos[2] - '0');
+    pos += 4;
+
+    if (!isdigit((unsigned char)pos[0]) || !isdigit((unsigned char)pos[1])
+        || !isdigit((unsigned char)pos[2])) {
+        return NULL;
+    }
+    header->status_code = (pos[0] - '0') * 100 + (pos[1] - '0') * 10
+                        + (pos[2] - '0');
+
+    char *line_end = memchr(pos, '\n', end - pos);
+    return (line_end != NULL) ? line_end + 1 : end;
+}
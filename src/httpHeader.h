@@ -0,0 +1,93 @@
+/**
+ * @file      httpHeader.h
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     HTTP response header module. It includes
+ *              1. parsing the status line and the header fields of a
+ *                 response in one pass
+ *              2. looking up the header fields the crawler uses by name
+ *              3. reading a header field value as a number or a token
+ *            The field values are views (offset and length) into the
+ *            received response, they are not copied. The offsets stay valid
+ *            when the response buffer is moved (e.g. it grows).
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#ifndef HTTPHEADER_H
+#define HTTPHEADER_H
+
+#include <stdbool.h>
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+/**
+ * @brief  The header fields recognised in a response
+ */
+typedef enum {
+    HEADER_CONTENT_LENGTH,
+    HEADER_CONTENT_TYPE,
+    HEADER_LOCATION,
+    HEADER_TRANSFER_ENCODING,
+    HEADER_CONNECTION,
+    HEADER_CONTENT_ENCODING,
+    HEADER_ETAG,
+    HEADER_LAST_MODIFIED,
+    HEADER_RETRY_AFTER,
+    HEADER_WWW_AUTHENTICATE,
+    NUM_HEADER_FIELDS
+} HeaderField;
+
+
+typedef struct header_value HeaderValue;
+/**
+ * @brief  A HeaderValue is a view of a field value in the response
+ *         (without the whitespace around it), by its offset from the start
+ *         of the response. The offset is -1 if the field is not in the 
+ *         response
+ */
+struct header_value {
+    int offset;
+    int len;
+};
+
+
+typedef struct http_header HttpHeader;
+/**
+ * @brief  A HttpHeader include the response it is parsed from, the HTTP 
+ *         version (e.g. 11 for HTTP/1.1), the status code, and the value of 
+ *         each recognised field
+ */
+struct http_header {
+    char *base;
+    int version;
+    int status_code;
+    HeaderValue fields[NUM_HEADER_FIELDS];
+};
+
+
+// ============================================================================
+// == | Module Functions
+// ============================================================================
+// Parse the status line and header fields of a response in one pass
+bool parse_http_header(char *buffer, int header_len, HttpHeader *header);
+
+// Find which recognised field a field name is
+HeaderField lookup_header_field(char *name, int name_len);
+
+// Return the value of a field and its length, or NULL if it is not given
+char *get_header_value(HttpHeader *header, HeaderField field, int *len);
+
+// Return the value of a field as a non-negative number, or -1
+long get_header_number(HttpHeader *header, HeaderField field);
+
+// Check if the value of a field contains a token (case insensitive)
+bool header_has_token(HttpHeader *header, HeaderField field, char *token);
+
+// Return the delay asked by Retry-After in seconds, or -1
+long get_header_retry_after(HttpHeader *header);
+
+
+#endif
@@ -0,0 +1,195 @@
+/**
+ * @file      mailbox.c
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     Implementation of single producer single consumer mailbox 
+ *            module. It includes
+ *              1. creating and destroying a mailbox
+ *              2. pushing URLs into the mailbox, and publishing them to the
+ *                 consumer in a batch
+ *              3. popping the URLs published
+ *            The producer writes the slots after the published tail, and
+ *            makes them visible by storing the tail (release). The consumer
+ *            reads the slots up to the tail (acquire), and frees them by
+ *            storing the head (release). Both positions only increase, and
+ *            each side keeps its own copy of the other position, so the
+ *            shared cache lines are only read when the copy is used up.
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#include "mailbox.h"
+
+#include "urlInfo.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <assert.h>
+#include <stdbool.h>
+
+
+// ============================================================================
+// == | Constant Definitions
+// ============================================================================
+#define CACHE_LINE_SIZE     64
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+/**
+ * @brief  A mailbox include the ring of URL slots, the position the consumer
+ *         pops next (head) and the position the producer published up to
+ *         (tail). The producer also keeps the position it pushes next and 
+ *         the head it saw last, and the consumer keeps the tail it saw last,
+ *         each side in its own cache line
+ */
+struct mailbox {
+    UrlInfo **slots;
+    unsigned long mask;
+
+    // Written by the consumer
+    unsigned long head __attribute__((aligned(CACHE_LINE_SIZE)));
+    unsigned long cached_tail;
+
+    // Written by the producer
+    unsigned long tail __attribute__((aligned(CACHE_LINE_SIZE)));
+    unsigned long write_pos;
+    unsigned long cached_head;
+};
+
+
+// ============================================================================
+// == | Module Functions
+// ============================================================================
+/**
+ * @brief  Create a new empty mailbox
+ *
+ * @param  capacity   the number of URL slots (a power of two)
+ * @return            the pointer of new mailbox
+ */
+Mailbox *new_Mailbox(int capacity) {
+
+    assert(capacity > 0 && (capacity & (capacity - 1)) == 0);
+
+    Mailbox *mailbox = (Mailbox *)aligned_alloc(CACHE_LINE_SIZE,
+                                                sizeof *mailbox);
+    UrlInfo **slots = (UrlInfo **)malloc(capacity * sizeof(UrlInfo *));
+    if (mailbox == NULL || slots == NULL) {
+        fprintf(stderr, "Error: new_Mailbox() malloc returned NULL\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Initalise value of the mailbox
+    mailbox->slots       = slots;
+    mailbox->mask        = capacity - 1;
+    mailbox->head        = 0;
+    mailbox->cached_tail = 0;
+    mailbox->tail        = 0;
+    mailbox->write_pos   = 0;
+    mailbox->cached_head = 0;
+
+    return mailbox;
+}
+
+
+/**
+ * @brief  Destroy and free the memory associated with a mailbox, and the
+ *         URLs still in it (neither side uses it anymore)
+ *
+ * @param  mailbox  a mailbox
+ */
+void free_Mailbox(Mailbox *mailbox) {
+
+    // Error if the mailbox does not initalise
+    assert(mailbox != NULL);
+
+    for (unsigned long i = mailbox->head; i != mailbox->write_pos; i++) {
+        free_urlInfo(mailbox->slots[i & mailbox->mask]);
+    }
+
+    free(mailbox->slots);
+    mailbox->slots = NULL;
+
+    free(mailbox);
+    mailbox = NULL;
+}
+
+
+/**
+ * @brief  Push a URL into the mailbox (by the producer). It is not seen by
+ *         the consumer until it is published
+ *
+ * @param  mailbox  a mailbox
+ * @param  url      a UrlInfo data
+ * @return true     If the URL is pushed
+ * @return false    If the mailbox is full
+ */
+bool mailbox_push(Mailbox *mailbox, UrlInfo *url) {
+
+    assert(mailbox != NULL);
+
+    if (mailbox->write_pos - mailbox->cached_head > mailbox->mask) {
+        // Look at how far the consumer popped only if it seems full
+        mailbox->cached_head = __atomic_load_n(&mailbox->head,
+                                               __ATOMIC_ACQUIRE);
+        if (mailbox->write_pos - mailbox->cached_head > mailbox->mask) {
+            return false;
+        }
+    }
+
+    mailbox->slots[mailbox->write_pos & mailbox->mask] = url;
+    mailbox->write_pos++;
+
+    return true;
+}
+
+
+/**
+ * @brief  Publish the URLs pushed to the consumer (by the producer)
+ *
+ * @param  mailbox  a mailbox
+ * @return          the number of URLs published
+ */
+int mailbox_publish(Mailbox *mailbox) {
+
+    assert(mailbox != NULL);
+
+    int published = (int)(mailbox->write_pos - mailbox->tail);
+
+    if (published > 0) {
+        __atomic_store_n(&mailbox->tail, mailbox->write_pos, 
+                         __ATOMIC_RELEASE);
+    }
+
+    return published;
+}
+
+
+/**
+ * @brief  Pop the next URL published (by the consumer)
+ *
+ * @param  mailbox  a mailbox
+ * @return          the URL, or NULL if no URL is published
+ */
+UrlInfo *mailbox_pop(Mailbox *mailbox) {
+
+    assert(mailbox != NULL);
+
+    unsigned long head = mailbox->head;
+
+    if (head == mailbox->cached_tail) {
+        // Look at how far the producer published only if it seems empty
+        mailbox->cached_tail = __atomic_load_n(&mailbox->tail,
+                                               __ATOMIC_ACQUIRE);
+        if (head == mailbox->cached_tail) {
+            return NULL;
+        }
+    }
+
+    UrlInfo *url = mailbox->slots[head & mailbox->mask];
+    __atomic_store_n(&mailbox->head, head + 1, __ATOMIC_RELEASE);
+
+    return url;
+}
@@ -0,0 +1,49 @@
+/**
+ * @file      mailbox.h
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     Single producer single consumer mailbox module. It includes
+ *              1. creating and destroying a mailbox
+ *              2. pushing URLs into the mailbox, and publishing them to the
+ *                 consumer in a batch
+ *              3. popping the URLs published
+ *            The mailbox is a lock-free ring buffer: exactly one thread
+ *            pushes and exactly one thread pops
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#ifndef MAILBOX_H
+#define MAILBOX_H
+
+#include "urlInfo.h"
+
+#include <stdbool.h>
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+typedef struct mailbox Mailbox;
+
+
+// ============================================================================
+// == | Module Functions
+// ============================================================================
+// Create a new empty mailbox holding up to a power of two number of URLs
+Mailbox *new_Mailbox(int capacity);
+
+// Destroy a mailbox and free its memory (and the URLs still in it)
+void free_Mailbox(Mailbox *mailbox);
+
+// Push a URL into the mailbox (not published yet), false if it is full
+bool mailbox_push(Mailbox *mailbox, UrlInfo *url);
+
+// Publish the URLs pushed to the consumer, return the number published
+int mailbox_publish(Mailbox *mailbox);
+
+// Pop the next URL published, or NULL if there is none
+UrlInfo *mailbox_pop(Mailbox *mailbox);
+
+
+#endif
@@ -7,15 +7,12 @@
  *
  */
 
-#include "dlist.h"
-#include "fetchHandler.h"
-#include "httpHandler.h"
-#include "htmlHandler.h"
-#include "responseInfo.h"
-#include "socketHandler.h"
+#include "crawlConfig.h"
+#include "dnsCache.h"
 #include "urlInfo.h"
 #include "urlHandler.h"
 #include "utilities.h"
+#include "workerPool.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -29,7 +26,7 @@
 // == | Function Prototypes
 // ============================================================================
 // Loop crawling the webpages and fetching the URLs
-void loop_fetching(UrlInfo *url) ;
+void loop_fetching(UrlInfo *url, CrawlConfig *config);
 
 
 // ============================================================================
@@ -44,19 +41,21 @@ void loop_fetching(UrlInfo *url) ;
  */
 int main(int argc, char** argv) {
 
+    CrawlConfig config;
+
     // If the input is incorrect, exits
-    if (argc != 2){
-        fprintf(stderr, "Usage: %s <URL> \n", argv[0]);
+    if (!parse_config(argc, argv, &config)){
+        print_usage(argv[0]);
 		exit(EXIT_FAILURE);
     }
 
     // Parse the first URL which from the input
-    UrlInfo *url = parse_first_url(argv[1]);
+    UrlInfo *url = parse_first_url(config.first_url);
 
     
     if (url != NULL){
         // Loop crawling the webpages and fetching the URLs
-        loop_fetching(url);
+        loop_fetching(url, &config);
     }
 
     return 0;
@@ -67,98 +66,47 @@ int main(int argc, char** argv) {
 // ============================================================================
 /**
  * @brief  Loop crawling the webpages and fetching the URLs
+ *         The crawl workers fetch up to the configured number of URLs 
+ *         concurrently, and each response is handled by the worker once 
+ *         its fetch is completed
  * 
- * @param  url    a UrlInfo data
+ * @param  url      a UrlInfo data
+ * @param  config   the crawler configuration
  */
-void loop_fetching(UrlInfo *url) {
+void loop_fetching(UrlInfo *url, CrawlConfig *config) {
 
-    // Initialise the URL already be fetched and will be fetched dlist
-    Dlist *waitedList = new_Wait();
-    Dlist *visitedList = new_Visited();
+    // Initialise the DNS cache shared by the whole crawl
+    DnsCache *dnsCache = new_DnsCache(config->dns_cache_size,
+                                      config->dns_ttl_s * 1000,
+                                      config->dns_negative_ttl_s * 1000);
 
-    // Insert the first be fetched URL
-    insert_new_Wait(waitedList, visitedList, url);
-    int waitsize = get_dlist_size(waitedList);
-    int visitsize = get_dlist_size(visitedList);
-    
-    // The maximum number of fetching is 100
-    while(waitsize > 0 && visitsize < MAX_FETCH){
-
-        // Get a URL from the URL will be fetched dlist
-        url = dlist_remove_start(waitedList);
-
-        // Set up socket and connect it
-        int connfd = setup_socket(url->hostname);
-
-        // Fetched the URL by sending HTTP request to server
-        send_request(connfd, url);
-        insert_new_Visit(visitedList, url);
-        
-
-        ResponseInfo *resp = new_ResponseInfo();
-
-        // If it is valid and satisfies the handle rules, we will get
-        // response from the server
-        if(get_response_from_server(connfd, resp)){
-
-            if (resp->status_code == 200){
-                /** If the status code is 200 OK
-                 * Parsing the HTML file of the content to find the URLs
-                 * And parsing URLs 
-                 */
-                char *content = resp->content;
-                
-                parse_html(content, url, waitedList, visitedList);
-
-                // If the URL is valid and unique(never fetched before), 
-                // add to the URL will be fetched list
-                insert_new_Wait(waitedList, visitedList, url);
-                
-            } else if (resp->status_code == 503){
-                /** If the status code is 503 Service Unavailable
-                 * Add the URL to the URL will be fetched list
-                 * It will be refetching
-                 */
-                UrlInfo *newurl = deep_copy_url(url);
-                dlist_add_start(waitedList, newurl); 
-
-            } else if (resp->status_code == 301){
-                /** If the status code is 301 Moved Permanently 
-                 * Find the redirect link from the response and parsing it
-                 */
-                url_will_be_fetched(resp->redirect_loc, 
-                                    url, 
-                                    waitedList, 
-                                    visitedList);
-
-            } else if(resp->status_code == 401){
-                /** If the status code is 401 Unauthorized Error
-                 * Refetching it 
-                 * and send the HTTP request with Authorization information 
-                 */
-                url->isAuthorization = true;
-                UrlInfo *newurl = deep_copy_url(url);
-                dlist_add_start(waitedList, newurl);
-            }
-        }
-
-        // Get the current number of URL in the URL already be fetched dlist
-        // and the URL will be fetched dlist
-        waitsize = get_dlist_size(waitedList);
-        visitsize = get_dlist_size(visitedList);
-        
-        // free the memory of responseInfo data 
-        free_ResponseInfo(resp);
+    // Initialise the crawl workers, each with its own frontier and engine
+    WorkerPool *pool = new_WorkerPool(config, dnsCache);
+
+    // Resume the crawl kept in the checkpoint journal if it is required,
+    // the first URL is not fetched again if it is fetched before
+    if (config->resume) {
+        resume_WorkerPool(pool);
     }
 
-    // Print out all the fetched URLs
-    for (int i = 0; i < visitsize; i++){
-        UrlInfo *url = get_dlist_point(visitedList, i);
-        print_url(url);
+    // Crawl from the first URL until no URL is left, or the maximum 
+    // number of URLs are fetched
+    run_WorkerPool(pool, url);
+
+    // Write out the fetched URLs not written yet, and the results buffered
+    print_visited_urls(pool);
+
+    // Print out the crawl statistics if it is required
+    if (config->show_stats) {
+        print_worker_pool_stats(pool, stderr);
+        print_dns_cache_stats(dnsCache, stderr);
+        print_url_arena_stats(stderr);
     }
 
-    // free the dlists of the URL already be fetched and will be fetched 
-    free_dlist(waitedList);
-    free_dlist(visitedList);
-}
+    // free the workers and the DNS cache
+    free_WorkerPool(pool);
+    free_DnsCache(dnsCache);
 
+    // Release all URL datas at once, at the end of the crawl
+    free_url_arena();
+}
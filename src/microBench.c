@@ -0,0 +1,864 @@
+/**
+ * @file      microBench.c
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     Micro-benchmark of the parsing and URL hot paths of the
+ *            crawler, without the network. It times
+ *              1. parsing HTML files into a fresh frontier (parse_html)
+ *              2. parsing links (parse_url, split_host_file, ignore_url)
+ *                 and comparing URLs (compare_two_URL_diff)
+ *              3. inserting URLs into a frontier of growing size
+ *                 (insert_new_Wait), new ones and already seen ones
+ *              4. parsing response headers (parse_http_header) and taking
+ *                 the fields the crawler uses from them (extract_*)
+ *            over fixed corpora: a generated page shaped like a news site
+ *            (or the HTML files given), a set of response headers and a
+ *            list of links. The nanoseconds and heap allocations per
+ *            operation, and the bytes per second (when the operation reads
+ *            a corpus) are printed for each.
+ *            Each benchmark repeats its rounds until it runs for the
+ *            minimum time. The heap allocations are counted by wrapping
+ *            malloc, calloc and realloc of the C library (the URL datas
+ *            from the arenas only count when an arena grows).
+ *
+ *            Usage: ./microbench [-t <min ms>] [-m <max frontier size>]
+ *                                [file.html ...]
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#include "crawlConfig.h"
+#include "dnsCache.h"
+#include "fetchHandler.h"
+#include "hostScheduler.h"
+#include "htmlHandler.h"
+#include "httpHeader.h"
+#include "responseInfo.h"
+#include "urlHandler.h"
+#include "urlInfo.h"
+#include "urlSet.h"
+#include "utilities.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <assert.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+
+// ============================================================================
+// == | Constant Definitions
+// ============================================================================
+#define DEFAULT_MIN_MS        200
+#define DEFAULT_MAX_FRONTIER  100000
+#define FIRST_FRONTIER        1000
+#define FRONTIER_GROWTH       10
+#define NUM_HOSTS             64
+#define GENERATED_ARTICLES    120
+#define BENCH_HOST            "localhost"
+#define BENCH_PAGE            "/news/world/index.html"
+#define NS_PER_US             1000.0
+#define US_PER_S              1e6
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+typedef struct corpus Corpus;
+/**
+ * @brief  A corpus include the HTML files and their total length
+ */
+struct corpus {
+    char **pages;
+    int *page_lens;
+    int size;
+    long total_len;
+};
+
+typedef struct measure Measure;
+/**
+ * @brief  A measure include the time taken and the heap allocations made
+ *         while it is running, the operations and bytes done, and the time
+ *         and allocations when it is started last
+ */
+struct measure {
+    long long elapsed_us;
+    long allocs;
+    long ops;
+    long bytes;
+    long long start_us;
+    long start_allocs;
+};
+
+
+// ============================================================================
+// == | Function Prototypes
+// ============================================================================
+// The auxillary functions of the crawler benchmarked (not in its headers)
+UrlInfo *parse_url(char *link, UrlInfo *original);
+bool ignore_url(char *link);
+UrlInfo *split_host_file(int protocol_len, char *link);
+bool extract_content_type(HttpHeader *header, ResponseInfo *resp);
+bool extract_content_loc(HttpHeader *header, ResponseInfo *resp);
+
+// The allocation functions of the C library, wrapped to count allocations
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t num, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+
+// Time parsing the HTML files into a fresh frontier
+void bench_parse_html(Corpus *corpus, DnsCache *dnsCache,
+                      HostLimiter *limiter, long long min_us);
+
+// Time parsing, splitting, checking and comparing the links
+void bench_links(long long min_us);
+
+// Time inserting URLs into a frontier of a given size
+void bench_insert_wait(int size, DnsCache *dnsCache, HostLimiter *limiter,
+                       long long min_us);
+
+// Time parsing the response headers and taking the fields from them
+void bench_headers(long long min_us);
+
+// Start timing a measure and counting its allocations
+void start_measure(Measure *measure);
+
+// Stop timing a measure, adding the time and allocations since it started
+void stop_measure(Measure *measure);
+
+// Print out the time, bytes per second and allocations per operation
+void print_measure(char *name, Measure *measure);
+
+// Add a HTML file into the corpus
+void add_page(Corpus *corpus, char *page, int len);
+
+// Read a HTML file into the corpus
+void read_page(Corpus *corpus, char *path);
+
+// Generate a HTML page shaped like the front page of a news site
+void generate_page(Corpus *corpus);
+
+
+// ============================================================================
+// == | Global Variables
+// ============================================================================
+// The number of heap allocations made
+long num_allocs = 0;
+
+// The list of links: absolute, implied protocol, relative path, file name,
+// ignored, and of other hosts
+static char *links[] = {
+    "http://localhost/news/world/europe.html",
+    "http://localhost/news/world/asia/china-trade-talks.html",
+    "http://www.localhost/sport/football/",
+    "http://LOCALHOST/news/",
+    "http://cdn.example.com/static/js/app.min.js",
+    "http://accounts.example.org/login",
+    "//localhost/weather/melbourne",
+    "//static.localhost/img/logo.svg",
+    "/news/technology/ai-chip-shortage.html",
+    "/news/business/",
+    "/about",
+    "/",
+    "/news/world/../local/council.html",
+    "/search?q=election&page=2",
+    "/news/world/europe.html#comments",
+    "/tag/100%25-renewable",
+    "opinion.html",
+    "asia/japan-earthquake.html",
+    "./index.html",
+    "live-blog-2020-10-17.html",
+    "http://localhost/video/2020/10/17/highlights.html",
+    "http://localhost/news/world/europe.html",
+    "/news/world/europe.html",
+    "europe.html",
+};
+
+// The set of response headers: a page, a chunked page, a redirect,
+// authorization required, unavailable, an image and not found
+static char *headers[] = {
+    "HTTP/1.1 200 OK\r\n"
+    "Server: nginx/1.18.0 (Ubuntu)\r\n"
+    "Date: Sat, 17 Oct 2020 04:12:51 GMT\r\n"
+    "Content-Type: text/html; charset=UTF-8\r\n"
+    "Content-Length: 48213\r\n"
+    "Connection: keep-alive\r\n"
+    "Last-Modified: Sat, 17 Oct 2020 03:58:10 GMT\r\n"
+    "ETag: \"5f8a6c82-bc55\"\r\n"
+    "Cache-Control: max-age=60\r\n"
+    "Accept-Ranges: bytes\r\n\r\n",
+
+    "HTTP/1.1 200 OK\r\n"
+    "Date: Sat, 17 Oct 2020 04:12:52 GMT\r\n"
+    "Content-Type: text/html;charset=utf-8\r\n"
+    "Transfer-Encoding: chunked\r\n"
+    "Connection: keep-alive\r\n"
+    "Set-Cookie: __cfduid=d8b1e0f3a7c2; expires=Mon, 16-Nov-20 04:12:52 "
+    "GMT; path=/; domain=.localhost; HttpOnly; SameSite=Lax\r\n"
+    "Vary: Accept-Encoding\r\n"
+    "X-Frame-Options: SAMEORIGIN\r\n"
+    "Strict-Transport-Security: max-age=15552000\r\n"
+    "CF-Cache-Status: DYNAMIC\r\n"
+    "Server: cloudflare\r\n"
+    "CF-RAY: 5e3b1c2d8f9a0b1c-MEL\r\n\r\n",
+
+    "HTTP/1.1 301 Moved Permanently\r\n"
+    "Server: Apache/2.4.41 (Ubuntu)\r\n"
+    "Date: Sat, 17 Oct 2020 04:12:53 GMT\r\n"
+    "Location: http://localhost/news/world/europe.html\r\n"
+    "Content-Length: 0\r\n"
+    "Content-Type: text/html; charset=iso-8859-1\r\n\r\n",
+
+    "HTTP/1.1 401 Unauthorized\r\n"
+    "Server: Apache/2.4.41 (Ubuntu)\r\n"
+    "Date: Sat, 17 Oct 2020 04:12:54 GMT\r\n"
+    "WWW-Authenticate: Basic realm=\"Subscribers\"\r\n"
+    "Content-Length: 381\r\n"
+    "Content-Type: text/html; charset=iso-8859-1\r\n\r\n",
+
+    "HTTP/1.1 503 Service Unavailable\r\n"
+    "Server: nginx\r\n"
+    "Date: Sat, 17 Oct 2020 04:12:55 GMT\r\n"
+    "Content-Type: text/html\r\n"
+    "Content-Length: 197\r\n"
+    "Connection: close\r\n"
+    "Retry-After: 120\r\n\r\n",
+
+    "HTTP/1.1 200 OK\r\n"
+    "Server: nginx/1.18.0 (Ubuntu)\r\n"
+    "Date: Sat, 17 Oct 2020 04:12:56 GMT\r\n"
+    "Content-Type: image/png\r\n"
+    "Content-Length: 20371\r\n"
+    "Last-Modified: Tue, 02 Jun 2020 11:20:31 GMT\r\n"
+    "Connection: keep-alive\r\n"
+    "ETag: \"5ed6364f-4f93\"\r\n"
+    "Expires: Sun, 17 Oct 2021 04:12:56 GMT\r\n"
+    "Cache-Control: max-age=31536000\r\n\r\n",
+
+    "HTTP/1.0 404 Not Found\r\n"
+    "Content-Type: text/html; charset=UTF-8\r\n"
+    "Referrer-Policy: no-referrer\r\n"
+    "Content-Length: 1568\r\n"
+    "Date: Sat, 17 Oct 2020 04:12:57 GMT\r\n\r\n",
+};
+
+
+// ============================================================================
+// == | Main Functions
+// ============================================================================
+/**
+ * @brief  Run the benchmarks and print out the time, bytes per second and
+ *         allocations per operation of each
+ *
+ * @param  argc   number of inputs
+ * @param  argv   an array of inputs
+ * @return        if no fail exits, return 0
+ */
+int main(int argc, char **argv) {
+
+    Corpus corpus = {NULL, NULL, 0, 0};
+    long long min_us = DEFAULT_MIN_MS * 1000LL;
+    int max_frontier = DEFAULT_MAX_FRONTIER;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "t:m:")) != -1) {
+        if (opt == 't') {
+            min_us = atoi(optarg) * 1000LL;
+        } else if (opt == 'm') {
+            max_frontier = atoi(optarg);
+        } else {
+            fprintf(stderr, "Usage: %s [-t <min ms>] [-m <max frontier "
+                            "size>] [file.html ...]\n", argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (int i = optind; i < argc; i++) {
+        read_page(&corpus, argv[i]);
+    }
+    if (corpus.size == 0) {
+        generate_page(&corpus);
+    }
+
+    // The hostname of the links is resolved before, so the frontiers
+    // check it in the DNS cache without waiting for the network
+    struct in_addr addr;
+    DnsCache *dnsCache = new_DnsCache(DEFAULT_DNS_CACHE_SIZE,
+                                      DEFAULT_DNS_TTL_S * 1000,
+                                      DEFAULT_DNS_NEG_TTL_S * 1000);
+    HostLimiter *limiter = new_HostLimiter(0, DEFAULT_MAX_PER_HOST);
+
+    if (!dns_cache_resolve(dnsCache, BENCH_HOST, &addr)) {
+        fprintf(stderr, "Error: cannot resolve %s, the links found are "
+                        "not inserted\n", BENCH_HOST);
+    }
+
+    printf("corpus: %d pages (%ld bytes), %d links, %d headers\n",
+           corpus.size, corpus.total_len,
+           (int)(sizeof links / sizeof links[0]),
+           (int)(sizeof headers / sizeof headers[0]));
+    printf("%-28s %12s %12s %10s %12s\n",
+           "benchmark", "ops", "ns/op", "MB/s", "allocs/op");
+
+    bench_parse_html(&corpus, dnsCache, limiter, min_us);
+    bench_links(min_us);
+    for (int size = FIRST_FRONTIER; size <= max_frontier;
+         size *= FRONTIER_GROWTH) {
+        bench_insert_wait(size, dnsCache, limiter, min_us);
+    }
+    bench_headers(min_us);
+
+    free_HostLimiter(limiter);
+    free_DnsCache(dnsCache);
+    free_url_arena();
+    for (int p = 0; p < corpus.size; p++) {
+        free(corpus.pages[p]);
+    }
+    free(corpus.pages);
+    free(corpus.page_lens);
+
+    return 0;
+}
+
+
+// ============================================================================
+// == | Auxillary Functions
+// ============================================================================
+/**
+ * @brief  Allocate memory with the C library, counting the allocation
+ *
+ * @param  size   the size of memory
+ * @return        the memory allocated, or NULL
+ */
+void *malloc(size_t size) {
+
+    __atomic_add_fetch(&num_allocs, 1, __ATOMIC_RELAXED);
+    return __libc_malloc(size);
+}
+
+
+/**
+ * @brief  Allocate zeroed memory with the C library, counting the
+ *         allocation
+ *
+ * @param  num    the number of elements
+ * @param  size   the size of an element
+ * @return        the memory allocated, or NULL
+ */
+void *calloc(size_t num, size_t size) {
+
+    __atomic_add_fetch(&num_allocs, 1, __ATOMIC_RELAXED);
+    return __libc_calloc(num, size);
+}
+
+
+/**
+ * @brief  Resize memory with the C library, counting the allocation
+ *
+ * @param  ptr    the memory (or NULL)
+ * @param  size   the new size of memory
+ * @return        the memory resized, or NULL
+ */
+void *realloc(void *ptr, size_t size) {
+
+    __atomic_add_fetch(&num_allocs, 1, __ATOMIC_RELAXED);
+    return __libc_realloc(ptr, size);
+}
+
+
+/**
+ * @brief  Time parsing the HTML files into a fresh frontier, where the
+ *         links of the same host are inserted (the frontier and its set of
+ *         URLs are created and destroyed outside the timing)
+ *
+ * @param  corpus     a corpus
+ * @param  dnsCache   a DNS cache with the hostname of the pages resolved
+ * @param  limiter    a host limiter
+ * @param  min_us     the minimum time to run in microseconds
+ */
+void bench_parse_html(Corpus *corpus, DnsCache *dnsCache,
+                      HostLimiter *limiter, long long min_us) {
+
+    Measure measure = {0, 0, 0, 0, 0, 0};
+    UrlInfo *original = new_UrlInfo(BENCH_HOST, strlen(BENCH_HOST),
+                                    BENCH_PAGE, strlen(BENCH_PAGE));
+    long inserted = 0, rounds = 0;
+
+    while (measure.elapsed_us < min_us) {
+        UrlSet *seenSet = new_urlSet();
+        Frontier *frontier = new_Frontier(dnsCache, seenSet, limiter);
+
+        start_measure(&measure);
+        for (int p = 0; p < corpus->size; p++) {
+            parse_html(corpus->pages[p], corpus->page_lens[p], original,
+                       frontier);
+        }
+        stop_measure(&measure);
+
+        measure.ops   += corpus->size;
+        measure.bytes += corpus->total_len;
+        inserted      += get_waited_size(frontier);
+        rounds++;
+
+        free_Frontier(frontier);
+        free_urlSet(seenSet);
+    }
+    free_urlInfo(original);
+
+    print_measure("parse_html", &measure);
+    printf("  (%ld links inserted per round)\n", inserted / rounds);
+}
+
+
+/**
+ * @brief  Time parsing, splitting, checking and comparing the links of the
+ *         list (the UrlInfo datas are freed outside the timing)
+ *
+ * @param  min_us     the minimum time to run in microseconds
+ */
+void bench_links(long long min_us) {
+
+    int num_links = sizeof links / sizeof links[0];
+    int http_len = strlen(HTTP_HEADER);
+    long links_len = 0;
+    UrlInfo *urls[sizeof links / sizeof links[0]];
+    UrlInfo *original = new_UrlInfo(BENCH_HOST, strlen(BENCH_HOST),
+                                    BENCH_PAGE, strlen(BENCH_PAGE));
+    Measure measure;
+    long found;
+
+    for (int i = 0; i < num_links; i++) {
+        links_len += strlen(links[i]);
+    }
+
+    // parse_url
+    measure = (Measure){0, 0, 0, 0, 0, 0};
+    while (measure.elapsed_us < min_us) {
+        start_measure(&measure);
+        for (int i = 0; i < num_links; i++) {
+            urls[i] = parse_url(links[i], original);
+        }
+        stop_measure(&measure);
+        measure.ops   += num_links;
+        measure.bytes += links_len;
+
+        for (int i = 0; i < num_links; i++) {
+            if (urls[i] != NULL) {
+                free_urlInfo(urls[i]);
+            }
+        }
+    }
+    print_measure("parse_url", &measure);
+
+    // split_host_file, on the absolute links only
+    int num_absolute = 0;
+    long absolute_len = 0;
+    measure = (Measure){0, 0, 0, 0, 0, 0};
+    while (measure.elapsed_us < min_us) {
+        num_absolute = 0;
+        absolute_len = 0;
+
+        start_measure(&measure);
+        for (int i = 0; i < num_links; i++) {
+            if (strncasecmp(links[i], HTTP_HEADER, http_len) == SUCCESS) {
+                urls[num_absolute++] = split_host_file(http_len, links[i]);
+            }
+        }
+        stop_measure(&measure);
+
+        for (int i = 0; i < num_absolute; i++) {
+            absolute_len += strlen(urls[i]->hostname)
+                          + strlen(urls[i]->filepath) + http_len;
+            free_urlInfo(urls[i]);
+        }
+        measure.ops   += num_absolute;
+        measure.bytes += absolute_len;
+    }
+    print_measure("split_host_file", &measure);
+
+    // ignore_url
+    found = 0;
+    measure = (Measure){0, 0, 0, 0, 0, 0};
+    while (measure.elapsed_us < min_us) {
+        start_measure(&measure);
+        for (int i = 0; i < num_links; i++) {
+            found += ignore_url(links[i]);
+        }
+        stop_measure(&measure);
+        measure.ops   += num_links;
+        measure.bytes += links_len;
+    }
+    print_measure("ignore_url", &measure);
+
+    // compare_two_URL_diff, of each URL parsed with the next one (some are
+    // the same URL) and with the page they are found in
+    int num_urls = 0;
+    for (int i = 0; i < num_links; i++) {
+        UrlInfo *url = parse_url(links[i], original);
+        if (url != NULL) {
+            urls[num_urls++] = url;
+        }
+    }
+    measure = (Measure){0, 0, 0, 0, 0, 0};
+    while (measure.elapsed_us < min_us) {
+        start_measure(&measure);
+        for (int i = 0; i < num_urls; i++) {
+            found += compare_two_URL_diff(urls[i],
+                                          urls[(i + 1) % num_urls]);
+            found += compare_two_URL_diff(original, urls[i]);
+        }
+        stop_measure(&measure);
+        measure.ops += 2 * num_urls;
+    }
+    print_measure("compare_two_URL_diff", &measure);
+
+    for (int i = 0; i < num_urls; i++) {
+        free_urlInfo(urls[i]);
+    }
+    free_urlInfo(original);
+
+    // The result is used, so the calls are not left out
+    if (found < 0) {
+        printf("%ld\n", found);
+    }
+}
+
+
+/**
+ * @brief  Time inserting URLs (spread over the hosts) into a fresh
+ *         frontier until it holds a given number of URLs, then inserting
+ *         them again (they are already seen, so they are rejected)
+ *
+ * @param  size       the number of URLs inserted
+ * @param  dnsCache   a DNS cache
+ * @param  limiter    a host limiter
+ * @param  min_us     the minimum time to run in microseconds
+ */
+void bench_insert_wait(int size, DnsCache *dnsCache, HostLimiter *limiter,
+                       long long min_us) {
+
+    Measure measure = {0, 0, 0, 0, 0, 0};
+    Measure again   = {0, 0, 0, 0, 0, 0};
+    char hostname[64], filepath[64];
+
+    UrlInfo **urls = (UrlInfo **)malloc(size * sizeof(UrlInfo *));
+    if (urls == NULL) {
+        fprintf(stderr, "Error: bench_insert_wait() malloc returned NULL\n");
+        exit(EXIT_FAILURE);
+    }
+
+    while (measure.elapsed_us < min_us) {
+        UrlSet *seenSet = new_urlSet();
+        Frontier *frontier = new_Frontier(dnsCache, seenSet, limiter);
+
+        for (int i = 0; i < size; i++) {
+            int host_len = sprintf(hostname, "host%d.%s", i % NUM_HOSTS,
+                                   BENCH_HOST);
+            int path_len = sprintf(filepath, "/section%d/article-%d.html",
+                                   i % 97, i);
+            urls[i] = new_UrlInfo(hostname, host_len, filepath, path_len);
+        }
+
+        start_measure(&measure);
+        for (int i = 0; i < size; i++) {
+            if (!insert_new_Wait(frontier, urls[i])) {
+                fprintf(stderr, "Error: bench_insert_wait() URL %d "
+                                "rejected\n", i);
+                exit(EXIT_FAILURE);
+            }
+        }
+        stop_measure(&measure);
+        measure.ops += size;
+
+        // The frontier owns the URLs inserted, so copies are inserted again
+        for (int i = 0; i < size; i++) {
+            urls[i] = deep_copy_url(urls[i]);
+        }
+
+        start_measure(&again);
+        for (int i = 0; i < size; i++) {
+            if (insert_new_Wait(frontier, urls[i])) {
+                fprintf(stderr, "Error: bench_insert_wait() URL %d "
+                                "inserted twice\n", i);
+                exit(EXIT_FAILURE);
+            }
+        }
+        stop_measure(&again);
+        again.ops += size;
+
+        for (int i = 0; i < size; i++) {
+            free_urlInfo(urls[i]);
+        }
+        free_Frontier(frontier);
+        free_urlSet(seenSet);
+    }
+    free(urls);
+
+    char name[64];
+    sprintf(name, "insert_new_Wait %d", size);
+    print_measure(name, &measure);
+    sprintf(name, "insert_new_Wait %d seen", size);
+    print_measure(name, &again);
+}
+
+
+/**
+ * @brief  Time parsing the response headers, and taking the content type
+ *         and redirect location from the parsed headers
+ *
+ * @param  min_us     the minimum time to run in microseconds
+ */
+void bench_headers(long long min_us) {
+
+    int num_headers = sizeof headers / sizeof headers[0];
+    HttpHeader parsed[sizeof headers / sizeof headers[0]];
+    int header_lens[sizeof headers / sizeof headers[0]];
+    long headers_len = 0;
+    ResponseInfo *resp = new_ResponseInfo();
+    Measure measure;
+    long found = 0;
+
+    for (int i = 0; i < num_headers; i++) {
+        header_lens[i] = strlen(headers[i]);
+        headers_len   += header_lens[i];
+    }
+
+    // parse_http_header
+    measure = (Measure){0, 0, 0, 0, 0, 0};
+    while (measure.elapsed_us < min_us) {
+        start_measure(&measure);
+        for (int i = 0; i < num_headers; i++) {
+            if (!parse_http_header(headers[i], header_lens[i],
+                                   &parsed[i])) {
+                fprintf(stderr, "Error: bench_headers() header %d is not "
+                                "parsed\n", i);
+                exit(EXIT_FAILURE);
+            }
+        }
+        stop_measure(&measure);
+        measure.ops   += num_headers;
+        measure.bytes += headers_len;
+    }
+    print_measure("parse_http_header", &measure);
+
+    // extract_content_type
+    measure = (Measure){0, 0, 0, 0, 0, 0};
+    while (measure.elapsed_us < min_us) {
+        start_measure(&measure);
+        for (int i = 0; i < num_headers; i++) {
+            found += extract_content_type(&parsed[i], resp);
+        }
+        stop_measure(&measure);
+        measure.ops += num_headers;
+    }
+    print_measure("extract_content_type", &measure);
+
+    // extract_content_loc
+    measure = (Measure){0, 0, 0, 0, 0, 0};
+    while (measure.elapsed_us < min_us) {
+        start_measure(&measure);
+        for (int i = 0; i < num_headers; i++) {
+            found += extract_content_loc(&parsed[i], resp);
+        }
+        stop_measure(&measure);
+        measure.ops += num_headers;
+    }
+    print_measure("extract_content_loc", &measure);
+
+    free_ResponseInfo(resp);
+
+    // The result is used, so the calls are not left out
+    if (found < 0) {
+        printf("%ld\n", found);
+    }
+}
+
+
+/**
+ * @brief  Start timing a measure and counting its allocations
+ *
+ * @param  measure    a measure
+ */
+void start_measure(Measure *measure) {
+
+    measure->start_allocs = __atomic_load_n(&num_allocs, __ATOMIC_RELAXED);
+    measure->start_us     = get_monotonic_us();
+}
+
+
+/**
+ * @brief  Stop timing a measure, adding the time and allocations since it
+ *         is started
+ *
+ * @param  measure    a measure
+ */
+void stop_measure(Measure *measure) {
+
+    measure->elapsed_us += get_monotonic_us() - measure->start_us;
+    measure->allocs     += __atomic_load_n(&num_allocs, __ATOMIC_RELAXED)
+                         - measure->start_allocs;
+}
+
+
+/**
+ * @brief  Print out the operations done, and the time, bytes per second
+ *         (if the operation reads a corpus) and allocations per operation
+ *
+ * @param  name       the name of the benchmark
+ * @param  measure    a measure
+ */
+void print_measure(char *name, Measure *measure) {
+
+    double ns_per_op = measure->elapsed_us * NS_PER_US / measure->ops;
+    double allocs_per_op = (double)measure->allocs / measure->ops;
+
+    if (measure->bytes > 0 && measure->elapsed_us > 0) {
+        printf("%-28s %12ld %12.1f %10.1f %12.2f\n", name, measure->ops,
+               ns_per_op,
+               measure->bytes * US_PER_S / measure->elapsed_us / 1e6,
+               allocs_per_op);
+    } else {
+        printf("%-28s %12ld %12.1f %10s %12.2f\n", name, measure->ops,
+               ns_per_op, "-", allocs_per_op);
+    }
+}
+
+
+/**
+ * @brief  Add a HTML file into the corpus, the corpus takes its memory
+ *
+ * @param  corpus   a corpus
+ * @param  page     a NULL terminated HTML file
+ * @param  len      the length of the HTML file
+ */
+void add_page(Corpus *corpus, char *page, int len) {
+
+    int size = corpus->size + 1;
+
+    corpus->pages     = realloc(corpus->pages, size * sizeof(char *));
+    corpus->page_lens = realloc(corpus->page_lens, size * sizeof(int));
+    if (corpus->pages == NULL || corpus->page_lens == NULL) {
+        fprintf(stderr, "Error: add_page() realloc returned NULL\n");
+        exit(EXIT_FAILURE);
+    }
+
+    corpus->pages[corpus->size]     = page;
+    corpus->page_lens[corpus->size] = len;
+    corpus->size       = size;
+    corpus->total_len += len;
+}
+
+
+/**
+ * @brief  Read a HTML file into the corpus
+ *
+ * @param  corpus   a corpus
+ * @param  path     the path of the HTML file
+ */
+void read_page(Corpus *corpus, char *path) {
+
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+
+    fseek(fp, 0, SEEK_END);
+    long len = ftell(fp);
+    rewind(fp);
+
+    char *page = (char *)malloc(len + 1);
+    if (page == NULL) {
+        fprintf(stderr, "Error: read_page() malloc returned NULL\n");
+        exit(EXIT_FAILURE);
+    }
+    if (fread(page, 1, len, fp) != (size_t)len) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+    page[len] = NULL_TERMINATED;
+    fclose(fp);
+
+    // The crawler treats the content as a string, so does the benchmark
+    add_page(corpus, page, strlen(page));
+}
+
+
+/**
+ * @brief  Generate a HTML page shaped like the front page of a news site:
+ *         a head with metadata and scripts, a navigation bar, the articles
+ *         (with links to them, their tags and other hosts) and a footer
+ *
+ * @param  corpus   a corpus
+ */
+void generate_page(Corpus *corpus) {
+
+    static const char *head =
+        "<!DOCTYPE html>\n<html lang=\"en\">\n<head>\n"
+        "<meta charset=\"utf-8\">\n"
+        "<meta name=\"viewport\" content=\"width=device-width\">\n"
+        "<title>World news | Localhost News</title>\n"
+        "<link rel=\"stylesheet\" href=\"/static/css/main.css\">\n"
+        "<link rel=\"canonical\" href=\"http://localhost/news/world/\">\n"
+        "<script async src=\"http://cdn.example.com/js/analytics.js\">"
+        "</script>\n"
+        "<script>window.dataLayer = window.dataLayer || []; if (a < b &&"
+        " c > d) { document.write('<a href=\"/in-script\">x</a>'); }"
+        "</script>\n"
+        "</head>\n<body>\n<header class=\"site-header\">\n"
+        "<a href=\"/\" class=\"logo\"><img src=\"/static/img/logo.svg\" "
+        "alt=\"Localhost News\"></a>\n<nav><ul>\n"
+        "<li><a href=\"/news/\">News</a></li>\n"
+        "<li><a href=\"/news/world/\">World</a></li>\n"
+        "<li><a href=\"/news/business/\">Business</a></li>\n"
+        "<li><a href=\"/news/technology/\">Technology</a></li>\n"
+        "<li><a href=\"http://www.localhost/sport/\">Sport</a></li>\n"
+        "<li><a href=\"//localhost/weather/\">Weather</a></li>\n"
+        "<li><a href=\"/search?q=\">Search</a></li>\n"
+        "</ul></nav>\n</header>\n<main id=\"content\">\n";
+    static const char *article =
+        "<article class=\"story story--%s\" data-id=\"%d\">\n"
+        "  <a class=\"story__link\" href=\"/news/world/story-%d.html\">\n"
+        "    <img class=\"story__img\" src=\"/img/%d/640x360.jpg\" "
+        "srcset=\"/img/%d/1280x720.jpg 2x\" alt=\"\" loading=\"lazy\">\n"
+        "    <h3 class=\"story__title\">Leaders meet as talks enter "
+        "their %dth day</h3>\n  </a>\n"
+        "  <p class=\"story__summary\">Negotiators said on Saturday that "
+        "progress had been made, but that &quot;significant gaps&quot; "
+        "remain on trade, fishing rights and the rules for state aid.</p>"
+        "\n  <ul class=\"story__tags\">\n"
+        "    <li><A HREF = 'tag-%d.html' >Politics</A></li>\n"
+        "    <li><a href=\"story-%d.html#comments\">Comments</a></li>\n"
+        "    <li><a rel=\"nofollow\" href=\"http://share.example.com/?u="
+        "%d\">Share</a></li>\n  </ul>\n"
+        "  <!-- <a href=\"/news/world/draft-%d.html\">draft</a> -->\n"
+        "</article>\n";
+    static const char *foot =
+        "</main>\n<footer><ul>\n"
+        "<li><a href=\"/about\">About us</a></li>\n"
+        "<li><a href=\"/contact\">Contact</a></li>\n"
+        "<li><a href=\"/terms\">Terms of use</a></li>\n"
+        "<li><a href=\"/privacy\">Privacy</a></li>\n"
+        "<li><a href=\"http://accounts.example.org/login\">Sign in</a>"
+        "</li>\n</ul>\n<p>&copy; 2020 Localhost News</p>\n</footer>\n"
+        "<style>.story > a { color: inherit; }</style>\n"
+        "</body>\n</html>\n";
+
+    int cap = strlen(head) + strlen(foot)
+            + GENERATED_ARTICLES * (strlen(article) + 128);
+    char *page = (char *)malloc(cap);
+    if (page == NULL) {
+        fprintf(stderr, "Error: generate_page() malloc returned NULL\n");
+        exit(EXIT_FAILURE);
+    }
+
+    int len = sprintf(page, "%s", head);
+    for (int i = 0; i < GENERATED_ARTICLES; i++) {
+        len += sprintf(page + len, article, (i % 5 == 0) ? "lead" : "small",
+                       i, i, i, i, i, i % 12, i, i, i);
+    }
+    len += sprintf(page + len, "%s", foot);
+
+    add_page(corpus, page, len);
+}
@@ -0,0 +1,614 @@
+/**
+ * @file      mockServer.c
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     Mock HTTP server serving a generated site, for benchmarking the
+ *            crawler on the loopback interface. It includes
+ *              1. generating the pages of the site: page /pN links to the
+ *                 pages after it (so every page is reached from /p0), and
+ *                 is padded with text up to the page size
+ *              2. a mix of status codes: some pages are moved (301) to the
+ *                 next page, some need the authorization (401), and some
+ *                 are unavailable (503, or 504 for the odd pages) the first
+ *                 time they are fetched
+ *              3. sending some pages in chunks (Transfer-Encoding: chunked)
+ *              4. keeping the connections alive, a thread for each
+ *              5. reporting the requests served and the bytes sent once it
+ *                 is terminated (SIGTERM or SIGINT)
+ *            Which pages are moved, need the authorization, are unavailable
+ *            or chunked is decided by a hash of the page number, so the site
+ *            is the same for every run. The port is printed once the server
+ *            is listening (a free port is chosen if the port is 0).
+ *
+ *            Usage: ./mockserver [-p <port>] [-n <pages>] [-l <links>]
+ *                                [-b <page bytes>] [-r <301 %>] [-a <401 %>]
+ *                                [-u <503 %>] [-c <chunked %>]
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <arpa/inet.h>
+#include <assert.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+
+// ============================================================================
+// == | Constant Definitions
+// ============================================================================
+#define DEFAULT_PAGES           1000
+#define DEFAULT_LINKS           8
+#define DEFAULT_PAGE_BYTES      16384
+#define DEFAULT_REDIRECT_PCT    2
+#define DEFAULT_AUTH_PCT        2
+#define DEFAULT_UNAVAILABLE_PCT 2
+#define DEFAULT_CHUNKED_PCT     20
+#define MAX_PAGE_BYTES          (64 << 20)
+#define MAX_REQUEST_BYTES       8192
+#define CHUNK_BYTES             4096
+#define LISTEN_BACKLOG          128
+#define PAGE_PREFIX             "/p"
+#define AUTH_HEADER             "\r\nAuthorization:"
+#define FILLER_TEXT             "lorem ipsum dolor sit amet consectetur "
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+/**
+ * @brief  The kind of response a page gets
+ */
+typedef enum {
+    PAGE_OK,
+    PAGE_MOVED,
+    PAGE_AUTHORIZED,
+    PAGE_UNAVAILABLE
+} PageKind;
+
+
+typedef struct site Site;
+/**
+ * @brief  A site include the number of pages, the links of each page, the
+ *         page size, the percent of pages of each status code (and chunked),
+ *         the number of times each page is fetched, and the requests served
+ *         and bytes sent (counted by all threads)
+ */
+struct site {
+    int num_pages;
+    int num_links;
+    int page_bytes;
+    int redirect_pct;
+    int auth_pct;
+    int unavailable_pct;
+    int chunked_pct;
+    int *fetches;
+    long requests;
+    long long bytes_sent;
+};
+
+
+// ============================================================================
+// == | Function Prototypes
+// ============================================================================
+// Parse the command line options into the site, and the port
+bool parse_options(int argc, char **argv, Site *site, int *port);
+
+// Accept the connections, a thread serves each
+void *accept_connections(void *arg);
+
+// Serve the requests of a connection until it is closed
+void *serve_connection(void *arg);
+
+// Send the response to a request
+bool send_response(Site *site, int connfd, char *request);
+
+// Generate the body of a page
+char *generate_body(Site *site, int page, int *body_len);
+
+// Get the kind of response a page gets
+PageKind get_page_kind(Site *site, int page);
+
+// Check if a page is sent in chunks
+bool is_page_chunked(Site *site, int page);
+
+// Hash a page number
+uint64_t hash_page(int page, uint64_t salt);
+
+// Send all bytes into a socket
+bool send_all(Site *site, int connfd, char *data, size_t len);
+
+
+// ============================================================================
+// == | Global Variables
+// ============================================================================
+static Site site;
+static int listenfd;
+
+
+// ============================================================================
+// == | Main Functions
+// ============================================================================
+/**
+ * @brief  Serve the generated site until it is terminated, then print out
+ *         the requests served and the bytes sent
+ *
+ * @param  argc   number of inputs
+ * @param  argv   an array of inputs
+ * @return        0 once it is terminated
+ */
+int main(int argc, char **argv) {
+
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof addr;
+    sigset_t signals;
+    pthread_t thread;
+    int port = 0;
+    int sig;
+
+    if (!parse_options(argc, argv, &site, &port)) {
+        fprintf(stderr, "Usage: %s [-p <port>] [-n <pages>] [-l <links>] "
+                        "[-b <page bytes>] [-r <301 %%>] [-a <401 %%>] "
+                        "[-u <503 %%>] [-c <chunked %%>]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    site.fetches = (int *)calloc(site.num_pages, sizeof(int));
+    if (site.fetches == NULL) {
+        fprintf(stderr, "Error: main() calloc returned NULL\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // The termination signals are only taken by the main thread
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    listenfd = socket(AF_INET, SOCK_STREAM, 0);
+    int enable = 1;
+    setsockopt(listenfd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof enable);
+
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port        = htons(port);
+    if (listenfd < 0
+        || bind(listenfd, (struct sockaddr *)&addr, sizeof addr) < 0
+        || listen(listenfd, LISTEN_BACKLOG) < 0
+        || getsockname(listenfd, (struct sockaddr *)&addr, &addr_len) < 0) {
+        perror("ERROR listening");
+        exit(EXIT_FAILURE);
+    }
+
+    // Tell the port chosen, once the server is listening
+    printf("port %d\n", ntohs(addr.sin_port));
+    fflush(stdout);
+
+    if (pthread_create(&thread, NULL, accept_connections, NULL) != 0) {
+        fprintf(stderr, "Error: main() pthread_create failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    sigwait(&signals, &sig);
+
+    printf("requests %ld bytes %lld\n",
+           __atomic_load_n(&site.requests, __ATOMIC_RELAXED),
+           __atomic_load_n(&site.bytes_sent, __ATOMIC_RELAXED));
+    fflush(stdout);
+
+    return 0;
+}
+
+
+// ============================================================================
+// == | Auxillary Functions
+// ============================================================================
+/**
+ * @brief  Parse the command line options into the site, and the port.
+ *         Options which are not given keep their default value
+ *
+ * @param  argc     number of inputs
+ * @param  argv     an array of inputs
+ * @param  site     the site will be set
+ * @param  port     the port will be set
+ * @return true     If the options are valid
+ * @return false    If any option is invalid
+ */
+bool parse_options(int argc, char **argv, Site *site, int *port) {
+
+    int opt;
+
+    site->num_pages       = DEFAULT_PAGES;
+    site->num_links       = DEFAULT_LINKS;
+    site->page_bytes      = DEFAULT_PAGE_BYTES;
+    site->redirect_pct    = DEFAULT_REDIRECT_PCT;
+    site->auth_pct        = DEFAULT_AUTH_PCT;
+    site->unavailable_pct = DEFAULT_UNAVAILABLE_PCT;
+    site->chunked_pct     = DEFAULT_CHUNKED_PCT;
+    site->fetches         = NULL;
+    site->requests        = 0;
+    site->bytes_sent      = 0;
+
+    while ((opt = getopt(argc, argv, "p:n:l:b:r:a:u:c:")) != -1) {
+        int value = atoi(optarg);
+
+        switch (opt) {
+            case 'p':
+                *port = value;
+                break;
+            case 'n':
+                site->num_pages = value;
+                break;
+            case 'l':
+                site->num_links = value;
+                break;
+            case 'b':
+                site->page_bytes = value;
+                break;
+            case 'r':
+                site->redirect_pct = value;
+                break;
+            case 'a':
+                site->auth_pct = value;
+                break;
+            case 'u':
+                site->unavailable_pct = value;
+                break;
+            case 'c':
+                site->chunked_pct = value;
+                break;
+            default:
+                return false;
+        }
+    }
+
+    return optind == argc && *port >= 0 && *port <= UINT16_MAX
+        && site->num_pages > 0 && site->num_links >= 0
+        && site->page_bytes >= 0 && site->page_bytes <= MAX_PAGE_BYTES
+        && site->redirect_pct >= 0 && site->auth_pct >= 0
+        && site->unavailable_pct >= 0 && site->chunked_pct >= 0
+        && site->redirect_pct + site->auth_pct + site->unavailable_pct <= 100
+        && site->chunked_pct <= 100;
+}
+
+
+/**
+ * @brief  Accept the connections, a detached thread serves each
+ *
+ * @param  arg    not used
+ * @return        NULL
+ */
+void *accept_connections(void *arg) {
+
+    pthread_t thread;
+    int enable = 1;
+
+    (void)arg;
+
+    while (true) {
+        int connfd = accept(listenfd, NULL, NULL);
+        if (connfd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            perror("ERROR accepting");
+            exit(EXIT_FAILURE);
+        }
+
+        // Headers and bodies are sent apart, so do not wait on delayed ACKs
+        setsockopt(connfd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof enable);
+
+        if (pthread_create(&thread, NULL, serve_connection,
+                           (void *)(intptr_t)connfd) != 0) {
+            close(connfd);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+
+    return NULL;
+}
+
+
+/**
+ * @brief  Serve the requests of a connection until it is closed (the
+ *         requests are read one at a time, up to the end of their headers)
+ *
+ * @param  arg    the socket of the connection
+ * @return        NULL
+ */
+void *serve_connection(void *arg) {
+
+    int connfd = (int)(intptr_t)arg;
+    char buffer[MAX_REQUEST_BYTES + 1];
+    int used = 0;
+
+    while (true) {
+        char *end;
+
+        buffer[used] = '\0';
+        while ((end = strstr(buffer, "\r\n\r\n")) == NULL) {
+            if (used == MAX_REQUEST_BYTES) {
+                close(connfd);
+                return NULL;
+            }
+            ssize_t n = recv(connfd, buffer + used, MAX_REQUEST_BYTES - used,
+                             0);
+            if (n <= 0) {
+                close(connfd);
+                return NULL;
+            }
+            used += n;
+            buffer[used] = '\0';
+        }
+
+        // The request ends with its headers (a GET has no body)
+        end += strlen("\r\n\r\n");
+        char saved = *end;
+        *end = '\0';
+        bool isSent = send_response(&site, connfd, buffer);
+        *end = saved;
+        if (!isSent) {
+            close(connfd);
+            return NULL;
+        }
+
+        used -= end - buffer;
+        memmove(buffer, end, used);
+    }
+}
+
+
+/**
+ * @brief  Send the response to a request by the kind of its page: the page
+ *         (in chunks or not), a redirect to the next page, a request for
+ *         the authorization, or unavailable (the first time only). A path
+ *         which is not a page is not found
+ *
+ * @param  site       the site
+ * @param  connfd     the socket of the connection
+ * @param  request    the request (its line and headers)
+ * @return true       If the response is sent
+ * @return false      If the connection is closed
+ */
+bool send_response(Site *site, int connfd, char *request) {
+
+    char header[512];
+    char *path = strchr(request, ' ');
+    char *end;
+    int page = -1;
+
+    __atomic_add_fetch(&site->requests, 1, __ATOMIC_RELAXED);
+
+    if (path != NULL && strncmp(path + 1, PAGE_PREFIX,
+                                strlen(PAGE_PREFIX)) == 0) {
+        long num = strtol(path + 1 + strlen(PAGE_PREFIX), &end, 10);
+        if (end != path + 1 + strlen(PAGE_PREFIX) && num >= 0
+            && num < site->num_pages) {
+            page = (int)num;
+        }
+    }
+
+    if (page < 0) {
+        int len = snprintf(header, sizeof header,
+                           "HTTP/1.1 404 Not Found\r\n"
+                           "Content-Length: 0\r\n\r\n");
+        return send_all(site, connfd, header, len);
+    }
+
+    int fetches = __atomic_fetch_add(&site->fetches[page], 1,
+                                     __ATOMIC_RELAXED);
+    PageKind kind = get_page_kind(site, page);
+
+    if (kind == PAGE_MOVED) {
+        int len = snprintf(header, sizeof header,
+                           "HTTP/1.1 301 Moved Permanently\r\n"
+                           "Location: %s%d\r\n"
+                           "Content-Length: 0\r\n\r\n",
+                           PAGE_PREFIX, (page + 1) % site->num_pages);
+        return send_all(site, connfd, header, len);
+    }
+    if (kind == PAGE_AUTHORIZED && strcasestr(request, AUTH_HEADER) == NULL) {
+        int len = snprintf(header, sizeof header,
+                           "HTTP/1.1 401 Unauthorized\r\n"
+                           "WWW-Authenticate: Basic realm=\"bench\"\r\n"
+                           "Content-Length: 0\r\n\r\n");
+        return send_all(site, connfd, header, len);
+    }
+    if (kind == PAGE_UNAVAILABLE && fetches == 0) {
+        int len = snprintf(header, sizeof header,
+                           (page % 2 == 0)
+                               ? "HTTP/1.1 503 Service Unavailable\r\n"
+                                 "Content-Length: 0\r\n\r\n"
+                               : "HTTP/1.1 504 Gateway Timeout\r\n"
+                                 "Content-Length: 0\r\n\r\n");
+        return send_all(site, connfd, header, len);
+    }
+
+    int body_len;
+    char *body = generate_body(site, page, &body_len);
+    bool isSent;
+
+    if (is_page_chunked(site, page)) {
+        int len = snprintf(header, sizeof header,
+                           "HTTP/1.1 200 OK\r\n"
+                           "Content-Type: text/html; charset=UTF-8\r\n"
+                           "Transfer-Encoding: chunked\r\n\r\n");
+        isSent = send_all(site, connfd, header, len);
+
+        for (int i = 0; isSent && i < body_len; i += CHUNK_BYTES) {
+            int chunk = (body_len - i < CHUNK_BYTES) ? body_len - i
+                                                      : CHUNK_BYTES;
+            len = snprintf(header, sizeof header, "%x\r\n", chunk);
+            isSent = send_all(site, connfd, header, len)
+                  && send_all(site, connfd, body + i, chunk)
+                  && send_all(site, connfd, "\r\n", 2);
+        }
+        isSent = isSent && send_all(site, connfd, "0\r\n\r\n", 5);
+    } else {
+        int len = snprintf(header, sizeof header,
+                           "HTTP/1.1 200 OK\r\n"
+                           "Content-Type: text/html; charset=UTF-8\r\n"
+                           "Content-Length: %d\r\n\r\n", body_len);
+        isSent = send_all(site, connfd, header, len)
+              && send_all(site, connfd, body, body_len);
+    }
+
+    free(body);
+    return isSent;
+}
+
+
+/**
+ * @brief  Generate the body of a page: the links to the pages after it
+ *         (page N links to pages N * links + 1 to N * links + links, so the
+ *         site is a tree from /p0, plus the pages they wrap around to), and
+ *         text up to the page size
+ *
+ * @param  site       the site
+ * @param  page       the page number
+ * @param  body_len   returns the length of the body
+ * @return            the body (the caller frees it)
+ */
+char *generate_body(Site *site, int page, int *body_len) {
+
+    int capacity = site->page_bytes + (site->num_links + 2) * 64;
+    char *body = (char *)malloc(capacity);
+    if (body == NULL) {
+        fprintf(stderr, "Error: generate_body() malloc returned NULL\n");
+        exit(EXIT_FAILURE);
+    }
+
+    int len = snprintf(body, capacity, "<html><head><title>page %d</title>"
+                                       "</head><body>\n", page);
+    for (int i = 1; i <= site->num_links; i++) {
+        long target = ((long)page * site->num_links + i) % site->num_pages;
+        len += snprintf(body + len, capacity - len,
+                        "<p><a href=\"%s%ld\">page %ld</a></p>\n",
+                        PAGE_PREFIX, target, target);
+    }
+
+    char *tail = "</body></html>\n";
+    int tail_len = strlen(tail);
+    int filler_len = strlen(FILLER_TEXT);
+    while (len + tail_len < site->page_bytes) {
+        int n = site->page_bytes - len - tail_len;
+        if (n > filler_len) {
+            n = filler_len;
+        }
+        memcpy(body + len, FILLER_TEXT, n);
+        len += n;
+    }
+    memcpy(body + len, tail, tail_len);
+    len += tail_len;
+
+    *body_len = len;
+    return body;
+}
+
+
+/**
+ * @brief  Get the kind of response a page gets, by a hash of its number.
+ *         The first page is always served
+ *
+ * @param  site   the site
+ * @param  page   the page number
+ * @return        the kind of response
+ */
+PageKind get_page_kind(Site *site, int page) {
+
+    if (page == 0) {
+        return PAGE_OK;
+    }
+
+    int pct = (int)(hash_page(page, 1) % 100);
+
+    if (pct < site->redirect_pct) {
+        return PAGE_MOVED;
+    }
+    pct -= site->redirect_pct;
+    if (pct < site->auth_pct) {
+        return PAGE_AUTHORIZED;
+    }
+    pct -= site->auth_pct;
+    if (pct < site->unavailable_pct) {
+        return PAGE_UNAVAILABLE;
+    }
+
+    return PAGE_OK;
+}
+
+
+/**
+ * @brief  Check if a page is sent in chunks, by a hash of its number
+ *
+ * @param  site   the site
+ * @param  page   the page number
+ * @return true   If it is sent in chunks
+ * @return false  If it is sent with its length
+ */
+bool is_page_chunked(Site *site, int page) {
+
+    return (int)(hash_page(page, 2) % 100) < site->chunked_pct;
+}
+
+
+/**
+ * @brief  Hash a page number (SplitMix64), with a salt for each decision
+ *
+ * @param  page   the page number
+ * @param  salt   the salt
+ * @return        the hash value
+ */
+uint64_t hash_page(int page, uint64_t salt) {
+
+    uint64_t x = (uint64_t)page * 0x9e3779b97f4a7c15ULL + salt;
+
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+
+    return x ^ (x >> 31);
+}
+
+
+/**
+ * @brief  Send all bytes into a socket, and count them
+ *
+ * @param  site     the site
+ * @param  connfd   the socket of the connection
+ * @param  data     the bytes
+ * @param  len      the number of bytes
+ * @return true     If all bytes are sent
+ * @return false    If the connection is closed
+ */
+bool send_all(Site *site, int connfd, char *data, size_t len) {
+
+    while (len > 0) {
+        ssize_t n = send(connfd, data, len, MSG_NOSIGNAL);
+
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        __atomic_add_fetch(&site->bytes_sent, n, __ATOMIC_RELAXED);
+        data += n;
+        len  -= n;
+    }
+
+    return true;
+}
@@ -0,0 +1,410 @@
+/**
+ * @file      perfCounters.c
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     Implementation of hardware performance counters module. It
+ *            includes
+ *              1. creating the counters of a crawl worker, and opening them
+ *                 (with perf_event_open) for the thread of the worker
+ *              2. reading the counters before and after each stage of the
+ *                 crawl, and adding up the counts of each stage
+ *              3. merging the counts of the workers, and printing them out
+ *                 per page and per KB of HTML
+ *            The cycles lead the group if they are available, otherwise the
+ *            CPU time is opened alone. Only the user space of the thread is
+ *            counted, so it works with perf_event_paranoid up to 2
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#include "perfCounters.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+
+// ============================================================================
+// == | Constant Definitions
+// ============================================================================
+#define BYTES_PER_KB        1024.0
+#define NS_PER_US           1000.0
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+/**
+ * @brief  The counters include the file descriptor of each event (-1 if it
+ *         is not open), the event of each value read from the group (in
+ *         the order they are opened), the number of events open, the error
+ *         of the event not opened first (0 if none), if each event is
+ *         counted (by any worker merged), the pages parsed and the bytes of
+ *         their HTML, and the number of times and the counts of each stage
+ */
+struct perf_counters {
+    int fds[NUM_PERF_EVENTS];
+    int order[NUM_PERF_EVENTS];
+    int num_open;
+    int open_errno;
+    bool isCounted[NUM_PERF_EVENTS];
+    long pages;
+    long html_bytes;
+    long calls[NUM_STAGES];
+    uint64_t counts[NUM_STAGES][NUM_PERF_EVENTS];
+};
+
+
+// ============================================================================
+// == | Function Prototypes
+// ============================================================================
+// Open an event for the calling thread, into a group (or as its leader)
+bool open_perf_event(PerfCounters *perf, PerfEvent event, int group_fd);
+
+// Read the values of the counters open
+bool read_perf_sample(PerfCounters *perf, PerfSample *sample);
+
+// Print out a count per unit, or n/a if it is not counted
+void print_per_unit(FILE *fp, bool isCounted, double count, double units,
+                    char *name);
+
+
+// ============================================================================
+// == | Global Variables
+// ============================================================================
+// The type and config of each event for perf_event_open
+static const uint32_t perf_types[NUM_PERF_EVENTS] = {
+    PERF_TYPE_SOFTWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+    PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE
+};
+static const uint64_t perf_configs[NUM_PERF_EVENTS] = {
+    PERF_COUNT_SW_TASK_CLOCK, PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES
+};
+
+// The names of the stages in the report
+static const char *stage_names[NUM_STAGES] = {
+    "parse_html", "header", "parse_url", "dedup"
+};
+
+
+// ============================================================================
+// == | Module Functions
+// ============================================================================
+/**
+ * @brief  Create the counters of a worker, with nothing counted. They are
+ *         opened by the thread of the worker
+ *
+ * @return        the pointer of new counters
+ */
+PerfCounters *new_PerfCounters() {
+
+    PerfCounters *perf = (PerfCounters *)calloc(1, sizeof *perf);
+    if (perf == NULL) {
+        fprintf(stderr, "Error: new_PerfCounters() calloc returned NULL\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int i = 0; i < NUM_PERF_EVENTS; i++) {
+        perf->fds[i] = -1;
+    }
+
+    return perf;
+}
+
+
+/**
+ * @brief  Close the counters and free the memory associated with them
+ *
+ * @param  perf   the counters
+ */
+void free_PerfCounters(PerfCounters *perf) {
+
+    assert(perf != NULL);
+
+    close_PerfCounters(perf);
+
+    free(perf);
+    perf = NULL;
+}
+
+
+/**
+ * @brief  Open the counters for the calling thread: the hardware events
+ *         in a group led by the cycles, with the CPU time. If the cycles
+ *         are not available, the CPU time is opened alone, and an event
+ *         not available in the group is left out
+ *
+ * @param  perf   the counters
+ * @return true   If any event is opened
+ * @return false  If no event is available (the error is kept)
+ */
+bool open_PerfCounters(PerfCounters *perf) {
+
+    assert(perf != NULL);
+    assert(perf->num_open == 0);
+
+    if (open_perf_event(perf, PERF_CYCLES, -1)) {
+        int leader = perf->fds[PERF_CYCLES];
+
+        open_perf_event(perf, PERF_INSTRUCTIONS, leader);
+        open_perf_event(perf, PERF_CACHE_MISSES, leader);
+        open_perf_event(perf, PERF_BRANCH_MISSES, leader);
+        open_perf_event(perf, PERF_TASK_CLOCK, leader);
+    } else {
+        open_perf_event(perf, PERF_TASK_CLOCK, -1);
+    }
+
+    return perf->num_open > 0;
+}
+
+
+/**
+ * @brief  Close the counters (the leader of the group last), the counts of
+ *         the stages are kept
+ *
+ * @param  perf   the counters
+ */
+void close_PerfCounters(PerfCounters *perf) {
+
+    assert(perf != NULL);
+
+    for (int i = perf->num_open - 1; i >= 0; i--) {
+        close(perf->fds[perf->order[i]]);
+        perf->fds[perf->order[i]] = -1;
+    }
+    perf->num_open = 0;
+}
+
+
+/**
+ * @brief  Read the counters as a stage is started
+ *
+ * @param  perf   the counters, or NULL if they are not kept
+ * @param  start  the values when the stage is started, will be updated
+ */
+void perf_stage_begin(PerfCounters *perf, PerfSample *start) {
+
+    start->isRead = perf != NULL && read_perf_sample(perf, start);
+}
+
+
+/**
+ * @brief  Read the counters as a stage is ended, and add the counts since
+ *         it is started to the stage
+ *
+ * @param  perf   the counters, or NULL if they are not kept
+ * @param  stage  the stage
+ * @param  start  the values when the stage is started
+ */
+void perf_stage_end(PerfCounters *perf, PerfStage stage, PerfSample *start) {
+
+    PerfSample end;
+
+    if (perf == NULL || !start->isRead || !read_perf_sample(perf, &end)) {
+        return;
+    }
+
+    for (int i = 0; i < NUM_PERF_EVENTS; i++) {
+        perf->counts[stage][i] += end.values[i] - start->values[i];
+    }
+    perf->calls[stage]++;
+}
+
+
+/**
+ * @brief  Count a page parsed and the bytes of its HTML, the counts of the
+ *         stages are divided by them
+ *
+ * @param  perf       the counters, or NULL if they are not kept
+ * @param  html_len   the bytes of the HTML of the page
+ */
+void perf_count_page(PerfCounters *perf, int html_len) {
+
+    if (perf == NULL) {
+        return;
+    }
+
+    perf->pages++;
+    perf->html_bytes += html_len;
+}
+
+
+/**
+ * @brief  Add the counts of a worker into another, once the worker is
+ *         stopped
+ *
+ * @param  dest   the counters added into
+ * @param  src    the counters added
+ */
+void perf_counters_merge(PerfCounters *dest, PerfCounters *src) {
+
+    assert(dest != NULL);
+    assert(src != NULL);
+
+    dest->pages      += src->pages;
+    dest->html_bytes += src->html_bytes;
+    for (int i = 0; i < NUM_PERF_EVENTS; i++) {
+        dest->isCounted[i] = dest->isCounted[i] || src->isCounted[i];
+    }
+    for (int i = 0; i < NUM_STAGES; i++) {
+        dest->calls[i] += src->calls[i];
+        for (int j = 0; j < NUM_PERF_EVENTS; j++) {
+            dest->counts[i][j] += src->counts[i][j];
+        }
+    }
+    if (dest->open_errno == 0) {
+        dest->open_errno = src->open_errno;
+    }
+}
+
+
+/**
+ * @brief  Print out the pages and KB of HTML parsed, then for each stage
+ *         the number of times it is counted, its CPU time per page, its
+ *         cycles per page and per KB, its instructions per cycle, and its
+ *         cache and branch misses per KB (n/a if they are not counted)
+ *
+ * @param  perf   the counters
+ * @param  fp     the file to print into
+ */
+void print_perf_report(PerfCounters *perf, FILE *fp) {
+
+    assert(perf != NULL);
+
+    double pages = (perf->pages > 0) ? (double)perf->pages : 1.0;
+    double kbs   = (perf->html_bytes > 0) ? perf->html_bytes / BYTES_PER_KB
+                                          : 1.0;
+
+    fprintf(fp, "perf: %ld pages, %.1f KB of HTML", perf->pages,
+            perf->html_bytes / BYTES_PER_KB);
+    if (!perf->isCounted[PERF_CYCLES] && perf->open_errno != 0) {
+        fprintf(fp, ", hardware counters not available (%s)",
+                strerror(perf->open_errno));
+    }
+    fprintf(fp, "\n");
+
+    for (int i = 0; i < NUM_STAGES; i++) {
+        uint64_t *counts = perf->counts[i];
+        bool isIpc = perf->isCounted[PERF_CYCLES]
+                  && perf->isCounted[PERF_INSTRUCTIONS]
+                  && counts[PERF_CYCLES] > 0;
+
+        fprintf(fp, "perf %s: %ld calls", stage_names[i], perf->calls[i]);
+        print_per_unit(fp, perf->isCounted[PERF_TASK_CLOCK],
+                       counts[PERF_TASK_CLOCK] / NS_PER_US, pages,
+                       "us/page");
+        print_per_unit(fp, perf->isCounted[PERF_CYCLES],
+                       counts[PERF_CYCLES], pages, "cycles/page");
+        print_per_unit(fp, perf->isCounted[PERF_CYCLES],
+                       counts[PERF_CYCLES], kbs, "cycles/KB");
+        print_per_unit(fp, isIpc, counts[PERF_INSTRUCTIONS],
+                       isIpc ? counts[PERF_CYCLES] : 1.0, "IPC");
+        print_per_unit(fp, perf->isCounted[PERF_CACHE_MISSES],
+                       counts[PERF_CACHE_MISSES], kbs, "cache-misses/KB");
+        print_per_unit(fp, perf->isCounted[PERF_BRANCH_MISSES],
+                       counts[PERF_BRANCH_MISSES], kbs, "branch-misses/KB");
+        fprintf(fp, "\n");
+    }
+}
+
+
+// ============================================================================
+// == | Auxillary Functions
+// ============================================================================
+/**
+ * @brief  Open an event counting the user space of the calling thread on
+ *         any CPU, into a group read together (or as its leader)
+ *
+ * @param  perf       the counters
+ * @param  event      the event
+ * @param  group_fd   the leader of the group, or -1 to lead a group
+ * @return true       If the event is opened
+ * @return false      If it is not available (the first error is kept)
+ */
+bool open_perf_event(PerfCounters *perf, PerfEvent event, int group_fd) {
+
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof attr);
+    attr.type           = perf_types[event];
+    attr.size           = sizeof attr;
+    attr.config         = perf_configs[event];
+    attr.read_format    = PERF_FORMAT_GROUP;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+
+    int fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+    if (fd < 0) {
+        if (perf->open_errno == 0) {
+            perf->open_errno = errno;
+        }
+        return false;
+    }
+
+    perf->fds[event]              = fd;
+    perf->order[perf->num_open++] = event;
+    perf->isCounted[event]        = true;
+
+    return true;
+}
+
+
+/**
+ * @brief  Read the values of the counters open with one read of the group,
+ *         the events not open are 0
+ *
+ * @param  perf     the counters
+ * @param  sample   the values read, will be updated
+ * @return true     If the values are read
+ * @return false    If no counter is open, or the read failed
+ */
+bool read_perf_sample(PerfCounters *perf, PerfSample *sample) {
+
+    // The number of values, then the value of each event in the group
+    uint64_t buffer[NUM_PERF_EVENTS + 1];
+
+    if (perf->num_open == 0) {
+        return false;
+    }
+
+    ssize_t expected = (ssize_t)((perf->num_open + 1) * sizeof(uint64_t));
+    if (read(perf->fds[perf->order[0]], buffer, sizeof buffer) < expected) {
+        return false;
+    }
+
+    memset(sample->values, 0, sizeof sample->values);
+    for (int i = 0; i < perf->num_open; i++) {
+        sample->values[perf->order[i]] = buffer[i + 1];
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief  Print out a count divided by its units, or n/a if the event is
+ *         not counted
+ *
+ * @param  fp         the file to print into
+ * @param  isCounted  if the event is counted
+ * @param  count      the count
+ * @param  units      the units (pages, KB or cycles) it is divided by
+ * @param  name       the name of the value
+ */
+void print_per_unit(FILE *fp, bool isCounted, double count, double units,
+                    char *name) {
+
+    if (!isCounted) {
+        fprintf(fp, ", n/a %s", name);
+    } else {
+        fprintf(fp, ", %.2f %s", count / units, name);
+    }
+}
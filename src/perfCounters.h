@@ -0,0 +1,102 @@
+/**
+ * @file      perfCounters.h
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     Hardware performance counters module. It includes
+ *              1. creating the counters of a crawl worker, and opening them
+ *                 (with perf_event_open) for the thread of the worker
+ *              2. reading the counters before and after each stage of the
+ *                 crawl, and adding up the counts of each stage
+ *              3. merging the counts of the workers, and printing them out
+ *                 per page and per KB of HTML
+ *            The counters of a thread are opened as one group (cycles,
+ *            instructions, cache misses, branch misses and the CPU time of
+ *            the thread), so they are read together with a single read.
+ *            The hardware counters are not available everywhere (e.g. in a
+ *            virtual machine), then only the CPU time is counted.
+ *            A stage is counted inclusively: the URLs parsed and inserted
+ *            into the frontier while a page is parsed are counted in the
+ *            stage of parsing the page as well
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+/**
+ * @brief  The stages of the crawl counted
+ */
+typedef enum {
+    STAGE_PARSE_HTML,
+    STAGE_HEADER,
+    STAGE_PARSE_URL,
+    STAGE_DEDUP,
+    NUM_STAGES
+} PerfStage;
+
+/**
+ * @brief  The events counted for a stage
+ */
+typedef enum {
+    PERF_TASK_CLOCK,
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_CACHE_MISSES,
+    PERF_BRANCH_MISSES,
+    NUM_PERF_EVENTS
+} PerfEvent;
+
+typedef struct perf_counters PerfCounters;
+
+typedef struct perf_sample PerfSample;
+/**
+ * @brief  A PerfSample include the value of each counter when a stage is
+ *         started, and if they are read
+ */
+struct perf_sample {
+    uint64_t values[NUM_PERF_EVENTS];
+    bool isRead;
+};
+
+
+// ============================================================================
+// == | Module Functions
+// ============================================================================
+// Create the counters of a worker, not opened yet
+PerfCounters *new_PerfCounters();
+
+// Close the counters and free their memory
+void free_PerfCounters(PerfCounters *perf);
+
+// Open the counters for the calling thread
+bool open_PerfCounters(PerfCounters *perf);
+
+// Close the counters, the counts are kept
+void close_PerfCounters(PerfCounters *perf);
+
+// Read the counters as a stage is started (NULL counters are ignored)
+void perf_stage_begin(PerfCounters *perf, PerfSample *start);
+
+// Add the counts since a stage is started to it (NULL counters are ignored)
+void perf_stage_end(PerfCounters *perf, PerfStage stage, PerfSample *start);
+
+// Count a page parsed and the bytes of its HTML (NULL counters are ignored)
+void perf_count_page(PerfCounters *perf, int html_len);
+
+// Add the counts of a worker into another
+void perf_counters_merge(PerfCounters *dest, PerfCounters *src);
+
+// Print out the counts of each stage per page and per KB of HTML
+void print_perf_report(PerfCounters *perf, FILE *fp);
+
+
+#endif
@@ -4,9 +4,13 @@
  * @brief     Implementation of Response related information module. It includes
  *              1. creating a new responseInfo data
  *              2. destory a responseInfo data
- *            The responseInfo include response header, content, status code
+ *            The responseInfo include the whole response received, 
+ *            response header, content, status code
  *            content length (if has), content type (if has and is "text/html"), 
  *            redirect link location (if has)
+ *            The header, content and redirect link are views (pointer and
+ *            length) into the response received, which is the only memory
+ *            owned by the responseInfo besides itself
  *
  * @copyright created for COMP30023 Computer System 2020
  *
@@ -37,12 +41,15 @@ ResponseInfo *new_ResponseInfo() {
     }
 
     // Initalise value of the responseInfo data
-    resp->header       = NULL;
+    resp->buffer       = NULL;
+    resp->header_len   = 0;
     resp->content      = NULL;
     resp->content_type = NULL;
     resp->redirect_loc = NULL;
+    resp->redirect_len = 0;
     resp->status_code  = 0;
     resp->content_len  = -1;
+    resp->isTruncated  = false;
 
     return resp;
 }
@@ -59,9 +66,8 @@ void free_ResponseInfo(ResponseInfo *resp) {
     assert(resp != NULL);
 
     // Free the memory associated with a responseInfo
-    free(resp->header);
-    free(resp->redirect_loc);
-    resp->header       = NULL;
+    free(resp->buffer);
+    resp->buffer       = NULL;
     resp->content      = NULL;
     resp->content_type = NULL;
     resp->redirect_loc = NULL;
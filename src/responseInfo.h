@@ -4,9 +4,13 @@
  * @brief     Response related information module. It includes
  *              1. creating a new responseInfo data
  *              2. destory a responseInfo data
- *            The responseInfo include response header, content, status code
+ *            The responseInfo include the whole response received, 
+ *            response header, content, status code
  *            content length (if has), content type (if has and is "text/html"), 
  *            redirect link location (if has)
+ *            The header, content and redirect link are views (pointer and
+ *            length) into the response received, which is the only memory
+ *            owned by the responseInfo besides itself
  *
  * @copyright created for COMP30023 Computer System 2020
  *
@@ -15,23 +19,34 @@
 #ifndef RESPONSEINFO_H
 #define RESPONSEINFO_H
 
+#include "httpHeader.h"
+
+#include <stdbool.h>
+
 
 // ============================================================================
 // == | Data Type Definitions
 // ============================================================================
 typedef struct http_response ResponseInfo;
 /**
- * @brief  A responseInfo include response header, content, status code
- *            content length (if has), content type (if has and is "text/html"), 
- *            redirect link location (if has)
+ * @brief  A responseInfo include the whole response received (which the
+ *            other fields point into), response header length and its 
+ *            fields, content, status code, content length, if the content 
+ *            is truncated (as it is over the maximum kept), content type 
+ *            (if has and is "text/html"), redirect link location and its 
+ *            length (if has)
  */
 struct http_response {
-    char *header;
+    char *buffer;
+    int header_len;
+    HttpHeader header;
     int status_code;
     int content_len;
+    bool isTruncated;
     char *content;
     char *content_type;
     char *redirect_loc;
+    int redirect_len;
 };
 
 
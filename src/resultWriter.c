@@ -0,0 +1,420 @@
+/**
+ * @file      resultWriter.c
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     Implementation of result writer module. It includes
+ *              1. creating a writer of the results of the crawl into a file
+ *                 (or stdout), and destroying it
+ *              2. writing the result of each fetch into a buffer as it is
+ *                 fetched, in one of the formats
+ *              3. writing the buffer into the file in large blocks, once it
+ *                 is full or it is flushed
+ *            A result is formatted straight into the buffer: the buffer is
+ *            written out first if the result may not fit, and grown if it
+ *            may not fit an empty buffer either (a very long URL). The
+ *            fields of a binary record over their size are clamped
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#include "resultWriter.h"
+
+#include "urlInfo.h"
+#include "utilities.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+
+// ============================================================================
+// == | Constant Definitions
+// ============================================================================
+#define BINARY_MAGIC        "CRAWLRS1"
+#define BINARY_MAGIC_LEN    8
+#define BINARY_HEAD_BYTES   20
+#define JSON_FIELDS_BYTES   160
+#define JSON_ESCAPE_BYTES   6
+#define OUTPUT_MODE         0644
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+/**
+ * @brief  A writer include the file written into (and if it is opened by
+ *         the writer), the format, the buffer (its size and how much is
+ *         used), the number of results, bytes and writes into the file, if
+ *         a write failed (the results are dropped from then on), and the
+ *         lock guarding them
+ */
+struct result_writer {
+    int fd;
+    bool isOpened;
+    OutputFormat format;
+    char *buffer;
+    int buffer_size;
+    int buffer_used;
+    long records;
+    long written;
+    long writes;
+    bool isFailed;
+    pthread_mutex_t lock;
+};
+
+
+// ============================================================================
+// == | Function Prototypes
+// ============================================================================
+// Make room in the buffer for a result of the given size at most
+void reserve_result_bytes(ResultWriter *writer, int max_len);
+
+// Write the buffer into the file, with the lock of the writer held
+void write_result_buffer(ResultWriter *writer);
+
+// Format a result as a JSON object line at the end of the buffer
+void append_json_result(ResultWriter *writer, FetchRecord *record);
+
+// Format a result as a binary record at the end of the buffer
+void append_binary_result(ResultWriter *writer, FetchRecord *record);
+
+// Put an unsigned integer at the end of the buffer in little-endian
+void append_le(ResultWriter *writer, unsigned long long value, int bytes,
+               unsigned long long max);
+
+
+// ============================================================================
+// == | Global Variables
+// ============================================================================
+// The names of the formats (in the order of OutputFormat)
+static const char *format_names[] = {"plain", "jsonl", "binary"};
+
+
+// ============================================================================
+// == | Module Functions
+// ============================================================================
+/**
+ * @brief  Create a writer of the results into a file (truncated), or into
+ *         stdout. A binary file starts with its magic
+ *
+ * @param  path     the path of the file, or NULL for stdout
+ * @param  format   the format of the results
+ * @return          the pointer of new writer
+ */
+ResultWriter *new_ResultWriter(char *path, OutputFormat format) {
+
+    int fd = STDOUT_FILENO;
+    if (path != NULL) {
+        fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                  OUTPUT_MODE);
+        if (fd < 0) {
+            perror(path);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    ResultWriter *writer = (ResultWriter *)malloc(sizeof *writer);
+    char *buffer = (char *)malloc(RESULT_BUFFER_BYTES);
+    if (writer == NULL || buffer == NULL) {
+        fprintf(stderr, "Error: new_ResultWriter() malloc returned NULL\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Initalise value of the writer
+    writer->fd          = fd;
+    writer->isOpened    = path != NULL;
+    writer->format      = format;
+    writer->buffer      = buffer;
+    writer->buffer_size = RESULT_BUFFER_BYTES;
+    writer->buffer_used = 0;
+    writer->records     = 0;
+    writer->written     = 0;
+    writer->writes      = 0;
+    writer->isFailed    = false;
+    pthread_mutex_init(&writer->lock, NULL);
+
+    if (format == FORMAT_BINARY) {
+        memcpy(writer->buffer, BINARY_MAGIC, BINARY_MAGIC_LEN);
+        writer->buffer_used = BINARY_MAGIC_LEN;
+    }
+
+    return writer;
+}
+
+
+/**
+ * @brief  Write the results left, and destroy and free the memory
+ *         associated with a writer (closing the file it opened)
+ *
+ * @param  writer   a result writer
+ */
+void free_ResultWriter(ResultWriter *writer) {
+
+    assert(writer != NULL);
+
+    flush_ResultWriter(writer);
+    if (writer->isOpened) {
+        close(writer->fd);
+    }
+
+    pthread_mutex_destroy(&writer->lock);
+    free(writer->buffer);
+    writer->buffer = NULL;
+
+    free(writer);
+    writer = NULL;
+}
+
+
+/**
+ * @brief  Write the result of a fetch in the format of the writer into the
+ *         buffer (a plain result is only the URL)
+ *
+ * @param  writer   a result writer
+ * @param  record   the result of a fetch
+ */
+void write_result(ResultWriter *writer, FetchRecord *record) {
+
+    assert(writer != NULL);
+    assert(record != NULL && record->url != NULL);
+
+    UrlInfo *url = record->url;
+    int url_len  = strlen(HTTP_HEADER) + strlen(url->hostname)
+                 + strlen(url->filepath);
+
+    pthread_mutex_lock(&writer->lock);
+
+    if (writer->format == FORMAT_PLAIN) {
+        reserve_result_bytes(writer, url_len + 2);
+        writer->buffer_used += sprintf(writer->buffer + writer->buffer_used,
+                                       "%s%s%s\n", HTTP_HEADER,
+                                       url->hostname, url->filepath);
+    } else if (writer->format == FORMAT_JSONL) {
+        reserve_result_bytes(writer, JSON_FIELDS_BYTES
+                                     + url_len * JSON_ESCAPE_BYTES);
+        append_json_result(writer, record);
+    } else {
+        reserve_result_bytes(writer, BINARY_HEAD_BYTES + url_len + 1);
+        append_binary_result(writer, record);
+    }
+    writer->records++;
+
+    pthread_mutex_unlock(&writer->lock);
+}
+
+
+/**
+ * @brief  Write the results buffered into the file
+ *
+ * @param  writer   a result writer
+ */
+void flush_ResultWriter(ResultWriter *writer) {
+
+    assert(writer != NULL);
+
+    pthread_mutex_lock(&writer->lock);
+    write_result_buffer(writer);
+    pthread_mutex_unlock(&writer->lock);
+}
+
+
+/**
+ * @brief  Get the format of the name given (plain, jsonl or binary)
+ *
+ * @param  name     the name of a format
+ * @param  format   the format, will be updated
+ * @return true     If the name is a format
+ * @return false    If it is not
+ */
+bool parse_output_format(char *name, OutputFormat *format) {
+
+    for (int i = FORMAT_PLAIN; i <= FORMAT_BINARY; i++) {
+        if (strcmp(name, format_names[i]) == SUCCESS) {
+            *format = (OutputFormat)i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/**
+ * @brief  Print out the statistics of the writer: the results and bytes
+ *         written, and the writes into the file
+ *
+ * @param  writer   a result writer
+ * @param  fp       the file to print into
+ */
+void print_result_writer_stats(ResultWriter *writer, FILE *fp) {
+
+    assert(writer != NULL);
+
+    pthread_mutex_lock(&writer->lock);
+    fprintf(fp, "output: %ld %s results, %ld bytes in %ld writes%s\n",
+            writer->records, format_names[writer->format], writer->written,
+            writer->writes, writer->isFailed ? " (failed)" : "");
+    pthread_mutex_unlock(&writer->lock);
+}
+
+
+// ============================================================================
+// == | Auxillary Functions
+// ============================================================================
+/**
+ * @brief  Make room in the buffer for a result of the given size at most:
+ *         write the buffer into the file if it is not enough, and grow it
+ *         if the result is larger than the buffer
+ *
+ * @param  writer     a result writer
+ * @param  max_len    the size of the result at most
+ */
+void reserve_result_bytes(ResultWriter *writer, int max_len) {
+
+    if (writer->buffer_used + max_len <= writer->buffer_size) {
+        return;
+    }
+
+    write_result_buffer(writer);
+    if (max_len <= writer->buffer_size) {
+        return;
+    }
+
+    writer->buffer = (char *)realloc(writer->buffer, max_len);
+    if (writer->buffer == NULL) {
+        fprintf(stderr, "Error: reserve_result_bytes() realloc returned "
+                        "NULL\n");
+        exit(EXIT_FAILURE);
+    }
+    writer->buffer_size = max_len;
+}
+
+
+/**
+ * @brief  Write the buffer into the file (all of it, as a write may be
+ *         partial), with the lock of the writer held. If a write fails, the
+ *         results are dropped from then on
+ *
+ * @param  writer   a result writer
+ */
+void write_result_buffer(ResultWriter *writer) {
+
+    int offset = 0;
+
+    while (offset < writer->buffer_used && !writer->isFailed) {
+        ssize_t nbytes = write(writer->fd, writer->buffer + offset,
+                               writer->buffer_used - offset);
+        if (nbytes < 0 && errno == EINTR) {
+            continue;
+        }
+        if (nbytes < 0) {
+            perror("ERROR writing the results");
+            writer->isFailed = true;
+            break;
+        }
+        offset          += nbytes;
+        writer->written += nbytes;
+        writer->writes++;
+    }
+
+    writer->buffer_used = 0;
+}
+
+
+/**
+ * @brief  Format a result as a JSON object line at the end of the buffer,
+ *         escaping the quotation marks, backslashes and control characters
+ *         of the URL
+ *
+ * @param  writer   a result writer (with room for the line)
+ * @param  record   the result of a fetch
+ */
+void append_json_result(ResultWriter *writer, FetchRecord *record) {
+
+    char *out = writer->buffer + writer->buffer_used;
+    UrlInfo *url = record->url;
+    char *parts[] = {HTTP_HEADER, url->hostname, url->filepath};
+
+    out += sprintf(out, "{\"url\":\"");
+    for (int i = 0; i < 3; i++) {
+        for (char *str = parts[i]; *str != NULL_TERMINATED; str++) {
+            unsigned char c = (unsigned char)*str;
+
+            if (c == '"' || c == '\\') {
+                *out++ = '\\';
+                *out++ = c;
+            } else if (c < 0x20) {
+                out += sprintf(out, "\\u%04x", c);
+            } else {
+                *out++ = c;
+            }
+        }
+    }
+    out += sprintf(out, "\",\"status\":%d,\"bytes\":%d,\"start_ms\":%lld,"
+                        "\"elapsed_us\":%lld,\"worker\":%d}\n",
+                   record->status_code, record->bytes, record->start_ms,
+                   record->elapsed_us, record->worker);
+
+    writer->buffer_used = out - writer->buffer;
+}
+
+
+/**
+ * @brief  Format a result as a binary record at the end of the buffer
+ *
+ * @param  writer   a result writer (with room for the record)
+ * @param  record   the result of a fetch
+ */
+void append_binary_result(ResultWriter *writer, FetchRecord *record) {
+
+    UrlInfo *url = record->url;
+    int url_len  = strlen(HTTP_HEADER) + strlen(url->hostname)
+                 + strlen(url->filepath);
+
+    append_le(writer, url_len, 2, UINT16_MAX);
+    append_le(writer, record->status_code, 2, UINT16_MAX);
+    append_le(writer, record->bytes, 4, UINT32_MAX);
+    append_le(writer, record->start_ms, 4, UINT32_MAX);
+    append_le(writer, record->elapsed_us, 4, UINT32_MAX);
+    append_le(writer, record->worker, 2, UINT16_MAX);
+    append_le(writer, 0, 2, UINT16_MAX);
+
+    // The URL is cut to the length recorded, the NULL terminator of the
+    // formatting is overwritten by the next record
+    snprintf(writer->buffer + writer->buffer_used,
+             (url_len > UINT16_MAX ? UINT16_MAX : url_len) + 1, "%s%s%s",
+             HTTP_HEADER, url->hostname, url->filepath);
+    writer->buffer_used += (url_len > UINT16_MAX) ? UINT16_MAX : url_len;
+}
+
+
+/**
+ * @brief  Put an unsigned integer at the end of the buffer in little-endian
+ *         (negative values are 0, values over the maximum are the maximum)
+ *
+ * @param  writer   a result writer (with room for the integer)
+ * @param  value    the value
+ * @param  bytes    the size of the integer in bytes
+ * @param  max      the maximum value of the integer
+ */
+void append_le(ResultWriter *writer, unsigned long long value, int bytes,
+               unsigned long long max) {
+
+    if ((long long)value < 0) {
+        value = 0;
+    } else if (value > max) {
+        value = max;
+    }
+
+    for (int i = 0; i < bytes; i++) {
+        writer->buffer[writer->buffer_used++] = (char)(value & 0xff);
+        value >>= 8;
+    }
+}
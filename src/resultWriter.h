@@ -0,0 +1,96 @@
+/**
+ * @file      resultWriter.h
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     Result writer module. It includes
+ *              1. creating a writer of the results of the crawl into a file
+ *                 (or stdout), and destroying it
+ *              2. writing the result of each fetch into a buffer as it is
+ *                 fetched, in one of the formats
+ *              3. writing the buffer into the file in large blocks, once it
+ *                 is full or it is flushed
+ *            The formats are:
+ *              plain   a URL per line (as the crawler always prints)
+ *              jsonl   a JSON object per line, with the URL, status code,
+ *                      bytes received, start (in ms since the crawl is
+ *                      started), time to fetch (in us) and worker
+ *              binary  the magic "CRAWLRS1", then a record per fetch of
+ *                      little-endian fields: u16 URL length, u16 status
+ *                      code, u32 bytes received, u32 start, u32 time to
+ *                      fetch, u16 worker, u16 reserved (0), and the URL
+ *                      (not NULL terminated)
+ *            The writer is shared by the crawl threads, each call holds the
+ *            writer lock
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#ifndef RESULTWRITER_H
+#define RESULTWRITER_H
+
+#include "urlInfo.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+
+
+// ============================================================================
+// == | Constant Definitions
+// ============================================================================
+#define RESULT_BUFFER_BYTES     65536
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+/**
+ * @brief  The formats of the results
+ */
+typedef enum {
+    FORMAT_PLAIN,
+    FORMAT_JSONL,
+    FORMAT_BINARY
+} OutputFormat;
+
+typedef struct result_writer ResultWriter;
+
+typedef struct fetch_record FetchRecord;
+/**
+ * @brief  A FetchRecord include the URL fetched, the status code of its
+ *         response (0 if there is none), the bytes received, the time the
+ *         fetch is started (since the crawl is started), the time to fetch
+ *         it, and the worker fetching it
+ */
+struct fetch_record {
+    UrlInfo *url;
+    int status_code;
+    int bytes;
+    long long start_ms;
+    long long elapsed_us;
+    int worker;
+};
+
+
+// ============================================================================
+// == | Module Functions
+// ============================================================================
+// Create a writer of the results into a file (stdout if it is NULL)
+ResultWriter *new_ResultWriter(char *path, OutputFormat format);
+
+// Write the results left, and destroy a writer and free its memory
+void free_ResultWriter(ResultWriter *writer);
+
+// Write the result of a fetch in the format of the writer
+void write_result(ResultWriter *writer, FetchRecord *record);
+
+// Write the results buffered into the file
+void flush_ResultWriter(ResultWriter *writer);
+
+// Get the format of the name given, return false if there is none
+bool parse_output_format(char *name, OutputFormat *format);
+
+// Print out the statistics of the writer
+void print_result_writer_stats(ResultWriter *writer, FILE *fp);
+
+
+#endif
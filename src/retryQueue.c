@@ -0,0 +1,218 @@
+/**
+ * @file      retryQueue.c
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     Implementation of delayed retry queue module. It includes
+ *              1. creating and destroying a retry queue
+ *              2. adding a URL to be retried at a given time
+ *              3. taking the URLs whose time has come
+ *            The URLs are kept in a binary min-heap by the time they are
+ *            retried, which grows by doubling
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#include "retryQueue.h"
+
+#include "urlInfo.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <assert.h>
+
+
+// ============================================================================
+// == | Constant Definitions
+// ============================================================================
+#define RETRY_QUEUE_INIT_CAPACITY   16
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+typedef struct retry_entry RetryEntry;
+/**
+ * @brief  A URL waiting to be retried, and the time it is retried
+ */
+struct retry_entry {
+    long long due;
+    UrlInfo *url;
+};
+
+
+/**
+ * @brief  A retry queue is a heap of the URLs waiting to be retried
+ */
+struct retry_queue {
+    RetryEntry *heap;
+    int size;
+    int capacity;
+};
+
+
+// ============================================================================
+// == | Module Functions
+// ============================================================================
+/**
+ * @brief  Create a new empty retry queue
+ *
+ * @return  the pointer of new retry queue
+ */
+RetryQueue *new_RetryQueue() {
+
+    RetryQueue *queue = (RetryQueue *)malloc(sizeof *queue);
+    if (queue == NULL) {
+        fprintf(stderr, "Error: new_RetryQueue() malloc returned NULL\n");
+        exit(EXIT_FAILURE);
+    }
+
+    queue->heap = (RetryEntry *)malloc(RETRY_QUEUE_INIT_CAPACITY
+                                       * sizeof *queue->heap);
+    if (queue->heap == NULL) {
+        fprintf(stderr, "Error: new_RetryQueue() malloc returned NULL\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Initalise value of the retry queue
+    queue->size     = 0;
+    queue->capacity = RETRY_QUEUE_INIT_CAPACITY;
+
+    return queue;
+}
+
+
+/**
+ * @brief  Destroy and free the memory associated with a retry queue, and
+ *         the URLs left in it
+ *
+ * @param  queue  a retry queue
+ */
+void free_RetryQueue(RetryQueue *queue) {
+
+    assert(queue != NULL);
+
+    for (int i = 0; i < queue->size; i++) {
+        free_urlInfo(queue->heap[i].url);
+    }
+    free(queue->heap);
+    queue->heap = NULL;
+
+    free(queue);
+    queue = NULL;
+}
+
+
+/**
+ * @brief  Add a URL to be retried at the given time
+ *
+ * @param  queue  a retry queue
+ * @param  url    a UrlInfo data
+ * @param  due    the time it is retried (of the monotonic clock)
+ */
+void retry_queue_push(RetryQueue *queue, UrlInfo *url, long long due) {
+
+    assert(queue != NULL);
+    assert(url != NULL);
+
+    if (queue->size == queue->capacity) {
+        queue->capacity *= 2;
+        queue->heap = (RetryEntry *)realloc(queue->heap, queue->capacity
+                                            * sizeof *queue->heap);
+        if (queue->heap == NULL) {
+            fprintf(stderr, "Error: retry_queue_push() realloc returned "
+                            "NULL\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // Move the parents retried later down, until its place is found
+    int pos = queue->size++;
+    while (pos > 0) {
+        int parent = (pos - 1) / 2;
+
+        if (queue->heap[parent].due <= due) {
+            break;
+        }
+        queue->heap[pos] = queue->heap[parent];
+        pos = parent;
+    }
+
+    queue->heap[pos].due = due;
+    queue->heap[pos].url = url;
+}
+
+
+/**
+ * @brief  Remove and return the URL retried first, if its time has come
+ *
+ * @param  queue  a retry queue
+ * @param  now    the current time (of the monotonic clock)
+ * @return        the UrlInfo data, or NULL if no URL is due yet
+ */
+UrlInfo *retry_queue_pop_due(RetryQueue *queue, long long now) {
+
+    assert(queue != NULL);
+
+    if (queue->size == 0 || queue->heap[0].due > now) {
+        return NULL;
+    }
+
+    UrlInfo *url = queue->heap[0].url;
+    RetryEntry last = queue->heap[--queue->size];
+
+    // Move the children retried earlier up, until the place of the last
+    // entry is found
+    int pos = 0;
+    while (true) {
+        int child = 2 * pos + 1;
+
+        if (child >= queue->size) {
+            break;
+        }
+        if (child + 1 < queue->size
+            && queue->heap[child + 1].due < queue->heap[child].due) {
+            child++;
+        }
+        if (last.due <= queue->heap[child].due) {
+            break;
+        }
+        queue->heap[pos] = queue->heap[child];
+        pos = child;
+    }
+    queue->heap[pos] = last;
+
+    return url;
+}
+
+
+/**
+ * @brief  Get the time the next URL is retried
+ *
+ * @param  queue  a retry queue
+ * @return        the time (of the monotonic clock), or -1 if it is empty
+ */
+long long get_retry_queue_due(RetryQueue *queue) {
+
+    assert(queue != NULL);
+
+    if (queue->size == 0) {
+        return -1;
+    }
+
+    return queue->heap[0].due;
+}
+
+
+/**
+ * @brief  Get the number of URLs waiting to be retried
+ *
+ * @param  queue  a retry queue
+ * @return        the number of URLs
+ */
+int get_retry_queue_size(RetryQueue *queue) {
+
+    assert(queue != NULL);
+
+    return queue->size;
+}
@@ -0,0 +1,48 @@
+/**
+ * @file      retryQueue.h
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     Delayed retry queue module. It includes
+ *              1. creating and destroying a retry queue
+ *              2. adding a URL to be retried at a given time
+ *              3. taking the URLs whose time has come
+ *            The URLs are kept in a min-heap by the time they are retried
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#ifndef RETRYQUEUE_H
+#define RETRYQUEUE_H
+
+#include "urlInfo.h"
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+typedef struct retry_queue RetryQueue;
+
+
+// ============================================================================
+// == | Module Functions
+// ============================================================================
+// Create a new empty retry queue
+RetryQueue *new_RetryQueue();
+
+// Destroy a retry queue and free its memory (and the URLs left)
+void free_RetryQueue(RetryQueue *queue);
+
+// Add a URL to be retried at the given time
+void retry_queue_push(RetryQueue *queue, UrlInfo *url, long long due);
+
+// Remove and return a URL whose time has come, or NULL
+UrlInfo *retry_queue_pop_due(RetryQueue *queue, long long now);
+
+// Return the time the next URL is retried, or -1 if it is empty
+long long get_retry_queue_due(RetryQueue *queue);
+
+// Return the number of URLs waiting to be retried
+int get_retry_queue_size(RetryQueue *queue);
+
+
+#endif
@@ -2,8 +2,9 @@
  * @file      socketHandler.c
  * @author    Erya Wen (eryaw@student.unimelb.edu.au)
  * @brief     Implementation of socket connection module. It includes
- *              1. set up and connect socket 
- *              2. close the socket connection
+ *              1. set up and connect non-blocking socket 
+ *              2. check if the non-blocking connection succeeded
+ *              3. close the socket connection
  *
  * @copyright created for COMP30023 Computer System 2020
  *
@@ -11,11 +12,14 @@
 
 #include "socketHandler.h"
 
+#include "dnsCache.h"
+
 #include <stdio.h>
 #include <stdlib.h>
 
 #include <arpa/inet.h>
 #include <assert.h>
+#include <errno.h>
 #include <netdb.h>
 #include <netinet/in.h>
 #include <stdbool.h>
@@ -24,56 +28,55 @@
 #include <sys/types.h>
 #include <unistd.h>
 
-// ============================================================================
-// == | Constant Definitions 
-// ============================================================================
-#define SERVER_PORT 80
-
 // ============================================================================
 // == | Module Functions 
 // ============================================================================
 /**
- * @brief Set the up socket object and connect
+ * @brief  Set the up socket object and start connecting it.
+ *         The socket is non-blocking, so the connection may still be in 
+ *         progress when it returns (it is writable once connected)
  * 
  * @param  hostname     a string of hostname
- * @return              the socket conncection ID
+ * @param  port         the port of the server
+ * @param  dnsCache     the DNS cache used to resolve the hostname
+ * @return              the socket conncection ID, 
+ *                      or -1 if the hostname is invalid or connection fails
  */
-int setup_socket(char *hostname) {
+int setup_socket(char *hostname, int port, DnsCache *dnsCache) {
     
     int connfd;
 
     struct sockaddr_in serv_addr;
-    struct hostent *host_info;
+    struct in_addr host_addr;
 
-    // Create socket
-    connfd = socket(AF_INET, SOCK_STREAM, 0);
-    if (connfd < 0) {
-        perror("ERROR opening socket");
-        exit(EXIT_FAILURE);
+    // Get IP address from the hostname
+    // If the hostname is invalid, return -1
+    if (!dns_cache_resolve(dnsCache, hostname, &host_addr)) {
+        fprintf(stderr, "ERROR, no such host: %s\n", hostname);
+        return -1;
     }
 
-    // Get IP address from the hostname
-    // If the hostname is invalid, exits
-    host_info = gethostbyname(hostname);
-    if (host_info == NULL) {
-        fprintf(stderr, "ERROR, no such host\n");
+    // Create non-blocking socket
+    connfd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (connfd < 0) {
+        perror("ERROR opening socket");
         exit(EXIT_FAILURE);
     }
 
     // Set up the socket and host information
     bzero((char *)&serv_addr, sizeof(serv_addr));
     serv_addr.sin_family = AF_INET;
-    bcopy(host_info->h_addr_list[0], (char *)&serv_addr.sin_addr.s_addr,
-          host_info->h_length);
-    serv_addr.sin_port = htons(SERVER_PORT);
+    serv_addr.sin_addr = host_addr;
+    serv_addr.sin_port = htons(port);
 
-    // Connect the socket
-    // If the connection fails, exits
+    // Start connecting the socket
+    // If the connection fails immediately, return -1
     if (connect(connfd, (struct sockaddr *)&serv_addr,
                 sizeof(struct sockaddr_in))
-        < 0) {
+        < 0 && errno != EINPROGRESS) {
         perror("ERROR connecting");
-        exit(EXIT_FAILURE);
+        close_socket(connfd);
+        return -1;
     }
 
     // Return the socket connection ID
@@ -81,6 +84,32 @@ int setup_socket(char *hostname) {
 }
 
 
+/**
+ * @brief  Get the result of a non-blocking connection once it is writable
+ * 
+ * @param  connfd   the socket connection ID
+ * @return true     If the socket is connected
+ * @return false    If the connection fails
+ */
+bool socket_connected(int connfd) {
+
+    int error = 0;
+    socklen_t len = sizeof(error);
+
+    if (getsockopt(connfd, SOL_SOCKET, SO_ERROR, &error, &len) < 0) {
+        perror("ERROR getting socket status");
+        return false;
+    }
+
+    if (error != 0) {
+        fprintf(stderr, "ERROR connecting: %s\n", strerror(error));
+        return false;
+    }
+
+    return true;
+}
+
+
 /**
  * @brief  Close the socket connectoin
  * 
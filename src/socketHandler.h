@@ -2,8 +2,9 @@
  * @file      socketHandler.h
  * @author    Erya Wen (eryaw@student.unimelb.edu.au)
  * @brief     Socket connection module. It includes
- *              1. set up and connect socket 
- *              2. close the socket connection
+ *              1. set up and connect non-blocking socket 
+ *              2. check if the non-blocking connection succeeded
+ *              3. close the socket connection
  *
  * @copyright created for COMP30023 Computer System 2020
  *
@@ -12,11 +13,19 @@
 #ifndef SOCKETHANDLER_H
 #define SOCKETHANDLER_H
 
+#include "dnsCache.h"
+
+#include <stdbool.h>
+
+
 // ============================================================================
 // == | Module Functions
 // ============================================================================
-// Set the up socket object and connect
-int setup_socket(char *hostname);
+// Set the up non-blocking socket object and start connecting
+int setup_socket(char *hostname, int port, DnsCache *dnsCache);
+
+// Get the result of a non-blocking connection once it is writable
+bool socket_connected(int connfd);
 
 // Close the socket connectoin
 void close_socket(int connfd);
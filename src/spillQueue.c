@@ -0,0 +1,484 @@
+/**
+ * @file      spillQueue.c
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     Implementation of disk-backed spill queue module. It includes
+ *              1. creating and destroying a spill queue in a directory
+ *              2. appending a URL as a compact binary record
+ *              3. reading the URLs back in the order they are appended
+ *              4. reporting the spill statistics
+ *            The records are appended to the tail segment file, mapped
+ *            into memory. Once it is full, it is unmapped (its pages are
+ *            written back by the kernel) and a new segment is started. The
+ *            head segment is mapped again to read its records sequentially,
+ *            and removed once they are all read. A segment ends at a record
+ *            with an empty hostname (or where no more record fits), and
+ *            when the queue is empty the segment read and written is reused
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#include "spillQueue.h"
+
+#include "urlInfo.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <assert.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+
+// ============================================================================
+// == | Constant Definitions
+// ============================================================================
+#define SPILL_SEGMENT_SIZE      (4 << 20)
+#define SPILL_RECORD_ALIGN      8
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+typedef struct spill_record SpillRecord;
+/**
+ * @brief  The record of a URL in a segment file, it is followed by the
+ *         hostname and the filepath (not NULL terminated), and padded to
+ *         the alignment of the records
+ */
+struct spill_record {
+    uint64_t hash;
+    uint32_t id;
+    uint16_t hostname_len;
+    uint16_t filepath_len;
+    uint16_t retries;
+    uint8_t isAuthorization;
+    uint8_t reserved;
+};
+
+
+/**
+ * @brief  A spill queue include the directory and id naming its segment
+ *         files, the head segment (read) and the tail segment (written)
+ *         with their mappings and offsets, the number of URLs in it, and
+ *         the URLs and bytes spilled and reloaded so far
+ */
+struct spill_queue {
+    char *dir;
+    int id;
+    int head_seg;
+    char *head_map;
+    size_t head_off;
+    int tail_seg;
+    char *tail_map;
+    size_t tail_off;
+    long size;
+    long spilled;
+    long reloaded;
+    long long spilled_bytes;
+    long long reloaded_bytes;
+    int segments;
+};
+
+
+// ============================================================================
+// == | Function Prototypes
+// ============================================================================
+// Get the path of a segment file
+void get_segment_path(SpillQueue *queue, int seg, char *path);
+
+// Start a new tail segment file, and map it for writing
+void open_tail_segment(SpillQueue *queue);
+
+// Mark the end of the tail segment, and unmap it unless it is being read
+void seal_tail_segment(SpillQueue *queue);
+
+// Map the head segment for reading
+void open_head_segment(SpillQueue *queue);
+
+// Unmap and remove the head segment once all its records are read
+void close_head_segment(SpillQueue *queue);
+
+// Get the size of the record of a URL (padded to the alignment)
+size_t get_record_size(size_t hostname_len, size_t filepath_len);
+
+
+// ============================================================================
+// == | Module Functions
+// ============================================================================
+/**
+ * @brief  Create a new empty spill queue. No segment file is created until
+ *         the first URL is spilled
+ *
+ * @param  dir    the directory of the segment files (not copied)
+ * @param  id     the id of the queue, naming its segment files
+ * @return        the pointer of new spill queue
+ */
+SpillQueue *new_SpillQueue(char *dir, int id) {
+
+    assert(dir != NULL);
+
+    if (access(dir, W_OK | X_OK) != 0) {
+        fprintf(stderr, "Error: new_SpillQueue() cannot write to %s\n", dir);
+        exit(EXIT_FAILURE);
+    }
+
+    SpillQueue *queue = (SpillQueue *)malloc(sizeof *queue);
+    if (queue == NULL) {
+        fprintf(stderr, "Error: new_SpillQueue() malloc returned NULL\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Initalise value of the spill queue
+    queue->dir            = dir;
+    queue->id             = id;
+    queue->head_seg       = 0;
+    queue->head_map       = NULL;
+    queue->head_off       = 0;
+    queue->tail_seg       = -1;
+    queue->tail_map       = NULL;
+    queue->tail_off       = 0;
+    queue->size           = 0;
+    queue->spilled        = 0;
+    queue->reloaded       = 0;
+    queue->spilled_bytes  = 0;
+    queue->reloaded_bytes = 0;
+    queue->segments       = 0;
+
+    return queue;
+}
+
+
+/**
+ * @brief  Destroy and free the memory associated with a spill queue, and
+ *         remove the segment files left
+ *
+ * @param  queue  a spill queue
+ */
+void free_SpillQueue(SpillQueue *queue) {
+
+    char path[PATH_MAX];
+
+    assert(queue != NULL);
+
+    if (queue->head_map != NULL && queue->head_map != queue->tail_map) {
+        munmap(queue->head_map, SPILL_SEGMENT_SIZE);
+    }
+    if (queue->tail_map != NULL) {
+        munmap(queue->tail_map, SPILL_SEGMENT_SIZE);
+    }
+    queue->head_map = NULL;
+    queue->tail_map = NULL;
+
+    for (int seg = queue->head_seg; seg <= queue->tail_seg; seg++) {
+        get_segment_path(queue, seg, path);
+        unlink(path);
+    }
+
+    free(queue);
+    queue = NULL;
+}
+
+
+/**
+ * @brief  Append a URL to the tail segment of the spill queue, starting a
+ *         new segment if it does not fit. The UrlInfo data is not freed
+ *
+ * @param  queue    a spill queue
+ * @param  url      a UrlInfo data
+ * @return true     If the URL is spilled
+ * @return false    If its hostname or filepath is too long for a record
+ */
+bool spill_queue_push(SpillQueue *queue, UrlInfo *url) {
+
+    assert(queue != NULL);
+    assert(url != NULL);
+
+    size_t hostname_len = strlen(url->hostname);
+    size_t filepath_len = strlen(url->filepath);
+    size_t size         = get_record_size(hostname_len, filepath_len);
+
+    if (hostname_len == 0 || hostname_len > UINT16_MAX
+        || filepath_len > UINT16_MAX || size > SPILL_SEGMENT_SIZE) {
+        return false;
+    }
+
+    if (queue->tail_map != NULL
+        && queue->tail_off + size > SPILL_SEGMENT_SIZE) {
+        seal_tail_segment(queue);
+    }
+    if (queue->tail_map == NULL) {
+        open_tail_segment(queue);
+    }
+
+    SpillRecord record = {
+        .hash            = url->hash,
+        .id              = url->id,
+        .hostname_len    = (uint16_t)hostname_len,
+        .filepath_len    = (uint16_t)filepath_len,
+        .retries         = url->retries,
+        .isAuthorization = url->isAuthorization,
+        .reserved        = 0
+    };
+
+    char *dest = queue->tail_map + queue->tail_off;
+    memcpy(dest, &record, sizeof record);
+    memcpy(dest + sizeof record, url->hostname, hostname_len);
+    memcpy(dest + sizeof record + hostname_len, url->filepath, filepath_len);
+
+    queue->tail_off      += size;
+    queue->size          += 1;
+    queue->spilled       += 1;
+    queue->spilled_bytes += size;
+
+    return true;
+}
+
+
+/**
+ * @brief  Remove and return the oldest URL of the spill queue, read from
+ *         the head segment (moving to the next segment once it ends)
+ *
+ * @param  queue    a spill queue
+ * @return          a new UrlInfo data, or NULL if the queue is empty
+ */
+UrlInfo *spill_queue_pop(SpillQueue *queue) {
+
+    SpillRecord record;
+
+    assert(queue != NULL);
+
+    if (queue->size == 0) {
+        return NULL;
+    }
+
+    while (true) {
+        if (queue->head_map == NULL) {
+            open_head_segment(queue);
+        }
+
+        if (queue->head_off + sizeof record <= SPILL_SEGMENT_SIZE) {
+            memcpy(&record, queue->head_map + queue->head_off,
+                   sizeof record);
+            if (record.hostname_len > 0) {
+                break;
+            }
+        }
+
+        // The head segment ends, read the next one
+        close_head_segment(queue);
+    }
+
+    char *src = queue->head_map + queue->head_off + sizeof record;
+    UrlInfo *url = new_UrlInfo(src, record.hostname_len,
+                               src + record.hostname_len,
+                               record.filepath_len);
+    url->isAuthorization = record.isAuthorization;
+    url->retries         = record.retries;
+    url->id              = record.id;
+    url->hash            = record.hash;
+
+    size_t size = get_record_size(record.hostname_len, record.filepath_len);
+    queue->head_off       += size;
+    queue->size           -= 1;
+    queue->reloaded       += 1;
+    queue->reloaded_bytes += size;
+
+    // Once every record is read, the segment written can be reused
+    if (queue->size == 0 && queue->head_map == queue->tail_map) {
+        queue->head_off = 0;
+        queue->tail_off = 0;
+    }
+
+    return url;
+}
+
+
+/**
+ * @brief  Get the number of URLs in the spill queue
+ *
+ * @param  queue    a spill queue
+ * @return          the number of URLs
+ */
+long get_spill_queue_size(SpillQueue *queue) {
+
+    assert(queue != NULL);
+
+    return queue->size;
+}
+
+
+/**
+ * @brief  Print out the number of URLs and bytes spilled and reloaded, and
+ *         the number of segment files created
+ *
+ * @param  queue    a spill queue
+ * @param  fp       the file to print into
+ */
+void print_spill_queue_stats(SpillQueue *queue, FILE *fp) {
+
+    assert(queue != NULL);
+
+    fprintf(fp, "spill: %ld urls (%lld bytes) spilled, %ld urls "
+                "(%lld bytes) reloaded, %d segments\n",
+            queue->spilled, queue->spilled_bytes, queue->reloaded,
+            queue->reloaded_bytes, queue->segments);
+}
+
+
+// ============================================================================
+// == | Auxillary Functions
+// ============================================================================
+/**
+ * @brief  Get the path of a segment file, named by the process, the queue
+ *         and the number of the segment
+ *
+ * @param  queue    a spill queue
+ * @param  seg      the number of the segment
+ * @param  path     the path will be set (of PATH_MAX bytes)
+ */
+void get_segment_path(SpillQueue *queue, int seg, char *path) {
+
+    snprintf(path, PATH_MAX, "%s/frontier-%d-%d-%d.seg", queue->dir,
+             (int)getpid(), queue->id, seg);
+}
+
+
+/**
+ * @brief  Start a new tail segment file, with its blocks allocated so
+ *         writing into the mapping cannot fail, and map it for writing.
+ *         If the queue is empty, it is the head segment as well
+ *
+ * @param  queue    a spill queue
+ */
+void open_tail_segment(SpillQueue *queue) {
+
+    char path[PATH_MAX];
+
+    queue->tail_seg += 1;
+    queue->tail_off  = 0;
+    queue->segments += 1;
+    get_segment_path(queue, queue->tail_seg, path);
+
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        fprintf(stderr, "Error: open_tail_segment() cannot create %s\n",
+                path);
+        exit(EXIT_FAILURE);
+    }
+    if (posix_fallocate(fd, 0, SPILL_SEGMENT_SIZE) != 0) {
+        fprintf(stderr, "Error: open_tail_segment() cannot allocate %s\n",
+                path);
+        exit(EXIT_FAILURE);
+    }
+
+    void *map = mmap(NULL, SPILL_SEGMENT_SIZE, PROT_READ | PROT_WRITE,
+                     MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "Error: open_tail_segment() mmap failed\n");
+        exit(EXIT_FAILURE);
+    }
+    close(fd);
+
+    queue->tail_map = (char *)map;
+}
+
+
+/**
+ * @brief  Mark the end of the tail segment with an empty record (if one
+ *         fits), and unmap it unless it is the head segment being read
+ *
+ * @param  queue    a spill queue
+ */
+void seal_tail_segment(SpillQueue *queue) {
+
+    if (queue->tail_off + sizeof(SpillRecord) <= SPILL_SEGMENT_SIZE) {
+        memset(queue->tail_map + queue->tail_off, 0, sizeof(SpillRecord));
+    }
+
+    if (queue->tail_map != queue->head_map) {
+        munmap(queue->tail_map, SPILL_SEGMENT_SIZE);
+    }
+    queue->tail_map = NULL;
+}
+
+
+/**
+ * @brief  Map the head segment for reading: the mapping of the tail segment
+ *         if they are the same segment, otherwise the segment file read
+ *         sequentially
+ *
+ * @param  queue    a spill queue
+ */
+void open_head_segment(SpillQueue *queue) {
+
+    char path[PATH_MAX];
+
+    queue->head_off = 0;
+
+    if (queue->head_seg == queue->tail_seg) {
+        queue->head_map = queue->tail_map;
+        return;
+    }
+
+    get_segment_path(queue, queue->head_seg, path);
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Error: open_head_segment() cannot open %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+
+    void *map = mmap(NULL, SPILL_SEGMENT_SIZE, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "Error: open_head_segment() mmap failed\n");
+        exit(EXIT_FAILURE);
+    }
+    close(fd);
+    madvise(map, SPILL_SEGMENT_SIZE, MADV_SEQUENTIAL);
+
+    queue->head_map = (char *)map;
+}
+
+
+/**
+ * @brief  Unmap and remove the head segment once all its records are read,
+ *         the next segment becomes the head segment
+ *
+ * @param  queue    a spill queue
+ */
+void close_head_segment(SpillQueue *queue) {
+
+    char path[PATH_MAX];
+
+    // The tail segment is never closed, the queue is empty once it is read
+    assert(queue->head_seg < queue->tail_seg);
+
+    munmap(queue->head_map, SPILL_SEGMENT_SIZE);
+    get_segment_path(queue, queue->head_seg, path);
+    unlink(path);
+
+    queue->head_seg += 1;
+    queue->head_map  = NULL;
+    queue->head_off  = 0;
+}
+
+
+/**
+ * @brief  Get the size of the record of a URL, padded to the alignment of
+ *         the records
+ *
+ * @param  hostname_len   the length of the hostname
+ * @param  filepath_len   the length of the filepath
+ * @return                the size of the record in bytes
+ */
+size_t get_record_size(size_t hostname_len, size_t filepath_len) {
+
+    size_t size = sizeof(SpillRecord) + hostname_len + filepath_len;
+
+    return (size + SPILL_RECORD_ALIGN - 1) & ~(size_t)(SPILL_RECORD_ALIGN - 1);
+}
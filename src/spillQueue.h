@@ -0,0 +1,54 @@
+/**
+ * @file      spillQueue.h
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     Disk-backed spill queue module. It includes
+ *              1. creating and destroying a spill queue in a directory
+ *              2. appending a URL as a compact binary record
+ *              3. reading the URLs back in the order they are appended
+ *              4. reporting the spill statistics
+ *            The records are appended to memory-mapped segment files of
+ *            fixed size, and each segment file is removed once all its
+ *            records are read back
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#ifndef SPILLQUEUE_H
+#define SPILLQUEUE_H
+
+#include "urlInfo.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+typedef struct spill_queue SpillQueue;
+
+
+// ============================================================================
+// == | Module Functions
+// ============================================================================
+// Create a new empty spill queue, its segment files are in the directory
+SpillQueue *new_SpillQueue(char *dir, int id);
+
+// Destroy a spill queue and free its memory (and remove its segment files)
+void free_SpillQueue(SpillQueue *queue);
+
+// Append a URL to the spill queue, return false if it cannot be spilled
+bool spill_queue_push(SpillQueue *queue, UrlInfo *url);
+
+// Remove and return the oldest URL of the spill queue, or NULL
+UrlInfo *spill_queue_pop(SpillQueue *queue);
+
+// Return the number of URLs in the spill queue
+long get_spill_queue_size(SpillQueue *queue);
+
+// Print out the spill statistics
+void print_spill_queue_stats(SpillQueue *queue, FILE *fp);
+
+
+#endif
@@ -13,15 +13,15 @@
 
 #include "urlHandler.h"
 
-#include "dlist.h"
+#include "crawlMetrics.h"
 #include "fetchHandler.h"
 #include "httpHandler.h"
+#include "perfCounters.h"
 #include "urlInfo.h"
 #include "utilities.h"
 
 #include <assert.h>
 #include <ctype.h>
-#include <netdb.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -37,14 +37,8 @@ UrlInfo *parse_url(char *link, UrlInfo *original);
 // Check if URL contains the ignorned characters (./, ../, %, ?, #)
 bool ignore_url(char *link);
 
-// Extract the hostname and filepath from a link string
-void split_host_file(int title_len, char *link, UrlInfo *url);
-
-// Extract the hostname of the link
-void add_new_hostname(char *link, int len, UrlInfo *url);
-
-// Check if the hostname is valid
-bool valid_hostname(char *hostname);
+// Create a UrlInfo data with the hostname and filepath from a link string
+UrlInfo *split_host_file(int protocol_len, char *link);
 
 // Check if two hostnames are same 
 bool compare_hostname(char *original, char *nexturl);
@@ -55,8 +49,8 @@ bool compare_host_except_fst(char *original, char *nexturl);
 // Check if two filepaths except the last trailing slash are same
 bool compare_filepath(char *original, char *nexturl);
 
-// Remove the last trailing slash if there has from the filepath
-char *omit_last_trailing(char *path);
+// Get the length of the filepath except the last trailing slash
+int get_path_len_no_trailing(char *path);
 
 
 // ============================================================================
@@ -69,44 +63,64 @@ char *omit_last_trailing(char *path);
  *          2. The URL has same for all but first component hostname compared to
  *             the URL currented be fetched
  *          3. The URL is HTTP protocol only
- *          4. The hostname of URL is valid
+ *          4. The hostname of URL is valid (checked with the DNS cache)
  *         If yes and it is never in the URL already be featched and 
  *         waited to be fetched list, insert it into waiting list .
+ *         If the hostname is still being resolved, the URL waits in the 
+ *         resolving list of the frontier until it is resolved.
+ *         If the crawl is sharded, a URL of another shard is forwarded to
+ *         that shard, which checks it instead.
+ *         The link is a view into a response, the byte after it is 
+ *         replaced by '\0' while it is parsed (instead of copying it)
  * 
- * @param  link         a link string
+ * @param  link         the start of a link (not NULL terminated)
+ * @param  link_len     the length of the link
  * @param  original     a UrlInfo data that currently that currently be fetched 
- * @param  waitedList   a dlist of UrlInfo data will be fetched 
- * @param  visitedList  a dlist of UrlInfo data already be fetched 
+ * @param  frontier     the frontier of URLs will be fetched
  */
 void url_will_be_fetched(char *link,
+                        int link_len,
                         UrlInfo *original,
-                        Dlist *waitedList,
-                        Dlist *visitedList) {
+                        Frontier *frontier) {
 
     assert(original != NULL);
-    assert(waitedList != NULL);
-    assert(visitedList != NULL);
+    assert(frontier != NULL);
 
     UrlInfo *nexturl;
+    PerfSample start;
+
+    METRICS_COUNT(frontier->metrics, COUNTER_LINKS_EXTRACTED, 1);
 
-    if ((nexturl = parse_url(link, original)) != NULL) {
+    char after_link = link[link_len];
+    link[link_len] = NULL_TERMINATED;
+    perf_stage_begin(frontier->perf, &start);
+    nexturl = parse_url(link, original);
+    perf_stage_end(frontier->perf, STAGE_PARSE_URL, &start);
+    link[link_len] = after_link;
+
+    if (nexturl != NULL) {
         // Check if the URL satisfies the handle rules
 
-        if (valid_hostname(nexturl->hostname)) {
-            // Check if the URL is valid and 
+        if (!compare_hostname(original->hostname, nexturl->hostname)) {
+            // If the URL has a different hostname, it is not handled
+            METRICS_COUNT(frontier->metrics, COUNTER_LINKS_REJECTED, 1);
 
-            if (insert_new_Wait(waitedList, visitedList, nexturl)) {
-                // if URL is never be fetched before and is unique, insert it
-                // into waited list
-                return;
-            }
+        } else if (insert_new_Found(frontier, nexturl)) {
+            // If the URL has same hostname for all but first component,
+            // and it is inserted into the frontier (or forwarded to the 
+            // frontier of the shard it belongs to)
+            return;
         }
 
         // Free the memory for URL not valid or satisfies the handle rules or
         // already be fetched or waiting list
         free_urlInfo(nexturl);
         nexturl = NULL;
+        return;
     }
+
+    // If the URL contains ignored characters, it is not handled
+    METRICS_COUNT(frontier->metrics, COUNTER_LINKS_REJECTED, 1);
 }
 
 /**
@@ -127,11 +141,8 @@ UrlInfo *parse_first_url(char *link) {
         if ((strncasecmp(link, HTTP_HEADER, strlen(HTTP_HEADER))) == SUCCESS) {
             // If the link is Absolute URL (fully specified)
 
-            url = new_UrlInfo();
-
             // Extract the hostname and filepath from the link
-
-            split_host_file(strlen(HTTP_HEADER), link, url);
+            url = split_host_file(strlen(HTTP_HEADER), link);
 
             return url;
         } else {
@@ -164,7 +175,8 @@ void print_url(UrlInfo *url) {
 
 /**
  * @brief  Compare two UrlInfo datas if they are the same 
- *         (same hostname except first component and filepath)
+ *         (same hostname except first component and filepath).
+ *         If both URLs are interned, the filepaths are compared by their ids
  * 
  * @param  original     the UrlInfo data currently be fetched
  * @param  nexturl      the UrlInfo data may be fetched
@@ -174,12 +186,16 @@ void print_url(UrlInfo *url) {
  *                      component and same filepath
  */
 bool compare_two_URL_diff(UrlInfo *original, UrlInfo *nexturl) {
-    if (compare_hostname(original->hostname, nexturl->hostname)
-        && !compare_filepath(original->filepath,
-                            nexturl->filepath)) {
-        return true;
+    if (!compare_hostname(original->hostname, nexturl->hostname)) {
+        return false;
     }
-    return false;
+
+    if (original->id != URL_ID_NONE && nexturl->id != URL_ID_NONE) {
+        // The same canonical form has the same id
+        return original->id != nexturl->id;
+    }
+
+    return !compare_filepath(original->filepath, nexturl->filepath);
 }
 
 
@@ -207,60 +223,49 @@ UrlInfo *parse_url(char *link, UrlInfo *original) {
     if (!ignore_url(link)) {
         // If the link doesn't contain ignored characters
 
-        nexturl = new_UrlInfo();
-
-       
         if ((strncasecmp(link, HTTP_HEADER, strlen(HTTP_HEADER))) == SUCCESS) {
             // If the link is Absolute URL (fully specified)
             
             // Extract the hostname and filepath from the link
-            split_host_file(strlen(HTTP_HEADER), link, nexturl);
+            nexturl = split_host_file(strlen(HTTP_HEADER), link);
 
         } else if (link[0] == SINGLE_SLASH 
                     && link[1] == SINGLE_SLASH) {
             // If the link is Absolute URL (implied protocol)
 
             // Extract the hostname and filepath from the link
-            split_host_file(strlen(DOUBLE_SLASH), link, nexturl);
+            nexturl = split_host_file(strlen(DOUBLE_SLASH), link);
 
         } else {
             // If the link is Relative URL
 
             // the hostname of the link should be same as the URL 
             // current be fetched
-            nexturl->hostname = deep_copy_str(original->hostname,
-                                    strlen(original->hostname), IS_COPY_WHOLE);
+            char *ori_host = original->hostname;
+            int host_len = strlen(ori_host);
 
             if (link[0] == SINGLE_SLASH) {
                 // If the Relative URL is filepath
 
-                nexturl->filepath = deep_copy_str(link, 
-                                                strlen(link), IS_COPY_WHOLE);
+                nexturl = new_UrlInfo(ori_host, host_len, link, strlen(link));
             } else {
                 // If the Relative URL is file name only
 
                 // Extract the filepath exclude the file name of URL 
                 // current be fetched (/filpath/filenam.ext )
-                char *ori_filefull
-                    = omit_last_trailing(original->filepath);
-                char *ori_filename = strrchr(ori_filefull, SINGLE_SLASH);
-
-                int len = ori_filename - ori_filefull + 1;
-                char *tmp_file
-                    = (char *)malloc((len + strlen(link) + 1) * sizeof(char));
-                strncpy(tmp_file, ori_filefull, len);
-                tmp_file[len] = NULL_TERMINATED;
+                char *ori_file = original->filepath;
+                char *ori_filename = memrchr(ori_file, SINGLE_SLASH,
+                                        get_path_len_no_trailing(ori_file));
+                int dir_len = (ori_filename != NULL) 
+                              ? ori_filename - ori_file + 1 : 1;
+                int link_len = strlen(link);
 
                 // Add the file name after the extracted file path
                 // which gives the full filepath for this link
-                strcat(tmp_file, link);
-                tmp_file[len + strlen(link)] = NULL_TERMINATED;
-
-                nexturl->filepath = tmp_file;
-
-                // Free the memory
-                free(ori_filefull);
-                ori_filefull = NULL;
+                nexturl = alloc_UrlInfo(host_len, dir_len + link_len);
+                memcpy(nexturl->hostname, ori_host, host_len);
+                memcpy(nexturl->filepath, ori_file, dir_len);
+                memcpy(nexturl->filepath + dir_len, link, link_len);
             }
         }
         // If the link doesn't ignored characters, return the UrlInfo data
@@ -293,77 +298,30 @@ bool ignore_url(char *link) {
 
 
 /**
- * @brief  Extract the hostname and filepath from a link string
+ * @brief  Create a UrlInfo data with the hostname and filepath from a 
+ *         link string
  * 
  * @param  protocol_len     length of protocol and/or slashs before 
  *                          hostname/filepath
  * @param  link             a link string
- * @param  url              a UrlInfo data
+ * @return                  a UrlInfo data
  */
-void split_host_file(int protocol_len, char *link, UrlInfo *url) {
+UrlInfo *split_host_file(int protocol_len, char *link) {
 
     char *path;
 
     link += protocol_len;
 
     if ((path = strchr(link, SINGLE_SLASH)) != NULL) {
-        // If there is filepath in the link
-
-        // Extract the filepath from the link
-        url->filepath = deep_copy_str(path, strlen(path), false);
-
-        // Extract the hostname from the link
-        int len = path - link;
-        add_new_hostname(link, len, url);
-
-    } else {
-        // If there is no filepath in the link, the default is "/"
-
-        // Add the default filepath "/" to the filepath
-        url->filepath = deep_copy_str("/", strlen("/"), false);
-
-        // Extract the hostname from the link
-        int len = strlen(link);
-        add_new_hostname(link, len, url);
+        // If there is filepath in the link, the hostname is before it
+        return new_UrlInfo(link, path - link, path, strlen(path));
     }
-}
 
-/**
- * @brief  Extract the hostname of the link
- * 
- * @param  link   a link string
- * @param  len    the length of the hostname
- * @param  url    a UrlInfo data
- */
-void add_new_hostname(char *link, int len, UrlInfo *url) {
-
-    url->hostname = deep_copy_str(link, len, false);
+    // If there is no filepath in the link, the default is "/"
+    return new_UrlInfo(link, strlen(link), "/", strlen("/"));
 }
 
 
-/**
- * @brief  Check if the hostname is valid
- * 
- * @param  hostname     a hostname string
- * @return true         If the hostname is valid
- * @return false        If the hostname is invalid
- */
-bool valid_hostname(char *hostname) {
-
-    struct hostent *host_info;
-    
-    // Check if the hostname is valid
-    host_info = gethostbyname(hostname);
-    if (host_info == NULL) {
-
-        // If it is invalid, return false
-        return false;
-    }
-
-    // If it is valid, return true
-    return true;
-}
-
 /**
  * @brief  Check if two hostnames are same 
  *         (including identical, same for all but first component)
@@ -448,56 +406,30 @@ bool compare_host_except_fst(char *original, char *nexturl) {
  */
 bool compare_filepath(char *original, char *nexturl) {
 
-    // Remove the last trailing slash if there has from the filepath
-    char *ori_path  = omit_last_trailing(original);
-    char *next_path = omit_last_trailing(nexturl);
+    // Ignore the last trailing slash if there has from the filepath
+    int ori_len  = get_path_len_no_trailing(original);
+    int next_len = get_path_len_no_trailing(nexturl);
 
     // Check if the filepath except the last trailing slash are same
-    if (strcmp(ori_path, next_path) == SUCCESS) {
-
-        // Free the memory
-        free(ori_path);
-        ori_path = NULL;
-        free(next_path);
-        next_path = NULL;
-
-        // If two filepath are same, return false
-        return true;
-    }
-    // Free the memory
-    free(ori_path);
-    ori_path = NULL;
-    free(next_path);
-    next_path = NULL;
-
-    // If two filepath are different, return false
-    return false;
+    return ori_len == next_len 
+           && memcmp(original, nexturl, ori_len) == SUCCESS;
 }
 
 
 /**
- * @brief  Remove the last trailing slash if there has from the filepath
+ * @brief  Get the length of the filepath except the last trailing slash
  * 
  * @param  path   a filepath string
- * @return        the string after removing the last trailing slash
+ * @return        the length of the filepath without the last trailing slash
  */
-char *omit_last_trailing(char *path) {
+int get_path_len_no_trailing(char *path) {
 
-    char *tmp;
     int path_len = strlen(path);
 
-    if (path[path_len - 1] == SINGLE_SLASH) {
+    if (path_len > 0 && path[path_len - 1] == SINGLE_SLASH) {
         // If there is a trailing slash at the last of the filepath
-
-        // Get the filepath except the last trailing slash
-        tmp = deep_copy_str(path, path_len - 1, !IS_COPY_WHOLE);
-    } else {
-        // If there is no trailing slash at the last of the filepath
-
-        // Get the full filepath
-        tmp = deep_copy_str(path, path_len, IS_COPY_WHOLE);
+        path_len--;
     }
 
-    // return the string after removing the last trailing slash
-    return tmp;
+    return path_len;
 }
@@ -13,8 +13,7 @@
 #ifndef URLHANDLER_H
 #define URLHANDLER_H
 
-#include "dlist.h"
-
+#include "fetchHandler.h"
 #include "urlInfo.h"
 
 // ============================================================================
@@ -22,9 +21,9 @@
 // ============================================================================
 // Parsing URL and checking if it is valid and will be handled.
 void url_will_be_fetched(char *link,
+                        int link_len,
                         UrlInfo *original,
-                        Dlist *waitedList,
-                        Dlist *visitedList);
+                        Frontier *frontier);
 
 
 // Parsing the first URL (which is the input)
@@ -5,8 +5,11 @@
  *              1. creating a new URL data
  *              2. destory and free a URL data
  *              3. deep copy a url
+ *              4. the arena all URL datas are allocated from
  *            The urlInfo include hostname, file path name, and
- *            if the webpage url direct to required the authorization
+ *            if the webpage url direct to required the authorization.
+ *            A urlInfo is one block of the arena: the struct, followed by
+ *            the hostname and the filepath, so creating a URL allocates once
  *
  * @copyright created for COMP30023 Computer System 2020
  *
@@ -14,43 +17,102 @@
 
 #include "urlInfo.h"
 
+#include "arena.h"
 #include "utilities.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 
 #include <assert.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <string.h>
 
 
+// ============================================================================
+// == | Constant Definitions
+// ============================================================================
+#define URL_ARENA_CHUNK_SIZE    65536
+
+
+// ============================================================================
+// == | Global Variables
+// ============================================================================
+// The arena of URL datas of this thread, created when the thread creates 
+// its first URL, so the threads do not share (and lock) an arena
+static __thread Arena *url_arena = NULL;
+
+// The arenas of all threads, released together at the end of the crawl
+static Arena **url_arenas     = NULL;
+static int num_url_arenas     = 0;
+static int url_arenas_size    = 0;
+static pthread_mutex_t url_arenas_lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+// ============================================================================
+// == | Function Prototypes
+// ============================================================================
+// Get the size of the block of a UrlInfo data of given string lengths
+int get_url_block_size(int hostname_len, int filepath_len);
+
+
 // ============================================================================
 // == | Module Functions
 // ============================================================================
 /**
- * @brief  Create a new urlInfo data
+ * @brief  Create a new urlInfo data with room for a hostname and filepath of
+ *         given length, both are NULL terminated (and empty) 
  * 
- * @return      return a pointer to the new urlInfo data
+ * @param  hostname_len   the length of the hostname
+ * @param  filepath_len   the length of the filepath
+ * @return                return a pointer to the new urlInfo data
  */
-UrlInfo *new_UrlInfo() {
+UrlInfo *alloc_UrlInfo(int hostname_len, int filepath_len) {
 
-    UrlInfo *url = (UrlInfo *)malloc(sizeof *url);
-    if (url == NULL) {
-        fprintf(stderr, "Error: new_UrlInfo() malloc returned NULL\n");
-        exit(EXIT_FAILURE);
-    }
+    int size = get_url_block_size(hostname_len, filepath_len);
+    UrlInfo *url = (UrlInfo *)arena_alloc(get_url_arena(), size);
 
-    // Initalise value of the responseInfo data
-    url->hostname        = NULL;
-    url->filepath        = NULL;
+    // Initalise value of the urlInfo data, the strings follow the struct
+    url->hostname        = (char *)(url + 1);
+    url->filepath        = url->hostname + hostname_len + 1;
     url->isAuthorization = false;
+    url->retries         = 0;
+    url->id              = URL_ID_NONE;
+    url->hash            = 0;
+
+    url->hostname[0]            = NULL_TERMINATED;
+    url->hostname[hostname_len] = NULL_TERMINATED;
+    url->filepath[0]            = NULL_TERMINATED;
+    url->filepath[filepath_len] = NULL_TERMINATED;
+
+    return url;
+}
+
+
+/**
+ * @brief  Create a new urlInfo data with a copy of the hostname and filepath
+ * 
+ * @param  hostname       the hostname (not need to be NULL terminated)
+ * @param  hostname_len   the length of the hostname
+ * @param  filepath       the filepath (not need to be NULL terminated)
+ * @param  filepath_len   the length of the filepath
+ * @return                return a pointer to the new urlInfo data
+ */
+UrlInfo *new_UrlInfo(char *hostname, int hostname_len,
+                     char *filepath, int filepath_len) {
+
+    UrlInfo *url = alloc_UrlInfo(hostname_len, filepath_len);
+
+    memcpy(url->hostname, hostname, hostname_len);
+    memcpy(url->filepath, filepath, filepath_len);
 
     return url;
 }
 
 
 /**
- * @brief  Destroy and free the memory associated with a UrlInfo data
+ * @brief  Destroy and free the memory associated with a UrlInfo data,
+ *         its block goes back to the URL arena
  * 
  * @param  resp   a UrlInfo data
  */
@@ -59,14 +121,15 @@ void free_urlInfo(UrlInfo *url) {
     // Error if the UrlInfo does not initalise
     assert(url != NULL);
 
-    // Free the memory associated with a UrlInfo
-    free(url->hostname);
-    free(url->filepath);
+    // The block size is known from the length of the strings
+    int size = get_url_block_size(strlen(url->hostname),
+                                  strlen(url->filepath));
     url->hostname = NULL;
     url->filepath = NULL;
 
-  // Free the UrlInfo data itself
-    free(url);
+    // The block goes to the arena of this thread, even if it is carved
+    // from the arena of another thread (they are released together)
+    arena_free(get_url_arena(), url, size);
     url = NULL;
 }
 
@@ -79,21 +142,105 @@ void free_urlInfo(UrlInfo *url) {
  */
 UrlInfo *deep_copy_url(UrlInfo *oldurl){
 
-    UrlInfo *url = new_UrlInfo();
-    if (url == NULL) {
-        printf("ERROR: new_UrlInfo() malloc returned NULL.");
-        exit(EXIT_FAILURE);
-    }
-
     // Get the hostname and filepath of URL will be copied
     char *old_host = oldurl->hostname;
     char *old_file = oldurl->filepath;
 
     // Deep copy the old UrlInfo data to new UrlInfo data
-    url->hostname = deep_copy_str(old_host, strlen(old_host), IS_COPY_WHOLE);
-    url->filepath = deep_copy_str(old_file, strlen(old_file), IS_COPY_WHOLE);
+    UrlInfo *url = new_UrlInfo(old_host, strlen(old_host),
+                               old_file, strlen(old_file));
     url->isAuthorization = oldurl->isAuthorization;
+    url->retries         = oldurl->retries;
+    url->id              = oldurl->id;
+    url->hash            = oldurl->hash;
 
     return url;
 }
 
+
+/**
+ * @brief  Get the arena of this thread the URL datas (and the dlist nodes) 
+ *         are allocated from, create it if it is the first time
+ * 
+ * @return      the URL arena of this thread
+ */
+Arena *get_url_arena() {
+
+    if (url_arena != NULL) {
+        return url_arena;
+    }
+
+    url_arena = new_Arena(URL_ARENA_CHUNK_SIZE);
+
+    // Keep the arena, so it is released at the end of the crawl
+    pthread_mutex_lock(&url_arenas_lock);
+    if (num_url_arenas == url_arenas_size) {
+        url_arenas_size = (url_arenas_size > 0) ? url_arenas_size * 2 : 8;
+        url_arenas = (Arena **)realloc(url_arenas,
+                                       url_arenas_size * sizeof(Arena *));
+        if (url_arenas == NULL) {
+            fprintf(stderr, "Error: get_url_arena() realloc returned NULL\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    url_arenas[num_url_arenas++] = url_arena;
+    pthread_mutex_unlock(&url_arenas_lock);
+
+    return url_arena;
+}
+
+
+/**
+ * @brief  Release the URL arenas of all threads at the end of the crawl,
+ *         every URL data and dlist node is no longer valid. The other 
+ *         threads should not use their arenas anymore
+ */
+void free_url_arena() {
+
+    pthread_mutex_lock(&url_arenas_lock);
+    for (int i = 0; i < num_url_arenas; i++) {
+        free_Arena(url_arenas[i]);
+    }
+    free(url_arenas);
+    url_arenas      = NULL;
+    num_url_arenas  = 0;
+    url_arenas_size = 0;
+    url_arena       = NULL;
+    pthread_mutex_unlock(&url_arenas_lock);
+}
+
+
+/**
+ * @brief  Print out the allocation statistics of the URL arenas 
+ *         (of all threads together)
+ * 
+ * @param  fp   the file to print into
+ */
+void print_url_arena_stats(FILE *fp) {
+
+    ArenaStats stats = {0, 0, 0, 0, 0, 0};
+
+    pthread_mutex_lock(&url_arenas_lock);
+    for (int i = 0; i < num_url_arenas; i++) {
+        add_arena_stats(url_arenas[i], &stats);
+    }
+    pthread_mutex_unlock(&url_arenas_lock);
+
+    print_arena_stats(&stats, "URL", fp);
+}
+
+
+// ============================================================================
+// == | Auxillary Functions 
+// ============================================================================
+/**
+ * @brief  Get the size of the block of a UrlInfo data of given string lengths
+ * 
+ * @param  hostname_len   the length of the hostname
+ * @param  filepath_len   the length of the filepath
+ * @return                the size of the struct and both strings
+ */
+int get_url_block_size(int hostname_len, int filepath_len) {
+
+    return sizeof(UrlInfo) + hostname_len + 1 + filepath_len + 1;
+}
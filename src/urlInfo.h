@@ -4,8 +4,12 @@
  * @brief     URL related information module. It includes
  *              1. creating a new URL data
  *              2. destory and free a URL data
+ *              3. the arenas all URL datas are allocated from
  *            The UrlInfo include hostname, file path name, and
- *            if the webpage url direct to required the authorization
+ *            if the webpage url direct to required the authorization.
+ *            A UrlInfo and its hostname and file path are one block of the
+ *            URL arena of the thread creating it, and the arenas of all
+ *            threads are released at once at the end of the crawl
  *
  * @copyright created for COMP30023 Computer System 2020
  *
@@ -14,7 +18,17 @@
 #ifndef URLINFO_H
 #define URLINFO_H
 
+#include "arena.h"
+
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+
+// ============================================================================
+// == | Constant Definitions
+// ============================================================================
+#define URL_ID_NONE     UINT32_MAX
 
 
 // ============================================================================
@@ -22,21 +36,32 @@
 // ============================================================================
 typedef struct link UrlInfo;
 /**
- * @brief The UrlInfo include hostname, file path name, and
- *        if the webpage url direct to required the authorization
+ * @brief The UrlInfo include hostname, file path name, 
+ *        if the webpage url direct to required the authorization, the
+ *        number of times it is retried as the server was unavailable, and
+ *        the id and hash value of its canonical form once it is interned
+ *        (the id is URL_ID_NONE before)
  */
 struct link {
     char *hostname;
     char *filepath;
     bool isAuthorization;
+    uint16_t retries;
+    uint32_t id;
+    uint64_t hash;
 };
 
 
 // ============================================================================
 // == | Module Functions
 // ============================================================================
-//  Create a new UrlInfo data
-UrlInfo *new_UrlInfo();
+// Create a new UrlInfo data with room for a hostname and filepath of given
+// length (both are NULL terminated, the caller fills them in)
+UrlInfo *alloc_UrlInfo(int hostname_len, int filepath_len);
+
+//  Create a new UrlInfo data with a copy of the hostname and filepath
+UrlInfo *new_UrlInfo(char *hostname, int hostname_len,
+                     char *filepath, int filepath_len);
 
 // Destroy and free the memory associated with a UrlInfo data
 void free_urlInfo(UrlInfo *url);
@@ -44,5 +69,15 @@ void free_urlInfo(UrlInfo *url);
 // Deep copy an url inforamtion to another
 UrlInfo *deep_copy_url(UrlInfo *oldurl);
 
+// Get the arena of this thread the URL datas (and the dlist nodes) are
+// allocated from
+Arena *get_url_arena();
+
+// Release the URL arenas of all threads, every URL data is no longer valid
+void free_url_arena();
+
+// Print out the allocation statistics of the URL arenas
+void print_url_arena_stats(FILE *fp);
+
 
-#endif
\ No newline at end of file
+#endif
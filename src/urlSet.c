@@ -0,0 +1,691 @@
+/**
+ * @file      urlSet.c
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     Implementation of hash-indexed URL set (intern table) module. 
+ *            It includes
+ *              1. creating and destroying a URL set
+ *              2. interning a URL, which gives it an integer id
+ *              3. inserting a URL into the set of seen URLs
+ *              4. checking if a URL is already seen
+ *              5. checking the seen URLs with a Bloom filter instead (and
+ *                 an optional exact store on disk)
+ *            The canonical form of each URL is stored once as a record, and
+ *            its id is the index of the record. The records are indexed by
+ *            an open addressing hash table (linear probing) of ids.
+ *            The set is split into shards by the hash value, each with its
+ *            own lock, so threads inserting URLs rarely wait for each other
+ *            (the id tells which shard the record is in). The
+ *            canonical key of a URL is computed in place from its hostname
+ *            and filepath, and only once: the id and hash value are kept in
+ *            the UrlInfo, so a URL already interned is looked up by its id.
+ *            With a filter, a URL is added to the filter under the lock of
+ *            its shard, so the same URL found by two threads is only new
+ *            once. If the filter takes a URL as seen, the exact store (by
+ *            the 64-bit hash value) decides, and the mistake is counted.
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#include "urlSet.h"
+
+#include "arena.h"
+#include "bloomFilter.h"
+#include "hashStore.h"
+#include "urlInfo.h"
+#include "utilities.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <assert.h>
+#include <ctype.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+
+
+// ============================================================================
+// == | Constant Definitions
+// ============================================================================
+#define URLSET_INIT_CAPACITY    64
+#define URLSET_MAX_LOAD_NUM     7
+#define URLSET_MAX_LOAD_DEN     10
+#define FNV_OFFSET_BASIS        14695981039346656037ULL
+#define FNV_PRIME               1099511628211ULL
+#define SCOPE_PATH_SEPARATOR    0xff
+#define EMPTY_SLOT              0
+#define URLSET_NUM_SHARDS       16
+#define CACHE_LINE_SIZE         64
+
+// The shard of a hash value (the low bits are used for the slots)
+#define SHARD_OF_HASH(hash)     ((int)((hash) >> 32) & (URLSET_NUM_SHARDS - 1))
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+typedef struct url_record UrlRecord;
+/**
+ * @brief  A record of the URL set stores the hash value and the canonical key
+ *         of a URL, and if the URL is seen. The key is the lowercase hostname
+ *         scope followed by the filepath except the last trailing slash 
+ *         (one allocation in the URL arena)
+ */
+struct url_record {
+    uint64_t hash;
+    char *key;
+    int scope_len;
+    int path_len;
+    bool isSeen;
+};
+
+
+typedef struct url_set_shard UrlSetShard;
+/**
+ * @brief  A shard of the URL set is a hash table of record indices with a 
+ *         power of two capacity (each slot stores the index plus one, as the 
+ *         empty slots are 0), the records, the number of seen URLs, and 
+ *         the lock of the shard. The shards are in different cache lines
+ */
+struct url_set_shard {
+    pthread_mutex_t lock;
+    uint32_t *slots;
+    int capacity;
+    UrlRecord *records;
+    int num_records;
+    int records_capacity;
+    int size;
+} __attribute__((aligned(CACHE_LINE_SIZE)));
+
+
+/**
+ * @brief  A URL set is its shards, and the filter (and the exact store) the
+ *         seen URLs are checked with, if any (not owned by the set). The id
+ *         of a record is its index in the shard times the number of shards,
+ *         plus the shard
+ */
+struct url_set {
+    UrlSetShard shards[URLSET_NUM_SHARDS];
+    BloomFilter *filter;
+    HashStore *store;
+};
+
+
+// ============================================================================
+// == | Function Prototypes
+// ============================================================================
+// Find the canonical hostname scope and filepath length of a URL
+void canonical_url_span(UrlInfo *url, char **scope, int *scope_len,
+                        int *path_len);
+
+// Compute the hash value of the canonical key of a URL
+uint64_t hash_canonical_url(char *scope, int scope_len,
+                            char *path, int path_len);
+
+// Insert a URL into the filter of the set
+bool urlSet_filter_insert(UrlSet *set, UrlInfo *url);
+
+// Check if a URL is in the filter of the set
+bool urlSet_filter_contains(UrlSet *set, UrlInfo *url);
+
+// Get the hash value of the canonical form of a URL, computed once
+uint64_t get_url_key_hash(UrlInfo *url);
+
+// Get the record of an interned URL, with the lock of its shard held
+UrlRecord *urlSet_lock_record(UrlSet *set, uint32_t id, UrlSetShard **shard);
+
+// Find the slot of the canonical key, or the empty slot it should go
+uint32_t *urlSet_find(UrlSetShard *shard, uint64_t hash, char *scope,
+                      int scope_len, char *path, int path_len);
+
+// Add the record of a canonical key and return its index in the shard
+uint32_t urlSet_add_record(UrlSetShard *shard, uint64_t hash, char *scope,
+                           int scope_len, char *path, int path_len);
+
+// Double the capacity of a shard and rehash all record indices
+void urlSet_grow(UrlSetShard *shard);
+
+
+// ============================================================================
+// == | Module Functions
+// ============================================================================
+/**
+ * @brief  Create a new empty URL set
+ *
+ * @return        the pointer of new empty URL set
+ */
+UrlSet *new_urlSet() {
+
+    UrlSet *set = (UrlSet *)aligned_alloc(CACHE_LINE_SIZE, sizeof *set);
+    if (set == NULL) {
+        fprintf(stderr, "Error: new_urlSet() malloc returned NULL\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int i = 0; i < URLSET_NUM_SHARDS; i++) {
+        UrlSetShard *shard = &set->shards[i];
+
+        shard->slots = (uint32_t *)calloc(URLSET_INIT_CAPACITY,
+                                          sizeof *shard->slots);
+        shard->records = (UrlRecord *)malloc(URLSET_INIT_CAPACITY
+                                             * sizeof *shard->records);
+        if (shard->slots == NULL || shard->records == NULL) {
+            fprintf(stderr, "Error: new_urlSet() malloc returned NULL\n");
+            exit(EXIT_FAILURE);
+        }
+
+        // Initalise value of the shard
+        pthread_mutex_init(&shard->lock, NULL);
+        shard->capacity         = URLSET_INIT_CAPACITY;
+        shard->num_records      = 0;
+        shard->records_capacity = URLSET_INIT_CAPACITY;
+        shard->size             = 0;
+    }
+    set->filter = NULL;
+    set->store  = NULL;
+
+    return set;
+}
+
+
+/**
+ * @brief  Destroy and free the memory associated with a URL set
+ *
+ * @param  set    a URL set
+ */
+void free_urlSet(UrlSet *set) {
+
+    // Error if the set does not initalise
+    assert(set != NULL);
+
+    for (int i = 0; i < URLSET_NUM_SHARDS; i++) {
+        UrlSetShard *shard = &set->shards[i];
+
+        // Return the canonical key of each record to the URL arena
+        for (int j = 0; j < shard->num_records; j++) {
+            UrlRecord *record = &shard->records[j];
+            arena_free(get_url_arena(), record->key,
+                       record->scope_len + record->path_len + 1);
+        }
+
+        // Free the tables of the shard
+        free(shard->slots);
+        free(shard->records);
+        shard->slots   = NULL;
+        shard->records = NULL;
+        pthread_mutex_destroy(&shard->lock);
+    }
+
+    // Free the set itself
+    free(set);
+    set = NULL;
+}
+
+
+/**
+ * @brief  Check the seen URLs with a filter (and an exact store) instead of
+ *         interning them, the set should be empty
+ *
+ * @param  set      a URL set
+ * @param  filter   a Bloom filter (may be shared by sets)
+ * @param  store    an exact store of the hash values, or NULL
+ */
+void urlSet_use_filter(UrlSet *set, BloomFilter *filter, HashStore *store) {
+
+    assert(set != NULL);
+    assert(filter != NULL);
+
+    set->filter = filter;
+    set->store  = store;
+}
+
+
+/**
+ * @brief  Intern a URL: find the id of its canonical form, or store the
+ *         canonical form and give it a new id. The id and hash value are 
+ *         kept in the UrlInfo, so it is only computed once for each URL
+ *         (a URL belongs to one set)
+ *
+ * @param  set    a URL set
+ * @param  url    a UrlInfo data
+ * @return        the id of the URL
+ */
+uint32_t urlSet_intern(UrlSet *set, UrlInfo *url) {
+
+    char *scope;
+    int scope_len, path_len;
+
+    assert(set != NULL);
+    assert(url != NULL);
+
+    // If the URL is already interned (or copied from one interned)
+    if (url->id != URL_ID_NONE) {
+        return url->id;
+    }
+
+    // The canonical key and its hash are computed before taking the lock
+    canonical_url_span(url, &scope, &scope_len, &path_len);
+    uint64_t hash
+        = hash_canonical_url(scope, scope_len, url->filepath, path_len);
+    int shard_index = SHARD_OF_HASH(hash);
+    UrlSetShard *shard = &set->shards[shard_index];
+
+    pthread_mutex_lock(&shard->lock);
+
+    // Keep the load factor below the maximum before inserting
+    if ((shard->num_records + 1) * URLSET_MAX_LOAD_DEN
+        > shard->capacity * URLSET_MAX_LOAD_NUM) {
+        urlSet_grow(shard);
+    }
+
+    uint32_t *slot = urlSet_find(shard, hash, scope, scope_len,
+                                 url->filepath, path_len);
+    if (*slot == EMPTY_SLOT) {
+        // If the canonical form is new, store it
+        *slot = urlSet_add_record(shard, hash, scope, scope_len,
+                                  url->filepath, path_len) + 1;
+    }
+    uint32_t index = *slot - 1;
+
+    pthread_mutex_unlock(&shard->lock);
+
+    url->id   = index * URLSET_NUM_SHARDS + shard_index;
+    url->hash = hash;
+
+    return url->id;
+}
+
+
+/**
+ * @brief  Insert a URL into the set of seen URLs (interning it if needed,
+ *         unless the set uses a filter)
+ *
+ * @param  set    a URL set
+ * @param  url    a UrlInfo data
+ * @return true   If the URL is not in the set and be inserted successfully
+ * @return false  If the URL (in canonical form) is already in the set
+ */
+bool urlSet_insert(UrlSet *set, UrlInfo *url) {
+
+    if (set->filter != NULL) {
+        return urlSet_filter_insert(set, url);
+    }
+
+    UrlSetShard *shard;
+    UrlRecord *record = urlSet_lock_record(set, urlSet_intern(set, url),
+                                           &shard);
+    bool isNew = !record->isSeen;
+
+    if (isNew) {
+        // If the URL is not in the set, insert it
+        record->isSeen = true;
+        shard->size++;
+    }
+
+    pthread_mutex_unlock(&shard->lock);
+
+    return isNew;
+}
+
+
+/**
+ * @brief  Check if a URL (in canonical form) is already in the set of seen
+ *         URLs (interning it if needed, unless the set uses a filter)
+ *
+ * @param  set    a URL set
+ * @param  url    a UrlInfo data
+ * @return true   If the URL is in the set
+ * @return false  If the URL is not in the set
+ */
+bool urlSet_contains(UrlSet *set, UrlInfo *url) {
+
+    if (set->filter != NULL) {
+        return urlSet_filter_contains(set, url);
+    }
+
+    UrlSetShard *shard;
+    UrlRecord *record = urlSet_lock_record(set, urlSet_intern(set, url),
+                                           &shard);
+    bool isSeen = record->isSeen;
+
+    pthread_mutex_unlock(&shard->lock);
+
+    return isSeen;
+}
+
+
+/**
+ * @brief  Get the number of URLs in a URL set (seen URLs)
+ *
+ * @param  set    a URL set
+ * @return        the number of URLs in a URL set
+ */
+int get_urlSet_size(UrlSet *set) {
+
+    // Error if the set does not initalise
+    assert(set != NULL);
+
+    int size = 0;
+    for (int i = 0; i < URLSET_NUM_SHARDS; i++) {
+        pthread_mutex_lock(&set->shards[i].lock);
+        size += set->shards[i].size;
+        pthread_mutex_unlock(&set->shards[i].lock);
+    }
+
+    return size;
+}
+
+
+/**
+ * @brief  Get the number of canonical URLs interned in a URL set 
+ *         (seen or not)
+ *
+ * @param  set    a URL set
+ * @return        the number of canonical URLs interned
+ */
+int get_urlSet_interned(UrlSet *set) {
+
+    // Error if the set does not initalise
+    assert(set != NULL);
+
+    int num_records = 0;
+    for (int i = 0; i < URLSET_NUM_SHARDS; i++) {
+        pthread_mutex_lock(&set->shards[i].lock);
+        num_records += set->shards[i].num_records;
+        pthread_mutex_unlock(&set->shards[i].lock);
+    }
+
+    return num_records;
+}
+
+
+/**
+ * @brief  Compute the hash value of the canonical form of a URL (the same
+ *         value it is interned with), so the URLs with the same canonical
+ *         form have the same hash value
+ *
+ * @param  url    a UrlInfo data
+ * @return        the hash value
+ */
+uint64_t hash_url_key(UrlInfo *url) {
+
+    char *scope;
+    int scope_len, path_len;
+
+    assert(url != NULL);
+
+    canonical_url_span(url, &scope, &scope_len, &path_len);
+
+    return hash_canonical_url(scope, scope_len, url->filepath, path_len);
+}
+
+
+// ============================================================================
+// == | Auxillary Functions
+// ============================================================================
+/**
+ * @brief  Find the canonical hostname scope and filepath length of a URL.
+ *         The scope is the hostname for all but first component (or the
+ *         whole hostname if it has only one component), and the filepath
+ *         does not include the last trailing slash
+ *
+ * @param  url          a UrlInfo data
+ * @param  scope        returns the start of the hostname scope
+ * @param  scope_len    returns the length of the hostname scope
+ * @param  path_len     returns the length of the filepath to be compared
+ */
+void canonical_url_span(UrlInfo *url, char **scope, int *scope_len,
+                        int *path_len) {
+
+    char *dot = strchr(url->hostname, '.');
+
+    *scope     = (dot != NULL) ? dot : url->hostname;
+    *scope_len = strlen(*scope);
+
+    *path_len = strlen(url->filepath);
+    if (*path_len > 0 && url->filepath[*path_len - 1] == SINGLE_SLASH) {
+        *path_len -= 1;
+    }
+}
+
+
+/**
+ * @brief  Compute the FNV-1a hash value of the canonical key of a URL
+ *         (the scope is hashed case insensitively)
+ *
+ * @param  scope        the hostname scope
+ * @param  scope_len    the length of the hostname scope
+ * @param  path         the filepath
+ * @param  path_len     the length of the filepath to be hashed
+ * @return              the hash value
+ */
+uint64_t hash_canonical_url(char *scope, int scope_len,
+                            char *path, int path_len) {
+
+    uint64_t hash = FNV_OFFSET_BASIS;
+
+    for (int i = 0; i < scope_len; i++) {
+        hash ^= (unsigned char)tolower((unsigned char)scope[i]);
+        hash *= FNV_PRIME;
+    }
+
+    // Separate the scope and the filepath so they can not run together
+    hash ^= SCOPE_PATH_SEPARATOR;
+    hash *= FNV_PRIME;
+
+    for (int i = 0; i < path_len; i++) {
+        hash ^= (unsigned char)path[i];
+        hash *= FNV_PRIME;
+    }
+
+    return hash;
+}
+
+
+/**
+ * @brief  Insert a URL into the filter of the set, under the lock of its
+ *         shard. If the filter takes it as seen, the exact store decides
+ *
+ * @param  set    a URL set using a filter
+ * @param  url    a UrlInfo data
+ * @return true   If the URL is new
+ * @return false  If the URL is seen (or the filter takes it as seen, and
+ *                there is no exact store)
+ */
+bool urlSet_filter_insert(UrlSet *set, UrlInfo *url) {
+
+    uint64_t hash = get_url_key_hash(url);
+    UrlSetShard *shard = &set->shards[SHARD_OF_HASH(hash)];
+
+    pthread_mutex_lock(&shard->lock);
+
+    bool isNew = bloom_filter_add(set->filter, hash);
+    if (set->store != NULL) {
+        if (isNew) {
+            hash_store_add(set->store, hash);
+        } else if (hash_store_add(set->store, hash)) {
+            // The filter takes it as seen, but it is not
+            bloom_filter_add_false_positive(set->filter);
+            isNew = true;
+        }
+    }
+    if (isNew) {
+        shard->size++;
+    }
+
+    pthread_mutex_unlock(&shard->lock);
+
+    return isNew;
+}
+
+
+/**
+ * @brief  Check if a URL is in the filter of the set. If the filter takes it
+ *         as seen, the exact store decides
+ *
+ * @param  set    a URL set using a filter
+ * @param  url    a UrlInfo data
+ * @return true   If the URL is seen (or the filter takes it as seen, and
+ *                there is no exact store)
+ * @return false  If the URL is not seen
+ */
+bool urlSet_filter_contains(UrlSet *set, UrlInfo *url) {
+
+    uint64_t hash = get_url_key_hash(url);
+
+    if (!bloom_filter_contains(set->filter, hash)) {
+        return false;
+    }
+
+    return set->store == NULL || hash_store_contains(set->store, hash);
+}
+
+
+/**
+ * @brief  Get the hash value of the canonical form of a URL, it is kept in
+ *         the UrlInfo so it is only computed once (0 is taken as unknown)
+ *
+ * @param  url    a UrlInfo data
+ * @return        the hash value
+ */
+uint64_t get_url_key_hash(UrlInfo *url) {
+
+    if (url->hash == 0) {
+        url->hash = hash_url_key(url);
+    }
+
+    return url->hash;
+}
+
+
+/**
+ * @brief  Get the record of an interned URL, and take the lock of its shard
+ *         (the caller releases it)
+ *
+ * @param  set    a URL set
+ * @param  id     the id of the URL
+ * @param  shard  returns the shard of the record
+ * @return        the record
+ */
+UrlRecord *urlSet_lock_record(UrlSet *set, uint32_t id, UrlSetShard **shard) {
+
+    *shard = &set->shards[id % URLSET_NUM_SHARDS];
+    pthread_mutex_lock(&(*shard)->lock);
+
+    return &(*shard)->records[id / URLSET_NUM_SHARDS];
+}
+
+
+/**
+ * @brief  Find the slot of a canonical key in a shard by linear probing
+ *
+ * @param  shard        a shard of a URL set
+ * @param  hash         the hash value of the key
+ * @param  scope        the hostname scope
+ * @param  scope_len    the length of the hostname scope
+ * @param  path         the filepath
+ * @param  path_len     the length of the filepath
+ * @return              the slot holding the index of the key, or the empty 
+ *                      slot where the index should be inserted
+ */
+uint32_t *urlSet_find(UrlSetShard *shard, uint64_t hash, char *scope,
+                      int scope_len, char *path, int path_len) {
+
+    int mask = shard->capacity - 1;
+    int i    = (int)(hash & (uint64_t)mask);
+
+    while (shard->slots[i] != EMPTY_SLOT) {
+        UrlRecord *record = &shard->records[shard->slots[i] - 1];
+
+        if (record->hash == hash
+            && record->scope_len == scope_len
+            && record->path_len == path_len
+            && strncasecmp(record->key, scope, scope_len) == SUCCESS
+            && memcmp(record->key + scope_len, path, path_len) == SUCCESS) {
+            return &shard->slots[i];
+        }
+        i = (i + 1) & mask;
+    }
+
+    return &shard->slots[i];
+}
+
+
+/**
+ * @brief  Add the record of a canonical key (not seen yet) to a shard, 
+ *         the key is stored in the URL arena
+ *
+ * @param  shard        a shard of a URL set
+ * @param  hash         the hash value of the key
+ * @param  scope        the hostname scope
+ * @param  scope_len    the length of the hostname scope
+ * @param  path         the filepath
+ * @param  path_len     the length of the filepath
+ * @return              the index of the record in the shard
+ */
+uint32_t urlSet_add_record(UrlSetShard *shard, uint64_t hash, char *scope,
+                           int scope_len, char *path, int path_len) {
+
+    // Double the records if they are full
+    if (shard->num_records == shard->records_capacity) {
+        shard->records_capacity *= 2;
+        shard->records = (UrlRecord *)realloc(shard->records,
+                            shard->records_capacity * sizeof *shard->records);
+        if (shard->records == NULL) {
+            fprintf(stderr, "Error: urlSet_add_record() realloc returned "
+                            "NULL\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // Store the lowercase scope and the filepath in one allocation
+    char *key = (char *)arena_alloc(get_url_arena(),
+                                    scope_len + path_len + 1);
+    for (int i = 0; i < scope_len; i++) {
+        key[i] = tolower((unsigned char)scope[i]);
+    }
+    memcpy(key + scope_len, path, path_len);
+    key[scope_len + path_len] = NULL_TERMINATED;
+
+    uint32_t index = shard->num_records++;
+    UrlRecord *record = &shard->records[index];
+    record->hash      = hash;
+    record->key       = key;
+    record->scope_len = scope_len;
+    record->path_len  = path_len;
+    record->isSeen    = false;
+
+    return index;
+}
+
+
+/**
+ * @brief  Double the capacity of a shard and rehash all record indices
+ *
+ * @param  shard  a shard of a URL set
+ */
+void urlSet_grow(UrlSetShard *shard) {
+
+    free(shard->slots);
+
+    shard->capacity = shard->capacity * 2;
+    shard->slots    = (uint32_t *)calloc(shard->capacity,
+                                         sizeof *shard->slots);
+    if (shard->slots == NULL) {
+        fprintf(stderr, "Error: urlSet_grow() calloc returned NULL\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Put each index into the new table by the hash value of its record
+    int mask = shard->capacity - 1;
+    for (int index = 0; index < shard->num_records; index++) {
+        int i = (int)(shard->records[index].hash & (uint64_t)mask);
+        while (shard->slots[i] != EMPTY_SLOT) {
+            i = (i + 1) & mask;
+        }
+        shard->slots[i] = index + 1;
+    }
+}
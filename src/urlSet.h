@@ -0,0 +1,73 @@
+/**
+ * @file      urlSet.h
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     Hash-indexed URL set (intern table) module. It includes
+ *              1. creating and destroying a URL set
+ *              2. interning a URL, which gives it an integer id
+ *              3. inserting a URL into the set of seen URLs
+ *              4. checking if a URL is already seen
+ *              5. checking the seen URLs with a Bloom filter instead (and
+ *                 an optional exact store on disk)
+ *            URLs are keyed on their canonical form, which is the hostname
+ *            for all but first component (case insensitive) and the filepath
+ *            except the last trailing slash. Each canonical form is stored
+ *            once and given an id, the URLs with the same canonical form
+ *            get the same id, so they are compared by their ids.
+ *            With a filter, the seen URLs are not interned: only the hash
+ *            value of their canonical form is added to the filter, so a new
+ *            URL may be taken as seen at the false positive rate of the
+ *            filter (unless the exact store is checked)
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#ifndef URLSET_H
+#define URLSET_H
+
+#include "bloomFilter.h"
+#include "hashStore.h"
+#include "urlInfo.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+typedef struct url_set UrlSet;
+
+
+// ============================================================================
+// == | Module Functions
+// ============================================================================
+// Create a new empty URL set
+UrlSet *new_urlSet();
+
+// Destroy a URL set and free its memory
+void free_urlSet(UrlSet *set);
+
+// Check the seen URLs with a filter (and a store, if not NULL) instead
+void urlSet_use_filter(UrlSet *set, BloomFilter *filter, HashStore *store);
+
+// Intern a URL, set and return its id (the same for the same canonical form)
+uint32_t urlSet_intern(UrlSet *set, UrlInfo *url);
+
+// Insert a URL into the set, return false if it is already in the set
+bool urlSet_insert(UrlSet *set, UrlInfo *url);
+
+// Check if a URL (in canonical form) is already in the set
+bool urlSet_contains(UrlSet *set, UrlInfo *url);
+
+// Return the number of URLs contained in the set
+int get_urlSet_size(UrlSet *set);
+
+// Return the number of canonical URLs interned
+int get_urlSet_interned(UrlSet *set);
+
+// Compute the hash value of the canonical form of a URL
+uint64_t hash_url_key(UrlInfo *url);
+
+
+#endif
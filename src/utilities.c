@@ -20,6 +20,7 @@
 #include <string.h>
 #include <ctype.h>
 #include <assert.h>
+#include <time.h>
 
 
 // ============================================================================
@@ -87,3 +88,31 @@ char *deep_copy_str(char *src, int src_len, bool copy_whole) {
 }
 
 
+/**
+ * @brief  Get the current time of the monotonic clock in milliseconds
+ *         (it is not affected by changes of the system time)
+ * 
+ * @return        the current time in milliseconds
+ */
+long long get_monotonic_ms() {
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+
+/**
+ * @brief  Get the current time of the monotonic clock in microseconds
+ *         (to time the operations shorter than a millisecond)
+ * 
+ * @return        the current time in microseconds
+ */
+long long get_monotonic_us() {
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (long long)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
@@ -4,6 +4,7 @@
  * @brief     Implementation of Utilities module. It includes
  *              1. remove whitespace of a string
  *              2. deep copy of a string
+ *              3. get the current time of the monotonic clock
  *
  * @copyright created for COMP30023 Computer System 2020
  *
@@ -43,5 +44,11 @@ char *remove_spaces(char *src);
 // Deep copy of a string of given length
 char *deep_copy_str(char *src, int src_len, bool copy_whole);
 
+// Get the current time of the monotonic clock in milliseconds
+long long get_monotonic_ms();
+
+// Get the current time of the monotonic clock in microseconds
+long long get_monotonic_us();
+
 
 #endif
@@ -0,0 +1,1856 @@
+/**
+ * @file      workerPool.c
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     Implementation of crawl worker pool module. It includes
+ *              1. creating and destroying a pool of crawl worker threads
+ *              2. crawling from the first URL with all workers until no
+ *                 URL is left or the maximum number of URLs are fetched
+ *              3. printing out the fetched URLs and the crawl statistics
+ *              4. keeping a checkpoint journal of the crawl, and resuming
+ *                 the crawl kept in it
+ *            A worker starts fetching the URLs of its own frontier (newest
+ *            first), and handles the response of each completed fetch.
+ *            When it has nothing to fetch or wait for, it steals the oldest
+ *            URLs of another worker, or sleeps until a worker finds new URLs.
+ *            A URL the server is unavailable for is retried after a delay
+ *            which doubles with each retry (with random jitter, and at least
+ *            as long as Retry-After asks), up to a number of retries.
+ *            The crawl is done once all workers are idle at the same time.
+ *            The first worker runs on the calling thread.
+ *            If the crawl is sharded, each worker is pinned to a core and
+ *            only crawls the URLs hashed to its shard, with its own
+ *            set of URLs seen and DNS cache. The URLs found for another
+ *            shard are forwarded through a mailbox instead of stolen, and
+ *            the crawl is done once no URL is in transit as well.
+ *            If the crawl is checkpointed, the frontiers record the URLs
+ *            found, fetched and requeued, and a checkpointer thread writes
+ *            them (with the state of the hosts backing off) into the journal
+ *            at an interval. A crawl resumed replays the journal: the URLs
+ *            fetched are fetched already, and the URLs found or requeued but
+ *            not fetched since are fetched first. The journal is then
+ *            compacted to those records, and appended to from there.
+ *            If the metrics are kept, each worker records the phases of its
+ *            fetches and counts its links into its own metrics. They are
+ *            merged and written as JSON once the crawl is done, and by a
+ *            thread waiting for SIGUSR1 while it is running.
+ *            If the crawl is traced, each worker records the phases and
+ *            responses of its URLs into its own ring of events, and a
+ *            trace writer thread writes them into the trace file at an
+ *            interval, so the rings do not fill up.
+ *            If the stages are profiled, each worker opens the performance
+ *            counters of its thread and counts its stages with them. They
+ *            are merged and reported once the crawl is done.
+ *            While the crawl is running, a reporter thread can print a line
+ *            of its statistics at an interval, and a server thread can send
+ *            them as JSON to the clients of a Unix socket. The statistics
+ *            are collected from the workers as they crawl.
+ *            The results are written through a buffered writer as the
+ *            crawl goes: a plain URL as it is added to the fetched list (so
+ *            they keep its order), a JSON or binary result once its fetch is
+ *            completed. Only sorted results are written once it is done.
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#include "workerPool.h"
+
+#include "bloomFilter.h"
+#include "byteScan.h"
+#include "checkpoint.h"
+#include "crawlConfig.h"
+#include "crawlMetrics.h"
+#include "crawlStats.h"
+#include "crawlTrace.h"
+#include "dlist.h"
+#include "dnsCache.h"
+#include "fetchEngine.h"
+#include "fetchHandler.h"
+#include "hashStore.h"
+#include "histogram.h"
+#include "hostScheduler.h"
+#include "htmlHandler.h"
+#include "httpHeader.h"
+#include "perfCounters.h"
+#include "responseInfo.h"
+#include "resultWriter.h"
+#include "spillQueue.h"
+#include "urlHandler.h"
+#include "urlInfo.h"
+#include "urlSet.h"
+#include "utilities.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+
+// ============================================================================
+// == | Constant Definitions
+// ============================================================================
+#define WORKER_IDLE_WAIT_MS     10
+#define MAX_RETRY_DELAY_MS      30000
+#define MS_PER_S                1000
+#define NS_PER_MS               1000000L
+#define NS_PER_S                1000000000L
+#define US_PER_MS               1000.0
+#define RESUME_INIT_ENTRIES     1024
+#define COMPACT_SUFFIX          ".compact"
+#define TRACE_FLUSH_MS          100
+#define STATS_POLL_MS           100
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+typedef struct crawl_worker Worker;
+/**
+ * @brief  A worker include its pool, its thread, its own frontier and fetch
+ *         engine (with its share of the requests in flight), the set of URLs
+ *         seen and the DNS cache it uses (its own if the crawl is sharded),
+ *         its metrics (NULL if they are not kept), its ring of trace events
+ *         (NULL if the crawl is not traced), its performance counters
+ *         (NULL if the stages are not profiled), the state of its random
+ *         jitter, and the number of URLs it fetched, stole, forwarded,
+ *         received, retried and gave up on
+ */
+struct crawl_worker {
+    WorkerPool *pool;
+    int index;
+    pthread_t thread;
+    Frontier *frontier;
+    FetchEngine *engine;
+    UrlSet *seenSet;
+    DnsCache *dnsCache;
+    CrawlMetrics *metrics;
+    TraceRing *traceRing;
+    PerfCounters *perf;
+    long fetched;
+    long steals;
+    long stolen_urls;
+    long forwarded;
+    long received;
+    long retried;
+    long gave_up;
+    uint64_t rng;
+};
+
+
+/**
+ * @brief  A worker pool include the workers, the set of URLs seen (and the
+ *         filter and exact store it is checked with, and the file the filter
+ *         is saved into), the DNS cache, the limiter pacing each host, the
+ *         list of fetched URLs (and
+ *         the maximum fetched), the number of idle workers, the number
+ *         of URLs forwarded between shards but not received, and the
+ *         checkpoint (its journal, the interval it is written at, its
+ *         thread, and what is resumed from it), the file the metrics are
+ *         written into (and the thread writing them on SIGUSR1), the trace
+ *         (and the thread writing it), the interval of the lines of the
+ *         statistics (0 if they are not printed, and the thread printing
+ *         them), the path of the socket of the statistics (NULL if they are
+ *         not served, its listening socket and the thread serving it), the
+ *         writer of the results (their format, and the interval they are
+ *         flushed at and the thread flushing them, 0 if they are not), and
+ *         the time the crawl is started.
+ *         The lock guards the fetched list and the idle workers
+ */
+struct worker_pool {
+    Worker *workers;
+    int num_workers;
+    UrlSet *seenSet;
+    DnsCache *dnsCache;
+    HostLimiter *limiter;
+    BloomFilter *filter;
+    HashStore *store;
+    char *filter_save;
+    Dlist *visitedList;
+    int num_visited;
+    int num_idle;
+    bool isDone;
+    bool sort_output;
+    bool sharded;
+    int max_pages;
+    int max_retries;
+    int retry_base_ms;
+    long in_transit;
+    Checkpoint *checkpoint;
+    char *checkpoint_path;
+    int checkpoint_ms;
+    pthread_t checkpointer;
+    bool isResumed;
+    long resumed_records;
+    int resumed_visited;
+    int resumed_pending;
+    long long resume_ms;
+    char *metrics_path;
+    pthread_t metricsWriter;
+    Trace *trace;
+    pthread_t traceWriter;
+    int stats_ms;
+    pthread_t statsReporter;
+    char *stats_socket;
+    int statsfd;
+    pthread_t statsServer;
+    ResultWriter *writer;
+    OutputFormat output_format;
+    int flush_ms;
+    pthread_t flusher;
+    long long start_ms;
+    pthread_mutex_t lock;
+    pthread_cond_t idle_cond;
+};
+
+
+typedef struct resume_entry ResumeEntry;
+/**
+ * @brief  The state of a URL replayed from a checkpoint: the URL will be
+ *         fetched (NULL if there is none), and if it is fetched before
+ */
+struct resume_entry {
+    UrlInfo *url;
+    bool isVisited;
+};
+
+
+// ============================================================================
+// == | Function Prototypes
+// ============================================================================
+// Crawl with a worker until the crawl is done
+void *run_worker(void *arg);
+
+// Handle the response of a completed fetch
+void handle_fetch_result(Worker *worker, FetchResult *result);
+
+// Schedule a URL the server is unavailable for to be fetched again
+void retry_later(Worker *worker, UrlInfo *url, ResponseInfo *resp);
+
+// Add a URL to the fetched list if the maximum is not reached
+bool reserve_visit(WorkerPool *pool, Frontier *frontier, UrlInfo *url);
+
+// Steal URLs will be fetched from another worker
+bool worker_steal(Worker *worker);
+
+// Wait as an idle worker, return false if the crawl is done
+bool worker_wait_idle(Worker *worker);
+
+// Wake up the idle workers, so they can steal the new URLs
+void notify_idle_workers(WorkerPool *pool);
+
+// Return the time a worker can wait before a host is ready, or -1
+int worker_wait_ms(Worker *worker);
+
+// Sleep until a host is ready (for a short time at most)
+void worker_sleep(int wait_ms);
+
+// Create the filter the seen URLs are checked with, if it is required
+void init_visited_filter(WorkerPool *pool, CrawlConfig *config);
+
+// Write the checkpoint journal at an interval until the crawl is done
+void *run_checkpointer(void *arg);
+
+// Wait for an interval with the lock of the pool, return false if the crawl
+// is done
+bool wait_pool_interval(WorkerPool *pool, int interval_ms);
+
+// Grow the states of the URLs replayed to hold the given id
+ResumeEntry *grow_resume_entries(ResumeEntry *entries, long *capacity,
+                                 uint32_t id);
+
+// Write the state resumed into a new journal, which replaces the old one
+void compact_checkpoint(WorkerPool *pool, ResumeEntry *entries,
+                        long capacity);
+
+// Write the metrics of all workers into the metrics file on SIGUSR1 until
+// the crawl is done
+void *run_metrics_writer(void *arg);
+
+// Write the metrics of all workers into the metrics file
+void write_metrics(WorkerPool *pool);
+
+// Write the trace events of all workers at an interval until the crawl is
+// done
+void *run_trace_writer(void *arg);
+
+// Report the performance counters of all workers
+void report_perf_counters(WorkerPool *pool, FILE *fp);
+
+// Print a line of the statistics of the crawl at an interval until it is
+// done
+void *run_stats_reporter(void *arg);
+
+// Send the statistics of the crawl to the clients of the stats socket until
+// it is done
+void *run_stats_server(void *arg);
+
+// Collect the statistics of the crawl from the workers
+void collect_crawl_stats(WorkerPool *pool, CrawlStats *stats);
+
+// Write the result of a completed fetch (unless the results are plain)
+void write_fetch_result(Worker *worker, FetchResult *result);
+
+// Write the URLs in the fetched list as plain results, sorted if required
+void write_visited_urls(WorkerPool *pool, bool isSorted);
+
+// Write the results buffered out at an interval until the crawl is done
+void *run_result_flusher(void *arg);
+
+// Pin the thread of a worker to a core
+void pin_worker(Worker *worker);
+
+// Compare two URLs by their hostname and filepath (for qsort)
+int compare_url_order(const void *a, const void *b);
+
+
+// ============================================================================
+// == | Module Functions
+// ============================================================================
+/**
+ * @brief  Create a new pool of crawl workers. There are no more workers
+ *         than the maximum requests in flight, which are shared evenly (the
+ *         workers never take more than the maximum in total).
+ *         If the crawl is sharded, each worker has its own set of URLs seen
+ *         and DNS cache, and the frontiers are connected with mailboxes
+ *
+ * @param  config     the crawler configuration
+ * @param  dnsCache   the DNS cache shared by the workers
+ * @return            the pointer of new worker pool
+ */
+WorkerPool *new_WorkerPool(CrawlConfig *config, DnsCache *dnsCache) {
+
+    assert(config != NULL);
+    assert(dnsCache != NULL);
+
+    WorkerPool *pool = (WorkerPool *)malloc(sizeof *pool);
+    if (pool == NULL) {
+        fprintf(stderr, "Error: new_WorkerPool() malloc returned NULL\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Each worker takes at least one of the requests in flight
+    int num_workers = config->num_workers;
+    if (num_workers > config->max_inflight) {
+        num_workers = config->max_inflight;
+    }
+    CrawlConfig worker_config = *config;
+
+    pool->workers = (Worker *)calloc(num_workers, sizeof *pool->workers);
+    if (pool->workers == NULL) {
+        fprintf(stderr, "Error: new_WorkerPool() calloc returned NULL\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Initalise value of the worker pool
+    pool->num_workers     = num_workers;
+    pool->seenSet         = new_urlSet();
+    pool->dnsCache        = dnsCache;
+    pool->limiter         = new_HostLimiter(config->host_delay_ms,
+                                            config->max_per_host);
+    pool->filter_save     = config->filter_save;
+    pool->visitedList     = new_Visited();
+    pool->num_visited     = 0;
+    pool->num_idle        = 0;
+    pool->isDone          = false;
+    pool->sort_output     = config->sort_output;
+    pool->sharded         = config->sharded && num_workers > 1;
+    pool->max_pages       = config->max_pages;
+    pool->max_retries     = config->max_retries;
+    pool->retry_base_ms   = config->retry_base_ms;
+    pool->in_transit      = 0;
+    pool->checkpoint      = NULL;
+    pool->checkpoint_path = config->checkpoint;
+    pool->checkpoint_ms   = config->checkpoint_ms;
+    pool->isResumed       = false;
+    pool->resumed_records = 0;
+    pool->resumed_visited = 0;
+    pool->resumed_pending = 0;
+    pool->resume_ms       = 0;
+    pool->metrics_path    = config->metrics;
+    pool->trace           = NULL;
+    pool->stats_ms        = config->stats_interval_ms;
+    pool->stats_socket    = config->stats_socket;
+    pool->statsfd         = -1;
+    pool->writer          = new_ResultWriter(config->output,
+                                             config->output_format);
+    pool->output_format   = config->output_format;
+    pool->flush_ms        = config->flush_ms;
+    pool->start_ms        = 0;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->idle_cond, NULL);
+    init_visited_filter(pool, config);
+    if (config->trace != NULL) {
+        pool->trace = new_Trace(config->trace, num_workers,
+                                config->trace_events);
+    }
+
+    for (int i = 0; i < num_workers; i++) {
+        Worker *worker = &pool->workers[i];
+
+        worker->pool     = pool;
+        worker->index    = i;
+        worker->rng      = (uint64_t)time(NULL) * (i + 1) | 1;
+        worker->seenSet  = pool->seenSet;
+        worker->dnsCache = dnsCache;
+        if (pool->sharded) {
+            worker->seenSet  = new_urlSet();
+            worker->dnsCache = new_DnsCache(config->dns_cache_size,
+                                            config->dns_ttl_s * 1000,
+                                            config->dns_negative_ttl_s * 1000);
+            if (pool->filter != NULL) {
+                urlSet_use_filter(worker->seenSet, pool->filter, pool->store);
+            }
+        }
+        worker->frontier = new_Frontier(worker->dnsCache, worker->seenSet,
+                                        pool->limiter);
+
+        // Split the requests in flight exactly, the first workers take one
+        // more of the remainder
+        worker_config.max_inflight = config->max_inflight / num_workers;
+        if (i < config->max_inflight % num_workers) {
+            worker_config.max_inflight++;
+        }
+        worker->engine   = new_FetchEngine(&worker_config, worker->dnsCache);
+        worker->metrics  = NULL;
+        if (config->metrics != NULL) {
+            worker->metrics = new_CrawlMetrics();
+            worker->frontier->metrics = worker->metrics;
+            fetch_engine_use_metrics(worker->engine, worker->metrics);
+        }
+        worker->traceRing = NULL;
+        if (pool->trace != NULL) {
+            worker->traceRing = get_trace_ring(pool->trace, i);
+            worker->frontier->traceRing = worker->traceRing;
+            fetch_engine_use_trace(worker->engine, worker->traceRing);
+        }
+        worker->perf = NULL;
+        if (config->perf_stages) {
+            worker->perf = new_PerfCounters();
+            worker->frontier->perf = worker->perf;
+            fetch_engine_use_perf(worker->engine, worker->perf);
+        }
+        if (config->spill_dir != NULL) {
+            enable_Frontier_spill(worker->frontier, config->spill_dir, i,
+                                  config->spill_high, config->spill_low);
+        }
+    }
+
+    if (pool->sharded) {
+        Frontier **frontiers = (Frontier **)malloc(num_workers 
+                                                   * sizeof(Frontier *));
+        if (frontiers == NULL) {
+            fprintf(stderr, "Error: new_WorkerPool() malloc returned "
+                            "NULL\n");
+            exit(EXIT_FAILURE);
+        }
+        for (int i = 0; i < num_workers; i++) {
+            frontiers[i] = pool->workers[i].frontier;
+        }
+        connect_Frontier_shards(frontiers, num_workers, &pool->in_transit);
+        free(frontiers);
+    }
+
+    // Choose the byte scanning kernels before the threads share them
+    init_byte_scan();
+
+    return pool;
+}
+
+
+/**
+ * @brief  Destroy and free the memory associated with a worker pool
+ *         (the DNS cache is not owned by the pool)
+ *
+ * @param  pool   a worker pool
+ */
+void free_WorkerPool(WorkerPool *pool) {
+
+    assert(pool != NULL);
+
+    for (int i = 0; i < pool->num_workers; i++) {
+        Worker *worker = &pool->workers[i];
+
+        free_Frontier(worker->frontier);
+        free_FetchEngine(worker->engine);
+        if (worker->metrics != NULL) {
+            free_CrawlMetrics(worker->metrics);
+        }
+        if (worker->perf != NULL) {
+            free_PerfCounters(worker->perf);
+        }
+        if (pool->sharded) {
+            free_urlSet(worker->seenSet);
+            free_DnsCache(worker->dnsCache);
+        }
+    }
+    free(pool->workers);
+    pool->workers = NULL;
+
+    free_dlist(pool->visitedList);
+    free_urlSet(pool->seenSet);
+    free_HostLimiter(pool->limiter);
+    if (pool->filter != NULL) {
+        free_BloomFilter(pool->filter);
+    }
+    if (pool->store != NULL) {
+        free_HashStore(pool->store);
+    }
+    if (pool->checkpoint != NULL) {
+        free_Checkpoint(pool->checkpoint);
+    }
+    if (pool->trace != NULL) {
+        free_Trace(pool->trace);
+    }
+    free_ResultWriter(pool->writer);
+    pool->filter      = NULL;
+    pool->store       = NULL;
+    pool->checkpoint  = NULL;
+    pool->trace       = NULL;
+    pool->writer      = NULL;
+    pool->visitedList = NULL;
+    pool->seenSet     = NULL;
+    pool->limiter     = NULL;
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->idle_cond);
+
+    free(pool);
+    pool = NULL;
+}
+
+
+/**
+ * @brief  Resume the crawl kept in the checkpoint journal, if there is one:
+ *         replay its records in order, so the URLs fetched are in the list
+ *         of fetched URLs (and the set of URLs seen), the URLs found or
+ *         requeued but not fetched since are in the frontiers, and the hosts
+ *         backing off are restored. The journal is then compacted
+ *
+ * @param  pool   a worker pool
+ */
+void resume_WorkerPool(WorkerPool *pool) {
+
+    CheckpointRecord record;
+    long capacity = 0;
+
+    assert(pool != NULL);
+    assert(pool->checkpoint_path != NULL);
+
+    long long start = get_monotonic_ms();
+
+    CheckpointReader *reader = open_CheckpointReader(pool->checkpoint_path);
+    if (reader == NULL) {
+        // There is no crawl to resume if there is no journal yet
+        if (access(pool->checkpoint_path, F_OK) == SUCCESS) {
+            fprintf(stderr, "Error: resume_WorkerPool() cannot read the "
+                            "checkpoint %s\n", pool->checkpoint_path);
+            exit(EXIT_FAILURE);
+        }
+        return;
+    }
+
+    // The URLs replayed are interned in a set of their own, to find the
+    // state of each URL by its id
+    UrlSet *replayed = new_urlSet();
+    ResumeEntry *entries = grow_resume_entries(NULL, &capacity, 0);
+
+    while (read_checkpoint_record(reader, &record)) {
+        UrlInfo *url = record.url;
+
+        pool->resumed_records++;
+        if (record.type == CHECKPOINT_HOST) {
+            restore_host_limiter_state(pool->limiter, url->hostname,
+                                       record.delay_ms, record.failures,
+                                       record.pauses, start);
+            free_urlInfo(url);
+            continue;
+        }
+
+        uint32_t id = urlSet_intern(replayed, url);
+        url->id = URL_ID_NONE;
+        entries = grow_resume_entries(entries, &capacity, id);
+        ResumeEntry *entry = &entries[id];
+
+        if (record.type == CHECKPOINT_VISITED) {
+            // The URL is fetched, and will not be fetched again
+            if (entry->url != NULL) {
+                free_urlInfo(entry->url);
+                entry->url = NULL;
+            }
+            entry->isVisited = true;
+
+            int shard = 0;
+            if (pool->sharded) {
+                shard = (int)(hash_url_key(url) % pool->num_workers);
+            }
+            insert_new_Visit(pool->visitedList,
+                             pool->workers[shard].frontier, url);
+        } else if (record.type == CHECKPOINT_REQUEUED) {
+            // The URL will be fetched again (as it is requeued last)
+            if (entry->url != NULL) {
+                free_urlInfo(entry->url);
+            }
+            entry->url = url;
+        } else if (!entry->isVisited && entry->url == NULL) {
+            // The URL found will be fetched
+            entry->url = url;
+        } else {
+            free_urlInfo(url);
+        }
+    }
+
+    close_CheckpointReader(reader);
+    free_urlSet(replayed);
+
+    pool->num_visited     = get_dlist_size(pool->visitedList);
+    pool->resumed_visited = pool->num_visited;
+    compact_checkpoint(pool, entries, capacity);
+
+    // The URLs will be fetched are spread over the workers (or go to their
+    // shard)
+    for (long i = 0; i < capacity; i++) {
+        UrlInfo *url = entries[i].url;
+        if (url == NULL) {
+            continue;
+        }
+
+        int shard = pool->resumed_pending % pool->num_workers;
+        if (pool->sharded) {
+            shard = (int)(hash_url_key(url) % pool->num_workers);
+        }
+        restore_Wait(pool->workers[shard].frontier, url);
+        pool->resumed_pending++;
+    }
+    free(entries);
+
+    pool->isResumed = true;
+    pool->resume_ms = get_monotonic_ms() - start;
+}
+
+
+/**
+ * @brief  Crawl from the first URL with all workers until no URL is left,
+ *         or the maximum number of URLs are fetched. If the crawl is
+ *         checkpointed, the frontiers record into the journal (appended to
+ *         if the crawl is resumed), and it is written at an interval.
+ *         If the metrics are kept, they are written on SIGUSR1 (which is
+ *         blocked in the threads of the crawl, and waited for by a thread
+ *         of its own), and once the crawl is done. If the crawl is traced,
+ *         the events are written at an interval, and once it is done.
+ *         If the stages are profiled, they are reported once it is done.
+ *         The statistics are printed at an interval and served on a socket
+ *         while it is running, if it is required. The results are written
+ *         as it goes (the URLs fetched before it is resumed first)
+ *
+ * @param  pool   a worker pool
+ * @param  url    the first URL
+ */
+void run_WorkerPool(WorkerPool *pool, UrlInfo *url) {
+
+    assert(pool != NULL);
+    assert(url != NULL);
+
+    pool->start_ms = get_monotonic_ms();
+
+    if (pool->metrics_path != NULL) {
+        // The threads created from here on block SIGUSR1 as well
+        sigset_t set;
+        sigemptyset(&set);
+        sigaddset(&set, SIGUSR1);
+        pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+        if (pthread_create(&pool->metricsWriter, NULL, run_metrics_writer,
+                           pool) != SUCCESS) {
+            fprintf(stderr, "Error: run_WorkerPool() pthread_create "
+                            "failed\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (pool->trace != NULL
+        && pthread_create(&pool->traceWriter, NULL, run_trace_writer,
+                          pool) != SUCCESS) {
+        fprintf(stderr, "Error: run_WorkerPool() pthread_create failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (pool->output_format == FORMAT_PLAIN && !pool->sort_output) {
+        write_visited_urls(pool, false);
+    }
+    if (pool->flush_ms > 0
+        && pthread_create(&pool->flusher, NULL, run_result_flusher,
+                          pool) != SUCCESS) {
+        fprintf(stderr, "Error: run_WorkerPool() pthread_create failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (pool->stats_ms > 0
+        && pthread_create(&pool->statsReporter, NULL, run_stats_reporter,
+                          pool) != SUCCESS) {
+        fprintf(stderr, "Error: run_WorkerPool() pthread_create failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (pool->stats_socket != NULL) {
+        pool->statsfd = open_stats_socket(pool->stats_socket);
+        if (pthread_create(&pool->statsServer, NULL, run_stats_server,
+                           pool) != SUCCESS) {
+            fprintf(stderr, "Error: run_WorkerPool() pthread_create "
+                            "failed\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (pool->checkpoint_path != NULL) {
+        pool->checkpoint = new_Checkpoint(pool->checkpoint_path,
+                                          pool->isResumed);
+        for (int i = 0; i < pool->num_workers; i++) {
+            pool->workers[i].frontier->checkpoint = pool->checkpoint;
+        }
+        if (pthread_create(&pool->checkpointer, NULL, run_checkpointer,
+                           pool) != SUCCESS) {
+            fprintf(stderr, "Error: run_WorkerPool() pthread_create "
+                            "failed\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // The first worker (or the shard of the first URL) starts with it
+    int first = 0;
+    if (pool->sharded) {
+        first = (int)(hash_url_key(url) % pool->num_workers);
+    }
+    insert_new_Wait(pool->workers[first].frontier, url);
+
+    for (int i = 1; i < pool->num_workers; i++) {
+        if (pthread_create(&pool->workers[i].thread, NULL, run_worker,
+                           &pool->workers[i]) != SUCCESS) {
+            fprintf(stderr, "Error: run_WorkerPool() pthread_create "
+                            "failed\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    run_worker(&pool->workers[0]);
+
+    for (int i = 1; i < pool->num_workers; i++) {
+        pthread_join(pool->workers[i].thread, NULL);
+    }
+
+    // Write the records left, the crawl is done
+    if (pool->checkpoint != NULL) {
+        pthread_join(pool->checkpointer, NULL);
+        save_host_limiter_state(pool->limiter, pool->checkpoint,
+                                get_monotonic_ms());
+        flush_Checkpoint(pool->checkpoint);
+    }
+
+    // Stop the statistics and the flusher, the crawl is done
+    if (pool->flush_ms > 0) {
+        pthread_join(pool->flusher, NULL);
+    }
+    if (pool->stats_ms > 0) {
+        pthread_join(pool->statsReporter, NULL);
+    }
+    if (pool->stats_socket != NULL) {
+        pthread_join(pool->statsServer, NULL);
+        close_stats_socket(pool->statsfd, pool->stats_socket);
+        pool->statsfd = -1;
+    }
+
+    // Write the events left, the crawl is done
+    if (pool->trace != NULL) {
+        pthread_join(pool->traceWriter, NULL);
+        flush_Trace(pool->trace);
+    }
+
+    if (pool->workers[0].perf != NULL) {
+        report_perf_counters(pool, stderr);
+    }
+
+    // Wake up the metrics writer to stop it, and write the final metrics
+    if (pool->metrics_path != NULL) {
+        pthread_kill(pool->metricsWriter, SIGUSR1);
+        pthread_join(pool->metricsWriter, NULL);
+        write_metrics(pool);
+    }
+
+    // Keep the filter, so a later crawl can start with it
+    if (pool->filter_save != NULL
+        && !save_BloomFilter(pool->filter, pool->filter_save)) {
+        fprintf(stderr, "Error: run_WorkerPool() cannot save the filter "
+                        "into %s\n", pool->filter_save);
+    }
+}
+
+
+/**
+ * @brief  Write out the fetched URLs sorted by hostname and filepath if it
+ *         is required (the results are written as they are fetched
+ *         otherwise), and the results buffered
+ *
+ * @param  pool   a worker pool
+ */
+void print_visited_urls(WorkerPool *pool) {
+
+    assert(pool != NULL);
+
+    if (pool->sort_output) {
+        write_visited_urls(pool, true);
+    }
+    flush_ResultWriter(pool->writer);
+}
+
+
+/**
+ * @brief  Print out the statistics of the workers and their fetch engines,
+ *         the latency of the fetches of all workers, the politeness
+ *         statistics, the filter statistics (if there is a filter), the
+ *         checkpoint statistics (if it is checkpointed, and what is
+ *         resumed), and the number of URLs interned and seen. If the crawl
+ *         is sharded, the statistics of the DNS cache and URLs of each
+ *         shard as well
+ *
+ * @param  pool   a worker pool
+ * @param  fp     the file to print into
+ */
+void print_worker_pool_stats(WorkerPool *pool, FILE *fp) {
+
+    assert(pool != NULL);
+
+    for (int i = 0; i < pool->num_workers; i++) {
+        Worker *worker = &pool->workers[i];
+
+        if (pool->sharded) {
+            fprintf(fp, "shard %d: %ld fetched, %ld forwarded, "
+                        "%ld received\n",
+                    i, worker->fetched, worker->forwarded, worker->received);
+        } else if (pool->num_workers > 1) {
+            fprintf(fp, "worker %d: %ld fetched, %ld steals (%ld urls)\n",
+                    i, worker->fetched, worker->steals, worker->stolen_urls);
+        }
+        if (worker->retried > 0 || worker->gave_up > 0) {
+            fprintf(fp, "retries: %ld retried, %ld gave up\n",
+                    worker->retried, worker->gave_up);
+        }
+        print_fetch_engine_stats(worker->engine, fp);
+        if (worker->frontier->spillQueue != NULL) {
+            print_spill_queue_stats(worker->frontier->spillQueue, fp);
+        }
+
+        if (pool->sharded) {
+            print_dns_cache_stats(worker->dnsCache, fp);
+            fprintf(fp, "urls: %d interned, %d seen\n",
+                    get_urlSet_interned(worker->seenSet),
+                    get_urlSet_size(worker->seenSet));
+        }
+    }
+
+    Histogram *latency = new_Histogram();
+    for (int i = 0; i < pool->num_workers; i++) {
+        histogram_merge(latency,
+                        get_fetch_engine_latency(pool->workers[i].engine));
+    }
+    fprintf(fp, "latency: %ld fetches, p50 %.3f ms, p99 %.3f ms, "
+                "max %.3f ms\n",
+            get_histogram_count(latency),
+            get_histogram_percentile(latency, 50) / US_PER_MS,
+            get_histogram_percentile(latency, 99) / US_PER_MS,
+            get_histogram_max(latency) / US_PER_MS);
+    free_Histogram(latency);
+
+    print_host_limiter_stats(pool->limiter, fp);
+    if (pool->filter != NULL) {
+        print_bloom_filter_stats(pool->filter, fp);
+    }
+    if (pool->isResumed) {
+        fprintf(fp, "resume: %ld records, %d fetched, %d pending "
+                    "in %lld ms\n",
+                pool->resumed_records, pool->resumed_visited,
+                pool->resumed_pending, pool->resume_ms);
+    }
+    if (pool->checkpoint != NULL) {
+        print_checkpoint_stats(pool->checkpoint, fp);
+    }
+    if (pool->trace != NULL) {
+        print_trace_stats(pool->trace, fp);
+    }
+    print_result_writer_stats(pool->writer, fp);
+
+    if (pool->sharded) {
+        return;
+    }
+
+    fprintf(fp, "urls: %d interned, %d seen\n",
+            get_urlSet_interned(pool->seenSet),
+            get_urlSet_size(pool->seenSet));
+}
+
+
+// ============================================================================
+// == | Auxillary Functions
+// ============================================================================
+/**
+ * @brief  Crawl with a worker until the crawl is done: start fetching the
+ *         URLs of its frontier while its engine can take more requests,
+ *         and handle the response of each completed fetch
+ *
+ * @param  arg    the worker
+ * @return        NULL
+ */
+void *run_worker(void *arg) {
+
+    Worker *worker     = (Worker *)arg;
+    WorkerPool *pool   = worker->pool;
+    Frontier *frontier = worker->frontier;
+    UrlInfo *url;
+
+    if (pool->sharded) {
+        pin_worker(worker);
+    }
+
+    // The counters count the thread opening them
+    if (worker->perf != NULL) {
+        open_PerfCounters(worker->perf);
+    }
+
+    while (true) {
+
+        // Take the URLs forwarded by the other shards, and hand over the
+        // URLs found for them
+        if (pool->sharded) {
+            worker->received += receive_Found(frontier);
+
+            int num_forwarded = flush_Found(frontier);
+            if (num_forwarded > 0) {
+                worker->forwarded += num_forwarded;
+                notify_idle_workers(pool);
+            }
+        }
+
+        // Start fetching URLs from the URL will be fetched dlist
+        // while the engine can take more requests
+        while ((url = take_next_Wait(frontier, worker->engine)) != NULL) {
+
+            if (!reserve_visit(pool, frontier, url)) {
+                // If the maximum number of URLs are fetched, keep it
+                cancel_Wait(frontier, url);
+                break;
+            }
+
+            // Fetched the URL by sending HTTP request to server
+            fetch_engine_start(worker->engine, url);
+            worker->fetched++;
+        }
+
+        // The time until the host of a URL will be fetched is ready
+        int wait_ms = worker_wait_ms(worker);
+
+        // If there is nothing to wait for, steal URLs from another worker,
+        // or sleep until there are some. If the URLs left are waiting for
+        // their host to be ready, sleep until then instead
+        if (get_fetch_engine_inflight(worker->engine) == 0
+            && get_dlist_size(frontier->resolvingList) == 0) {
+            if (wait_ms >= 0) {
+                worker_sleep(wait_ms);
+                continue;
+            }
+            if (worker_steal(worker) || worker_wait_idle(worker)) {
+                continue;
+            }
+            break;
+        }
+
+        // Wait until one of the fetches is completed, the hostnames of 
+        // some URLs will be fetched are resolved, or a host is ready
+        FetchResult result = fetch_engine_complete(worker->engine, wait_ms);
+        resolve_pending_Wait(frontier);
+
+        // The host of the URL fetched can be fetched again
+        if (result.url != NULL) {
+            finish_Visit(frontier, result.url, result.resp);
+            write_fetch_result(worker, &result);
+        }
+
+        int waitsize = get_waited_size(frontier);
+        handle_fetch_result(worker, &result);
+
+        // Let the idle workers steal the URLs found
+        if (!pool->sharded && get_waited_size(frontier) > waitsize) {
+            notify_idle_workers(pool);
+        }
+    }
+
+    if (worker->perf != NULL) {
+        close_PerfCounters(worker->perf);
+    }
+
+    return NULL;
+}
+
+
+/**
+ * @brief  Handle the response of a completed fetch by its status code
+ *
+ * @param  worker   a worker
+ * @param  result   the result of the completed fetch
+ */
+void handle_fetch_result(Worker *worker, FetchResult *result) {
+
+    Frontier *frontier = worker->frontier;
+    UrlInfo *url       = result->url;
+    ResponseInfo *resp = result->resp;
+
+    // If it is valid and satisfies the handle rules, we will get
+    // response from the server
+    if (result->isHandled) {
+
+        if (resp->status_code == 200) {
+            /** If the status code is 200 OK
+             * Parsing the HTML file of the content to find the URLs
+             * And parsing URLs
+             */
+            bool isTraced = worker->traceRing != NULL;
+            long long parse_us = isTraced ? get_monotonic_us()
+                                          : METRICS_NOW();
+            PerfSample start;
+            perf_stage_begin(worker->perf, &start);
+            parse_html(resp->content, resp->content_len, url, frontier);
+            perf_stage_end(worker->perf, STAGE_PARSE_HTML, &start);
+            perf_count_page(worker->perf, resp->content_len);
+            long long parsed_us = isTraced ? get_monotonic_us()
+                                           : METRICS_NOW();
+            METRICS_PHASE(worker->metrics, PHASE_PARSE_HTML,
+                          parsed_us - parse_us);
+            trace_span(worker->traceRing, TRACE_EXTRACT, url, parse_us,
+                       parsed_us);
+            METRICS_COUNT(worker->metrics, COUNTER_PAGES_PARSED, 1);
+
+            // If the URL is valid and unique(never fetched before),
+            // add to the URL will be fetched list
+            insert_new_Wait(frontier, url);
+
+        } else if (resp->status_code == 503 || resp->status_code == 504) {
+            /** If the status code is 503 Service Unavailable 
+             * (or 504 Gateway Timeout)
+             * Add the URL to the URL will be retried queue
+             * It will be refetching after a delay
+             */
+            retry_later(worker, url, resp);
+
+        } else if (resp->status_code == 301) {
+            /** If the status code is 301 Moved Permanently
+             * Find the redirect link from the response and parsing it
+             */
+            trace_instant(worker->traceRing, TRACE_REDIRECT, url,
+                          resp->status_code);
+            url_will_be_fetched(resp->redirect_loc, resp->redirect_len,
+                                url, frontier);
+
+        } else if (resp->status_code == 401) {
+            /** If the status code is 401 Unauthorized Error
+             * Refetching it
+             * and send the HTTP request with Authorization information
+             */
+            trace_instant(worker->traceRing, TRACE_UNAUTHORIZED, url,
+                          resp->status_code);
+            url->isAuthorization = true;
+            requeue_Wait(frontier, deep_copy_url(url));
+        }
+    }
+
+    // free the memory of responseInfo data
+    if (resp != NULL) {
+        free_ResponseInfo(resp);
+    }
+}
+
+
+/**
+ * @brief  Schedule a URL the server is unavailable for to be fetched again,
+ *         if it has retries left and its host is not down. The delay is the
+ *         base delay doubled for each retry before (up to a maximum), with a
+ *         random jitter of up to half of it so the retries are spread. It
+ *         is at least as long as the server asks with Retry-After, up to
+ *         the same maximum its host is deferred for (MAX_RETRY_AFTER_S)
+ *
+ * @param  worker   a worker
+ * @param  url      the URL the server is unavailable for
+ * @param  resp     its response
+ */
+void retry_later(Worker *worker, UrlInfo *url, ResponseInfo *resp) {
+
+    WorkerPool *pool = worker->pool;
+
+    if (url->retries >= pool->max_retries
+        || host_limiter_is_down(pool->limiter, url->hostname)) {
+        // Give up on it, the server may be down for long
+        trace_instant(worker->traceRing, TRACE_GAVE_UP, url, url->retries);
+        worker->gave_up++;
+        return;
+    }
+
+    long delay = pool->retry_base_ms;
+    for (int i = 0; i < url->retries && delay < MAX_RETRY_DELAY_MS; i++) {
+        delay *= 2;
+    }
+    if (delay > MAX_RETRY_DELAY_MS) {
+        delay = MAX_RETRY_DELAY_MS;
+    }
+
+    // Take off a random jitter of up to half the delay (xorshift)
+    worker->rng ^= worker->rng << 13;
+    worker->rng ^= worker->rng >> 7;
+    worker->rng ^= worker->rng << 17;
+    delay -= (long)(worker->rng % (uint64_t)(delay / 2 + 1));
+
+    long retry_after = get_header_retry_after(&resp->header);
+    if (retry_after > MAX_RETRY_AFTER_S) {
+        retry_after = MAX_RETRY_AFTER_S;
+    }
+    if (retry_after >= 0 && retry_after * MS_PER_S > delay) {
+        delay = retry_after * MS_PER_S;
+    }
+
+    UrlInfo *retryurl = deep_copy_url(url);
+    retryurl->retries++;
+    schedule_Retry(worker->frontier, retryurl, (int)delay);
+    trace_instant(worker->traceRing, TRACE_RETRY, url, delay);
+    worker->retried++;
+}
+
+
+/**
+ * @brief  Add a URL to the list of fetched URLs (and the set of URLs seen),
+ *         if the maximum number of URLs are not fetched yet
+ *
+ * @param  pool       a worker pool
+ * @param  frontier   the frontier of the worker fetching it
+ * @param  url        the URL will be fetched
+ * @return true       If the URL is added and can be fetched
+ * @return false      If the maximum number of URLs are fetched
+ */
+bool reserve_visit(WorkerPool *pool, Frontier *frontier, UrlInfo *url) {
+
+    bool isReserved = false;
+
+    pthread_mutex_lock(&pool->lock);
+
+    if (get_dlist_size(pool->visitedList) < pool->max_pages) {
+        insert_new_Visit(pool->visitedList, frontier, url);
+        __atomic_store_n(&pool->num_visited,
+                         get_dlist_size(pool->visitedList), __ATOMIC_RELAXED);
+        isReserved = true;
+
+        // A plain result is written in the order of the list
+        if (pool->output_format == FORMAT_PLAIN && !pool->sort_output) {
+            FetchRecord record = {url, 0, 0, 0, 0, 0};
+            write_result(pool->writer, &record);
+        }
+    }
+
+    pthread_mutex_unlock(&pool->lock);
+
+    return isReserved;
+}
+
+
+/**
+ * @brief  Steal URLs will be fetched from another worker, trying the
+ *         workers after this one in turn
+ *
+ * @param  worker   an idle worker
+ * @return true     If some URLs are stolen
+ * @return false    If no worker has URLs (or no more URLs will be fetched)
+ */
+bool worker_steal(Worker *worker) {
+
+    WorkerPool *pool = worker->pool;
+
+    // A shard only crawls its own URLs
+    if (pool->sharded) {
+        return false;
+    }
+
+    if (__atomic_load_n(&pool->num_visited, __ATOMIC_RELAXED)
+        >= pool->max_pages) {
+        return false;
+    }
+
+    for (int i = 1; i < pool->num_workers; i++) {
+        Worker *victim = &pool->workers[(worker->index + i)
+                                        % pool->num_workers];
+        int num_stolen = steal_Wait(worker->frontier, victim->frontier);
+
+        if (num_stolen > 0) {
+            worker->steals++;
+            worker->stolen_urls += num_stolen;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/**
+ * @brief  Wait as an idle worker until another worker finds new URLs (or
+ *         for a short time). If all workers are idle (and no URL is in 
+ *         transit between shards), the crawl is done
+ *
+ * @param  worker   an idle worker
+ * @return true     If the worker should look for URLs again
+ * @return false    If the crawl is done
+ */
+bool worker_wait_idle(Worker *worker) {
+
+    WorkerPool *pool = worker->pool;
+    struct timespec deadline;
+
+    pthread_mutex_lock(&pool->lock);
+
+    __atomic_add_fetch(&pool->num_idle, 1, __ATOMIC_RELAXED);
+    if (pool->num_idle == pool->num_workers
+        && __atomic_load_n(&pool->in_transit, __ATOMIC_ACQUIRE) == 0) {
+        // Nobody can find new URLs anymore
+        pool->isDone = true;
+        pthread_cond_broadcast(&pool->idle_cond);
+    }
+
+    if (!pool->isDone) {
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += WORKER_IDLE_WAIT_MS * NS_PER_MS;
+        if (deadline.tv_nsec >= NS_PER_S) {
+            deadline.tv_sec  += 1;
+            deadline.tv_nsec -= NS_PER_S;
+        }
+        pthread_cond_timedwait(&pool->idle_cond, &pool->lock, &deadline);
+    }
+
+    bool isDone = pool->isDone;
+    if (!isDone) {
+        __atomic_sub_fetch(&pool->num_idle, 1, __ATOMIC_RELAXED);
+    }
+
+    pthread_mutex_unlock(&pool->lock);
+
+    return !isDone;
+}
+
+
+/**
+ * @brief  Wake up the idle workers, so they can steal the new URLs
+ *
+ * @param  pool   a worker pool
+ */
+void notify_idle_workers(WorkerPool *pool) {
+
+    if (__atomic_load_n(&pool->num_idle, __ATOMIC_RELAXED) == 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pthread_cond_broadcast(&pool->idle_cond);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+
+/**
+ * @brief  Get the time a worker can wait for its fetches before the host of
+ *         one of its URLs will be fetched is ready
+ *
+ * @param  worker   a worker
+ * @return          the time in milliseconds, or -1 if it can wait until a
+ *                  fetch is completed (no URL can be started anyway)
+ */
+int worker_wait_ms(Worker *worker) {
+
+    WorkerPool *pool = worker->pool;
+
+    if (fetch_engine_is_full(worker->engine)
+        || __atomic_load_n(&pool->num_visited, __ATOMIC_RELAXED)
+           >= pool->max_pages) {
+        return -1;
+    }
+
+    return get_frontier_wait_ms(worker->frontier);
+}
+
+
+/**
+ * @brief  Sleep until a host is ready, for a short time at most, so the URLs
+ *         forwarded or found meanwhile are not left waiting
+ *
+ * @param  wait_ms  the time until a host is ready
+ */
+void worker_sleep(int wait_ms) {
+
+    if (wait_ms > WORKER_IDLE_WAIT_MS) {
+        wait_ms = WORKER_IDLE_WAIT_MS;
+    }
+    if (wait_ms <= 0) {
+        return;
+    }
+
+    struct timespec delay = {0, wait_ms * NS_PER_MS};
+    nanosleep(&delay, NULL);
+}
+
+
+/**
+ * @brief  Create the filter the seen URLs are checked with (loaded from a
+ *         file, or sized for the number of URLs), and the exact store the
+ *         URLs it takes as seen are confirmed with, if they are required.
+ *         The set of URLs seen shared by the workers uses them
+ *
+ * @param  pool     a worker pool
+ * @param  config   the crawler configuration
+ */
+void init_visited_filter(WorkerPool *pool, CrawlConfig *config) {
+
+    pool->filter = NULL;
+    pool->store  = NULL;
+
+    if (config->filter_load != NULL) {
+        pool->filter = load_BloomFilter(config->filter_load);
+        if (pool->filter == NULL) {
+            fprintf(stderr, "Error: init_visited_filter() cannot load the "
+                            "filter from %s\n", config->filter_load);
+            exit(EXIT_FAILURE);
+        }
+    } else if (config->filter_size > 0) {
+        pool->filter = new_BloomFilter(config->filter_size,
+                                       config->filter_fp_rate);
+    } else {
+        return;
+    }
+
+    if (config->filter_confirm != NULL) {
+        // The store of a filter loaded holds the URLs it is saved with
+        if (config->filter_load != NULL) {
+            pool->store = load_HashStore(config->filter_confirm);
+            if (pool->store == NULL) {
+                fprintf(stderr, "Error: init_visited_filter() cannot load "
+                                "the store from %s\n",
+                        config->filter_confirm);
+                exit(EXIT_FAILURE);
+            }
+        } else {
+            pool->store = new_HashStore(config->filter_confirm);
+        }
+    }
+
+    urlSet_use_filter(pool->seenSet, pool->filter, pool->store);
+}
+
+
+/**
+ * @brief  Write the checkpoint journal (and the state of the hosts backing
+ *         off) at an interval, until the crawl is done. The thread sleeps on
+ *         the idle condition, so it wakes up once the crawl is done
+ *
+ * @param  arg    the worker pool
+ * @return        NULL
+ */
+void *run_checkpointer(void *arg) {
+
+    WorkerPool *pool = (WorkerPool *)arg;
+
+    pthread_mutex_lock(&pool->lock);
+
+    while (wait_pool_interval(pool, pool->checkpoint_ms)) {
+        // The journal is written without the lock of the pool
+        pthread_mutex_unlock(&pool->lock);
+        save_host_limiter_state(pool->limiter, pool->checkpoint,
+                                get_monotonic_ms());
+        flush_Checkpoint(pool->checkpoint);
+        pthread_mutex_lock(&pool->lock);
+    }
+
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+
+/**
+ * @brief  Wait for an interval on the idle condition, with the lock of the
+ *         pool held. The workers wake up the idle condition as well, so it
+ *         keeps sleeping until the interval passes or the crawl is done
+ *
+ * @param  pool           a worker pool
+ * @param  interval_ms    the interval
+ * @return true           If the interval passes
+ * @return false          If the crawl is done
+ */
+bool wait_pool_interval(WorkerPool *pool, int interval_ms) {
+
+    struct timespec deadline;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec  += interval_ms / MS_PER_S;
+    deadline.tv_nsec += (interval_ms % MS_PER_S) * NS_PER_MS;
+    if (deadline.tv_nsec >= NS_PER_S) {
+        deadline.tv_sec  += 1;
+        deadline.tv_nsec -= NS_PER_S;
+    }
+
+    while (!pool->isDone
+           && pthread_cond_timedwait(&pool->idle_cond, &pool->lock,
+                                     &deadline) != ETIMEDOUT) {
+    }
+
+    return !pool->isDone;
+}
+
+
+/**
+ * @brief  Grow the states of the URLs replayed (doubling them) to hold the
+ *         given id, the new states are empty
+ *
+ * @param  entries    the states of the URLs replayed, or NULL
+ * @param  capacity   the number of states, will be updated
+ * @param  id         the id of a URL replayed
+ * @return            the states of the URLs replayed
+ */
+ResumeEntry *grow_resume_entries(ResumeEntry *entries, long *capacity,
+                                 uint32_t id) {
+
+    if (entries != NULL && id < *capacity) {
+        return entries;
+    }
+
+    long new_capacity = (*capacity > 0) ? *capacity : RESUME_INIT_ENTRIES;
+    while (id >= new_capacity) {
+        new_capacity *= 2;
+    }
+
+    entries = (ResumeEntry *)realloc(entries,
+                                     new_capacity * sizeof(ResumeEntry));
+    if (entries == NULL) {
+        fprintf(stderr, "Error: grow_resume_entries() realloc returned "
+                        "NULL\n");
+        exit(EXIT_FAILURE);
+    }
+    memset(entries + *capacity, 0,
+           (new_capacity - *capacity) * sizeof(ResumeEntry));
+    *capacity = new_capacity;
+
+    return entries;
+}
+
+
+/**
+ * @brief  Write the state resumed into a new journal: the URLs fetched (in
+ *         the order they are fetched), the URLs will be fetched, and the
+ *         hosts backing off. It is synced and then replaces the old journal,
+ *         so a crash meanwhile keeps one of them
+ *
+ * @param  pool       a worker pool
+ * @param  entries    the states of the URLs replayed
+ * @param  capacity   the number of states
+ */
+void compact_checkpoint(WorkerPool *pool, ResumeEntry *entries,
+                        long capacity) {
+
+    char path[PATH_MAX];
+
+    snprintf(path, PATH_MAX, "%s%s", pool->checkpoint_path,
+             COMPACT_SUFFIX);
+    Checkpoint *compacted = new_Checkpoint(path, false);
+
+    // Walk the list once, moving each URL from its start to its end
+    int size = get_dlist_size(pool->visitedList);
+    for (int i = 0; i < size; i++) {
+        UrlInfo *url = dlist_remove_start(pool->visitedList);
+        dlist_add_end(pool->visitedList, url);
+        checkpoint_visited(compacted, url);
+    }
+
+    for (long i = 0; i < capacity; i++) {
+        if (entries[i].url != NULL) {
+            checkpoint_requeued(compacted, entries[i].url);
+        }
+    }
+
+    save_host_limiter_state(pool->limiter, compacted, get_monotonic_ms());
+    free_Checkpoint(compacted);
+
+    if (rename(path, pool->checkpoint_path) != SUCCESS) {
+        fprintf(stderr, "Error: compact_checkpoint() cannot replace %s\n",
+                pool->checkpoint_path);
+        exit(EXIT_FAILURE);
+    }
+}
+
+
+/**
+ * @brief  Write the metrics of all workers into the metrics file each time
+ *         SIGUSR1 is received, until the crawl is done (then it is woken
+ *         up with SIGUSR1 to stop)
+ *
+ * @param  arg    the worker pool
+ * @return        NULL
+ */
+void *run_metrics_writer(void *arg) {
+
+    WorkerPool *pool = (WorkerPool *)arg;
+    sigset_t set;
+    int sig;
+
+    sigemptyset(&set);
+    sigaddset(&set, SIGUSR1);
+
+    while (sigwait(&set, &sig) == SUCCESS) {
+        pthread_mutex_lock(&pool->lock);
+        bool isDone = pool->isDone;
+        pthread_mutex_unlock(&pool->lock);
+
+        if (isDone) {
+            break;
+        }
+        write_metrics(pool);
+    }
+
+    return NULL;
+}
+
+
+/**
+ * @brief  Write the trace events of all workers into the trace file at an
+ *         interval, until the crawl is done (the events left are written
+ *         once the workers are stopped)
+ *
+ * @param  arg    the worker pool
+ * @return        NULL
+ */
+void *run_trace_writer(void *arg) {
+
+    WorkerPool *pool = (WorkerPool *)arg;
+
+    pthread_mutex_lock(&pool->lock);
+
+    while (wait_pool_interval(pool, TRACE_FLUSH_MS)) {
+        // The events are written without the lock of the pool
+        pthread_mutex_unlock(&pool->lock);
+        flush_Trace(pool->trace);
+        pthread_mutex_lock(&pool->lock);
+    }
+
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+
+/**
+ * @brief  Write the metrics of all workers (merged, while the workers may
+ *         be recording into them) as JSON into the metrics file, or stderr
+ *         if it is "-". The file is written again each time
+ *
+ * @param  pool   a worker pool
+ */
+void write_metrics(WorkerPool *pool) {
+
+    CrawlMetrics *metrics = new_CrawlMetrics();
+    bool isStderr = strcmp(pool->metrics_path, "-") == SUCCESS;
+
+    for (int i = 0; i < pool->num_workers; i++) {
+        metrics_merge(metrics, pool->workers[i].metrics);
+    }
+
+    FILE *fp = isStderr ? stderr : fopen(pool->metrics_path, "w");
+    if (fp == NULL) {
+        perror(pool->metrics_path);
+        free_CrawlMetrics(metrics);
+        return;
+    }
+
+    print_metrics_json(metrics, get_monotonic_ms() - pool->start_ms, fp);
+
+    if (!isStderr) {
+        fclose(fp);
+    }
+    free_CrawlMetrics(metrics);
+}
+
+
+/**
+ * @brief  Report the performance counters of all workers (merged, once the
+ *         workers are stopped)
+ *
+ * @param  pool   a worker pool
+ * @param  fp     the file to print into
+ */
+void report_perf_counters(WorkerPool *pool, FILE *fp) {
+
+    PerfCounters *perf = new_PerfCounters();
+
+    for (int i = 0; i < pool->num_workers; i++) {
+        perf_counters_merge(perf, pool->workers[i].perf);
+    }
+    print_perf_report(perf, fp);
+
+    free_PerfCounters(perf);
+}
+
+
+/**
+ * @brief  Print a line of the statistics of the crawl to stderr at an
+ *         interval, and a last one once the crawl is done
+ *
+ * @param  arg    the worker pool
+ * @return        NULL
+ */
+void *run_stats_reporter(void *arg) {
+
+    WorkerPool *pool = (WorkerPool *)arg;
+    CrawlStats last  = {0};
+    CrawlStats stats;
+
+    pthread_mutex_lock(&pool->lock);
+
+    while (wait_pool_interval(pool, pool->stats_ms)) {
+        // The statistics are collected without the lock of the pool
+        pthread_mutex_unlock(&pool->lock);
+        collect_crawl_stats(pool, &stats);
+        print_stats_line(&stats, &last, stderr);
+        last = stats;
+        pthread_mutex_lock(&pool->lock);
+    }
+
+    pthread_mutex_unlock(&pool->lock);
+
+    collect_crawl_stats(pool, &stats);
+    print_stats_line(&stats, &last, stderr);
+
+    return NULL;
+}
+
+
+/**
+ * @brief  Send the statistics of the crawl as JSON to each client of the
+ *         stats socket, until the crawl is done. The socket is polled for
+ *         a short time, so the thread sees the crawl is done
+ *
+ * @param  arg    the worker pool
+ * @return        NULL
+ */
+void *run_stats_server(void *arg) {
+
+    WorkerPool *pool = (WorkerPool *)arg;
+    struct pollfd pfd;
+    CrawlStats stats;
+
+    pfd.fd     = pool->statsfd;
+    pfd.events = POLLIN;
+
+    while (true) {
+        pthread_mutex_lock(&pool->lock);
+        bool isDone = pool->isDone;
+        pthread_mutex_unlock(&pool->lock);
+
+        if (isDone) {
+            break;
+        }
+        if (poll(&pfd, 1, STATS_POLL_MS) <= 0) {
+            continue;
+        }
+
+        int clientfd = accept4(pool->statsfd, NULL, NULL, SOCK_CLOEXEC);
+        if (clientfd >= 0) {
+            collect_crawl_stats(pool, &stats);
+            send_stats_json(clientfd, &stats);
+        }
+    }
+
+    return NULL;
+}
+
+
+/**
+ * @brief  Collect the statistics of the crawl from the workers while they
+ *         are crawling: the pages fetched and the bytes received, the URLs
+ *         in their frontiers, their fetches in flight, the URLs waiting to
+ *         be retried, the lookups of the DNS caches, and the resident memory
+ *
+ * @param  pool   a worker pool
+ * @param  stats  the statistics, will be updated
+ */
+void collect_crawl_stats(WorkerPool *pool, CrawlStats *stats) {
+
+    memset(stats, 0, sizeof *stats);
+
+    pthread_mutex_lock(&pool->lock);
+    stats->pages = pool->num_visited;
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < pool->num_workers; i++) {
+        Worker *worker = &pool->workers[i];
+
+        stats->bytes_received += get_fetch_engine_bytes(worker->engine);
+        stats->frontier       += get_frontier_size(worker->frontier);
+        stats->inflight       += get_fetch_engine_inflight(worker->engine);
+        stats->retrying       += get_retrying_size(worker->frontier);
+
+        // Each shard has a DNS cache of its own
+        if (pool->sharded || i == 0) {
+            long hits, misses;
+            get_dns_cache_lookups(worker->dnsCache, &hits, &misses);
+            stats->dns_hits   += hits;
+            stats->dns_misses += misses;
+        }
+    }
+
+    stats->elapsed_ms = get_monotonic_ms() - pool->start_ms;
+    stats->rss_bytes  = get_rss_bytes();
+}
+
+
+/**
+ * @brief  Write the result of a completed fetch: its status code, the bytes
+ *         received, and when it is started and how long it takes. The plain
+ *         results are written as the URLs are added to the fetched list
+ *
+ * @param  worker   a worker
+ * @param  result   the result of the completed fetch
+ */
+void write_fetch_result(Worker *worker, FetchResult *result) {
+
+    WorkerPool *pool = worker->pool;
+
+    if (pool->output_format == FORMAT_PLAIN) {
+        return;
+    }
+
+    FetchRecord record;
+    record.url         = result->url;
+    record.status_code = (result->resp != NULL)
+                       ? result->resp->status_code : 0;
+    record.bytes       = result->bytes;
+    record.start_ms    = result->start_us / 1000 - pool->start_ms;
+    record.elapsed_us  = result->elapsed_us;
+    record.worker      = worker->index;
+
+    write_result(pool->writer, &record);
+}
+
+
+/**
+ * @brief  Write the URLs in the fetched list as plain results, in the order
+ *         they are fetched, or sorted by hostname and filepath
+ *
+ * @param  pool       a worker pool
+ * @param  isSorted   if the URLs are sorted
+ */
+void write_visited_urls(WorkerPool *pool, bool isSorted) {
+
+    int size = get_dlist_size(pool->visitedList);
+    if (size == 0) {
+        return;
+    }
+
+    UrlInfo **urls = (UrlInfo **)malloc(size * sizeof(UrlInfo *));
+    if (urls == NULL) {
+        fprintf(stderr, "Error: write_visited_urls() malloc returned NULL\n");
+        exit(EXIT_FAILURE);
+    }
+    // Walk the list once, moving each URL from its start to its end
+    for (int i = 0; i < size; i++) {
+        urls[i] = dlist_remove_start(pool->visitedList);
+        dlist_add_end(pool->visitedList, urls[i]);
+    }
+
+    if (isSorted) {
+        qsort(urls, size, sizeof(UrlInfo *), compare_url_order);
+    }
+
+    for (int i = 0; i < size; i++) {
+        FetchRecord record = {urls[i], 0, 0, 0, 0, 0};
+        write_result(pool->writer, &record);
+    }
+
+    free(urls);
+}
+
+
+/**
+ * @brief  Write the results buffered out at an interval, until the crawl is
+ *         done (the results left are written once they are printed out)
+ *
+ * @param  arg    the worker pool
+ * @return        NULL
+ */
+void *run_result_flusher(void *arg) {
+
+    WorkerPool *pool = (WorkerPool *)arg;
+
+    pthread_mutex_lock(&pool->lock);
+
+    while (wait_pool_interval(pool, pool->flush_ms)) {
+        // The results are written without the lock of the pool
+        pthread_mutex_unlock(&pool->lock);
+        flush_ResultWriter(pool->writer);
+        pthread_mutex_lock(&pool->lock);
+    }
+
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+
+/**
+ * @brief  Pin the thread of a worker to a core, the workers are spread
+ *         over the cores online in turn
+ *
+ * @param  worker   a worker
+ */
+void pin_worker(Worker *worker) {
+
+    long num_cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if (num_cores < 1) {
+        return;
+    }
+
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(worker->index % num_cores, &cpuset);
+
+    // Keep running unpinned if the core is not allowed
+    pthread_setaffinity_np(pthread_self(), sizeof cpuset, &cpuset);
+}
+
+
+/**
+ * @brief  Compare two URLs by their hostname, then their filepath
+ *         (for qsort)
+ *
+ * @param  a      a pointer to a UrlInfo data
+ * @param  b      a pointer to another UrlInfo data
+ * @return        negative, zero or positive as a is before, same or after b
+ */
+int compare_url_order(const void *a, const void *b) {
+
+    UrlInfo *url_a = *(UrlInfo **)a;
+    UrlInfo *url_b = *(UrlInfo **)b;
+
+    int order = strcmp(url_a->hostname, url_b->hostname);
+    if (order != SUCCESS) {
+        return order;
+    }
+
+    return strcmp(url_a->filepath, url_b->filepath);
+}
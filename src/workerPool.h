@@ -0,0 +1,61 @@
+/**
+ * @file      workerPool.h
+ * @author    Erya Wen (eryaw@student.unimelb.edu.au)
+ * @brief     Crawl worker pool module. It includes
+ *              1. creating and destroying a pool of crawl worker threads
+ *              2. crawling from the first URL with all workers until no
+ *                 URL is left or the maximum number of URLs are fetched
+ *              3. printing out the fetched URLs and the crawl statistics
+ *              4. keeping a checkpoint journal of the crawl, and resuming
+ *                 the crawl kept in it
+ *            Each worker has its own frontier and fetch engine, and handles
+ *            the responses of its own fetches. An idle worker steals URLs
+ *            from the frontier of another worker. The set of URLs seen,
+ *            the DNS cache and the list of fetched URLs are shared, unless
+ *            the crawl is sharded: then each worker is pinned to a core, has
+ *            its own set and DNS cache, and forwards the URLs of the other
+ *            shards to them instead of stealing
+ *
+ * @copyright created for COMP30023 Computer System 2020
+ *
+ */
+
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include "crawlConfig.h"
+#include "dnsCache.h"
+#include "urlInfo.h"
+
+#include <stdio.h>
+
+
+// ============================================================================
+// == | Data Type Definitions
+// ============================================================================
+typedef struct worker_pool WorkerPool;
+
+
+// ============================================================================
+// == | Module Functions
+// ============================================================================
+// Create a new pool of crawl workers
+WorkerPool *new_WorkerPool(CrawlConfig *config, DnsCache *dnsCache);
+
+// Destroy a pool of crawl workers and free its memory (except the DNS cache)
+void free_WorkerPool(WorkerPool *pool);
+
+// Resume the crawl kept in the checkpoint journal, if there is one
+void resume_WorkerPool(WorkerPool *pool);
+
+// Crawl from the first URL with all workers until the crawl is done
+void run_WorkerPool(WorkerPool *pool, UrlInfo *url);
+
+// Write out the fetched URLs not written yet (sorted), and flush the results
+void print_visited_urls(WorkerPool *pool);
+
+// Print out the statistics of the workers
+void print_worker_pool_stats(WorkerPool *pool, FILE *fp);
+
+
+#endif